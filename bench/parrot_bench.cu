@@ -0,0 +1,1093 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES.
+ * All rights reserved. SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// parrot_bench: runs the pipelines of examples/thrust and examples/real_world
+// at sizes from 1K to 1G elements next to hand-written Thrust/CUB versions,
+// and reports time, achieved bandwidth, kernel launches and allocations.
+//
+//   parrot_bench [--filter NAME] [--min-size N] [--max-size N]
+//                [--json FILE] [--kp DIR]
+//
+// --json writes every measurement (default parrot_bench.json). --kp writes
+// DIR/nsys_results/{parrot,thrust}_cuda_gpu_kern_sum.csv, which
+// `scripts/kp/kp DIR --plot-only` plots side by side.
+
+#ifndef PARROT_ENABLE_COUNTERS
+#define PARROT_ENABLE_COUNTERS
+#endif
+
+#include <thrust/binary_search.h>
+#include <thrust/copy.h>
+#include <thrust/extrema.h>
+#include <thrust/for_each.h>
+#include <thrust/gather.h>
+#include <thrust/inner_product.h>
+#include <thrust/iterator/constant_iterator.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/iterator/discard_iterator.h>
+#include <thrust/iterator/permutation_iterator.h>
+#include <thrust/iterator/reverse_iterator.h>
+#include <thrust/iterator/transform_iterator.h>
+#include <thrust/iterator/zip_iterator.h>
+#include <thrust/random.h>
+#include <thrust/reduce.h>
+#include <thrust/scan.h>
+#include <thrust/sequence.h>
+#include <thrust/sort.h>
+#include <thrust/tabulate.h>
+#include <thrust/transform.h>
+#include <thrust/transform_reduce.h>
+#include <thrust/zip_function.h>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "parrot.hpp"
+
+// The real-world pipelines are benchmarked straight from the examples
+#include "examples/real_world/aresdb_expand/expand.cu"
+#include "examples/real_world/fastllm_topk/topk.cu"
+#include "examples/real_world/paddle_paddle_mode/mode.h"
+
+namespace bench {
+
+// ----------------------------------------------------------------------------
+// Harness
+// ----------------------------------------------------------------------------
+
+// Work enqueued by one repetition of a pipeline
+using runner = std::function<void()>;
+
+// Both implementations of a case over the same inputs
+struct variants {
+    runner parrot;
+    runner thrust;
+    double bytes = 0;  // Compulsory traffic: inputs read, outputs written once
+};
+
+struct bench_case {
+    std::string name;
+    std::function<variants(int)> setup;
+};
+
+struct measurement {
+    double time_ns = 0;
+    int reps       = 0;
+    thrustx::activity_counters activity;  // Of a single repetition
+};
+
+// Baselines share parrot's stream and memory resource, and their thrust
+// dispatches are counted by the same hooks
+inline auto policy() { return parrot::detail::policy(); }
+inline auto blocking_policy() { return parrot::detail::blocking_policy(); }
+
+template <typename T>
+auto buffer(std::size_t n) {
+    return parrot::detail::make_buffer<T>(n);
+}
+
+// Evaluates a lazy parrot expression into out with a single kernel
+template <typename Expr, typename Buffer>
+void store(const Expr &expr, const Buffer &out) {
+    thrust::copy(policy(), expr.begin(), expr.end(), out->begin());
+}
+
+inline void synchronize() {
+    parrot::detail::throw_on_cuda_error(
+      cudaStreamSynchronize(parrot::detail::current_stream()), "bench");
+}
+
+// Times a pipeline over enough repetitions for about 50 ms of device work
+inline auto measure(const runner &run) -> measurement {
+    run();  // Warm up the pool and the kernels
+    synchronize();
+
+    measurement result;
+    auto &activity    = thrustx::detail::activity();
+    auto const before = activity;
+    auto const start  = std::chrono::steady_clock::now();
+    run();
+    synchronize();
+    std::chrono::duration<double> const once =
+      std::chrono::steady_clock::now() - start;
+    result.activity = activity;
+    result.activity -= before;
+    result.reps = std::clamp(
+      static_cast<int>(0.05 / std::max(once.count(), 1e-9)), 1, 100);
+
+    auto const stream = parrot::detail::current_stream();
+    cudaEvent_t begin_event = nullptr;
+    cudaEvent_t end_event   = nullptr;
+    cudaEventCreate(&begin_event);
+    cudaEventCreate(&end_event);
+    cudaEventRecord(begin_event, stream);
+    for (int r = 0; r < result.reps; ++r) { run(); }
+    cudaEventRecord(end_event, stream);
+    cudaEventSynchronize(end_event);
+    float ms = 0;
+    cudaEventElapsedTime(&ms, begin_event, end_event);
+    cudaEventDestroy(begin_event);
+    cudaEventDestroy(end_event);
+    result.time_ns = static_cast<double>(ms) * 1e6 / result.reps;
+    return result;
+}
+
+// Theoretical DRAM bandwidth of the current device in GB/s
+inline auto peak_gbps() -> double {
+    int device    = 0;
+    int clock_khz = 0;
+    int bus_bits  = 0;
+    cudaGetDevice(&device);
+    cudaDeviceGetAttribute(&clock_khz, cudaDevAttrMemoryClockRate, device);
+    cudaDeviceGetAttribute(&bus_bits, cudaDevAttrGlobalMemoryBusWidth, device);
+    return 2.0 * clock_khz * 1e3 * (bus_bits / 8.0) / 1e9;  // Double data rate
+}
+
+// ----------------------------------------------------------------------------
+// Thrust baselines
+// ----------------------------------------------------------------------------
+// Functors in the style of the original Thrust examples
+
+struct saxpy_functor {
+    float a;
+    __host__ __device__ auto operator()(float x, float y) const -> float {
+        return a * x + y;
+    }
+};
+
+struct fma_functor {
+    template <typename Tuple>
+    __host__ __device__ void operator()(Tuple t) const {
+        thrust::get<3>(t) = thrust::get<0>(t) +
+                            thrust::get<1>(t) * thrust::get<2>(t);
+    }
+};
+
+struct bbox {
+    float lo_x, lo_y, hi_x, hi_y;
+};
+
+struct bbox_point {
+    __host__ __device__ auto operator()(thrust::tuple<float, float> p) const
+      -> bbox {
+        auto const x = thrust::get<0>(p);
+        auto const y = thrust::get<1>(p);
+        return {x, y, x, y};
+    }
+};
+
+struct bbox_union {
+    __host__ __device__ auto operator()(const bbox &a, const bbox &b) const
+      -> bbox {
+        return {fminf(a.lo_x, b.lo_x),
+                fminf(a.lo_y, b.lo_y),
+                fmaxf(a.hi_x, b.hi_x),
+                fmaxf(a.hi_y, b.hi_y)};
+    }
+};
+
+struct row_of {
+    int cols;
+    __host__ __device__ auto operator()(int i) const -> int { return i / cols; }
+};
+
+struct product {
+    __host__ __device__ auto operator()(thrust::tuple<float, float> t) const
+      -> float {
+        return thrust::get<0>(t) * thrust::get<1>(t);
+    }
+};
+
+struct abs_diff {
+    __host__ __device__ auto operator()(thrust::tuple<float, float> t) const
+      -> float {
+        return fabsf(thrust::get<1>(t) - thrust::get<0>(t));
+    }
+};
+
+template <typename T>
+struct minmax_unary {
+    __host__ __device__ auto operator()(const T &x) const
+      -> thrust::pair<T, T> {
+        return {x, x};
+    }
+};
+
+template <typename T>
+struct minmax_binary {
+    __host__ __device__ auto operator()(const thrust::pair<T, T> &a,
+                                        const thrust::pair<T, T> &b) const
+      -> thrust::pair<T, T> {
+        return {thrust::min(a.first, b.first),
+                thrust::max(a.second, b.second)};
+    }
+};
+
+struct in_circle {
+    __host__ __device__ auto operator()(float x, float y) const -> bool {
+        return x * x + y * y <= 1;
+    }
+};
+
+struct monte_carlo_sample {
+    __host__ __device__ auto operator()(unsigned int i) const -> int {
+        // Hash the index to decorrelate the per-sample seeds
+        i = (i ^ 61) ^ (i >> 16);
+        i *= 9;
+        i = i ^ (i >> 4);
+        i *= 0x27d4eb2d;
+        i = i ^ (i >> 15);
+        thrust::default_random_engine rng(i);
+        thrust::uniform_real_distribution<float> u(0.F, 1.F);
+        float const x = u(rng);
+        float const y = u(rng);
+        return x * x + y * y <= 1.F ? 1 : 0;
+    }
+};
+
+struct square {
+    __host__ __device__ auto operator()(float x) const -> float {
+        return x * x;
+    }
+};
+
+// Minmax over the valid (first `width`) columns of a padded grid
+struct padded_minmax {
+    int pitch;
+    int width;
+    __host__ __device__ auto operator()(thrust::tuple<int, float> t) const
+      -> thrust::pair<float, float> {
+        if (thrust::get<0>(t) % pitch >= width) { return {FLT_MAX, -FLT_MAX}; }
+        return {thrust::get<1>(t), thrust::get<1>(t)};
+    }
+};
+
+struct run_letter {
+    __host__ __device__ auto operator()(int i) const -> char {
+        return static_cast<char>('a' + (i / 8) % 26);
+    }
+};
+
+struct moving_average {
+    const int *sums;
+    int window;
+    __host__ __device__ auto operator()(int i) const -> double {
+        int const before = i > 0 ? sums[i - 1] : 0;
+        return (sums[i + window - 1] - before) / static_cast<double>(window);
+    }
+};
+
+struct transpose_index {
+    int rows;
+    int cols;
+    __host__ __device__ auto operator()(int i) const -> int {
+        return (i % rows) * cols + i / rows;
+    }
+};
+
+struct clamp_1_5 {
+    __host__ __device__ auto operator()(int x) const -> int {
+        return thrust::min(thrust::max(x, 1), 5);
+    }
+};
+
+struct adjacent_count {
+    const int *base;
+    __host__ __device__ auto operator()(int idx) const -> int {
+        return base[idx + 1] - base[idx];
+    }
+};
+
+struct at_most {
+    int cap;
+    __host__ __device__ auto operator()(int x) const -> int {
+        return thrust::min(x, cap);
+    }
+};
+
+// ----------------------------------------------------------------------------
+// Cases: examples/thrust
+// ----------------------------------------------------------------------------
+
+inline auto arbitrary_transformation(int n) -> variants {
+    auto a   = parrot::random::integers(n, 1, 0, 9);
+    auto b   = parrot::random::integers(n, 2, 0, 9);
+    auto c   = parrot::random::integers(n, 3, 0, 9);
+    auto out = buffer<int>(n);
+    return {[=] { store(b * c + a, out); },
+            [=] {
+                auto first = thrust::make_zip_iterator(
+                  a.begin(), b.begin(), c.begin(), out->begin());
+                thrust::for_each(policy(), first, first + n, fma_functor{});
+            },
+            16.0 * n};
+}
+
+inline auto basic_vector(int n) -> variants {
+    auto x   = parrot::random::integers(n, 4, 0, 99);
+    auto out = buffer<int>(n / 2);
+    return {[=] { store(x.take(n / 2), out); },
+            [=] { thrust::copy_n(policy(), x.begin(), n / 2, out->begin()); },
+            8.0 * (n / 2)};
+}
+
+inline auto bounding_box(int n) -> variants {
+    int const m = n / 2;  // Points, stored as a row of x and a row of y
+    auto points = parrot::random::uniform(2 * m, 5).reshape({2, m});
+    return {[=] {
+                [[maybe_unused]] auto const lo = points.minr<2>().to_host();
+                [[maybe_unused]] auto const hi = points.maxr<2>().to_host();
+            },
+            [=] {
+                auto first = thrust::make_zip_iterator(points.begin(),
+                                                       points.begin() + m);
+                [[maybe_unused]] auto const box = thrust::transform_reduce(
+                  blocking_policy(),
+                  first,
+                  first + m,
+                  bbox_point{},
+                  bbox{FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX},
+                  bbox_union{});
+            },
+            8.0 * m};
+}
+
+inline auto constant_iterator(int n) -> variants {
+    auto data = parrot::random::integers(n, 6, 0, 99);
+    auto out  = buffer<int>(n);
+    return {[=] { store(data.add(10), out); },
+            [=] {
+                thrust::transform(policy(),
+                                  data.begin(),
+                                  data.end(),
+                                  thrust::make_constant_iterator(10),
+                                  out->begin(),
+                                  thrust::plus<int>());
+            },
+            8.0 * n};
+}
+
+inline auto counting_iterator(int n) -> variants {
+    auto stencil = parrot::random::integers(n, 7, 0, 1);
+    auto out     = buffer<int>(n);
+    return {[=] {
+                auto kept = parrot::range(n).minus(1).keep(stencil).apply();
+            },
+            [=] {
+                thrust::copy_if(blocking_policy(),
+                                thrust::make_counting_iterator(0),
+                                thrust::make_counting_iterator(n),
+                                stencil.begin(),
+                                out->begin(),
+                                cuda::std::identity{});
+            },
+            6.0 * n};
+}
+
+inline auto dot_products_with_zip(int n) -> variants {
+    int const m = n / 3;  // Columns of the two 3 x m matrices
+    auto a      = parrot::random::uniform(3 * m, 8).reshape({3, m});
+    auto b      = parrot::random::uniform(3 * m, 9).reshape({3, m});
+    auto sums   = buffer<float>(3);
+    return {[=] { auto dots = a.times(b).sum<2>(); },
+            [=] {
+                auto keys = thrust::make_transform_iterator(
+                  thrust::make_counting_iterator(0), row_of{m});
+                auto products = thrust::make_transform_iterator(
+                  thrust::make_zip_iterator(a.begin(), b.begin()), product{});
+                thrust::reduce_by_key(blocking_policy(),
+                                      keys,
+                                      keys + 3 * m,
+                                      products,
+                                      thrust::make_discard_iterator(),
+                                      sums->begin());
+            },
+            24.0 * m};
+}
+
+inline auto max_abs_diff(int n) -> variants {
+    auto a = parrot::random::uniform(n, 10);
+    auto b = parrot::random::uniform(n, 11);
+    return {[=] {
+                [[maybe_unused]] auto const diff =
+                  (b - a).abs().maxr().value();
+            },
+            [=] {
+                auto first = thrust::make_zip_iterator(a.begin(), b.begin());
+                [[maybe_unused]] auto const diff =
+                  thrust::transform_reduce(blocking_policy(),
+                                           first,
+                                           first + n,
+                                           abs_diff{},
+                                           0.F,
+                                           thrust::maximum<float>());
+            },
+            8.0 * n};
+}
+
+inline auto minmax(int n) -> variants {
+    auto data = parrot::random::integers(n, 12, 10, 99);
+    return {[=] { [[maybe_unused]] auto const range = data.minmax().value(); },
+            [=] {
+                [[maybe_unused]] auto const range = thrust::transform_reduce(
+                  blocking_policy(),
+                  data.begin(),
+                  data.end(),
+                  minmax_unary<int>{},
+                  thrust::make_pair(INT_MAX, INT_MIN),
+                  minmax_binary<int>{});
+            },
+            4.0 * n};
+}
+
+inline auto mode(int n) -> variants {
+    auto data = parrot::random::integers(n, 13, 0, 9);
+    return {[=] {
+                auto const mode =
+                  data.sort().rle().max_by_key(parrot::snd()).value();
+            },
+            [=] {
+                // Thrust's mode example: sort, count runs, reduce by key
+                auto sorted = buffer<int>(n);
+                thrust::copy(
+                  policy(), data.begin(), data.end(), sorted->begin());
+                thrust::sort(policy(), sorted->begin(), sorted->end());
+                int const runs =
+                  thrust::inner_product(blocking_policy(),
+                                        sorted->begin(),
+                                        sorted->end() - 1,
+                                        sorted->begin() + 1,
+                                        1,
+                                        thrust::plus<int>(),
+                                        thrust::not_equal_to<int>());
+                auto keys   = buffer<int>(runs);
+                auto counts = buffer<int>(runs);
+                thrust::reduce_by_key(blocking_policy(),
+                                      sorted->begin(),
+                                      sorted->end(),
+                                      thrust::make_constant_iterator(1),
+                                      keys->begin(),
+                                      counts->begin());
+                auto const most = thrust::max_element(
+                  blocking_policy(), counts->begin(), counts->end());
+                int const mode = (*keys)[most - counts->begin()];
+            },
+            8.0 * n};
+}
+
+inline auto monte_carlo(int n) -> variants {
+    return {[=] {
+                auto x = parrot::scalar(1.F).repeat(n).rand(2024);
+                auto y = parrot::scalar(1.F).repeat(n).rand(2024, n);
+                [[maybe_unused]] auto const inside =
+                  x.sq().add(y.sq()).lte(1).sum().value();
+            },
+            [=] {
+                [[maybe_unused]] auto const inside = thrust::transform_reduce(
+                  blocking_policy(),
+                  thrust::make_counting_iterator(0U),
+                  thrust::make_counting_iterator(static_cast<unsigned int>(n)),
+                  monte_carlo_sample{},
+                  0,
+                  thrust::plus<int>());
+            },
+            0.0};  // Compute bound: no bandwidth figure
+}
+
+inline auto norm(int n) -> variants {
+    auto x = parrot::random::uniform(n, 14);
+    return {[=] {
+                [[maybe_unused]] auto const norm =
+                  x.sq().sum().sqrt().value();
+            },
+            [=] {
+                [[maybe_unused]] auto const norm = std::sqrt(
+                  thrust::transform_reduce(blocking_policy(),
+                                           x.begin(),
+                                           x.end(),
+                                           square{},
+                                           0.F,
+                                           thrust::plus<float>()));
+            },
+            4.0 * n};
+}
+
+inline auto padded_grid_reduction(int n) -> variants {
+    int const rows = n / 16;
+    auto grid      = parrot::random::uniform(rows * 16, 15).reshape({rows, 16});
+    return {[=] {
+                auto mask = parrot::range(16).lt(11).cycle({rows, 16});
+                [[maybe_unused]] auto const range =
+                  grid.keep(mask).minmax().value();
+            },
+            [=] {
+                auto first = thrust::make_zip_iterator(
+                  thrust::make_counting_iterator(0), grid.begin());
+                [[maybe_unused]] auto const range = thrust::transform_reduce(
+                  blocking_policy(),
+                  first,
+                  first + rows * 16,
+                  padded_minmax{16, 10},
+                  thrust::make_pair(FLT_MAX, -FLT_MAX),
+                  minmax_binary<float>{});
+            },
+            4.0 * n};
+}
+
+inline auto permutation_iterator(int n) -> variants {
+    auto source  = parrot::random::uniform(n, 16);
+    auto indices = parrot::random::integers(n, 17, 0, n - 1);
+    return {[=] {
+                [[maybe_unused]] auto const sum =
+                  source.gather(indices).sum().value();
+            },
+            [=] {
+                auto first = thrust::make_permutation_iterator(source.begin(),
+                                                               indices.begin());
+                [[maybe_unused]] auto const sum =
+                  thrust::reduce(blocking_policy(), first, first + n);
+            },
+            8.0 * n};
+}
+
+inline auto remove_points2d(int n) -> variants {
+    auto x     = parrot::random::uniform(n, 18);
+    auto y     = parrot::random::uniform(n, 19);
+    auto out_x = buffer<float>(n);
+    auto out_y = buffer<float>(n);
+    return {[=] {
+                auto const kept = x.pairs(y)
+                                    .filter(thrust::make_zip_function(
+                                      in_circle{}))
+                                    .apply();
+            },
+            [=] {
+                auto first = thrust::make_zip_iterator(x.begin(), y.begin());
+                thrust::copy_if(
+                  blocking_policy(),
+                  first,
+                  first + n,
+                  thrust::make_zip_iterator(out_x->begin(), out_y->begin()),
+                  thrust::make_zip_function(in_circle{}));
+            },
+            8.0 * n * (1.0 + 3.14159265 / 4)};
+}
+
+inline auto run_length_encoding(int n) -> variants {
+    auto data = buffer<char>(n);
+    thrust::tabulate(policy(), data->begin(), data->end(), run_letter{});
+    auto input  = parrot::view(thrust::raw_pointer_cast(data->data()), n, data);
+    auto keys   = buffer<char>(n);
+    auto counts = buffer<int>(n);
+    return {[=] { auto runs = input.rle(); },
+            [=] {
+                thrust::reduce_by_key(blocking_policy(),
+                                      data->begin(),
+                                      data->end(),
+                                      thrust::make_constant_iterator(1),
+                                      keys->begin(),
+                                      counts->begin());
+            },
+            n + 5.0 * (n / 8)};
+}
+
+inline auto saxpy(int n) -> variants {
+    auto x   = parrot::random::uniform(n, 20);
+    auto y   = parrot::random::uniform(n, 21);
+    auto out = buffer<float>(n);
+    return {[=] { store(x.times(2.F).add(y), out); },
+            [=] {
+                thrust::transform(policy(),
+                                  x.begin(),
+                                  x.end(),
+                                  y.begin(),
+                                  out->begin(),
+                                  saxpy_functor{2.F});
+            },
+            12.0 * n};
+}
+
+inline auto simple_moving_average(int n) -> variants {
+    auto data = parrot::random::integers(n, 22, 0, 9);
+    auto out  = buffer<double>(n - 3);
+    return {[=] { store(data.rolling_mean(4), out); },
+            [=] {
+                auto sums = buffer<int>(n);
+                thrust::inclusive_scan(
+                  policy(), data.begin(), data.end(), sums->begin());
+                thrust::tabulate(
+                  policy(),
+                  out->begin(),
+                  out->end(),
+                  moving_average{thrust::raw_pointer_cast(sums->data()), 4});
+            },
+            4.0 * n + 8.0 * (n - 3)};
+}
+
+inline auto sort(int n) -> variants {
+    auto ints = parrot::random::integers(n, 23, 0, INT_MAX - 1);
+    return {[=] { auto sorted = ints.sort(); },
+            [=] {
+                auto sorted = buffer<int>(n);
+                thrust::copy(
+                  policy(), ints.begin(), ints.end(), sorted->begin());
+                thrust::sort(policy(), sorted->begin(), sorted->end());
+            },
+            8.0 * n};
+}
+
+inline auto sort_pairs(int n) -> variants {
+    auto floats = parrot::random::uniform(n, 24, 0.F, 10.F);
+    auto ints   = parrot::random::integers(n, 25, 0, 99);
+    return {[=] { auto sorted = floats.pairs(ints).sort(); },
+            [=] {
+                auto keys   = buffer<float>(n);
+                auto values = buffer<int>(n);
+                thrust::copy(
+                  policy(), floats.begin(), floats.end(), keys->begin());
+                thrust::copy(
+                  policy(), ints.begin(), ints.end(), values->begin());
+                auto first = thrust::make_zip_iterator(keys->begin(),
+                                                       values->begin());
+                thrust::sort(policy(), first, first + n);
+            },
+            16.0 * n};
+}
+
+inline auto sum(int n) -> variants {
+    auto x = parrot::random::uniform(n, 26);
+    return {[=] { [[maybe_unused]] auto const total = x.sum().value(); },
+            [=] {
+                [[maybe_unused]] auto const total = thrust::reduce(
+                  blocking_policy(), x.begin(), x.end(), 0.F);
+            },
+            4.0 * n};
+}
+
+inline auto sum_rows(int n) -> variants {
+    int const cols = 1024;
+    int const rows = std::max(n / cols, 1);
+    auto matrix    = parrot::random::uniform(rows * cols, 27)
+                    .reshape({rows, cols});
+    auto sums = buffer<float>(rows);
+    return {[=] { auto row_sums = matrix.sum<2>(); },
+            [=] {
+                auto keys = thrust::make_transform_iterator(
+                  thrust::make_counting_iterator(0), row_of{cols});
+                thrust::reduce_by_key(blocking_policy(),
+                                      keys,
+                                      keys + rows * cols,
+                                      matrix.begin(),
+                                      thrust::make_discard_iterator(),
+                                      sums->begin());
+            },
+            4.0 * rows * cols};
+}
+
+inline auto summed_area_table(int n) -> variants {
+    int const side = 1 << (static_cast<int>(std::log2(n)) / 2);
+    int const size = side * side;
+    auto m = parrot::random::integers(size, 28, 0, 9).reshape({side, side});
+    return {[=] { auto table = m.sums<2>().sums<1>(); },
+            [=] {
+                // Scan rows, transpose, scan rows again, transpose back
+                auto keys = thrust::make_transform_iterator(
+                  thrust::make_counting_iterator(0), row_of{side});
+                auto scanned    = buffer<int>(size);
+                auto transposed = buffer<int>(size);
+                auto transpose  = thrust::make_transform_iterator(
+                  thrust::make_counting_iterator(0),
+                  transpose_index{side, side});
+                thrust::inclusive_scan_by_key(policy(),
+                                              keys,
+                                              keys + size,
+                                              m.begin(),
+                                              scanned->begin());
+                thrust::gather(policy(),
+                               transpose,
+                               transpose + size,
+                               scanned->begin(),
+                               transposed->begin());
+                thrust::inclusive_scan_by_key(policy(),
+                                              keys,
+                                              keys + size,
+                                              transposed->begin(),
+                                              transposed->begin());
+                thrust::gather(policy(),
+                               transpose,
+                               transpose + size,
+                               transposed->begin(),
+                               scanned->begin());
+            },
+            8.0 * size};
+}
+
+inline auto transform_iterator(int n) -> variants {
+    auto values = parrot::random::integers(n, 29, 0, 9);
+    return {[=] {
+                [[maybe_unused]] auto const total =
+                  values.max(1).min(5).sum().value();
+            },
+            [=] {
+                [[maybe_unused]] auto const total =
+                  thrust::transform_reduce(blocking_policy(),
+                                           values.begin(),
+                                           values.end(),
+                                           clamp_1_5{},
+                                           0,
+                                           thrust::plus<int>());
+            },
+            4.0 * n};
+}
+
+// ----------------------------------------------------------------------------
+// Cases: examples/real_world
+// ----------------------------------------------------------------------------
+
+inline auto aresdb_expand(int n) -> variants {
+    // Cumulative counts of 0-3 rows per dimension value, capped at n rows
+    auto base     = parrot::random::integers(n, 30, 0, 3).prepend(0).sums();
+    auto indices  = parrot::random::integers(n, 31, 0, n - 1);
+    auto keys     = parrot::random::integers(n, 32, 0, INT_MAX - 1);
+    int const cap = n;
+    return {[=] { auto expanded = expand_parrot(keys, base, indices, cap); },
+            [=] {
+                auto offsets = buffer<int>(n);
+                thrust::transform(
+                  policy(),
+                  indices.begin(),
+                  indices.end(),
+                  offsets->begin(),
+                  adjacent_count{thrust::raw_pointer_cast(&*base.begin())});
+                thrust::inclusive_scan(
+                  policy(), offsets->begin(), offsets->end(), offsets->begin());
+                thrust::transform(policy(),
+                                  offsets->begin(),
+                                  offsets->end(),
+                                  offsets->begin(),
+                                  at_most{cap});
+                int const total = (*offsets)[n - 1];
+                auto sources    = buffer<int>(total);
+                auto expanded   = buffer<int>(total);
+                thrust::upper_bound(policy(),
+                                    offsets->begin(),
+                                    offsets->end(),
+                                    thrust::make_counting_iterator(0),
+                                    thrust::make_counting_iterator(total),
+                                    sources->begin());
+                thrust::gather(policy(),
+                               sources->begin(),
+                               sources->end(),
+                               keys.begin(),
+                               expanded->begin());
+            },
+            20.0 * n};
+}
+
+inline auto fastllm_topk(int n) -> variants {
+    auto logits = parrot::random::uniform(n, 33);
+    int const k = std::min(50, n);
+    return {[=] { auto best = topk(logits, k); },
+            [=] {
+                auto values  = buffer<float>(n);
+                auto indices = buffer<int>(n);
+                thrust::copy(
+                  policy(), logits.begin(), logits.end(), values->begin());
+                thrust::sequence(policy(), indices->begin(), indices->end());
+                thrust::sort_by_key(policy(),
+                                    values->begin(),
+                                    values->end(),
+                                    indices->begin(),
+                                    thrust::greater<float>());
+            },
+            4.0 * n};
+}
+
+inline auto paddle_mode(int n) -> variants {
+    int const rows = 16;
+    int const cols = n / rows;
+    auto data = parrot::random::integers(rows * cols, 34, 0, 9)
+                  .reshape({rows, cols});
+    return {[=] { auto modes = GetModeBySort_Parrot(data, rows, cols); },
+            [=] {
+                // Paddle's GetModeBySort: one sort and count per row
+                std::vector<thrust::pair<int, int>> results;
+                auto sorted = buffer<int>(cols);
+                auto keys   = buffer<int>(cols);
+                auto counts = buffer<int>(cols);
+                for (int r = 0; r < rows; ++r) {
+                    auto row = data.begin() + r * cols;
+                    thrust::copy(policy(), row, row + cols, sorted->begin());
+                    thrust::sort(policy(), sorted->begin(), sorted->end());
+                    auto ends = thrust::reduce_by_key(
+                      blocking_policy(),
+                      sorted->begin(),
+                      sorted->end(),
+                      thrust::make_constant_iterator(1),
+                      keys->begin(),
+                      counts->begin());
+                    auto const most = thrust::max_element(
+                      blocking_policy(), counts->begin(), ends.second);
+                    int const mode = (*keys)[most - counts->begin()];
+                    auto last = thrust::find(blocking_policy(),
+                                             thrust::make_reverse_iterator(
+                                               row + cols),
+                                             thrust::make_reverse_iterator(row),
+                                             mode);
+                    int const index =
+                      cols - 1 -
+                      static_cast<int>(
+                        last - thrust::make_reverse_iterator(row + cols));
+                    results.emplace_back(mode, index);
+                }
+            },
+            4.0 * rows * cols};
+}
+
+inline auto cases() -> std::vector<bench_case> {
+    return {
+      {"thrust/arbitrary_transformation", arbitrary_transformation},
+      {"thrust/basic_vector", basic_vector},
+      {"thrust/bounding_box", bounding_box},
+      {"thrust/constant_iterator", constant_iterator},
+      {"thrust/counting_iterator", counting_iterator},
+      {"thrust/dot_products_with_zip", dot_products_with_zip},
+      {"thrust/max_abs_diff", max_abs_diff},
+      {"thrust/minmax", minmax},
+      {"thrust/mode", mode},
+      {"thrust/monte_carlo", monte_carlo},
+      {"thrust/norm", norm},
+      {"thrust/padded_grid_reduction", padded_grid_reduction},
+      {"thrust/permutation_iterator", permutation_iterator},
+      {"thrust/remove_points2d", remove_points2d},
+      {"thrust/run_length_encoding", run_length_encoding},
+      {"thrust/saxpy", saxpy},
+      {"thrust/simple_moving_average", simple_moving_average},
+      {"thrust/sort", sort},
+      {"thrust/sort_pairs", sort_pairs},
+      {"thrust/sum", sum},
+      {"thrust/sum_rows", sum_rows},
+      {"thrust/summed_area_table", summed_area_table},
+      {"thrust/transform_iterator", transform_iterator},
+      {"real_world/aresdb_expand", aresdb_expand},
+      {"real_world/fastllm_topk", fastllm_topk},
+      {"real_world/paddle_paddle_mode", paddle_mode},
+    };
+}
+
+// ----------------------------------------------------------------------------
+// Reporting
+// ----------------------------------------------------------------------------
+
+struct result {
+    std::string name;
+    int size = 0;
+    double bytes = 0;
+    measurement parrot;
+    measurement thrust;
+    std::string skipped;  // Reason the size could not run, if any
+};
+
+inline auto json_string(const std::string &s) -> std::string {
+    std::string out = "\"";
+    for (char const c : s) {
+        if (c == '"' || c == '\\') { out += '\\'; }
+        out += c == '\n' ? ' ' : c;
+    }
+    return out + "\"";
+}
+
+inline void write_measurement(std::ostream &os,
+                              const measurement &m,
+                              double bytes,
+                              double peak) {
+    double const gbps = m.time_ns > 0 ? bytes / m.time_ns : 0;
+    os << "{\"time_ns\": " << m.time_ns << ", \"reps\": " << m.reps
+       << ", \"gbps\": " << gbps << ", \"peak_fraction\": "
+       << (peak > 0 ? gbps / peak : 0)
+       << ", \"launches\": " << m.activity.launches
+       << ", \"allocations\": " << m.activity.allocations
+       << ", \"allocated_bytes\": " << m.activity.allocated_bytes
+       << ", \"syncs\": " << m.activity.syncs << "}";
+}
+
+inline void write_json(const std::string &path,
+                       const std::vector<result> &results,
+                       const std::string &device,
+                       double peak) {
+    std::ofstream os(path);
+    if (!os) { throw std::runtime_error("parrot_bench: cannot open " + path); }
+    os << "{\n  \"device\": " << json_string(device)
+       << ",\n  \"peak_gbps\": " << peak << ",\n  \"results\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        auto const &r = results[i];
+        os << (i == 0 ? "\n" : ",\n") << "    {\"case\": "
+           << json_string(r.name) << ", \"size\": " << r.size
+           << ", \"bytes\": " << r.bytes;
+        if (!r.skipped.empty()) {
+            os << ", \"skipped\": " << json_string(r.skipped) << "}";
+            continue;
+        }
+        os << ",\n     \"parrot\": ";
+        write_measurement(os, r.parrot, r.bytes, peak);
+        os << ",\n     \"thrust\": ";
+        write_measurement(os, r.thrust, r.bytes, peak);
+        os << "}";
+    }
+    os << "\n  ]\n}\n";
+}
+
+// One CSV per implementation in the layout of nsys' kernel summary
+inline void write_kp(const std::string &dir,
+                     const std::vector<result> &results) {
+    auto const out_dir = std::filesystem::path(dir) / "nsys_results";
+    std::filesystem::create_directories(out_dir);
+    for (bool const is_parrot : {true, false}) {
+        auto const label = is_parrot ? "parrot" : "thrust";
+        std::ofstream os(out_dir /
+                         (std::string(label) + "_cuda_gpu_kern_sum.csv"));
+        os << "\"Name\",\"Total Time (ns)\",\"Instances\"\n";
+        for (auto const &r : results) {
+            if (!r.skipped.empty()) { continue; }
+            auto const &m = is_parrot ? r.parrot : r.thrust;
+            os << '"' << r.name << '[' << r.size << "]\","
+               << std::llround(m.time_ns) << ',' << m.activity.launches
+               << '\n';
+        }
+    }
+}
+
+inline void print_row(const result &r, double peak) {
+    if (!r.skipped.empty()) {
+        std::printf("%-34s %11d  skipped: %s\n",
+                    r.name.c_str(),
+                    r.size,
+                    r.skipped.c_str());
+        return;
+    }
+    auto const gbps = [&](const measurement &m) {
+        return m.time_ns > 0 ? r.bytes / m.time_ns : 0;
+    };
+    std::printf(
+      "%-34s %11d %11.1f %11.1f %7.2fx %8.1f (%3.0f%%) %4zu/%-4zu %4zu/%-4zu\n",
+      r.name.c_str(),
+      r.size,
+      r.parrot.time_ns / 1e3,
+      r.thrust.time_ns / 1e3,
+      r.thrust.time_ns / std::max(r.parrot.time_ns, 1e-9),
+      gbps(r.parrot),
+      peak > 0 ? 100 * gbps(r.parrot) / peak : 0,
+      r.parrot.activity.launches,
+      r.thrust.activity.launches,
+      r.parrot.activity.allocations,
+      r.thrust.activity.allocations);
+}
+
+}  // namespace bench
+
+auto main(int argc, char **argv) -> int {
+    std::string filter;
+    std::string json = "parrot_bench.json";
+    std::string kp_dir;
+    long long min_size = 1LL << 10;
+    long long max_size = 1LL << 30;
+    for (int i = 1; i < argc; ++i) {
+        std::string const arg = argv[i];
+        bool const has_value  = i + 1 < argc;
+        if (arg == "--filter" && has_value) {
+            filter = argv[++i];
+        } else if (arg == "--min-size" && has_value) {
+            min_size = std::stoll(argv[++i]);
+        } else if (arg == "--max-size" && has_value) {
+            max_size = std::stoll(argv[++i]);
+        } else if (arg == "--json" && has_value) {
+            json = argv[++i];
+        } else if (arg == "--kp" && has_value) {
+            kp_dir = argv[++i];
+        } else {
+            std::cerr << "usage: parrot_bench [--filter NAME] [--min-size N] "
+                         "[--max-size N] [--json FILE] [--kp DIR]\n";
+            return 1;
+        }
+    }
+    if (min_size < 1) {
+        std::cerr << "parrot_bench: --min-size must be at least 1\n";
+        return 1;
+    }
+    max_size = std::min(max_size, static_cast<long long>(INT_MAX));
+
+    // Every size starts from an empty pool so earlier cases do not hold
+    // memory the larger ones need
+    parrot::pool_memory_resource pool;
+    auto *previous = parrot::set_memory_resource(&pool);
+
+    cudaDeviceProp prop{};
+    int device = 0;
+    cudaGetDevice(&device);
+    cudaGetDeviceProperties(&prop, device);
+    double const peak = bench::peak_gbps();
+    std::printf("%s, peak %.0f GB/s\n\n", prop.name, peak);
+    std::printf("%-34s %11s %11s %11s %8s %15s %9s %9s\n",
+                "case",
+                "size",
+                "parrot us",
+                "thrust us",
+                "speedup",
+                "parrot GB/s",
+                "launches",
+                "allocs");
+
+    std::vector<bench::result> results;
+    for (auto const &c : bench::cases()) {
+        if (!filter.empty() && c.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        // 1K, 16K, 256K, 4M, 64M, 1G
+        for (long long n = min_size; n <= max_size; n *= 16) {
+            bench::result r;
+            r.name = c.name;
+            r.size = static_cast<int>(n);
+            try {
+                auto const v = c.setup(r.size);
+                r.bytes      = v.bytes;
+                r.parrot     = bench::measure(v.parrot);
+                r.thrust     = bench::measure(v.thrust);
+            } catch (const std::exception &e) {
+                r.skipped = e.what();
+                cudaGetLastError();  // Clear a sticky allocation failure
+            }
+            bench::synchronize();
+            pool.release();
+            bench::print_row(r, peak);
+            results.push_back(std::move(r));
+        }
+    }
+
+    bench::write_json(json, results, prop.name, peak);
+    if (!kp_dir.empty()) { bench::write_kp(kp_dir, results); }
+    parrot::set_memory_resource(previous);
+    return 0;
+}
@@ -2,13 +2,7 @@
 
 using namespace parrot::literals;
 
-auto softmax(auto matrix) {
-    auto cols = matrix.ncols();
-    auto z    = matrix - matrix.maxr(2_ic).replicate(cols);
-    auto num  = z.exp();
-    auto den  = num.sum(2_ic);
-    return num / den.replicate(cols);
-}
+auto softmax(auto matrix) { return matrix.softmax(2_ic); }
 
 int main() {
     auto matrix = parrot::range(6).as<float>().reshape({2, 3});
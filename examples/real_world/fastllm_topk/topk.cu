@@ -19,5 +19,5 @@
 // to 4453
 
 auto topk(auto d_input, int k) {
-    return d_input.enumerate().sort().rev().take(k);
+    return d_input.topk(k);
 }
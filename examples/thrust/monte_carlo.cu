@@ -20,8 +20,9 @@
 
 int main() {
     int N  = 1000000;
-    auto x = parrot::scalar(1.0).repeat(N).rand();
-    auto y = parrot::scalar(1.0).repeat(N).rand();
+    // x and y are consecutive slices of one reproducible stream
+    auto x = parrot::scalar(1.0).repeat(N).rand(2024);
+    auto y = parrot::scalar(1.0).repeat(N).rand(2024, N);
     auto i = x.sq().add(y.sq()).lte(1);
     std::setprecision(3);
     i.sum().div(N).times(4).print();  // 3.142
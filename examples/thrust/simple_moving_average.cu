@@ -19,6 +19,5 @@
 
 int main() {
     auto data = parrot::scalar(10).repeat(30).rand().print();
-    auto sums = data.prepend(0).sums();
-    sums.drop(4).minus(sums.take(27)).div(4.0).reshape({3, 9}).print();
+    data.rolling_mean(4).reshape({3, 9}).print();
 }
\ No newline at end of file
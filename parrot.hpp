@@ -18,10 +18,14 @@
 #ifndef PARROT_HPP
 #define PARROT_HPP
 
+#include <thrust/binary_search.h>
 #include <thrust/copy.h>
 #include <thrust/count.h>
+#include <thrust/device_malloc_allocator.h>
+#include <thrust/device_ptr.h>
 #include <thrust/device_reference.h>
 #include <thrust/device_vector.h>
+#include <thrust/fill.h>
 #include <thrust/functional.h>
 #include <thrust/iterator/constant_iterator.h>
 #include <thrust/iterator/counting_iterator.h>
@@ -29,30 +33,46 @@
 #include <thrust/iterator/permutation_iterator.h>
 #include <thrust/iterator/reverse_iterator.h>
 #include <thrust/iterator/transform_iterator.h>
+#include <thrust/iterator/transform_output_iterator.h>
 #include <thrust/iterator/zip_iterator.h>
+#include <thrust/merge.h>
 #include <thrust/pair.h>
-#include <thrust/random.h>
-#include <thrust/random/uniform_real_distribution.h>
 #include <thrust/reduce.h>
+#include <thrust/scan.h>
+#include <thrust/sequence.h>
 #include <thrust/sort.h>
+#include <thrust/system/cuda/execution_policy.h>
+#include <thrust/transform_reduce.h>
 #include <thrust/tuple.h>
 #include <thrust/zip_function.h>
 #include <algorithm>
 #include <atomic>
+#include <cassert>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
-#include <ctime>
+#include <deque>
+#include <fstream>
+#include <future>
 
 #include <initializer_list>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <random>
+#include <set>
 #include <sstream>
 #include <stdexcept>
+#include <string>
+#include <tuple>
 #include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -62,6 +82,32 @@
 #include "thrust/detail/vector_base.h"
 #include "thrustx.hpp"
 
+#if __has_include(<dlpack/dlpack.h>)
+#include <dlpack/dlpack.h>
+#endif
+
+#ifdef PARROT_ENABLE_CUBLAS
+#include <cublas_v2.h>
+#endif
+
+#ifdef PARROT_ENABLE_CUFILE
+#include <cufile.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef PARROT_ENABLE_NCCL
+#include <nccl.h>
+#endif
+
+#ifdef PARROT_ENABLE_INSTRUMENTATION
+#include <nvtx3/nvToolsExt.h>
+#include <cctype>
+#include <source_location>
+#include <string_view>
+#include <typeinfo>
+#endif
+
 namespace parrot {
 
 namespace literals {
@@ -79,715 +125,2838 @@ constexpr auto operator""_ic() {
 
 }  // namespace literals
 
-// Type trait to extract underlying type from device_reference
-template <typename T>
-struct extract_value_type {
-    using type = T;
-};
-
-template <typename T>
-struct extract_value_type<thrust::device_reference<T>> {
-    using type = T;
-};
+// Type of sizes, shapes and element positions: int, or std::int64_t when
+// PARROT_ENABLE_64BIT_INDEX is defined (see thrustx::index_t)
+using thrustx::index_t;
 
-template <typename T>
-using extract_value_type_t = typename extract_value_type<T>::type;
-
-// Sentinel type to indicate no mask
-struct no_mask_t {};
+// __half, __nv_bfloat16 and fp8 elements are stored narrow and computed on in
+// float; compute_type_t<T> is float for them and T otherwise
+using thrustx::compute_type_t;
+using thrustx::is_reduced_precision_v;
 
-// Forward declaration of fusion_array
-template <typename Iterator, typename MaskIterator = no_mask_t>
-class fusion_array;
+// ============================================================================
+// Memory Management
+// ============================================================================
+// Every eager operation allocates its result (and any thrust/CUB temporaries)
+// through a parrot::memory_resource. The default resource is a caching pool,
+// so steady-state pipelines stop paying for synchronous cudaMalloc/cudaFree.
 
-// Now define the trait since fusion_array is forward declared
-template <typename T>
-struct is_fusion_array : std::false_type {};
+/**
+ * @brief Allocation counters reported by a memory_resource
+ */
+struct memory_stats {
+    std::size_t allocations     = 0;  // Requests served (hits + misses)
+    std::size_t hits            = 0;  // Requests served without upstream
+    std::size_t misses          = 0;  // Requests that reached the upstream
+    std::size_t bytes_in_use    = 0;  // Bytes currently handed out
+    std::size_t high_water_mark = 0;  // Peak value of bytes_in_use
+    std::size_t bytes_cached    = 0;  // Bytes held by the resource but free
+    std::size_t foreign_frees   = 0;  // Deallocations of unknown pointers
 
-// Specialization for fusion_array (both with and without mask)
-template <typename Iterator>
-struct is_fusion_array<fusion_array<Iterator, no_mask_t>> : std::true_type {};
+    /**
+     * @brief Fraction of allocations served from the cache
+     * @return hits / allocations, or 0 if nothing was allocated yet
+     */
+    [[nodiscard]] auto hit_rate() const -> double {
+        return allocations == 0
+                 ? 0.0
+                 : static_cast<double>(hits) / static_cast<double>(allocations);
+    }
+};
 
-template <typename Iterator, typename MaskIterator>
-struct is_fusion_array<fusion_array<Iterator, MaskIterator>> : std::true_type {
+/**
+ * @brief Abstract interface for device memory used by parrot
+ * @details Allocations are stream-ordered: memory deallocated on a stream may
+ * be handed out again to work queued on the same stream without a sync.
+ */
+class memory_resource {
+   public:
+    memory_resource()                                            = default;
+    memory_resource(const memory_resource &)                     = delete;
+    auto operator=(const memory_resource &) -> memory_resource & = delete;
+    virtual ~memory_resource()                                   = default;
+
+    virtual auto allocate(std::size_t bytes, cudaStream_t stream = nullptr)
+      -> void * = 0;
+    virtual void deallocate(void *ptr,
+                            std::size_t bytes,
+                            cudaStream_t stream = nullptr) = 0;
+
+    [[nodiscard]] virtual auto stats() const -> memory_stats = 0;
+    virtual void reset_stats()                               = 0;
 };
 
-// Helper variable template
-template <typename T>
-inline constexpr bool is_fusion_array_v = is_fusion_array<T>::value;
+namespace detail {
+// Activity hooks of the optional instrumentation layer (see
+// parrot::instrumentation); empty unless PARROT_ENABLE_INSTRUMENTATION is set
+using thrustx::detail::count_allocation;
+using thrustx::detail::count_d2h;
+using thrustx::detail::count_launch;
+using thrustx::detail::count_sync;
 
-// Forward declare the range function
-inline auto range(int end) -> fusion_array<thrust::counting_iterator<int>>;
+// Shared bookkeeping for the concrete resources below
+class counted_resource : public memory_resource {
+   public:
+    [[nodiscard]] auto stats() const -> memory_stats override {
+        std::lock_guard<std::mutex> const lock(_mutex);
+        return _stats;
+    }
 
-// Forward declare the stats namespace
-namespace stats {
-template <typename Iterator, typename MaskIterator>
-auto norm_cdf(const fusion_array<Iterator, MaskIterator> &arr);
-}
+    void reset_stats() override {
+        std::lock_guard<std::mutex> const lock(_mutex);
+        _stats.allocations     = 0;
+        _stats.hits            = 0;
+        _stats.misses          = 0;
+        _stats.foreign_frees   = 0;
+        _stats.high_water_mark = _stats.bytes_in_use;
+    }
 
-// Type trait to check if a type is a thrust::pair
-template <typename T>
-struct is_thrust_pair : std::false_type {};
+   protected:
+    // Must be called with _mutex held
+    void _record_allocation(std::size_t bytes, bool hit) {
+        ++_stats.allocations;
+        hit ? ++_stats.hits : ++_stats.misses;
+        _stats.bytes_in_use += bytes;
+        _stats.high_water_mark = std::max(_stats.high_water_mark,
+                                          _stats.bytes_in_use);
+    }
 
-template <typename T1, typename T2>
-struct is_thrust_pair<thrust::pair<T1, T2>> : std::true_type {};
+    // Must be called with _mutex held
+    void _record_deallocation(std::size_t bytes) {
+        _stats.bytes_in_use -= std::min(bytes, _stats.bytes_in_use);
+    }
 
-template <typename T>
-inline constexpr bool is_thrust_pair_v = is_thrust_pair<T>::value;
+    mutable std::mutex _mutex;
+    memory_stats _stats;
+};
 
-// Helper function to check if T is a fusion_array (fallback for older
-// compilers)
-template <typename T>
-constexpr auto is_fusion_array_func() -> bool {
-    return is_fusion_array<T>::value;
+inline void throw_on_cuda_error(cudaError_t status, const char *what) {
+    if (status != cudaSuccess) {
+        throw std::runtime_error(std::string(what) + ": " +
+                                 cudaGetErrorString(status));
+    }
 }
 
-// First element of a pair
-template <typename T, typename U>
-struct fst_functor {
-    __host__ __device__ auto operator()(const thrust::pair<T, U> &p) const
-      -> T {
-        return p.first;
-    }
-};
+inline auto is_capturing(cudaStream_t stream) -> bool {
+    cudaStreamCaptureStatus status = cudaStreamCaptureStatusNone;
+    cudaStreamIsCapturing(stream, &status);
+    return status == cudaStreamCaptureStatusActive;
+}
 
-// Second element of a pair
-template <typename T, typename U>
-struct snd_functor {
-    __host__ __device__ auto operator()(const thrust::pair<T, U> &p) const
-      -> U {
-        return p.second;
+// Host synchronization cannot be recorded into a CUDA graph: fail with a
+// clear message instead of invalidating the capture
+inline void throw_if_capturing(cudaStream_t stream, const char *what) {
+    if (is_capturing(stream)) {
+        throw std::logic_error(std::string(what) +
+                               ": cannot read results back to the host "
+                               "while a graph is being captured");
     }
-};
+}
+}  // namespace detail
 
 /**
- * @brief Function object to extract the first element of a pair
+ * @brief Resource that forwards every request to cudaMalloc/cudaFree
  */
-struct fst {
-    template <typename T, typename U>
-    __host__ __device__ auto operator()(const thrust::pair<T, U> &p) const
-      -> T {
-        return p.first;
+class cuda_memory_resource : public detail::counted_resource {
+   public:
+    auto allocate(std::size_t bytes, cudaStream_t /*stream*/ = nullptr)
+      -> void * override {
+        if (bytes == 0) { return nullptr; }
+        void *ptr = nullptr;
+        if (cudaMalloc(&ptr, bytes) != cudaSuccess) {
+            cudaGetLastError();  // Clear the sticky allocation error
+            throw std::bad_alloc();
+        }
+        std::lock_guard<std::mutex> const lock(_mutex);
+        _record_allocation(bytes, false);
+        return ptr;
+    }
+
+    void deallocate(void *ptr,
+                    std::size_t bytes,
+                    cudaStream_t /*stream*/ = nullptr) override {
+        if (ptr == nullptr) { return; }
+        cudaFree(ptr);
+        std::lock_guard<std::mutex> const lock(_mutex);
+        _record_deallocation(bytes);
     }
 };
 
 /**
- * @brief Function object to extract the second element of a pair
+ * @brief Resource backed by the driver's stream-ordered pool
+ *        (cudaMallocAsync/cudaFreeAsync)
+ * @details The device's default memory pool is configured to keep freed
+ * memory reserved, so repeated allocations are served without returning to
+ * the OS. A request counts as a hit when it did not grow the pool's reserved
+ * memory.
  */
-struct snd {
-    template <typename T, typename U>
-    __host__ __device__ auto operator()(const thrust::pair<T, U> &p) const
-      -> U {
-        return p.second;
+class async_memory_resource : public detail::counted_resource {
+   public:
+    async_memory_resource() {
+        int device = 0;
+        detail::throw_on_cuda_error(cudaGetDevice(&device),
+                                    "async_memory_resource");
+        detail::throw_on_cuda_error(cudaDeviceGetDefaultMemPool(&_pool, device),
+                                    "async_memory_resource");
+        auto threshold = std::numeric_limits<std::uint64_t>::max();
+        cudaMemPoolSetAttribute(
+          _pool, cudaMemPoolAttrReleaseThreshold, &threshold);
+    }
+
+    auto allocate(std::size_t bytes, cudaStream_t stream = nullptr)
+      -> void * override {
+        if (bytes == 0) { return nullptr; }
+        auto const reserved_before = _reserved();
+        void *ptr                  = nullptr;
+        if (cudaMallocFromPoolAsync(&ptr, bytes, _pool, stream) !=
+            cudaSuccess) {
+            cudaGetLastError();
+            throw std::bad_alloc();
+        }
+        bool const hit = _reserved() == reserved_before;
+        std::lock_guard<std::mutex> const lock(_mutex);
+        _record_allocation(bytes, hit);
+        return ptr;
     }
-};
-
-// Function objects for transformations
-template <typename T>
-struct times_functor {
-    T scalar;
 
-    explicit times_functor(T s) : scalar(s) {}
+    void deallocate(void *ptr,
+                    std::size_t bytes,
+                    cudaStream_t stream = nullptr) override {
+        if (ptr == nullptr) { return; }
+        cudaFreeAsync(ptr, stream);
+        std::lock_guard<std::mutex> const lock(_mutex);
+        _record_deallocation(bytes);
+    }
 
-    __host__ __device__ auto operator()(const T &x) const -> T {
-        return x * scalar;
+   private:
+    [[nodiscard]] auto _reserved() const -> std::uint64_t {
+        std::uint64_t reserved = 0;
+        cudaMemPoolGetAttribute(
+          _pool, cudaMemPoolAttrReservedMemCurrent, &reserved);
+        return reserved;
     }
+
+    cudaMemPool_t _pool = nullptr;
 };
 
-template <typename T>
-struct add_functor {
-    T scalar;
+/**
+ * @brief Caching size-class arena on top of an upstream resource
+ * @details Requests are rounded up to a size class (powers of two up to
+ * 1 MiB, then multiples of 1 MiB). Freed blocks are kept per (device, stream,
+ * size class) and reused by later requests on the same stream, which is safe
+ * without synchronization because the stream orders the old and new uses.
+ * Cached memory is returned upstream by release() or when an upstream
+ * allocation fails. Deallocating a pointer the pool did not hand out fails
+ * an assert in debug builds; with NDEBUG the pointer is ignored and counted
+ * in memory_stats::foreign_frees.
+ */
+class pool_memory_resource : public detail::counted_resource {
+   public:
+    explicit pool_memory_resource(memory_resource *upstream = nullptr)
+      : _upstream(upstream) {
+        if (_upstream == nullptr) {
+            _owned_upstream = std::make_unique<cuda_memory_resource>();
+            _upstream       = _owned_upstream.get();
+        }
+    }
 
-    explicit add_functor(T s) : scalar(s) {}
+    ~pool_memory_resource() override { release(); }
+
+    auto allocate(std::size_t bytes, cudaStream_t stream = nullptr)
+      -> void * override {
+        if (bytes == 0) { return nullptr; }
+        auto const cls = size_class(bytes);
+        int device     = 0;
+        cudaGetDevice(&device);
+        block_key const key{device, stream, cls};
+
+        {
+            std::lock_guard<std::mutex> const lock(_mutex);
+            auto it = _free_blocks.find(key);
+            if (it != _free_blocks.end() && !it->second.empty()) {
+                void *ptr = it->second.back();
+                it->second.pop_back();
+                _stats.bytes_cached -= cls;
+                _live_blocks[ptr] = key;
+                _record_allocation(cls, true);
+                return ptr;
+            }
+        }
 
-    __host__ __device__ auto operator()(const T &x) const -> T {
-        return x + scalar;
+        void *ptr = nullptr;
+        try {
+            ptr = _upstream->allocate(cls, stream);
+        } catch (const std::bad_alloc &) {
+            // Give cached memory back to the upstream and retry once
+            release();
+            ptr = _upstream->allocate(cls, stream);
+        }
+
+        std::lock_guard<std::mutex> const lock(_mutex);
+        _live_blocks[ptr] = key;
+        _record_allocation(cls, false);
+        return ptr;
+    }
+
+    void deallocate(void *ptr,
+                    std::size_t /*bytes*/,
+                    cudaStream_t stream = nullptr) override {
+        if (ptr == nullptr) { return; }
+        std::lock_guard<std::mutex> const lock(_mutex);
+        auto it = _live_blocks.find(ptr);
+        if (it == _live_blocks.end()) {
+            // Reached from noexcept destructors, so never throw
+            assert(false && "pointer was not allocated by this pool");
+            ++_stats.foreign_frees;
+            return;
+        }
+        auto key = it->second;
+        _live_blocks.erase(it);
+        // The block becomes reusable by work ordered after this stream point
+        key.stream = stream;
+        _free_blocks[key].push_back(ptr);
+        _stats.bytes_cached += key.size;
+        _record_deallocation(key.size);
     }
-};
 
-// Delta functor for adjacent element differences
-struct delta {
-    template <typename T>
-    __host__ __device__ auto operator()(const T &a,
-                                        const T &b) const -> decltype(b - a) {
-        return b - a;
+    /**
+     * @brief Return all cached (free) blocks to the upstream resource
+     */
+    void release() {
+        std::map<block_key, std::vector<void *>> blocks;
+        {
+            std::lock_guard<std::mutex> const lock(_mutex);
+            blocks.swap(_free_blocks);
+            _stats.bytes_cached = 0;
+        }
+        int current_device = 0;
+        cudaGetDevice(&current_device);
+        for (auto &[key, ptrs] : blocks) {
+            cudaSetDevice(key.device);
+            for (void *ptr : ptrs) {
+                _upstream->deallocate(ptr, key.size, key.stream);
+            }
+        }
+        cudaSetDevice(current_device);
     }
-};
 
-// Min functor for elementwise minimum
-template <typename T>
-struct min_functor {
-    T scalar;
+    /**
+     * @brief Size class a request of the given size is rounded up to
+     * @param bytes The requested size in bytes
+     * @return The number of bytes actually reserved for the request
+     */
+    [[nodiscard]] static auto size_class(std::size_t bytes) -> std::size_t {
+        constexpr std::size_t min_block = 256;
+        constexpr std::size_t large     = std::size_t{1} << 20;
+        if (bytes > large) { return (bytes + large - 1) / large * large; }
+        std::size_t cls = min_block;
+        while (cls < bytes) { cls <<= 1; }
+        return cls;
+    }
 
-    explicit min_functor(T s) : scalar(s) {}
+   private:
+    struct block_key {
+        int device;
+        cudaStream_t stream;
+        std::size_t size;
+
+        auto operator<(const block_key &other) const -> bool {
+            return std::tie(device, stream, size) <
+                   std::tie(other.device, other.stream, other.size);
+        }
+    };
 
-    __host__ __device__ auto operator()(const T &x) const -> T {
-        return x < scalar ? x : scalar;
-    }
+    memory_resource *_upstream;
+    std::unique_ptr<memory_resource> _owned_upstream;
+    std::map<block_key, std::vector<void *>> _free_blocks;
+    std::unordered_map<void *, block_key> _live_blocks;
 };
 
+namespace detail {
+// The process-wide default pool is intentionally leaked: buffers owned by
+// static fusion_arrays may still be released after static destructors run.
+inline auto default_memory_resource() -> memory_resource * {
+    static auto *resource = new pool_memory_resource();  // NOLINT
+    return resource;
+}
+
+inline auto current_memory_resource() -> memory_resource *& {
+    static memory_resource *resource = nullptr;
+    return resource;
+}
+}  // namespace detail
+
 /**
- * @brief Function object for minimum of two values
+ * @brief Get the memory resource used by eager operations
+ * @return The active resource (a pool_memory_resource unless replaced)
  */
-struct min {
-    template <typename T>
-    __host__ __device__ auto operator()(const T &a, const T &b) const
-      -> decltype(a < b ? a : b) {
-        return a < b ? a : b;
-    }
-};
+inline auto get_memory_resource() -> memory_resource * {
+    auto *resource = detail::current_memory_resource();
+    return resource != nullptr ? resource : detail::default_memory_resource();
+}
 
 /**
- * @brief Function object for maximum of two values
+ * @brief Replace the memory resource used by eager operations
+ * @param resource The new resource (nullptr restores the default pool). The
+ * caller keeps ownership and must keep it alive while buffers allocated from
+ * it exist.
+ * @return The previously active resource
  */
-struct max {
-    template <typename T>
-    __host__ __device__ auto operator()(const T &a, const T &b) const
-      -> decltype(a > b ? a : b) {
-        return a > b ? a : b;
-    }
-};
+inline auto set_memory_resource(memory_resource *resource)
+  -> memory_resource * {
+    auto *previous                     = get_memory_resource();
+    detail::current_memory_resource() = resource;
+    return previous;
+}
+
+// ============================================================================
+// Execution Contexts
+// ============================================================================
+// An execution_context pairs a CUDA stream with a memory_resource. Eager
+// operations enqueue their kernels on the active context's stream without
+// synchronizing; the host only waits when it reads a value back.
 
 /**
- * @brief Function object for inequality comparison returning 1 if not equal, 0
- * otherwise
+ * @brief A CUDA stream plus the memory resource used for work queued on it
  */
-struct neq {
-    template <typename T>
-    __host__ __device__ auto operator()(const T &a, const T &b) const -> int {
-        return a != b ? 1 : 0;
+class execution_context {
+   public:
+    /**
+     * @brief Context on the legacy default stream using the active resource
+     */
+    execution_context() = default;
+
+    /**
+     * @brief Context on an existing stream (the caller keeps ownership)
+     * @param stream The stream eager operations are queued on
+     * @param resource The resource for results and temporaries (nullptr uses
+     * get_memory_resource())
+     */
+    explicit execution_context(cudaStream_t stream,
+                               memory_resource *resource = nullptr)
+      : _stream(stream), _resource(resource) {}
+
+    /**
+     * @brief Create a context that owns a new non-blocking stream
+     * @param resource The resource for results and temporaries (nullptr uses
+     * get_memory_resource())
+     * @return A context whose stream is destroyed with its last copy
+     */
+    static auto create(memory_resource *resource = nullptr)
+      -> execution_context {
+        cudaStream_t stream = nullptr;
+        detail::throw_on_cuda_error(
+          cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking),
+          "execution_context::create");
+        execution_context ctx(stream, resource);
+        ctx._owned_stream = stream_handle(
+          stream, [](cudaStream_t s) { cudaStreamDestroy(s); });
+        return ctx;
     }
-};
 
-/**
- * @brief Function object for less-than comparison returning 1 if a < b, 0
- * otherwise
- */
-struct lt {
-    template <typename T>
-    __host__ __device__ auto operator()(const T &a, const T &b) const -> int {
-        return a < b ? 1 : 0;
+    [[nodiscard]] auto stream() const -> cudaStream_t { return _stream; }
+
+    [[nodiscard]] auto resource() const -> memory_resource * {
+        return _resource != nullptr ? _resource : get_memory_resource();
     }
-};
 
-/**
- * @brief Function object for greater-than comparison returning 1 if a > b, 0
- * otherwise
- */
-struct gt {
-    template <typename T>
-    __host__ __device__ auto operator()(const T &a, const T &b) const -> int {
-        return a > b ? 1 : 0;
+    /**
+     * @brief Block the host until all work queued on this context finished
+     */
+    void synchronize() const {
+        detail::throw_if_capturing(_stream, "execution_context::synchronize");
+        detail::count_sync();
+        detail::throw_on_cuda_error(cudaStreamSynchronize(_stream),
+                                    "execution_context::synchronize");
     }
-};
 
-/**
- * @brief Function object for equality comparison returning 1 if equal, 0
- * otherwise
- */
-struct eq {
-    template <typename T>
-    __host__ __device__ auto operator()(const T &a, const T &b) const -> int {
-        return a == b ? 1 : 0;
+    /**
+     * @brief Make future work on this context wait for work queued on
+     * another context so far (no host synchronization)
+     * @param other The context whose pending work must complete first
+     */
+    void wait(const execution_context &other) const {
+        if (other._stream == _stream) { return; }
+        cudaEvent_t event = nullptr;
+        cudaEventCreateWithFlags(&event, cudaEventDisableTiming);
+        cudaEventRecord(event, other._stream);
+        cudaStreamWaitEvent(_stream, event, 0);
+        cudaEventDestroy(event);
     }
+
+   private:
+    using stream_handle = std::shared_ptr<std::remove_pointer_t<cudaStream_t>>;
+
+    cudaStream_t _stream       = nullptr;
+    memory_resource *_resource = nullptr;
+    stream_handle _owned_stream;
 };
 
+namespace detail {
+inline auto active_context() -> const execution_context *& {
+    thread_local const execution_context *ctx = nullptr;
+    return ctx;
+}
+
+// Context inherited by arrays constructed while an op of a bound array runs
+inline auto bound_context() -> std::shared_ptr<const execution_context> & {
+    thread_local std::shared_ptr<const execution_context> ctx;
+    return ctx;
+}
+
+inline auto current_context() -> const execution_context & {
+    static const execution_context default_context;
+    auto const *ctx = active_context();
+    return ctx != nullptr ? *ctx : default_context;
+}
+
+inline auto current_stream() -> cudaStream_t {
+    return current_context().stream();
+}
+}  // namespace detail
+
+namespace instrumentation {
 /**
- * @brief Function object for less-than-or-equal comparison returning 1 if a <=
- * b, 0 otherwise
+ * @brief Totals recorded for one operation name
+ * @details Counts are exclusive: activity of an operation invoked by another
+ * one (e.g. the sort behind value_counts) is attributed to the inner name.
  */
-struct lte {
-    template <typename T>
-    __host__ __device__ auto operator()(const T &a, const T &b) const -> int {
-        return a <= b ? 1 : 0;
+struct op_stats {
+    std::string name;                 // Method name, e.g. "sort" or "scan<2>"
+    std::size_t calls           = 0;  // Times the operation was entered
+    std::size_t launches        = 0;  // Kernels and CUB/thrust dispatches
+    std::size_t allocations     = 0;  // Device allocations
+    std::size_t allocated_bytes = 0;  // Bytes requested by those allocations
+    std::size_t syncs           = 0;  // Host synchronizations
+    std::size_t d2h_transfers   = 0;  // Device-to-host copies
+    std::size_t d2h_bytes       = 0;  // Bytes copied to the host
+    std::uint64_t gpu_time_ns   = 0;  // Stream time between entry and exit
+};
+}  // namespace instrumentation
+
+namespace detail {
+#ifdef PARROT_ENABLE_INSTRUMENTATION
+using call_site = std::source_location;
+
+// Operation name from a member's signature: "sort" for "auto parrot::
+// fusion_array<...>::_sort(bool) const", with the axis of axis-templated
+// members appended ("scan<2>")
+inline auto op_name(std::string_view signature) -> std::string {
+    auto const is_ident = [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) != 0 || c == '_';
+    };
+    std::string name;
+    int depth = 0;
+    for (std::size_t i = 0; i < signature.size() && name.empty(); ++i) {
+        char const c = signature[i];
+        if (c == '<') { ++depth; }
+        if (c == '>') { --depth; }
+        if (c != '(' || depth != 0) { continue; }
+        auto first = i;
+        while (first > 0 && is_ident(signature[first - 1])) { --first; }
+        auto const ident = signature.substr(first, i - first);
+        if (ident == "decltype") {
+            // Skip the return type's decltype(...)
+            int parens = 1;
+            while (parens > 0 && ++i < signature.size()) {
+                if (signature[i] == '(') { ++parens; }
+                if (signature[i] == ')') { --parens; }
+            }
+        } else if (auto const skip = ident.find_first_not_of('_');
+                   skip != std::string_view::npos) {
+            name = std::string(ident.substr(skip));
+        }
     }
+    auto const axis = signature.find("Axis = ");
+    if (axis != std::string_view::npos) {
+        auto const digits = signature.substr(axis + 7);
+        name += "<" +
+                std::string(digits.substr(
+                  0, digits.find_first_not_of("-0123456789"))) +
+                ">";
+    }
+    return name.empty() ? std::string(signature) : name;
+}
+
+// A closed or still running operation whose GPU time is not resolved yet.
+// Records are numbered in the order they were opened.
+struct op_record {
+    std::string name;
+    thrustx::activity_counters activity;  // Exclusive of nested operations
+    cudaEvent_t start = nullptr;
+    cudaEvent_t stop  = nullptr;
+    std::ptrdiff_t parent = -1;     // Number of the enclosing record
+    bool closed           = false;  // The operation has returned
+    std::size_t end       = 0;      // Records opened before it closed
 };
 
-/**
- * @brief Function object for greater-than-or-equal comparison returning 1 if a
- * >= b, 0 otherwise
- */
-struct gte {
-    template <typename T>
-    __host__ __device__ auto operator()(const T &a, const T &b) const -> int {
-        return a >= b ? 1 : 0;
+struct op_registry {
+    std::mutex mutex;
+    std::deque<op_record> pending;
+    std::size_t first = 0;  // Number of pending.front()
+    std::map<std::string, instrumentation::op_stats> totals;
+    // Times each lazy expression (type, iterator bytes, size) was evaluated,
+    // grouped by the storage it reads; groups of released storage are swept
+    struct evaluation_group {
+        std::weak_ptr<void> owner;
+        std::unordered_map<std::string, int> counts;
+    };
+    std::unordered_map<const void *, evaluation_group> evaluations;
+    std::size_t sweep_at = 64;  // Group count that triggers the next sweep
+};
+
+inline auto registry() -> op_registry & {
+    static op_registry instance;
+    return instance;
+}
+
+inline auto elapsed_ms(const op_record &record) -> float {
+    float ms = 0.0F;
+    if (record.stop != nullptr) {
+        cudaEventElapsedTime(&ms, record.start, record.stop);
+    }
+    return ms;
+}
+
+// Folds the oldest pending record into the per-operation totals once it and
+// every record opened while it ran have closed and finished on the GPU, so
+// a long-running process keeps a bounded number of events. Returns whether
+// a record was folded. The caller holds reg.mutex.
+inline auto fold_oldest(op_registry &reg) -> bool {
+    auto &pending = reg.pending;
+    if (pending.empty() || !pending.front().closed) { return false; }
+    auto const span = pending.front().end - reg.first;
+    for (std::size_t i = 0; i < span; ++i) {
+        auto const &record = pending[i];
+        if (!record.closed) { return false; }
+        if (record.stop != nullptr &&
+            cudaEventQuery(record.stop) != cudaSuccess) {
+            return false;
+        }
+    }
+
+    // An op's own time excludes the ops nested directly inside it
+    auto const &record = pending.front();
+    float nested       = 0.0F;
+    for (std::size_t i = 1; i < span; ++i) {
+        if (pending[i].parent == static_cast<std::ptrdiff_t>(reg.first)) {
+            nested += elapsed_ms(pending[i]);
+        }
     }
+    auto &stats = reg.totals[record.name];
+    stats.name  = record.name;
+    ++stats.calls;
+    stats.launches += record.activity.launches;
+    stats.allocations += record.activity.allocations;
+    stats.allocated_bytes += record.activity.allocated_bytes;
+    stats.syncs += record.activity.syncs;
+    stats.d2h_transfers += record.activity.d2h_transfers;
+    stats.d2h_bytes += record.activity.d2h_bytes;
+    auto const own_ms = std::max(0.0F, elapsed_ms(record) - nested);
+    stats.gpu_time_ns += static_cast<std::uint64_t>(
+      std::llround(static_cast<double>(own_ms) * 1e6));
+    if (record.stop != nullptr) {
+        cudaEventDestroy(record.start);
+        cudaEventDestroy(record.stop);
+    }
+    pending.pop_front();
+    ++reg.first;
+    return true;
+}
+
+// Operations currently running on this thread, innermost last
+struct op_frame {
+    std::size_t index;
+    thrustx::activity_counters entry;   // Counters when the op was entered
+    thrustx::activity_counters nested;  // Activity of nested operations
 };
 
-/**
- * @brief Function object for addition
- */
-struct add {
-    template <typename T>
-    __host__ __device__ auto operator()(const T &a,
-                                        const T &b) const -> decltype(a + b) {
-        return a + b;
+inline auto op_stack() -> std::vector<op_frame> & {
+    thread_local std::vector<op_frame> stack;
+    return stack;
+}
+
+// NVTX range, activity counters and stream timing of one eager operation
+class op_scope {
+   public:
+    explicit op_scope(const char *signature) {
+        thread_local std::unordered_map<const char *, std::string> names;
+        auto it = names.find(signature);
+        if (it == names.end()) {
+            it = names.emplace(signature, op_name(signature)).first;
+        }
+        nvtxRangePushA(it->second.c_str());
+
+        // Ops recorded into a graph are traced but not timed
+        op_record record{it->second};
+        if (!is_capturing(current_stream())) {
+            cudaEventCreate(&record.start);
+            cudaEventCreate(&record.stop);
+            cudaEventRecord(record.start, current_stream());
+        }
+        auto &stack = op_stack();
+        if (!stack.empty()) {
+            record.parent = static_cast<std::ptrdiff_t>(stack.back().index);
+        }
+
+        auto &reg = registry();
+        std::lock_guard<std::mutex> const lock(reg.mutex);
+        while (fold_oldest(reg)) {}
+        reg.pending.push_back(std::move(record));
+        stack.push_back({reg.first + reg.pending.size() - 1,
+                         thrustx::detail::activity(),
+                         {}});
+    }
+    op_scope(const op_scope &)                     = delete;
+    auto operator=(const op_scope &) -> op_scope & = delete;
+    ~op_scope() {
+        auto &stack     = op_stack();
+        auto const done = stack.back();
+        stack.pop_back();
+
+        auto inclusive = thrustx::detail::activity();
+        inclusive -= done.entry;
+        if (!stack.empty()) { stack.back().nested += inclusive; }
+        auto exclusive = inclusive;
+        exclusive -= done.nested;
+
+        auto &reg = registry();
+        {
+            std::lock_guard<std::mutex> const lock(reg.mutex);
+            auto &record    = reg.pending[done.index - reg.first];
+            record.activity = exclusive;
+            record.closed   = true;
+            record.end      = reg.first + reg.pending.size();
+            if (record.stop != nullptr) {
+                cudaEventRecord(record.stop, current_stream());
+            }
+        }
+        nvtxRangePop();
     }
 };
+#else
+// Stand-in for std::source_location when instrumentation is compiled out
+struct call_site {
+    static constexpr auto current() -> call_site { return {}; }
+};
+#endif
 
-/**
- * @brief Function object for multiplication
- */
-struct mul {
-    template <typename T>
-    __host__ __device__ auto operator()(const T &a,
-                                        const T &b) const -> decltype(a * b) {
-        return a * b;
+// Makes an array's bound context current for the duration of one of its
+// operations; a null context leaves the thread's context untouched. With
+// instrumentation enabled the operation is also traced under the name of the
+// calling member.
+class bind_scope {
+   public:
+    explicit bind_scope(const std::shared_ptr<const execution_context> &ctx,
+                        [[maybe_unused]] call_site site = call_site::current())
+      : _active(ctx != nullptr) {
+        if (_active) {
+            _previous       = active_context();
+            _previous_bound = std::exchange(bound_context(), ctx);
+            active_context() = ctx.get();
+        }
+#ifdef PARROT_ENABLE_INSTRUMENTATION
+        _op.emplace(site.function_name());
+#endif
+    }
+    bind_scope(const bind_scope &)                     = delete;
+    auto operator=(const bind_scope &) -> bind_scope & = delete;
+    ~bind_scope() {
+#ifdef PARROT_ENABLE_INSTRUMENTATION
+        _op.reset();  // Close the range on the operation's stream
+#endif
+        if (_active) {
+            active_context() = _previous;
+            bound_context()  = std::move(_previous_bound);
+        }
     }
+
+   private:
+    bool _active;
+    const execution_context *_previous = nullptr;
+    std::shared_ptr<const execution_context> _previous_bound;
+#ifdef PARROT_ENABLE_INSTRUMENTATION
+    std::optional<op_scope> _op;
+#endif
 };
+}  // namespace detail
+
+// ============================================================================
+// Instrumentation
+// ============================================================================
+// Compiled in with -DPARROT_ENABLE_INSTRUMENTATION. Every eager operation
+// then opens an NVTX range named after its method, so Nsight Systems shows
+// "sort" or "scan<2>" around the thrust/CUB kernels it launched, and its
+// launches, allocations, syncs and device-to-host copies are tallied.
+
+namespace instrumentation {
 
 /**
- * @brief Function object for division
+ * @brief Per-operation totals recorded since start-up or the last reset()
+ * @return One entry per operation name, sorted by name; empty when
+ * instrumentation is compiled out
+ * @details Waits for the traced work so GPU times are final. Call it while
+ * no parrot operation is running.
  */
-struct div {
-    template <typename T1, typename T2>
-    __host__ __device__ auto operator()(const T1 &a,
-                                        const T2 &b) const -> decltype(a / b) {
-        return a / b;
+inline auto summary() -> std::vector<op_stats> {
+    std::vector<op_stats> result;
+#ifdef PARROT_ENABLE_INSTRUMENTATION
+    auto &reg = detail::registry();
+    std::lock_guard<std::mutex> const lock(reg.mutex);
+    for (auto const &record : reg.pending) {
+        if (record.stop == nullptr) { continue; }  // Captured into a graph
+        cudaEventSynchronize(record.stop);
+    }
+    while (detail::fold_oldest(reg)) {}
+
+    for (auto const &entry : reg.totals) { result.push_back(entry.second); }
+#endif
+    return result;
+}
+
+/**
+ * @brief Discard everything recorded so far
+ * @details Call it while no parrot operation is running.
+ */
+inline void reset() {
+#ifdef PARROT_ENABLE_INSTRUMENTATION
+    auto &reg = detail::registry();
+    std::lock_guard<std::mutex> const lock(reg.mutex);
+    for (auto &record : reg.pending) {
+        if (record.stop == nullptr) { continue; }
+        cudaEventSynchronize(record.stop);
+        cudaEventDestroy(record.start);
+        cudaEventDestroy(record.stop);
+    }
+    reg.first += reg.pending.size();
+    reg.pending.clear();
+    reg.totals.clear();
+    reg.evaluations.clear();
+#endif
+}
+
+/**
+ * @brief Write summary() as CSV, one row per operation
+ * @param os Destination stream
+ * @details The first columns match the kernel summary of nsys stats
+ * ("Name", "Total Time (ns)", "Instances"), so a file saved as
+ * <dir>/nsys_results/<label>_cuda_gpu_kern_sum.csv is plotted by
+ * `scripts/kp/kp <dir> --plot-only`. The remaining columns hold the counters.
+ */
+inline void write_summary(std::ostream &os) {
+    os << "\"Name\",\"Total Time (ns)\",\"Instances\",\"Launches\","
+          "\"Allocations\",\"Allocated Bytes\",\"Syncs\",\"D2H Transfers\","
+          "\"D2H Bytes\"\n";
+    for (auto const &stats : summary()) {
+        os << '"' << stats.name << "\"," << stats.gpu_time_ns << ','
+           << stats.calls << ',' << stats.launches << ',' << stats.allocations
+           << ',' << stats.allocated_bytes << ',' << stats.syncs << ','
+           << stats.d2h_transfers << ',' << stats.d2h_bytes << '\n';
     }
-};
+}
 
 /**
- * @brief Function object for integer division
+ * @brief Write summary() as CSV to a file
+ * @param path Output file, replaced if it exists
  */
-struct idiv {
-    template <typename T>
-    __host__ __device__ auto operator()(const T &a, const T &b) const -> T {
-        if (std::is_integral<T>::value) { return a / b; }
-        return static_cast<T>(static_cast<int>(a / b));
+inline void write_summary(const std::string &path) {
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("write_summary: cannot open " + path);
     }
-};
+    write_summary(file);
+}
+
+}  // namespace instrumentation
 
 /**
- * @brief Function object for subtraction
+ * @brief RAII guard that makes a context current for the calling thread
+ * @details Arrays created and eager operations run while the guard is alive
+ * use the guarded context. The context must outlive the guard.
  */
-struct minus {
-    template <typename T>
-    __host__ __device__ auto operator()(const T &a,
-                                        const T &b) const -> decltype(a - b) {
-        return a - b;
+class context_guard {
+   public:
+    explicit context_guard(const execution_context &ctx)
+      : _previous(detail::active_context()) {
+        detail::active_context() = &ctx;
     }
-};
+    context_guard(const context_guard &)                     = delete;
+    auto operator=(const context_guard &) -> context_guard & = delete;
+    ~context_guard() { detail::active_context() = _previous; }
 
-// Double functor to multiply elements by 2
-template <typename T>
-struct double_functor {
-    __host__ __device__ auto operator()(const T &x) const -> T { return x * 2; }
+   private:
+    const execution_context *_previous;
 };
 
-// Half functor to divide elements by 2
+/**
+ * @brief Thrust allocator that draws device memory from a memory_resource
+ * @details The pointer type is thrust::device_ptr<T>, so iterators of a
+ * device_buffer<T> are the same type as those of thrust::device_vector<T>.
+ * The allocator remembers the stream of the context it was created under, so
+ * its blocks are recycled in that stream's order.
+ */
 template <typename T>
-struct half_functor {
-    __host__ __device__ auto operator()(const T &x) const -> T {
-        if (std::is_integral<T>::value) {
-            // For integer types, perform integer division
-            return x / T(2);
-        }  // For floating-point types, use regular division
-        return x * T(0.5);
+class resource_allocator : public thrust::device_malloc_allocator<T> {
+   public:
+    using value_type = T;
+    using pointer    = thrust::device_ptr<T>;
+    using size_type  = std::size_t;
+
+    template <typename U>
+    struct rebind {
+        using other = resource_allocator<U>;
+    };
+
+    __host__ resource_allocator()
+      : _resource(detail::current_context().resource()),
+        _stream(detail::current_stream()) {}
+    __host__ explicit resource_allocator(memory_resource *resource,
+                                         cudaStream_t stream = nullptr)
+      : _resource(resource), _stream(stream) {}
+    __host__ resource_allocator(const resource_allocator &other)
+      : thrust::device_malloc_allocator<T>(other),
+        _resource(other._resource),
+        _stream(other._stream) {}
+    template <typename U>
+    __host__ resource_allocator(  // NOLINT(google-explicit-constructor)
+      const resource_allocator<U> &other)
+      : _resource(other.resource()), _stream(other.stream()) {}
+    __host__ ~resource_allocator() = default;
+    auto operator=(const resource_allocator &)
+      -> resource_allocator & = default;
+
+    __host__ auto allocate(size_type n) -> pointer {
+        detail::count_allocation(n * sizeof(T));
+        return thrust::device_pointer_cast(
+          static_cast<T *>(_resource->allocate(n * sizeof(T), _stream)));
     }
-};
 
-// Absolute value functor
-template <typename T>
-struct abs_functor {
-    __host__ __device__ auto operator()(const T &x) const -> T {
-        return x < T(0) ? -x : x;
+    __host__ void deallocate(pointer ptr, size_type n) {
+        _resource->deallocate(
+          thrust::raw_pointer_cast(ptr), n * sizeof(T), _stream);
     }
-};
 
-// Odd check functor (returns 1 for odd numbers, 0 for even)
-template <typename T>
-struct odd_functor {
-    __host__ __device__ auto operator()(const T &x) const -> int {
-        return std::is_integral<T>::value ? (x % T(2) != T(0) ? 1 : 0) : 0;
+    [[nodiscard]] __host__ auto resource() const -> memory_resource * {
+        return _resource;
     }
-};
 
-// Even check functor (returns 1 for even numbers, 0 for odd)
-template <typename T>
-struct even_functor {
-    __host__ __device__ auto operator()(const T &x) const -> int {
-        return std::is_integral<T>::value ? (x % T(2) == T(0) ? 1 : 0) : 0;
+    [[nodiscard]] __host__ auto stream() const -> cudaStream_t {
+        return _stream;
     }
-};
 
-// Sign functor (returns 1 for positive, 0 for zero, -1 for negative)
-template <typename T>
-struct sign_functor {
-    __host__ __device__ auto operator()(const T &x) const -> int {
-        return (x > T(0)) ? 1 : ((x < T(0)) ? -1 : 0);
+    friend auto operator==(const resource_allocator &a,
+                           const resource_allocator &b) -> bool {
+        return a._resource == b._resource && a._stream == b._stream;
+    }
+    friend auto operator!=(const resource_allocator &a,
+                           const resource_allocator &b) -> bool {
+        return !(a == b);
     }
+
+   private:
+    memory_resource *_resource;
+    cudaStream_t _stream;
 };
 
-// Square root functor
+/**
+ * @brief Device vector whose storage comes from the active memory_resource
+ */
 template <typename T>
-struct sqrt_functor {
-    __host__ __device__ auto operator()(const T &x) const -> T {
-        return std::sqrt(x);
+using device_buffer = thrust::device_vector<T, resource_allocator<T>>;
+
+namespace detail {
+// Byte allocator passed to thrust::cuda::par_nosync(...) and thrustx
+// algorithms so their temporary storage is served by the active context
+struct temp_allocator {
+    using value_type = char;
+
+    memory_resource *resource = current_context().resource();
+    cudaStream_t stream       = current_stream();
+
+    auto allocate(std::ptrdiff_t num_bytes) -> char * {
+        count_allocation(static_cast<std::size_t>(num_bytes));
+        return static_cast<char *>(
+          resource->allocate(static_cast<std::size_t>(num_bytes), stream));
+    }
+
+    void deallocate(char *ptr, std::size_t num_bytes) {
+        resource->deallocate(ptr, num_bytes, stream);
     }
 };
 
-// Logarithm functor
+// Execution policy used by every eager operation: queued on the active
+// context's stream without a trailing synchronization
+inline auto policy() {
+    count_launch();
+    return thrust::cuda::par_nosync(temp_allocator{}).on(current_stream());
+}
+
+// Policy for thrust algorithms that hand a result back to the host: those
+// synchronize and copy the result (about one word) even under par_nosync
+inline auto blocking_policy() {
+    throw_if_capturing(current_stream(), "blocking_policy");
+    count_sync();
+    count_d2h(sizeof(std::ptrdiff_t));
+    return policy();
+}
+
+// Allocate an uninitialized, pool-backed buffer for an eager result
 template <typename T>
-struct log_functor {
-    __host__ __device__ auto operator()(const T &x) const -> T {
-        return std::log(x);
-    }
+auto make_buffer(std::size_t n) -> std::shared_ptr<device_buffer<T>> {
+    return std::make_shared<device_buffer<T>>(n, thrust::default_init);
+}
+}  // namespace detail
+
+// Type trait to extract underlying type from device_reference
+template <typename T>
+struct extract_value_type {
+    using type = T;
 };
 
-// Exponential functor
 template <typename T>
-struct exp_functor {
-    __host__ __device__ auto operator()(const T &x) const -> T {
-        return std::exp(x);
-    }
+struct extract_value_type<thrust::device_reference<T>> {
+    using type = T;
 };
 
-// Square functor
 template <typename T>
-struct sq_functor {
-    __host__ __device__ auto operator()(const T &x) const -> T { return x * x; }
+using extract_value_type_t = typename extract_value_type<T>::type;
+
+// Iterators over plain device memory (device_ptr and device_vector iterators)
+// that can be copied to the host with a single cudaMemcpy
+template <typename Iterator>
+struct is_contiguous_device_iterator : std::false_type {};
+
+template <typename T>
+struct is_contiguous_device_iterator<thrust::device_ptr<T>> : std::true_type {
 };
 
-// Type casting functor
-template <typename TargetType, typename SourceType>
-struct cast_functor {
-    __host__ __device__ auto operator()(const SourceType &x) const
-      -> TargetType {
-        return static_cast<TargetType>(x);
+template <typename T>
+struct is_contiguous_device_iterator<
+  thrust::detail::normal_iterator<thrust::device_ptr<T>>> : std::true_type {};
+
+template <typename Iterator>
+inline constexpr bool is_contiguous_device_iterator_v =
+  is_contiguous_device_iterator<Iterator>::value;
+
+namespace detail {
+// Pinned host buffer filled by an in-flight device-to-host copy. The buffer
+// (and the device memory it is copied from) is only released once the copy
+// has completed.
+template <typename T>
+class pending_host_copy {
+   public:
+    explicit pending_host_copy(std::size_t n) : _size(n) {
+        if (n > 0) {
+            throw_on_cuda_error(cudaMallocHost(&_data, n * sizeof(T)),
+                                "to_host_async");
+        }
+        throw_on_cuda_error(
+          cudaEventCreateWithFlags(&_event, cudaEventDisableTiming),
+          "to_host_async");
+    }
+    pending_host_copy(const pending_host_copy &) = delete;
+    auto operator=(const pending_host_copy &) -> pending_host_copy & = delete;
+    ~pending_host_copy() {
+        cudaEventSynchronize(_event);
+        cudaEventDestroy(_event);
+        if (_data != nullptr) { cudaFreeHost(_data); }
     }
-};
 
-// Random number generator struct
-struct rnd {
-    float a, b;
-    unsigned int seed;
+    [[nodiscard]] auto data() const -> T * { return _data; }
+    [[nodiscard]] auto size() const -> std::size_t { return _size; }
 
-#ifndef __CUDA_ARCH__
-    static std::atomic<unsigned int> global_counter;
-#endif
+    void record(cudaStream_t stream, std::shared_ptr<void> keepalive) {
+        _keepalive = std::move(keepalive);
+        cudaEventRecord(_event, stream);
+    }
 
-    __host__ __device__ explicit rnd(float _a = 0.F, float _b = 1.F)
-      : a(_a), b(_b) {
-#ifndef __CUDA_ARCH__
-        // Use a true entropy source when available
-        std::random_device rd;
-        // Mix entropy sources: random_device + timestamp + counter + address
-        auto timestamp = static_cast<unsigned int>(time(nullptr));
-        unsigned int const counter_val = global_counter.fetch_add(
-          1, std::memory_order_relaxed);
-        // Mix multiple entropy sources using XOR and rotation
-        auto tmp = reinterpret_cast<uintptr_t>(this);  // NOLINT
-        seed     = rd() ^ (timestamp << 16 | timestamp >> 16) ^
-               (counter_val * 2654435761U) ^
-               static_cast<unsigned int>(tmp & 0xFFFFFFFF);
-#else
-        // On device, mix thread/block IDs with a base seed
-        unsigned int tid = threadIdx.x + blockIdx.x * blockDim.x;
-        seed             = 42U + tid + clock();
-#endif
+    void wait() const {
+        count_sync();
+        throw_on_cuda_error(cudaEventSynchronize(_event), "to_host_async");
     }
 
-    __host__ __device__ auto operator()(const unsigned int n) const -> float {
-        // Use multiple mixing steps for better statistical properties
-        auto h1 = seed + n;
-        h1      = ((h1 >> 16) ^ h1) * 0x45d9f3b;
-        h1      = ((h1 >> 16) ^ h1) * 0x45d9f3b;
-        h1      = (h1 >> 16) ^ h1;
+   private:
+    T *_data = nullptr;
+    std::size_t _size;
+    cudaEvent_t _event = nullptr;
+    std::shared_ptr<void> _keepalive;
+};
+}  // namespace detail
 
-        thrust::default_random_engine rng(
-          static_cast<thrust::default_random_engine::result_type>(h1));
-        thrust::uniform_real_distribution<float> dist(a, b);
-        return dist(rng);
+#ifdef DLPACK_VERSION
+namespace detail {
+template <typename T>
+constexpr auto dlpack_dtype() -> DLDataType {
+    static_assert(std::is_arithmetic_v<T> || std::is_same_v<T, __half> ||
+                    std::is_same_v<T, __nv_bfloat16>,
+                  "DLPack exchange requires an arithmetic, __half or "
+                  "__nv_bfloat16 element type");
+    auto const bits = static_cast<std::uint8_t>(sizeof(T) * 8);
+    if constexpr (std::is_same_v<T, __half>) {
+        return {kDLFloat, bits, 1};
+    } else if constexpr (std::is_same_v<T, __nv_bfloat16>) {
+        return {kDLBfloat, bits, 1};
+    } else if constexpr (std::is_same_v<T, bool>) {
+        return {kDLBool, bits, 1};
+    } else if constexpr (std::is_floating_point_v<T>) {
+        return {kDLFloat, bits, 1};
+    } else if constexpr (std::is_signed_v<T>) {
+        return {kDLInt, bits, 1};
+    } else {
+        return {kDLUInt, bits, 1};
     }
+}
+
+// manager_ctx of exported tensors: keeps the data and the shape alive
+struct dlpack_export {
+    std::shared_ptr<void> storage;
+    std::vector<std::int64_t> shape;
+    DLManagedTensor tensor{};
 };
+}  // namespace detail
+#endif  // DLPACK_VERSION
+
+// ============================================================================
+// Matrix products
+// ============================================================================
+// Row-major products for fusion_array::matmul/matvec. With
+// PARROT_ENABLE_CUBLAS defined they run through cublasGemmEx for float,
+// double, __half and __nv_bfloat16 operands of one type (tensor cores for the
+// 16-bit types, accumulating in float); other types, and builds without
+// cuBLAS, use thrustx::gemm.
+namespace detail {
+#ifdef PARROT_ENABLE_CUBLAS
+inline void throw_on_cublas_error(cublasStatus_t status, const char *what) {
+    if (status != CUBLAS_STATUS_SUCCESS) {
+        throw std::runtime_error(std::string(what) + ": " +
+                                 cublasGetStatusString(status));
+    }
+}
 
-#ifndef __CUDA_ARCH__
-// Initialize atomic counter
-std::atomic<unsigned int> rnd::global_counter(0);  // NOLINT
-#endif
+// A handle must not be used by two host threads at once, so every thread
+// keeps one per device. They are leaked like the default pool.
+inline auto cublas_handle() -> cublasHandle_t {
+    thread_local std::map<int, cublasHandle_t> handles;
+    int device = 0;
+    throw_on_cuda_error(cudaGetDevice(&device), "cublas_handle");
+    auto it = handles.find(device);
+    if (it == handles.end()) {
+        cublasHandle_t created = nullptr;
+        throw_on_cublas_error(cublasCreate(&created), "cublasCreate");
+        it = handles.emplace(device, created).first;
+    }
+    return it->second;
+}
 
-// Random value functor (uses element index to generate random number, then
-// scales by element value)
+// cuBLAS element types parrot types map onto; value says whether a mapping
+// exists and id is the CUDA data type
 template <typename T>
-struct rand_functor {
-    unsigned int extra_entropy;
-
-    __host__ __device__ rand_functor() {
-#ifndef __CUDA_ARCH__
-        // Use true entropy source
-        std::random_device rd;
-        // Mix multiple sources of entropy
-        extra_entropy = rd() ^
-                        (static_cast<unsigned int>(clock()) * 2654435761U) ^
-                        static_cast<unsigned int>(
-                          reinterpret_cast<uintptr_t>(this) &  // NOLINT
-                          0xFFFFFFFF);
-#else
-        // On device, use thread ID and clock
-        unsigned int tid = threadIdx.x + blockIdx.x * blockDim.x;
-        extra_entropy    = 0x9e3779b9 + tid + clock();
+struct cublas_type : std::false_type {};
+template <>
+struct cublas_type<float> : std::true_type {
+    static constexpr cudaDataType_t id = CUDA_R_32F;
+};
+template <>
+struct cublas_type<double> : std::true_type {
+    static constexpr cudaDataType_t id = CUDA_R_64F;
+};
+template <>
+struct cublas_type<__half> : std::true_type {
+    static constexpr cudaDataType_t id = CUDA_R_16F;
+};
+template <>
+struct cublas_type<__nv_bfloat16> : std::true_type {
+    static constexpr cudaDataType_t id = CUDA_R_16BF;
+};
 #endif
+
+// Writes a (m x k) * b (k x n) to c (m x n) on the current stream; all three
+// are row-major device memory
+template <typename T, typename U, typename P>
+void gemm(const T *a, const U *b, index_t m, index_t n, index_t k, P *c) {
+#ifdef PARROT_ENABLE_CUBLAS
+    if constexpr (std::is_same_v<T, U> && cublas_type<T>::value) {
+        constexpr auto compute = std::is_same_v<P, double> ? CUBLAS_COMPUTE_64F
+                                                           : CUBLAS_COMPUTE_32F;
+        auto *handle = cublas_handle();
+        throw_on_cublas_error(cublasSetStream(handle, current_stream()),
+                              "cublasSetStream");
+        // cuBLAS is column-major, where row-major c is c^T = b^T * a^T
+        P const alpha(1);
+        P const beta(0);
+        count_launch();
+        throw_on_cublas_error(cublasGemmEx_64(handle,
+                                              CUBLAS_OP_N,
+                                              CUBLAS_OP_N,
+                                              n,
+                                              m,
+                                              k,
+                                              &alpha,
+                                              b,
+                                              cublas_type<T>::id,
+                                              n,
+                                              a,
+                                              cublas_type<T>::id,
+                                              k,
+                                              &beta,
+                                              c,
+                                              cublas_type<P>::id,
+                                              n,
+                                              compute,
+                                              CUBLAS_GEMM_DEFAULT),
+                              "cublasGemmEx");
+        return;
     }
+#endif
+    thrustx::gemm(a, b, m, n, k, c, current_stream());
+}
+}  // namespace detail
 
-    __host__ __device__ auto operator()(const thrust::tuple<int, T> &t) const
-      -> T {
-        // Get the index and value
-        int idx{thrust::get<0>(t)};
-        T val = thrust::get<1>(t);
-
-        // Improved hash mixing for better distribution
-        auto h1 = static_cast<unsigned int>(idx ^ extra_entropy);
-        h1      = ((h1 >> 16) ^ h1) * 0x45d9f3b;
-        h1      = ((h1 >> 16) ^ h1) * 0x45d9f3b;
-        h1      = (h1 >> 16) ^ h1;
-
-        // Generate a random float between 0 and 1 with extra entropy
-        thrust::default_random_engine rng(
-          static_cast<thrust::default_random_engine::result_type>(h1));
-        thrust::uniform_real_distribution<float> dist(0.0F, 1.0F);
-        float rand_val = dist(rng);
-
-        // Scale by value and convert to appropriate type
-        if (std::is_integral<T>::value) {
-            // For integers, return a random integer in [0, val]
-            return static_cast<T>(rand_val * val);
-        }  // For floating point, return a random float in [0, val)
-        return static_cast<T>(rand_val * val);
+// ============================================================================
+// Multi-output reductions
+// ============================================================================
+// Reducers for fusion_array::reduce_many. Each reducer lifts an element into
+// a state, combines two states associatively and finalizes a state into its
+// result; reduce_many runs a tuple of them in one pass over the input.
+namespace agg {
+
+// Tag base shared by all reducers
+struct reducer {};
+
+// Compute type used for moments: floating types keep their precision,
+// integral inputs are accumulated in double
+template <typename T>
+using moment_type = std::conditional_t<
+  std::is_floating_point_v<T>,
+  T,
+  std::conditional_t<is_reduced_precision_v<T>, float, double>>;
+
+/**
+ * @brief Running count, mean and sum of squared deviations (Welford)
+ */
+template <typename A>
+struct moments_state {
+    std::int64_t count;  // exact, even where A cannot represent it
+    A mean;
+    A m2;
+
+    [[nodiscard]] __host__ __device__ auto variance() const -> A {
+        return count > 0 ? m2 / static_cast<A>(count) : A(0);
     }
 };
 
-// Adapter to convert binary functors from tuple-based to two-argument calling
-// convention
-template <typename BinaryFunctor>
-struct binary_op_adapter {
-    BinaryFunctor binary_op;
+struct sum : reducer {
+    template <typename T>
+    using state_type = T;
 
-    explicit binary_op_adapter(BinaryFunctor op = BinaryFunctor())
-      : binary_op(op) {}
+    template <typename T>
+    auto identity() const -> T {
+        return T(0);
+    }
+    template <typename T>
+    __host__ __device__ auto lift(const T &x) const -> T {
+        return x;
+    }
+    template <typename S>
+    __host__ __device__ auto combine(const S &a, const S &b) const -> S {
+        return a + b;
+    }
+    template <typename S>
+    __host__ __device__ auto finalize(const S &s) const -> S {
+        return s;
+    }
+};
 
-    template <typename T1, typename T2>
-    __host__ __device__ auto operator()(const thrust::tuple<T1, T2> &t) const
-      -> decltype(binary_op(thrust::get<0>(t), thrust::get<1>(t))) {
-        return binary_op(thrust::get<0>(t), thrust::get<1>(t));
+struct sumsq : sum {
+    template <typename T>
+    __host__ __device__ auto lift(const T &x) const -> T {
+        return x * x;
     }
 };
 
-// Add a helper to convert binary functors to unary by binding the second
-// operand
-template <typename T, typename BinaryFunctor>
-struct make_unary_functor {
-    T scalar;
-    BinaryFunctor binary_op;
+struct min : reducer {
+    template <typename T>
+    using state_type = T;
 
-    explicit make_unary_functor(T s, BinaryFunctor op = BinaryFunctor())
-      : scalar(s), binary_op(op) {}
+    template <typename T>
+    auto identity() const -> T {
+        return std::numeric_limits<T>::max();
+    }
+    template <typename T>
+    __host__ __device__ auto lift(const T &x) const -> T {
+        return x;
+    }
+    template <typename S>
+    __host__ __device__ auto combine(const S &a, const S &b) const -> S {
+        return b < a ? b : a;
+    }
+    template <typename S>
+    __host__ __device__ auto finalize(const S &s) const -> S {
+        return s;
+    }
+};
 
-    __host__ __device__ auto operator()(const auto &x) const
-      -> decltype(binary_op(x, scalar)) {
-        return binary_op(x, scalar);
+struct max : reducer {
+    template <typename T>
+    using state_type = T;
+
+    template <typename T>
+    auto identity() const -> T {
+        return std::numeric_limits<T>::lowest();
+    }
+    template <typename T>
+    __host__ __device__ auto lift(const T &x) const -> T {
+        return x;
+    }
+    template <typename S>
+    __host__ __device__ auto combine(const S &a, const S &b) const -> S {
+        return a < b ? b : a;
+    }
+    template <typename S>
+    __host__ __device__ auto finalize(const S &s) const -> S {
+        return s;
     }
 };
 
-template <typename T>
-using minmax_pair = thrust::pair<T, T>;
+struct count : reducer {
+    template <typename T>
+    using state_type = std::int64_t;
 
-template <typename T>
-struct minmax_unary_op {
-    __host__ __device__ auto operator()(const T &x) const -> minmax_pair<T> {
-        return thrust::make_pair(x, x);
+    template <typename T>
+    auto identity() const -> std::int64_t {
+        return 0;
+    }
+    template <typename T>
+    __host__ __device__ auto lift(const T & /*x*/) const -> std::int64_t {
+        return 1;
+    }
+    __host__ __device__ auto combine(std::int64_t a, std::int64_t b) const
+      -> std::int64_t {
+        return a + b;
+    }
+    __host__ __device__ auto finalize(std::int64_t s) const -> std::int64_t {
+        return s;
     }
 };
 
-template <typename T>
-struct minmax_binary_op {
-    __host__ __device__ auto operator()(const minmax_pair<T> &x,
-                                        const minmax_pair<T> &y) const
-      -> minmax_pair<T> {
-        return thrust::make_pair(thrust::min(x.first, y.first),
-                                 thrust::max(x.second, y.second));
+// Count, mean and (population) variance in one numerically stable state,
+// merged with Chan et al.'s parallel update
+struct moments : reducer {
+    template <typename T>
+    using state_type = moments_state<moment_type<T>>;
+
+    template <typename T>
+    auto identity() const -> state_type<T> {
+        using A = moment_type<T>;
+        return {0, A(0), A(0)};
+    }
+    template <typename T>
+    __host__ __device__ auto lift(const T &x) const -> state_type<T> {
+        using A = moment_type<T>;
+        return {1, static_cast<A>(x), A(0)};
+    }
+    template <typename S>
+    __host__ __device__ auto combine(const S &a, const S &b) const -> S {
+        using A      = decltype(a.mean);
+        auto const n = a.count + b.count;
+        if (n == 0) { return a; }
+        // Weights are formed in double so large counts stay accurate in A
+        auto const na    = static_cast<double>(a.count);
+        auto const nb    = static_cast<double>(b.count);
+        auto const w     = static_cast<A>(nb / static_cast<double>(n));
+        auto const wab   = static_cast<A>(na * nb / static_cast<double>(n));
+        auto const delta = b.mean - a.mean;
+        return {n, a.mean + delta * w, a.m2 + b.m2 + delta * delta * wab};
+    }
+    template <typename S>
+    __host__ __device__ auto finalize(const S &s) const -> S {
+        return s;
     }
 };
 
-// Functor to convert a tuple to a pair
-template <typename T>
-struct tuple_to_pair_functor {
-    __host__ __device__ auto operator()(const thrust::tuple<T, int> &t) const
-      -> thrust::pair<T, int> {
-        return thrust::pair<T, int>(thrust::get<0>(t), thrust::get<1>(t));
+struct mean : moments {
+    template <typename S>
+    __host__ __device__ auto finalize(const S &s) const {
+        return s.mean;
     }
 };
 
-// Create a functor to make pairs from a tuple
-template <typename T1, typename T2>
-struct make_pair_functor {
-    __host__ __device__ auto operator()(const thrust::tuple<T1, T2> &t) const
-      -> thrust::pair<T1, T2> {
-        return thrust::make_pair(thrust::get<0>(t), thrust::get<1>(t));
+struct var : moments {
+    template <typename S>
+    __host__ __device__ auto finalize(const S &s) const {
+        return s.variance();
     }
 };
 
-// Transpose functor for permutation iterator
-struct transpose_functor {
-    int num_rows_orig;
-    int num_cols_orig;
+struct stddev : moments {
+    template <typename S>
+    __host__ __device__ auto finalize(const S &s) const {
+        return sqrt(s.variance());
+    }
+};
 
-    transpose_functor(int rows, int cols)  // NOLINT
-      : num_rows_orig(rows), num_cols_orig(cols) {}
+}  // namespace agg
 
-    __host__ __device__ auto operator()(int idx_new_linear) const -> int {
-        return (idx_new_linear % num_rows_orig) * num_cols_orig +
-               (idx_new_linear / num_rows_orig);
+namespace detail {
+// Lifts an element into the tuple of states of the given reducers
+template <typename T, typename... Reducers>
+struct reduce_many_lift {
+    __host__ __device__ auto operator()(const T &x) const
+      -> thrust::tuple<typename Reducers::template state_type<T>...> {
+        return thrust::make_tuple(Reducers{}.lift(x)...);
     }
 };
 
-// Pair operation functor for applying binary operations to pairs
-template <typename BinaryOp>
-struct pair_op_functor {
-    BinaryOp binary_op;
+// Combines two tuples of states component-wise
+template <typename... Reducers>
+struct reduce_many_combine {
+    template <typename Tuple>
+    __host__ __device__ auto operator()(const Tuple &a, const Tuple &b) const
+      -> Tuple {
+        return combine(a, b, std::index_sequence_for<Reducers...>{});
+    }
 
-    explicit pair_op_functor(BinaryOp op) : binary_op(op) {}
+    template <typename Tuple, std::size_t... I>
+    __host__ __device__ static auto combine(const Tuple &a,
+                                            const Tuple &b,
+                                            std::index_sequence<I...> /*seq*/)
+      -> Tuple {
+        return Tuple(
+          Reducers{}.combine(thrust::get<I>(a), thrust::get<I>(b))...);
+    }
+};
 
-    template <typename T1, typename T2>
-    __host__ __device__ auto operator()(const thrust::pair<T1, T2> &pair) const
-      -> decltype(binary_op(pair.first, pair.second)) {
-        return binary_op(pair.first, pair.second);
+// Extracts and finalizes the I-th state of a tuple of states
+template <std::size_t I, typename Reducer>
+struct reduce_many_finalize {
+    template <typename Tuple>
+    __host__ __device__ auto operator()(const Tuple &states) const {
+        return Reducer{}.finalize(thrust::get<I>(states));
     }
 };
+}  // namespace detail
 
-// Main class for lazy operations - now supports optional mask
-template <typename Iterator, typename MaskIterator>
-class fusion_array {
-   private:
-    Iterator _begin;
-    Iterator _end;
+// Iterator over a single device-resident value (the result of a reduction).
+// Every position reads element 0, so it broadcasts like a constant_iterator
+// without copying the value to the host.
+template <typename T>
+using device_scalar_iterator = thrust::permutation_iterator<
+  typename device_buffer<T>::iterator,
+  thrust::constant_iterator<int>>;
 
-    // Optional ownership of a device vector
-    std::shared_ptr<void> _owned_storage = nullptr;
+namespace detail {
+template <typename T>
+auto make_device_scalar_iterator(device_buffer<T> &buffer)
+  -> device_scalar_iterator<T> {
+    return thrust::make_permutation_iterator(buffer.begin(),
+                                             thrust::make_constant_iterator(0));
+}
 
-    // Shape information for the array (always 1D for now)
-    std::vector<int> _shape;
+template <typename Iterator>
+struct is_constant_iterator : std::false_type {};
 
-    // Optional mask iterators (only used when MaskIterator != no_mask_t)
-    [[no_unique_address]] std::conditional_t<
-      std::is_same_v<MaskIterator, no_mask_t>,
-      std::monostate,
-      std::pair<MaskIterator, MaskIterator>> _mask_range;
+template <typename T>
+struct is_constant_iterator<thrust::constant_iterator<T>> : std::true_type {};
+
+// Evaluate n elements of an expression into device memory. Expressions over
+// plain device memory, counters and constants run as one kernel with vector
+// loads and stores; anything else (permutations, reversals, ...) and
+// misaligned views go through thrust::copy.
+template <typename Iterator, typename T>
+void evaluate_into(Iterator first,
+                   std::size_t n,
+                   thrust::device_ptr<T> out,
+                   const std::shared_ptr<void> &owner) {
+    note_evaluation(owner, first, n, "evaluation");
+    if (thrustx::vectorized_copy(first,
+                                 static_cast<std::int64_t>(n),
+                                 thrust::raw_pointer_cast(out),
+                                 current_stream())) {
+        return;
+    }
+    thrust::copy(policy(), first, first + n, out);
+}
 
-    // Optional storage to keep mask source alive (only for masked arrays)
-    [[no_unique_address]] std::conditional_t<
-      std::is_same_v<MaskIterator, no_mask_t>,
-      std::monostate,
-      std::shared_ptr<void>> _mask_storage;
+// Element i of a cached expression: evaluated from the source on its first
+// read, then served from the buffer. Racing first reads store the same value.
+template <typename Iterator, typename T>
+struct cache_functor {
+    Iterator source;
+    thrust::device_ptr<T> values;
+    thrust::device_ptr<unsigned char> filled;
+
+    __host__ __device__ auto operator()(std::ptrdiff_t i) const -> T {
+        if (filled[i] != 0) {
+#ifdef __CUDA_ARCH__
+            __threadfence();  // Read the value after the flag
+#endif
+            return values[i];
+        }
+        T const value = source[i];
+        values[i]     = value;
+#ifdef __CUDA_ARCH__
+        __threadfence();  // Publish the value before the flag
+#endif
+        filled[i] = 1;
+        return value;
+    }
+};
 
-    // Helper to check if this is a masked array
-    static constexpr bool has_mask = !std::is_same_v<MaskIterator, no_mask_t>;
+template <typename Iterator>
+using cache_iterator = thrust::transform_iterator<
+  cache_functor<Iterator,
+                typename cuda::std::iterator_traits<Iterator>::value_type>,
+  thrust::counting_iterator<std::ptrdiff_t>>;
 
-    // Track if the array is sorted (for optimization purposes)
-    bool _is_sorted = false;
+template <typename Iterator>
+struct is_cache_iterator : std::false_type {};
 
-    // Helper to apply mask for eager operations
-    [[nodiscard]] auto _apply_mask_if_needed() const {
-        using value_type = typename cuda::std::iterator_traits<
-          Iterator>::value_type;
+template <typename Source>
+struct is_cache_iterator<cache_iterator<Source>> : std::true_type {};
 
-        if constexpr (!has_mask) {
-            // No mask - just return a copy of the data
-            int n = size();
-            auto
-              result_vec = std::make_shared<thrust::device_vector<value_type>>(
-                n, thrust::default_init);
-            thrust::copy(_begin, _end, result_vec->begin());
+// With instrumentation enabled, warn once when the same lazy expression is
+// evaluated a second time by an eager operation: its result should be kept
+// with eval() or cache() instead of being recomputed. Evaluations are
+// counted per owning storage, so a pool address handed to new storage never
+// matches an expression over the released one; expressions that own no
+// storage are not tracked.
+template <typename Iterator>
+void note_evaluation([[maybe_unused]] const std::shared_ptr<void> &owner,
+                     [[maybe_unused]] const Iterator &first,
+                     [[maybe_unused]] std::size_t n,
+                     [[maybe_unused]] const char *what) {
+#ifdef PARROT_ENABLE_INSTRUMENTATION
+    if constexpr (std::is_trivially_copyable_v<Iterator> &&
+                  !is_contiguous_device_iterator_v<Iterator> &&
+                  !is_cache_iterator<Iterator>::value &&
+                  !is_constant_iterator<Iterator>::value) {
+        if (!owner) { return; }
+        std::string key(reinterpret_cast<const char *>(&first),
+                        sizeof(Iterator));
+        key += std::to_string(typeid(Iterator).hash_code()) + ":" +
+               std::to_string(n);
+        auto &reg = registry();
+        std::lock_guard<std::mutex> const lock(reg.mutex);
+        auto &group = reg.evaluations[owner.get()];
+        if (group.owner.expired()) { group = {owner, {}}; }
+        if (++group.counts[key] == 2) {
+            std::cerr << "parrot: " << what << " evaluates a lazy expression "
+                      << "of " << n << " elements that was already evaluated;"
+                      << " keep it with eval() or cache()\n";
+        }
+        if (reg.evaluations.size() >= reg.sweep_at) {
+            std::erase_if(reg.evaluations, [](const auto &entry) {
+                return entry.second.owner.expired();
+            });
+            reg.sweep_at = std::max<std::size_t>(
+              64, 2 * reg.evaluations.size());
+        }
+    }
+#endif
+}
 
-            return fusion_array<
-              typename thrust::device_vector<value_type>::iterator,
-              no_mask_t>(result_vec->begin(), result_vec->end(), result_vec);
-        } else {
-            // Has mask - apply it
-            int n = size();
-            auto
-              result_vec = std::make_shared<thrust::device_vector<value_type>>(
-                n, thrust::default_init);
+// Storage that keeps both operands of a binary expression alive; only
+// allocates a holder when both own distinct storage
+inline auto join_storage(std::shared_ptr<void> first,
+                         std::shared_ptr<void> second)
+  -> std::shared_ptr<void> {
+    if (!second || second == first) { return first; }
+    if (!first) { return second; }
+    return std::make_shared<
+      std::pair<std::shared_ptr<void>, std::shared_ptr<void>>>(
+      std::move(first), std::move(second));
+}
+}  // namespace detail
 
-            auto end = thrust::copy_if(_begin,
-                                       _end,
-                                       _mask_range.first,
-                                       result_vec->begin(),
-                                       cuda::std::identity{});
+// Sentinel type to indicate no mask
+struct no_mask_t {};
 
-            int result_size = cuda::std::distance(result_vec->begin(), end);
+// Forward declaration of fusion_array
+template <typename Iterator, typename MaskIterator = no_mask_t>
+class fusion_array;
 
-            return fusion_array<
-              typename thrust::device_vector<value_type>::iterator,
-              no_mask_t>(result_vec->begin(),
-                         result_vec->begin() + result_size,
-                         result_vec);
-        }
-    }
+// Now define the trait since fusion_array is forward declared
+template <typename T>
+struct is_fusion_array : std::false_type {};
 
-   public:
-    using value_type = typename cuda::std::iterator_traits<
-      Iterator>::value_type;
+// Specialization for fusion_array (both with and without mask)
+template <typename Iterator>
+struct is_fusion_array<fusion_array<Iterator, no_mask_t>> : std::true_type {};
 
-    // Storage accessor for composite storage management
-    [[nodiscard]] auto storage() const -> const std::shared_ptr<void> & {
-        return _owned_storage;
-    }
+template <typename Iterator, typename MaskIterator>
+struct is_fusion_array<fusion_array<Iterator, MaskIterator>> : std::true_type {
+};
 
-    // Basic constructor (no mask)
-    fusion_array(Iterator begin, Iterator end)
-      : _begin(begin),
-        _end(end),
-        _shape{static_cast<int>(cuda::std::distance(begin, end))},
-        _mask_range{},
-        _mask_storage{} {
-        static_assert(
-          std::is_same_v<MaskIterator, no_mask_t>,
-          "Use the constructor with mask parameters for masked arrays");
-    }
+// Helper variable template
+template <typename T>
+inline constexpr bool is_fusion_array_v = is_fusion_array<T>::value;
 
-    // Constructor with mask - only enable for non-no_mask_t types
-    template <typename MI = MaskIterator>
-    fusion_array(Iterator begin,
-                 Iterator end,
-                 MI mask_begin,
-                 MI mask_end,
-                 std::shared_ptr<void> mask_storage = nullptr)
-        requires(!std::is_same_v<MI, no_mask_t>)
-      : _begin(begin),
-        _end(end),
-        _shape{static_cast<int>(cuda::std::distance(begin, end))},
-        _mask_range{mask_begin, mask_end},
-        _mask_storage{std::move(mask_storage)} {}
+// Forward declare the range function
+inline auto range(index_t end)
+  -> fusion_array<thrust::counting_iterator<index_t>>;
 
-    // Constructor with storage (no mask)
-    fusion_array(Iterator begin, Iterator end, std::shared_ptr<void> storage)
-      : _begin(begin),
-        _end(end),
-        _owned_storage(std::move(storage)),
-        _shape{static_cast<int>(cuda::std::distance(begin, end))},
-        _mask_range{},
-        _mask_storage{} {
-        static_assert(
-          std::is_same_v<MaskIterator, no_mask_t>,
-          "Use the constructor with mask parameters for masked arrays");
+// Forward declare the stats namespace
+namespace stats {
+template <typename Iterator, typename MaskIterator>
+auto norm_cdf(const fusion_array<Iterator, MaskIterator> &arr);
+}
+
+// Type trait to check if a type is a thrust::pair
+template <typename T>
+struct is_thrust_pair : std::false_type {};
+
+template <typename T1, typename T2>
+struct is_thrust_pair<thrust::pair<T1, T2>> : std::true_type {};
+
+template <typename T>
+inline constexpr bool is_thrust_pair_v = is_thrust_pair<T>::value;
+
+namespace detail {
+// Text of one host-side element as printed by fusion_array::print
+template <typename T>
+auto format_element(const T &value) -> std::string {
+    std::stringstream ss;
+    if constexpr (is_thrust_pair_v<T>) {
+        ss << "(" << value.first << ", " << value.second << ")";
+    } else if constexpr (is_reduced_precision_v<T>) {
+        ss << static_cast<float>(value);
+    } else {
+        ss << value;
+    }
+    return ss.str();
+}
+}  // namespace detail
+
+// Helper function to check if T is a fusion_array (fallback for older
+// compilers)
+template <typename T>
+constexpr auto is_fusion_array_func() -> bool {
+    return is_fusion_array<T>::value;
+}
+
+// First element of a pair
+template <typename T, typename U>
+struct fst_functor {
+    __host__ __device__ auto operator()(const thrust::pair<T, U> &p) const
+      -> T {
+        return p.first;
     }
+};
 
-    // Constructor with storage and is_sorted flag (no mask)
-    fusion_array(Iterator begin,
-                 Iterator end,
-                 std::shared_ptr<void> storage,
-                 bool is_sorted)
-      : _begin(begin),
-        _end(end),
-        _owned_storage(std::move(storage)),
-        _shape{static_cast<int>(cuda::std::distance(begin, end))},
-        _mask_range{},
-        _mask_storage{},
-        _is_sorted(is_sorted) {
-        static_assert(
-          std::is_same_v<MaskIterator, no_mask_t>,
-          "Use the constructor with mask parameters for masked arrays");
+// Second element of a pair
+template <typename T, typename U>
+struct snd_functor {
+    __host__ __device__ auto operator()(const thrust::pair<T, U> &p) const
+      -> U {
+        return p.second;
+    }
+};
+
+/**
+ * @brief Function object to extract the first element of a pair
+ */
+struct fst {
+    template <typename T, typename U>
+    __host__ __device__ auto operator()(const thrust::pair<T, U> &p) const
+      -> T {
+        return p.first;
+    }
+};
+
+/**
+ * @brief Function object to extract the second element of a pair
+ */
+struct snd {
+    template <typename T, typename U>
+    __host__ __device__ auto operator()(const thrust::pair<T, U> &p) const
+      -> U {
+        return p.second;
+    }
+};
+
+// Function objects for transformations
+template <typename T>
+struct times_functor {
+    T scalar;
+
+    explicit times_functor(T s) : scalar(s) {}
+
+    __host__ __device__ auto operator()(const T &x) const -> T {
+        return x * scalar;
+    }
+};
+
+template <typename T>
+struct add_functor {
+    T scalar;
+
+    explicit add_functor(T s) : scalar(s) {}
+
+    __host__ __device__ auto operator()(const T &x) const -> T {
+        return x + scalar;
+    }
+};
+
+// Delta functor for adjacent element differences
+struct delta {
+    template <typename T>
+    __host__ __device__ auto operator()(const T &a,
+                                        const T &b) const -> decltype(b - a) {
+        return b - a;
+    }
+};
+
+// Min functor for elementwise minimum
+template <typename T>
+struct min_functor {
+    T scalar;
+
+    explicit min_functor(T s) : scalar(s) {}
+
+    __host__ __device__ auto operator()(const T &x) const -> T {
+        return x < scalar ? x : scalar;
+    }
+};
+
+/**
+ * @brief Function object for minimum of two values
+ */
+struct min {
+    template <typename T>
+    __host__ __device__ auto operator()(const T &a, const T &b) const
+      -> decltype(a < b ? a : b) {
+        return a < b ? a : b;
+    }
+};
+
+/**
+ * @brief Function object for maximum of two values
+ */
+struct max {
+    template <typename T>
+    __host__ __device__ auto operator()(const T &a, const T &b) const
+      -> decltype(a > b ? a : b) {
+        return a > b ? a : b;
+    }
+};
+
+/**
+ * @brief Function object for inequality comparison returning 1 if not equal, 0
+ * otherwise
+ */
+struct neq {
+    template <typename T>
+    __host__ __device__ auto operator()(const T &a, const T &b) const -> int {
+        return a != b ? 1 : 0;
+    }
+};
+
+/**
+ * @brief Function object for less-than comparison returning 1 if a < b, 0
+ * otherwise
+ */
+struct lt {
+    template <typename T>
+    __host__ __device__ auto operator()(const T &a, const T &b) const -> int {
+        return a < b ? 1 : 0;
+    }
+};
+
+/**
+ * @brief Function object for greater-than comparison returning 1 if a > b, 0
+ * otherwise
+ */
+struct gt {
+    template <typename T>
+    __host__ __device__ auto operator()(const T &a, const T &b) const -> int {
+        return a > b ? 1 : 0;
+    }
+};
+
+/**
+ * @brief Function object for equality comparison returning 1 if equal, 0
+ * otherwise
+ */
+struct eq {
+    template <typename T>
+    __host__ __device__ auto operator()(const T &a, const T &b) const -> int {
+        return a == b ? 1 : 0;
+    }
+};
+
+/**
+ * @brief Function object for less-than-or-equal comparison returning 1 if a <=
+ * b, 0 otherwise
+ */
+struct lte {
+    template <typename T>
+    __host__ __device__ auto operator()(const T &a, const T &b) const -> int {
+        return a <= b ? 1 : 0;
+    }
+};
+
+/**
+ * @brief Function object for greater-than-or-equal comparison returning 1 if a
+ * >= b, 0 otherwise
+ */
+struct gte {
+    template <typename T>
+    __host__ __device__ auto operator()(const T &a, const T &b) const -> int {
+        return a >= b ? 1 : 0;
+    }
+};
+
+/**
+ * @brief Function object for addition
+ */
+struct add {
+    template <typename T>
+    __host__ __device__ auto operator()(const T &a,
+                                        const T &b) const -> decltype(a + b) {
+        return a + b;
+    }
+};
+
+/**
+ * @brief Function object for multiplication
+ */
+struct mul {
+    template <typename T>
+    __host__ __device__ auto operator()(const T &a,
+                                        const T &b) const -> decltype(a * b) {
+        return a * b;
+    }
+};
+
+/**
+ * @brief Function object for division
+ */
+struct div {
+    template <typename T1, typename T2>
+    __host__ __device__ auto operator()(const T1 &a,
+                                        const T2 &b) const -> decltype(a / b) {
+        return a / b;
+    }
+};
+
+/**
+ * @brief Function object for integer division
+ */
+struct idiv {
+    template <typename T>
+    __host__ __device__ auto operator()(const T &a, const T &b) const -> T {
+        if (std::is_integral<T>::value) { return a / b; }
+        return static_cast<T>(static_cast<int>(a / b));
+    }
+};
+
+/**
+ * @brief Function object for subtraction
+ */
+struct minus {
+    template <typename T>
+    __host__ __device__ auto operator()(const T &a,
+                                        const T &b) const -> decltype(a - b) {
+        return a - b;
+    }
+};
+
+// Double functor to multiply elements by 2
+template <typename T>
+struct double_functor {
+    __host__ __device__ auto operator()(const T &x) const -> T { return x * 2; }
+};
+
+// Half functor to divide elements by 2
+template <typename T>
+struct half_functor {
+    __host__ __device__ auto operator()(const T &x) const -> T {
+        if (std::is_integral<T>::value) {
+            // For integer types, perform integer division
+            return x / T(2);
+        }  // For floating-point types, use regular division
+        return x * T(0.5);
+    }
+};
+
+// Absolute value functor
+template <typename T>
+struct abs_functor {
+    __host__ __device__ auto operator()(const T &x) const -> T {
+        return x < T(0) ? -x : x;
+    }
+};
+
+// Odd check functor (returns 1 for odd numbers, 0 for even)
+template <typename T>
+struct odd_functor {
+    __host__ __device__ auto operator()(const T &x) const -> int {
+        return std::is_integral<T>::value ? (x % T(2) != T(0) ? 1 : 0) : 0;
+    }
+};
+
+// Even check functor (returns 1 for even numbers, 0 for odd)
+template <typename T>
+struct even_functor {
+    __host__ __device__ auto operator()(const T &x) const -> int {
+        return std::is_integral<T>::value ? (x % T(2) == T(0) ? 1 : 0) : 0;
+    }
+};
+
+// Sign functor (returns 1 for positive, 0 for zero, -1 for negative)
+template <typename T>
+struct sign_functor {
+    __host__ __device__ auto operator()(const T &x) const -> int {
+        return (x > T(0)) ? 1 : ((x < T(0)) ? -1 : 0);
+    }
+};
+
+// Square root functor
+template <typename T>
+struct sqrt_functor {
+    __host__ __device__ auto operator()(const T &x) const -> T {
+        return std::sqrt(x);
+    }
+};
+
+// Logarithm functor
+template <typename T>
+struct log_functor {
+    __host__ __device__ auto operator()(const T &x) const -> T {
+        return static_cast<T>(std::log(static_cast<compute_type_t<T>>(x)));
+    }
+};
+
+// Exponential functor
+template <typename T>
+struct exp_functor {
+    __host__ __device__ auto operator()(const T &x) const -> T {
+        return static_cast<T>(std::exp(static_cast<compute_type_t<T>>(x)));
+    }
+};
+
+// Square functor
+template <typename T>
+struct sq_functor {
+    __host__ __device__ auto operator()(const T &x) const -> T {
+        auto const v = static_cast<compute_type_t<T>>(x);
+        return static_cast<T>(v * v);
+    }
+
+    // Two __half or __nv_bfloat16 elements at once; the product of two
+    // 16-bit values is exact in float, so this rounds like operator()
+    template <typename Pair>
+    __device__ auto pair(const Pair &x) const -> Pair {
+        return __hmul2(x, x);
+    }
+};
+
+// Type casting functor
+template <typename TargetType, typename SourceType>
+struct cast_functor {
+    __host__ __device__ auto operator()(const SourceType &x) const
+      -> TargetType {
+        if constexpr (is_reduced_precision_v<SourceType> ||
+                      is_reduced_precision_v<TargetType>) {
+            // Reduced-precision types only convert to and from float
+            return static_cast<TargetType>(static_cast<float>(x));
+        } else {
+            return static_cast<TargetType>(x);
+        }
+    }
+};
+
+namespace detail {
+// Seed of generators that are not given one: std::random_device is read
+// once per process and each call advances from there
+inline auto entropy_seed() -> std::uint64_t {
+    static std::uint64_t const base = [] {
+        std::random_device rd;
+        return (static_cast<std::uint64_t>(rd()) << 32) ^ rd();
+    }();
+    static std::atomic<std::uint64_t> calls{0};
+    return thrustx::detail::mix_hash(
+      base + calls.fetch_add(1, std::memory_order_relaxed));
+}
+}  // namespace detail
+
+// Random number generator struct: uniform floats in [a, b), where
+// operator()(n) is element n of the counter-based stream for seed
+struct rnd {
+    float a, b;
+    std::uint64_t seed;
+
+    __host__ __device__ explicit rnd(float _a = 0.F, float _b = 1.F)
+      : a(_a), b(_b) {
+#ifndef __CUDA_ARCH__
+        seed = detail::entropy_seed();
+#else
+        seed = 0;
+#endif
+    }
+
+    __host__ __device__ rnd(float _a, float _b, std::uint64_t _seed)
+      : a(_a), b(_b), seed(_seed) {}
+
+    __host__ __device__ auto operator()(const unsigned int n) const -> float {
+        return thrustx::philox_functor<thrustx::uniform_distribution>{
+          seed, 0, {a, b}}(n);
+    }
+};
+
+// Random value functor: element idx of the stream for seed, skipped ahead
+// by offset, scales the element value
+template <typename T>
+struct rand_functor {
+    std::uint64_t seed;
+    std::uint64_t offset;
+
+    __host__ __device__ auto operator()(
+      const thrust::tuple<index_t, T> &t) const -> T {
+        float const rand_val =
+          thrustx::philox_functor<thrustx::uniform_distribution>{
+            seed, offset, {}}(thrust::get<0>(t));
+        // [0, val) for floating point values, truncated for integers
+        return static_cast<T>(
+          rand_val * static_cast<compute_type_t<T>>(thrust::get<1>(t)));
+    }
+};
+
+// Adapter to convert binary functors from tuple-based to two-argument calling
+// convention
+template <typename BinaryFunctor>
+struct binary_op_adapter {
+    BinaryFunctor binary_op;
+
+    explicit binary_op_adapter(BinaryFunctor op = BinaryFunctor())
+      : binary_op(op) {}
+
+    template <typename T1, typename T2>
+    __host__ __device__ auto operator()(const thrust::tuple<T1, T2> &t) const
+      -> decltype(binary_op(thrust::get<0>(t), thrust::get<1>(t))) {
+        return binary_op(thrust::get<0>(t), thrust::get<1>(t));
+    }
+};
+
+// Add a helper to convert binary functors to unary by binding the second
+// operand
+template <typename T, typename BinaryFunctor>
+struct make_unary_functor {
+    T scalar;
+    BinaryFunctor binary_op;
+
+    explicit make_unary_functor(T s, BinaryFunctor op = BinaryFunctor())
+      : scalar(s), binary_op(op) {}
+
+    __host__ __device__ auto operator()(const auto &x) const
+      -> decltype(binary_op(x, scalar)) {
+        return binary_op(x, scalar);
+    }
+};
+
+template <typename T>
+using minmax_pair = thrust::pair<T, T>;
+
+template <typename T>
+struct minmax_unary_op {
+    __host__ __device__ auto operator()(const T &x) const -> minmax_pair<T> {
+        return thrust::make_pair(x, x);
+    }
+};
+
+template <typename T>
+struct minmax_binary_op {
+    __host__ __device__ auto operator()(const minmax_pair<T> &x,
+                                        const minmax_pair<T> &y) const
+      -> minmax_pair<T> {
+        return thrust::make_pair(thrust::min(x.first, y.first),
+                                 thrust::max(x.second, y.second));
+    }
+};
+
+// Lifts a value to a (min, sum) pair for single-pass mask validation; the
+// sum is kept in S so narrow mask types (bool, int8) cannot overflow it
+template <typename T, typename S = T>
+struct min_sum_unary_op {
+    __host__ __device__ auto operator()(const T &x) const
+      -> thrust::pair<T, S> {
+        return thrust::make_pair(x, static_cast<S>(x));
+    }
+};
+
+template <typename T, typename S = T>
+struct min_sum_binary_op {
+    __host__ __device__ auto operator()(const thrust::pair<T, S> &x,
+                                        const thrust::pair<T, S> &y) const
+      -> thrust::pair<T, S> {
+        return thrust::make_pair(thrust::min(x.first, y.first),
+                                 x.second + y.second);
+    }
+};
+
+// Lifts a (value, mask) tuple to the (valid, value) state of a masked
+// reduction, so masked-out lanes never reach the reduction operator
+template <typename T>
+struct masked_lift {
+    template <typename Tuple>
+    __host__ __device__ auto operator()(const Tuple &t) const
+      -> thrust::tuple<bool, T> {
+        return thrust::make_tuple(static_cast<bool>(thrust::get<1>(t)),
+                                  static_cast<T>(thrust::get<0>(t)));
+    }
+};
+
+// Combines (valid, value) states, skipping invalid ones
+template <typename BinaryOp>
+struct masked_combine {
+    BinaryOp op;
+
+    template <typename State>
+    __host__ __device__ auto operator()(const State &a, const State &b) const
+      -> State {
+        if (!thrust::get<0>(a)) { return b; }
+        if (!thrust::get<0>(b)) { return a; }
+        return State(true, op(thrust::get<1>(a), thrust::get<1>(b)));
+    }
+};
+
+// Applies init to the reduced (valid, value) state
+template <typename T, typename BinaryOp>
+struct masked_finalize {
+    T init;
+    BinaryOp op;
+
+    __host__ __device__ auto operator()(const thrust::tuple<bool, T> &s) const
+      -> T {
+        return thrust::get<0>(s) ? static_cast<T>(op(init, thrust::get<1>(s)))
+                                 : init;
+    }
+};
+
+// State of a masked scan: running value, number of kept elements so far,
+// whether the current element is kept, and whether it is the last input
+template <typename T>
+using masked_scan_state = thrust::tuple<T, index_t, bool, bool>;
+
+// Lifts a (value, mask, index) tuple to a masked scan state
+template <typename T>
+struct masked_scan_lift {
+    index_t last;
+
+    template <typename Tuple>
+    __host__ __device__ auto operator()(const Tuple &t) const
+      -> masked_scan_state<T> {
+        bool const kept = static_cast<bool>(thrust::get<1>(t));
+        return masked_scan_state<T>(static_cast<T>(thrust::get<0>(t)),
+                                    kept ? 1 : 0,
+                                    kept,
+                                    thrust::get<2>(t) == last);
+    }
+};
+
+template <typename BinaryOp>
+struct masked_scan_combine {
+    BinaryOp op;
+
+    template <typename State>
+    __host__ __device__ auto operator()(const State &a, const State &b) const
+      -> State {
+        auto value = thrust::get<0>(b);
+        if (thrust::get<1>(b) == 0) {
+            value = thrust::get<0>(a);
+        } else if (thrust::get<1>(a) != 0) {
+            value = op(thrust::get<0>(a), thrust::get<0>(b));
+        }
+        return State(value,
+                     thrust::get<1>(a) + thrust::get<1>(b),
+                     thrust::get<2>(b),
+                     thrust::get<3>(b));
+    }
+};
+
+// Output functor of a masked scan: kept elements are written compacted to
+// out, and the last state records the number of kept elements in *total
+template <typename T>
+struct masked_scan_writer {
+    T *out;
+    index_t *total;
+
+    __host__ __device__ auto operator()(const masked_scan_state<T> &s) const
+      -> int {
+        if (thrust::get<2>(s)) {
+            out[thrust::get<1>(s) - 1] = thrust::get<0>(s);
+        }
+        if (thrust::get<3>(s)) { *total = thrust::get<1>(s); }
+        return 0;
+    }
+};
+
+// Functor to convert a tuple to a pair
+template <typename T>
+struct tuple_to_pair_functor {
+    __host__ __device__ auto operator()(const thrust::tuple<T, int> &t) const
+      -> thrust::pair<T, int> {
+        return thrust::pair<T, int>(thrust::get<0>(t), thrust::get<1>(t));
+    }
+};
+
+// Create a functor to make pairs from a tuple
+template <typename T1, typename T2>
+struct make_pair_functor {
+    __host__ __device__ auto operator()(const thrust::tuple<T1, T2> &t) const
+      -> thrust::pair<T1, T2> {
+        return thrust::make_pair(thrust::get<0>(t), thrust::get<1>(t));
+    }
+};
+
+// A pair array held as two columns: a zip of the first and second elements
+// viewed through make_pair_functor. fst()/snd() select a column directly.
+template <typename It>
+struct is_column_pair_iterator : std::false_type {};
+
+template <typename T1, typename T2, typename Tuple>
+struct is_column_pair_iterator<
+  thrust::transform_iterator<make_pair_functor<T1, T2>,
+                             thrust::zip_iterator<Tuple>>>
+  : std::bool_constant<thrust::tuple_size<Tuple>::value == 2> {};
+
+template <typename It>
+inline constexpr bool is_column_pair_iterator_v =
+  is_column_pair_iterator<It>::value;
+
+// Transpose functor for permutation iterator
+struct transpose_functor {
+    index_t num_rows_orig;
+    index_t num_cols_orig;
+
+    transpose_functor(index_t rows, index_t cols)  // NOLINT
+      : num_rows_orig(rows), num_cols_orig(cols) {}
+
+    __host__ __device__ auto operator()(index_t idx_new_linear) const
+      -> index_t {
+        return (idx_new_linear % num_rows_orig) * num_cols_orig +
+               (idx_new_linear / num_rows_orig);
+    }
+};
+
+// Pair operation functor for applying binary operations to pairs
+template <typename BinaryOp>
+struct pair_op_functor {
+    BinaryOp binary_op;
+
+    explicit pair_op_functor(BinaryOp op) : binary_op(op) {}
+
+    template <typename T1, typename T2>
+    __host__ __device__ auto operator()(const thrust::pair<T1, T2> &pair) const
+      -> decltype(binary_op(pair.first, pair.second)) {
+        return binary_op(pair.first, pair.second);
+    }
+};
+
+// Main class for lazy operations - now supports optional mask
+template <typename Iterator, typename MaskIterator>
+class fusion_array {
+   private:
+    // Execution context bound with on() (null means the thread's current
+    // context); arrays created by a bound array's operations inherit it.
+    // Declared first so it outlives the storage allocated through it.
+    std::shared_ptr<const execution_context> _context = detail::bound_context();
+
+    Iterator _begin;
+    Iterator _end;
+
+    // Optional ownership of a device vector
+    std::shared_ptr<void> _owned_storage = nullptr;
+
+    // Shape information for the array (always 1D for now)
+    std::vector<index_t> _shape;
+
+    // Optional mask iterators (only used when MaskIterator != no_mask_t)
+    [[no_unique_address]] std::conditional_t<
+      std::is_same_v<MaskIterator, no_mask_t>,
+      std::monostate,
+      std::pair<MaskIterator, MaskIterator>> _mask_range;
+
+    // Optional storage to keep mask source alive (only for masked arrays)
+    [[no_unique_address]] std::conditional_t<
+      std::is_same_v<MaskIterator, no_mask_t>,
+      std::monostate,
+      std::shared_ptr<void>> _mask_storage;
+
+    // Helper to check if this is a masked array
+    static constexpr bool has_mask = !std::is_same_v<MaskIterator, no_mask_t>;
+
+    // Track if the array is sorted (for optimization purposes)
+    bool _is_sorted = false;
+
+    [[nodiscard]] auto _current_context() const -> const execution_context & {
+        return _context != nullptr ? *_context : detail::current_context();
+    }
+
+    // Wait for queued work before the host reads device memory
+    void _synchronize() const { _current_context().synchronize(); }
+
+    // One finalized view per reducer over the tuple of reduced states
+    template <typename... Reducers, typename States, std::size_t... I>
+    static auto _finalize_many(const States &states,
+                               std::index_sequence<I...> /*seq*/) {
+        return std::make_tuple(
+          states.map(detail::reduce_many_finalize<I, Reducers>())...);
+    }
+
+    // Queue an evaluation of the array into host memory on the given stream.
+    // Returns the device memory the copy reads from, which must stay alive
+    // until the copy has completed.
+    template <typename HostT>
+    auto _copy_to_host_async(HostT *out, cudaStream_t stream) const
+      -> std::shared_ptr<void> {
+        auto const n = static_cast<std::size_t>(size());
+        detail::throw_if_capturing(stream, "to_host");
+        detail::count_d2h(n * sizeof(HostT));
+        if constexpr (is_contiguous_device_iterator_v<Iterator> &&
+                      std::is_same_v<value_type, HostT>) {
+            // Already materialized: copy straight out of device memory
+            detail::throw_on_cuda_error(
+              cudaMemcpyAsync(out,
+                              thrust::raw_pointer_cast(&*_begin),
+                              n * sizeof(HostT),
+                              cudaMemcpyDeviceToHost,
+                              stream),
+              "to_host");
+            return _owned_storage;
+        } else {
+            // Lazy expression: evaluate it with one kernel, then bulk copy
+            auto staging = detail::make_buffer<HostT>(n);
+            detail::evaluate_into(_begin, n, staging->data(), _owned_storage);
+            detail::throw_on_cuda_error(
+              cudaMemcpyAsync(out,
+                              thrust::raw_pointer_cast(staging->data()),
+                              n * sizeof(HostT),
+                              cudaMemcpyDeviceToHost,
+                              stream),
+              "to_host");
+            return staging;
+        }
+    }
+    // Raw device pointer to the elements, materializing lazy expressions into
+    // a buffer kept alive by keepalive; for kernels that read their input
+    // several times
+    auto _device_data(std::shared_ptr<void> &keepalive) const
+      -> const value_type * {
+        if constexpr (has_mask) {
+            auto compacted = _apply_mask_if_needed();
+            keepalive      = compacted.storage();
+            return thrust::raw_pointer_cast(&*compacted.begin());
+        } else if constexpr (is_contiguous_device_iterator_v<Iterator>) {
+            keepalive = _owned_storage;
+            return thrust::raw_pointer_cast(&*_begin);
+        } else {
+            auto staging = detail::make_buffer<value_type>(size());
+            detail::evaluate_into(
+              _begin, staging->size(), staging->data(), _owned_storage);
+            keepalive = staging;
+            return thrust::raw_pointer_cast(staging->data());
+        }
+    }
+
+    // Reduction of a masked array: the mask is zipped with the values and
+    // masked-out lanes are skipped inside the reduction, so nothing is
+    // compacted first
+    template <int Axis, typename T, typename BinaryOp>
+    auto _reduce_masked(T init, BinaryOp op) const {
+        if constexpr (Axis != 0) {
+            // Masked arrays are one-dimensional; compact to reduce by axis
+            return _apply_mask_if_needed().reduce(
+              init, op, std::integral_constant<int, Axis>{});
+        } else {
+            using state_type = thrust::tuple<bool, T>;
+            auto lifted      = thrust::make_transform_iterator(
+              thrust::make_zip_iterator(
+                thrust::make_tuple(_begin, _mask_range.first)),
+              detail::masked_lift<T>{});
+            auto const n = cuda::std::distance(_begin, _end);
+
+            auto state = detail::make_buffer<state_type>(1);
+            thrustx::reduce_into(lifted,
+                                 lifted + n,
+                                 state->begin(),
+                                 detail::masked_combine<BinaryOp>{op},
+                                 state_type(false, T{}),
+                                 detail::temp_allocator{},
+                                 detail::current_stream());
+
+            auto result_vec = detail::make_buffer<T>(1);
+            thrust::transform(detail::policy(),
+                              state->begin(),
+                              state->end(),
+                              result_vec->begin(),
+                              detail::masked_finalize<T, BinaryOp>{init, op});
+
+            auto result_begin = detail::make_device_scalar_iterator(
+              *result_vec);
+            return fusion_array<device_scalar_iterator<T>>(
+              result_begin,
+              result_begin + 1,
+              result_vec,
+              std::vector<index_t>{});
+        }
+    }
+
+    // Inclusive scan of a masked array in one pass: the scan carries the
+    // number of kept elements, and its output functor writes each kept
+    // element's running value straight to its compacted position
+    template <typename BinaryOp>
+    auto _scan_masked(BinaryOp op) const {
+        auto const n    = static_cast<index_t>(_end - _begin);
+        auto result_vec = detail::make_buffer<value_type>(n);
+        if (n == 0) {
+            return fusion_array<typename device_buffer<value_type>::iterator>(
+              result_vec->begin(), result_vec->end(), result_vec);
+        }
+
+        auto total  = detail::make_buffer<index_t>(1);
+        auto lifted = thrust::make_transform_iterator(
+          thrust::make_zip_iterator(
+            thrust::make_tuple(_begin,
+                               _mask_range.first,
+                               thrust::make_counting_iterator<index_t>(0))),
+          detail::masked_scan_lift<value_type>{n - 1});
+        auto writer = thrust::make_transform_output_iterator(
+          thrust::make_discard_iterator(),
+          detail::masked_scan_writer<value_type>{
+            thrust::raw_pointer_cast(result_vec->data()),
+            thrust::raw_pointer_cast(total->data())});
+        thrust::inclusive_scan(detail::policy(),
+                               lifted,
+                               lifted + n,
+                               writer,
+                               detail::masked_scan_combine<BinaryOp>{op});
+
+        index_t kept      = 0;
+        auto const stream = detail::current_stream();
+        detail::throw_if_capturing(stream, "scan");
+        detail::throw_on_cuda_error(
+          cudaMemcpyAsync(&kept,
+                          thrust::raw_pointer_cast(total->data()),
+                          sizeof(index_t),
+                          cudaMemcpyDeviceToHost,
+                          stream),
+          "scan");
+        detail::count_d2h(sizeof(index_t));
+        detail::count_sync();
+        detail::throw_on_cuda_error(cudaStreamSynchronize(stream), "scan");
+
+        return fusion_array<typename device_buffer<value_type>::iterator>(
+          result_vec->begin(), result_vec->begin() + kept, result_vec);
+    }
+
+    // Distinct values and their counts from the hash engine, ordered by
+    // value; nullopt when hashing does not apply to value_type or the
+    // cardinality estimate favours sorting
+    auto _hash_value_counts() const
+      -> std::optional<std::pair<std::shared_ptr<device_buffer<value_type>>,
+                                 std::shared_ptr<device_buffer<int>>>> {
+        if constexpr (!thrustx::is_hash_key_v<value_type>) {
+            return std::nullopt;
+        } else {
+            index_t const n = size();
+            std::shared_ptr<void> input;
+            auto const *data    = _device_data(input);
+            auto const stream   = detail::current_stream();
+            auto const estimate = thrustx::estimate_cardinality(
+              data, n, detail::temp_allocator{}, stream);
+            if (!thrustx::prefer_hash(
+                  estimate, n, sizeof(value_type) + sizeof(int))) {
+                return std::nullopt;
+            }
+
+            auto keys          = detail::make_buffer<value_type>(n);
+            auto counts        = detail::make_buffer<int>(n);
+            int const distinct = thrustx::hash_count(
+              data,
+              n,
+              estimate,
+              thrust::raw_pointer_cast(keys->data()),
+              thrust::raw_pointer_cast(counts->data()),
+              detail::temp_allocator{},
+              stream);
+            keys->resize(distinct);
+            counts->resize(distinct);
+
+            // Only the distinct keys are sorted
+            thrust::sort_by_key(detail::policy(),
+                                keys->begin(),
+                                keys->end(),
+                                counts->begin());
+            return std::make_pair(keys, counts);
+        }
+    }
+
+    // View two owned columns as one pair array; rle(), value_counts() and
+    // topk() return their outputs this way instead of packing pairs
+    template <typename T1, typename T2>
+    static auto _pair_columns(std::shared_ptr<device_buffer<T1>> first,
+                              std::shared_ptr<device_buffer<T2>> second,
+                              std::vector<index_t> shape = {}) {
+        auto const n    = static_cast<index_t>(first->size());
+        auto zip_begin  = thrust::make_zip_iterator(
+          thrust::make_tuple(first->begin(), second->begin()));
+        auto pair_begin = thrust::make_transform_iterator(
+          zip_begin, make_pair_functor<T1, T2>());
+        auto storage    = std::make_shared<
+          std::pair<std::shared_ptr<void>, std::shared_ptr<void>>>(
+          std::move(first), std::move(second));
+        if (shape.empty()) { shape = {n}; }
+        return fusion_array<decltype(pair_begin)>(
+          pair_begin, pair_begin + n, storage, shape);
+    }
+
+    // Shared implementation of fst() and snd()
+    template <int I>
+    auto _column() const {
+        if constexpr (is_column_pair_iterator_v<Iterator> &&
+                      !has_mask) {
+            auto const columns = _begin.base().get_iterator_tuple();
+            auto const column  = thrust::get<I>(columns);
+            return fusion_array<std::decay_t<decltype(column)>>(
+              column, column + size(), _owned_storage, _shape);
+        } else if constexpr (I == 0) {
+            return map(parrot::fst{});
+        } else {
+            return map(parrot::snd{});
+        }
+    }
+
+    // Minimum (last = false) or maximum of a sorted array: its first or
+    // last element copied into a device scalar, or empty_value if there is
+    // none, in the same form as reduce()
+    auto _sorted_extreme(bool last, value_type empty_value) const {
+        auto result_vec = detail::make_buffer<value_type>(1);
+        auto const n    = cuda::std::distance(_begin, _end);
+        if (n == 0) {
+            thrust::fill_n(
+              detail::policy(), result_vec->begin(), 1, empty_value);
+        } else {
+            thrust::copy_n(detail::policy(),
+                           last ? _begin + (n - 1) : _begin,
+                           1,
+                           result_vec->begin());
+        }
+        auto result_begin = detail::make_device_scalar_iterator(*result_vec);
+        return fusion_array<device_scalar_iterator<value_type>>(
+          result_begin, result_begin + 1, result_vec, std::vector<index_t>{});
+    }
+
+    // Element type of products with an array of U elements
+    template <typename U>
+    using _product_t = decltype(std::declval<compute_type_t<value_type>>() *
+                                std::declval<compute_type_t<U>>());
+
+    // Shared implementation of matmul and matvec: the m x k product with the
+    // k x n matrix (or k-vector for n == 1) other, in the given shape
+    template <typename OtherIterator>
+    auto _product(const fusion_array<OtherIterator> &other,
+                  index_t m,
+                  index_t n,
+                  index_t k,
+                  const std::vector<index_t> &shape) const {
+        detail::bind_scope const scope(_context);
+        using U      = typename fusion_array<OtherIterator>::value_type;
+        using P      = _product_t<U>;
+        auto const a = eval();
+        auto const b = other.eval();
+        auto result  = detail::make_buffer<P>(static_cast<std::size_t>(m * n));
+        if (m * n > 0) {
+            detail::gemm(thrust::raw_pointer_cast(&*a.begin()),
+                         thrust::raw_pointer_cast(&*b.begin()),
+                         m,
+                         n,
+                         k,
+                         thrust::raw_pointer_cast(result->data()));
+        }
+        return fusion_array<typename device_buffer<P>::iterator>(
+          result->begin(), result->end(), result, shape);
+    }
+
+    // Shared implementation of lower_bound, upper_bound and searchsorted
+    template <typename NeedleIterator>
+    auto _bounds(const fusion_array<NeedleIterator> &needles,
+                 bool upper) const {
+        detail::bind_scope const scope(_context);
+        if constexpr (has_mask) {
+            auto unmasked = _apply_mask_if_needed();
+            return upper ? unmasked.upper_bound(needles)
+                         : unmasked.lower_bound(needles);
+        } else {
+            auto positions = detail::make_buffer<index_t>(needles.size());
+            if (upper) {
+                thrust::upper_bound(detail::policy(),
+                                    _begin,
+                                    _end,
+                                    needles.begin(),
+                                    needles.end(),
+                                    positions->begin());
+            } else {
+                thrust::lower_bound(detail::policy(),
+                                    _begin,
+                                    _end,
+                                    needles.begin(),
+                                    needles.end(),
+                                    positions->begin());
+            }
+            return fusion_array<typename device_buffer<index_t>::iterator>(
+              positions->begin(),
+              positions->end(),
+              positions,
+              needles.shape());
+        }
+    }
+
+    // Shared implementation of sort and sort_desc
+    auto _sort(bool descending) const {
+        detail::bind_scope const scope(_context);
+        index_t n = size();
+
+        // Create a new device vector and take ownership of it
+        auto sorted_data = detail::make_buffer<value_type>(n);
+
+        if constexpr (std::is_arithmetic_v<value_type>) {
+            std::shared_ptr<void> input;
+            auto const *data = _device_data(input);
+            thrustx::radix_sort_keys(
+              data,
+              thrust::raw_pointer_cast(sorted_data->data()),
+              n,
+              descending,
+              detail::temp_allocator{},
+              detail::current_stream());
+        } else {
+            detail::evaluate_into(
+              _begin, n, sorted_data->data(), _owned_storage);
+            if (descending) {
+                thrust::sort(detail::policy(),
+                             sorted_data->begin(),
+                             sorted_data->end(),
+                             thrust::greater<value_type>());
+            } else {
+                thrust::sort(
+                  detail::policy(), sorted_data->begin(), sorted_data->end());
+            }
+        }
+
+        // Only ascending results can use the sorted-array fast paths
+        return fusion_array<typename device_buffer<value_type>::iterator>(
+          sorted_data->begin(), sorted_data->end(), sorted_data, !descending);
+    }
+
+    // Shared implementation of sort(2_ic) and sort_desc(2_ic)
+    template <int Axis>
+    auto _sort_rows(bool descending) const {
+        static_assert(Axis == 2, "Row sorts support axis 2 (rows)");
+        static_assert(std::is_arithmetic_v<value_type>,
+                      "Row sorts require an arithmetic value type");
+        detail::bind_scope const scope(_context);
+        if (_shape.size() < 2) {
+            throw std::runtime_error(
+              "Cannot perform row-wise sort on array with rank < 2");
+        }
+
+        index_t const rows = _shape[0];
+        index_t const cols = _shape[1];
+        std::shared_ptr<void> input;
+        auto const *data = _device_data(input);
+        auto sorted_data = detail::make_buffer<value_type>(size());
+        thrustx::segmented_sort_rows(
+          data,
+          thrust::raw_pointer_cast(sorted_data->data()),
+          rows,
+          cols,
+          descending,
+          detail::temp_allocator{},
+          detail::current_stream());
+
+        return fusion_array<typename device_buffer<value_type>::iterator>(
+          sorted_data->begin(), sorted_data->end(), sorted_data, _shape);
+    }
+
+    // Shared implementation of sort_by_key and sort_by_key_desc
+    template <typename KeyFunc>
+    auto _sort_by_key(KeyFunc key_func, bool descending) const {
+        detail::bind_scope const scope(_context);
+        using key_type =
+          std::decay_t<std::invoke_result_t<KeyFunc, value_type>>;
+        index_t n = size();
+
+        // Evaluate the input and its keys once
+        std::shared_ptr<void> input;
+        auto const *data = _device_data(input);
+        auto keys        = detail::make_buffer<key_type>(n);
+        thrust::transform(
+          detail::policy(), data, data + n, keys->begin(), key_func);
+
+        auto sorted_data = detail::make_buffer<value_type>(n);
+        if constexpr (std::is_arithmetic_v<key_type> &&
+                      std::is_trivially_copyable_v<value_type>) {
+            auto sorted_keys = detail::make_buffer<key_type>(n);
+            thrustx::radix_sort_pairs(
+              thrust::raw_pointer_cast(keys->data()),
+              thrust::raw_pointer_cast(sorted_keys->data()),
+              data,
+              thrust::raw_pointer_cast(sorted_data->data()),
+              n,
+              descending,
+              detail::temp_allocator{},
+              detail::current_stream());
+        } else {
+            thrust::copy(
+              detail::policy(), data, data + n, sorted_data->begin());
+            if (descending) {
+                thrust::stable_sort_by_key(detail::policy(),
+                                           keys->begin(),
+                                           keys->end(),
+                                           sorted_data->begin(),
+                                           thrust::greater<key_type>());
+            } else {
+                thrust::stable_sort_by_key(detail::policy(),
+                                           keys->begin(),
+                                           keys->end(),
+                                           sorted_data->begin());
+            }
+        }
+
+        return fusion_array<typename device_buffer<value_type>::iterator>(
+          sorted_data->begin(), sorted_data->end(), sorted_data);
+    }
+
+    // Shared implementation of softmax, log_softmax and logsumexp
+    template <thrustx::row_normalize Mode>
+    auto _normalize_rows(const char *what) const {
+        detail::bind_scope const scope(_context);
+        using result_type =
+          std::conditional_t<std::is_floating_point_v<value_type>,
+                             value_type,
+                             float>;
+        if (_shape.size() < 2) {
+            throw std::runtime_error(std::string("Cannot perform row-wise ") +
+                                     what + " on array with rank < 2");
+        }
+
+        index_t const rows = _shape[0];
+        index_t const cols = _shape[1];
+        bool const per_row = Mode == thrustx::row_normalize::logsumexp;
+        auto result        = detail::make_buffer<result_type>(
+          per_row ? rows : static_cast<std::size_t>(rows) * cols);
+        thrustx::normalize_rows<Mode>(
+          _begin, rows, cols, result->begin(), detail::current_stream());
+
+        auto const shape = per_row ? std::vector<index_t>{rows}
+                                   : std::vector<index_t>{rows, cols};
+        return fusion_array<typename device_buffer<result_type>::iterator>(
+          result->begin(), result->end(), result, shape);
+    }
+
+    // Helper to apply mask for eager operations
+    [[nodiscard]] auto _apply_mask_if_needed() const {
+        detail::bind_scope const scope(_context);
+        using value_type = typename cuda::std::iterator_traits<
+          Iterator>::value_type;
+
+        if constexpr (!has_mask) {
+            // No mask - just return a copy of the data
+            index_t n = size();
+            auto result_vec = detail::make_buffer<value_type>(n);
+            detail::evaluate_into(
+              _begin, n, result_vec->data(), _owned_storage);
+
+            return fusion_array<
+              typename device_buffer<value_type>::iterator,
+              no_mask_t>(result_vec->begin(), result_vec->end(), result_vec);
+        } else {
+            // Has mask - apply it
+            index_t n = size();
+            auto result_vec = detail::make_buffer<value_type>(n);
+
+            auto end = thrust::copy_if(detail::blocking_policy(),
+                                       _begin,
+                                       _end,
+                                       _mask_range.first,
+                                       result_vec->begin(),
+                                       cuda::std::identity{});
+
+            index_t result_size = cuda::std::distance(result_vec->begin(),
+                                                      end);
+
+            return fusion_array<
+              typename device_buffer<value_type>::iterator,
+              no_mask_t>(result_vec->begin(),
+                         result_vec->begin() + result_size,
+                         result_vec);
+        }
+    }
+
+   public:
+    using value_type = typename cuda::std::iterator_traits<
+      Iterator>::value_type;
+
+    // Storage accessor for composite storage management
+    [[nodiscard]] auto storage() const -> const std::shared_ptr<void> & {
+        return _owned_storage;
+    }
+
+    // Basic constructor (no mask)
+    fusion_array(Iterator begin, Iterator end)
+      : _begin(begin),
+        _end(end),
+        _shape{static_cast<index_t>(cuda::std::distance(begin, end))},
+        _mask_range{},
+        _mask_storage{} {
+        static_assert(
+          std::is_same_v<MaskIterator, no_mask_t>,
+          "Use the constructor with mask parameters for masked arrays");
+    }
+
+    // Constructor with mask - only enable for non-no_mask_t types
+    template <typename MI = MaskIterator>
+    fusion_array(Iterator begin,
+                 Iterator end,
+                 MI mask_begin,
+                 MI mask_end,
+                 std::shared_ptr<void> mask_storage = nullptr)
+        requires(!std::is_same_v<MI, no_mask_t>)
+      : _begin(begin),
+        _end(end),
+        _shape{static_cast<index_t>(cuda::std::distance(begin, end))},
+        _mask_range{mask_begin, mask_end},
+        _mask_storage{std::move(mask_storage)} {}
+
+    // Constructor with storage (no mask)
+    fusion_array(Iterator begin, Iterator end, std::shared_ptr<void> storage)
+      : _begin(begin),
+        _end(end),
+        _owned_storage(std::move(storage)),
+        _shape{static_cast<index_t>(cuda::std::distance(begin, end))},
+        _mask_range{},
+        _mask_storage{} {
+        static_assert(
+          std::is_same_v<MaskIterator, no_mask_t>,
+          "Use the constructor with mask parameters for masked arrays");
+    }
+
+    // Constructor with storage and is_sorted flag (no mask)
+    fusion_array(Iterator begin,
+                 Iterator end,
+                 std::shared_ptr<void> storage,
+                 bool is_sorted)
+      : _begin(begin),
+        _end(end),
+        _owned_storage(std::move(storage)),
+        _shape{static_cast<index_t>(cuda::std::distance(begin, end))},
+        _mask_range{},
+        _mask_storage{},
+        _is_sorted(is_sorted) {
+        static_assert(
+          std::is_same_v<MaskIterator, no_mask_t>,
+          "Use the constructor with mask parameters for masked arrays");
     }
 
     // Constructor with storage and mask
@@ -802,2102 +2971,5515 @@ class fusion_array {
       : _begin(begin),
         _end(end),
         _owned_storage(std::move(storage)),
-        _shape{static_cast<int>(cuda::std::distance(begin, end))},
-        _mask_range{mask_begin, mask_end},
-        _mask_storage{std::move(mask_storage)} {}
+        _shape{static_cast<index_t>(cuda::std::distance(begin, end))},
+        _mask_range{mask_begin, mask_end},
+        _mask_storage{std::move(mask_storage)} {}
+
+    // Constructor with storage and shape (no mask)
+    fusion_array(Iterator begin,
+                 Iterator end,
+                 std::shared_ptr<void> storage,
+                 const std::vector<index_t> &shape)
+      : _begin(begin),
+        _end(end),
+        _owned_storage(std::move(storage)),
+        _shape(shape),
+        _mask_range{},
+        _mask_storage{} {
+        static_assert(
+          std::is_same_v<MaskIterator, no_mask_t>,
+          "Use the constructor with mask parameters for masked arrays");
+    }
+
+    // Constructor with storage, shape and mask
+    template <typename MI = MaskIterator>
+    fusion_array(Iterator begin,
+                 Iterator end,
+                 std::shared_ptr<void> storage,
+                 const std::vector<index_t> &shape,
+                 MI mask_begin,
+                 MI mask_end,
+                 std::shared_ptr<void> mask_storage = nullptr)
+        requires(!std::is_same_v<MI, no_mask_t>)
+      : _begin(begin),
+        _end(end),
+        _owned_storage(std::move(storage)),
+        _shape(shape),
+        _mask_range{mask_begin, mask_end},
+        _mask_storage{std::move(mask_storage)} {}
+
+    // Constructor with initializer_list shape (no mask)
+    fusion_array(Iterator begin,
+                 Iterator end,
+                 std::shared_ptr<void> storage,
+                 std::initializer_list<index_t> shape)
+      : _begin(begin),
+        _end(end),
+        _owned_storage(std::move(storage)),
+        _shape(shape.begin(), shape.end()),
+        _mask_range{},
+        _mask_storage{} {
+        static_assert(
+          std::is_same_v<MaskIterator, no_mask_t>,
+          "Use the constructor with mask parameters for masked arrays");
+    }
+
+    // Scalar constructor - only for non-masked arrays
+    template <typename T>
+    explicit fusion_array(T value)
+      : _begin(thrust::make_constant_iterator(value)),
+        _end(thrust::make_constant_iterator(value) + 1),
+        // Scalar has empty shape (rank 0)
+        _mask_range{},
+        _mask_storage{} {
+        static_assert(std::is_same_v<MaskIterator, no_mask_t>,
+                      "Scalar constructor is only for non-masked arrays");
+    }
+
+    /**
+     * @brief Bind the array to an execution context
+     * @param ctx The context whose stream and memory resource eager operations
+     * on this array (and on arrays derived from it) use
+     * @return A copy of the array bound to ctx
+     * @details Operations are queued without synchronizing; reading a value
+     * on the host (value(), to_host(), print(), ...) waits for the stream.
+     */
+    [[nodiscard]] auto on(const execution_context &ctx) const -> fusion_array {
+        auto bound     = *this;
+        bound._context = std::make_shared<const execution_context>(ctx);
+        return bound;
+    }
+
+    /**
+     * @brief Get the execution context the array's operations run on
+     * @return The bound context, or the calling thread's current context
+     */
+    [[nodiscard]] auto context() const -> const execution_context & {
+        return _current_context();
+    }
+
+    /**
+     * @brief Block until all work queued on the array's context finished
+     */
+    void synchronize() const { _synchronize(); }
+
+    // Iterator accessors
+    [[nodiscard]] auto begin() const -> Iterator { return _begin; }
+    [[nodiscard]] auto end() const -> Iterator { return _end; }
+
+    // For masked arrays, provide a method to apply the mask (eager operation)
+    [[nodiscard]] auto apply() const {
+        static_assert(has_mask, "apply() can only be called on masked arrays");
+        return _apply_mask_if_needed();
+    }
+
+    /**
+     * @brief Evaluate the array into device memory (eager operation)
+     * @return An array over a new pool-backed buffer with the same shape and
+     * sorted flag, or this array if it already is plain device memory.
+     * Masked arrays are compacted as by apply().
+     * @details Lazy arrays are recomputed by every operation that consumes
+     * them; evaluate an expression that feeds several operations once:
+     * @code
+     * auto num = (matrix - matrix.maxr(2_ic).replicate(cols)).exp().eval();
+     * auto softmax = num / num.sum(2_ic).replicate(cols);
+     * @endcode
+     */
+    [[nodiscard]] auto eval() const {
+        detail::bind_scope const scope(_context);
+        if constexpr (has_mask) {
+            return _apply_mask_if_needed();
+        } else if constexpr (is_contiguous_device_iterator_v<Iterator>) {
+            return *this;
+        } else {
+            auto const n = static_cast<std::size_t>(size());
+            auto result  = detail::make_buffer<value_type>(n);
+            detail::evaluate_into(_begin, n, result->data(), _owned_storage);
+            using result_type = fusion_array<
+              typename device_buffer<value_type>::iterator>;
+            if (_is_sorted) {
+                return result_type(
+                  result->begin(), result->end(), result, true);
+            }
+            return result_type(result->begin(), result->end(), result, _shape);
+        }
+    }
+
+    /**
+     * @brief Keep the values of the array once they are first computed
+     * @return A lazy array with the same shape (and mask) that evaluates each
+     * element from this expression on its first read and stores it in a
+     * pool-backed buffer; later reads, by any operation, load the stored
+     * value. Plain device memory is returned as it is.
+     * @details Unlike eval(), nothing runs until an operation consumes the
+     * array, and that first consumer computes the values fused with its own
+     * work. Each later read also loads a one-byte flag per element, so prefer
+     * eval() when every element is consumed more than once anyway.
+     */
+    [[nodiscard]] auto cache() const {
+        detail::bind_scope const scope(_context);
+        if constexpr (is_contiguous_device_iterator_v<Iterator> ||
+                      detail::is_cache_iterator<Iterator>::value) {
+            return *this;
+        } else {
+            auto const n = static_cast<std::size_t>(_end - _begin);
+            auto values  = detail::make_buffer<value_type>(n);
+            auto filled  = detail::make_buffer<unsigned char>(n);
+            thrust::fill(
+              detail::policy(), filled->begin(), filled->end(), 0);
+            auto const first = thrust::make_transform_iterator(
+              thrust::counting_iterator<std::ptrdiff_t>(0),
+              detail::cache_functor<Iterator, value_type>{
+                _begin, values->data(), filled->data()});
+            auto storage = detail::join_storage(
+              detail::join_storage(values, filled), _owned_storage);
+            if constexpr (has_mask) {
+                return fusion_array<detail::cache_iterator<Iterator>,
+                                    MaskIterator>(first,
+                                                  first + n,
+                                                  storage,
+                                                  _mask_range.first,
+                                                  _mask_range.second,
+                                                  _mask_storage);
+            } else if (_is_sorted) {
+                return fusion_array<detail::cache_iterator<Iterator>>(
+                  first, first + n, storage, true);
+            } else {
+                return fusion_array<detail::cache_iterator<Iterator>>(
+                  first, first + n, storage, _shape);
+            }
+        }
+    }
+
+    // Shape accessor
+    [[nodiscard]] auto shape() const -> std::vector<index_t> {
+        if constexpr (has_mask) {
+            // For masked arrays, return 1D shape with the masked size
+            return {size()};
+        } else {
+            return _shape;
+        }
+    }
+
+    /**
+     * @brief Get the rank (dimensionality) of the array
+     * @return The number of dimensions in the array's shape
+     */
+    [[nodiscard]] auto rank() const -> int { return _shape.size(); }
+
+    /**
+     * @brief Whether the array is known to be sorted in ascending order
+     * @return True for results of sort() and other operations that keep the
+     * order, false when unknown
+     */
+    [[nodiscard]] auto is_sorted() const -> bool { return _is_sorted; }
+
+    /**
+     * @brief Get the number of rows in a 2D array
+     * @return The number of rows (first dimension)
+     * @throws std::runtime_error if the array rank is not 2
+     */
+    [[nodiscard]] auto nrows() const -> index_t {
+        if (rank() != 2) {
+            throw std::runtime_error(
+              "nrows() can only be called on rank-2 arrays");
+        }
+        return _shape[0];
+    }
+
+    /**
+     * @brief Get the number of columns in a 2D array
+     * @return The number of columns (second dimension)
+     * @throws std::runtime_error if the array rank is not 2
+     */
+    [[nodiscard]] auto ncols() const -> index_t {
+        if (rank() != 2) {
+            throw std::runtime_error(
+              "ncols() can only be called on rank-2 arrays");
+        }
+        return _shape[1];
+    }
+
+    // Map operation with another fusion_array
+    template <typename OtherIterator,
+              typename OtherMaskIterator,
+              typename BinaryFunctor>
+    auto map2(const fusion_array<OtherIterator, OtherMaskIterator> &value,
+              BinaryFunctor binary_op) const {
+        detail::bind_scope const scope(_context);
+        if (size() != value.size() and rank() != 0 and value.rank() != 0) {
+            throw std::invalid_argument(
+              "Incompatible shapes for element-wise operations: " +
+              std::to_string(size()) + " " + std::to_string(value.size()));
+        }
+
+        auto const n = std::max(size(), value.size());
+        // Prioritize higher-dimensional arrays to preserve shape information
+        // If ranks are equal, prefer the larger array by size
+        auto const shape = (rank() < value.rank()) ||
+                               (rank() == value.rank() && size() < value.size())
+                             ? value.shape()
+                             : _shape;
+
+        auto zip_begin = thrust::make_zip_iterator(
+          thrust::make_tuple(_begin, value.begin()));
+        auto zip_end = thrust::make_zip_iterator(
+          thrust::make_tuple(_begin + n, value.begin() + n));
+
+        // Create an adapter that converts from tuple-based to two-argument
+        // calling convention
+        auto adapter = binary_op_adapter<BinaryFunctor>(binary_op);
+
+        using result_iterator = thrust::transform_iterator<decltype(adapter),
+                                                           decltype(zip_begin)>;
+
+        // Keep both operands alive
+        auto composite_storage = detail::join_storage(_owned_storage,
+                                                      value.storage());
+
+        return fusion_array<result_iterator>(
+          thrust::make_transform_iterator(zip_begin, adapter),
+          thrust::make_transform_iterator(zip_end, adapter),
+          composite_storage,
+          shape);
+    }
+
+    // Map operation with a scalar value
+    template <typename T, typename BinaryFunctor>
+    auto map2(const T &value, BinaryFunctor binary_op) const -> decltype(auto) {
+        detail::bind_scope const scope(_context);
+        using unary_functor = make_unary_functor<value_type, BinaryFunctor>;
+        if constexpr (has_mask) {
+            return map(unary_functor(value, binary_op));
+        } else {
+            using TransformIterator = thrust::transform_iterator<unary_functor,
+                                                                 Iterator>;
+
+            return fusion_array<TransformIterator>(
+              thrust::make_transform_iterator(_begin,
+                                              unary_functor(value, binary_op)),
+              thrust::make_transform_iterator(_end,
+                                              unary_functor(value, binary_op)),
+              _owned_storage,
+              _shape);
+        }
+    }
+
+    /**
+     * @brief Apply a unary functor to each element of the array
+     * @tparam UnaryFunctor The type of the unary functor
+     * @param op The unary operation to apply
+     * @return A new fusion_array with the operation applied
+     */
+    template <typename UnaryFunctor>
+    auto map(UnaryFunctor op) const {
+        detail::bind_scope const scope(_context);
+        using TransformIterator = thrust::transform_iterator<UnaryFunctor,
+                                                             Iterator>;
+
+        if constexpr (has_mask) {
+            // Element-wise maps keep the mask, so masked reductions stay fused
+            return fusion_array<TransformIterator, MaskIterator>(
+              thrust::make_transform_iterator(_begin, op),
+              thrust::make_transform_iterator(_end, op),
+              _owned_storage,
+              _mask_range.first,
+              _mask_range.second,
+              _mask_storage);
+        } else {
+            return fusion_array<TransformIterator>(
+              thrust::make_transform_iterator(_begin, op),
+              thrust::make_transform_iterator(_end, op),
+              _owned_storage,  // Pass ownership to derived array
+              _shape);
+        }
+    }
+
+    /**
+     * @brief Multiply each element by a scalar
+     * @param scalar The value to multiply by
+     * @return A new fusion_array with the operation applied
+     */
+    template <typename T = int>
+    auto times(T scalar) const {
+        return map2(scalar, mul{});
+    }
+
+    /**
+     * @brief Add a scalar or another fusion_array element-wise
+     * @param value The scalar or fusion_array to add
+     * @return A new fusion_array with the operation applied
+     */
+    template <typename T>
+    auto add(const T &value) const {
+        return map2(value, parrot::add{});
+    }
+
+    /**
+     * @brief Return elementwise minimum with a scalar
+     * @param scalar The value to compare with
+     * @return A new fusion_array with the operation applied
+     */
+    template <typename T = int>
+    auto min(T scalar) const {
+        return map2(scalar, parrot::min{});
+    }
+
+    /**
+     * @brief Return elementwise maximum with a scalar
+     * @param scalar The value to compare with
+     * @return A new fusion_array with the operation applied
+     */
+    template <typename T = int>
+    auto max(T scalar) const {
+        return map2(scalar, parrot::max{});
+    }
+
+    /**
+     * @brief Divide each element by a scalar or perform element-wise division
+     * with another fusion_array.
+     * @tparam T The type of the argument, which can be a scalar or another
+     * fusion_array.
+     * @param arg The scalar value to divide by or the other fusion_array for
+     * element-wise division.
+     * @return A new fusion_array with the division operation applied.
+     * @throws std::invalid_argument if `arg` is a fusion_array and shapes are
+     * incompatible for element-wise operations.
+     */
+    template <typename T>
+    auto div(const T &arg) const {
+        return map2(arg, parrot::div{});
+    }
+
+    /**
+     * @brief Integer divide each element by a scalar (truncating any fractional
+     * part)
+     * @param scalar The value to divide by
+     * @return A new fusion_array with the operation applied
+     */
+    template <typename T = int>
+    auto idiv(T scalar) const {
+        return map2(scalar, parrot::idiv{});
+    }
+
+    /**
+     * @brief Subtract a scalar from each element
+     * @param scalar The value to subtract
+     * @return A new fusion_array with the operation applied
+     */
+    template <typename T = int>
+    auto minus(T scalar) const {
+        return map2(scalar, parrot::minus{});
+    }
+
+    /**
+     * @brief Check if each element is greater than or equal to a scalar
+     * @param scalar The value to compare with
+     * @return A new fusion_array containing 1 where the condition is true, 0
+     * otherwise
+     */
+    template <typename T = int>
+    auto gte(T scalar) const {
+        return map2(scalar, parrot::gte{});
+    }
+
+    /**
+     * @brief Check if each element is less than or equal to a scalar
+     * @param scalar The value to compare with
+     * @return A new fusion_array containing 1 where the condition is true, 0
+     * otherwise
+     */
+    template <typename T = int>
+    auto lte(T scalar) const {
+        return map2(scalar, parrot::lte{});
+    }
+
+    /**
+     * @brief Check if each element is greater than a scalar
+     * @param scalar The value to compare with
+     * @return A new fusion_array containing 1 where the condition is true, 0
+     * otherwise
+     */
+    template <typename T = int>
+    auto gt(T scalar) const {
+        return map2(scalar, parrot::gt{});
+    }
+
+    /**
+     * @brief Check if each element is less than a scalar
+     * @param scalar The value to compare with
+     * @return A new fusion_array containing 1 where the condition is true, 0
+     * otherwise
+     */
+    template <typename T = int>
+    auto lt(T scalar) const {
+        return map2(scalar, parrot::lt{});
+    }
+
+    /**
+     * @brief Check if each element is equal to a scalar
+     * @param scalar The value to compare with
+     * @return A new fusion_array containing 1 where the condition is true, 0
+     * otherwise
+     */
+    template <typename T = int>
+    auto eq(T scalar) const {
+        return map2(scalar, parrot::eq{});
+    }
+
+    /**
+     * @brief Check if each element is not equal to a scalar
+     * @param scalar The value to compare with
+     * @return A new fusion_array containing 1 where the condition is true, 0
+     * otherwise
+     */
+    template <typename T = int>
+    auto neq(T scalar) const {
+        return map2(scalar, parrot::neq{});
+    }
+
+    /**
+     * @brief Apply a binary operation to adjacent elements
+     * @param op The binary operation to apply
+     * @return A new fusion_array with the operation applied
+     */
+    template <typename BinaryOp>
+    auto map_adj(BinaryOp op) const
+      -> fusion_array<thrust::transform_iterator<
+        thrust::zip_function<BinaryOp>,
+        thrust::zip_iterator<thrust::tuple<Iterator, Iterator>>>> {
+        auto zip_begin = thrust::make_zip_iterator(
+          thrust::make_tuple(_begin, _begin + 1));
+        auto transform_begin = thrust::make_transform_iterator(
+          zip_begin, thrust::make_zip_function(op));
+
+        using return_type = fusion_array<decltype(transform_begin)>;
+
+        // If we don't have at least 2 elements, return empty array type
+        if (size() < 2) {
+            return return_type(
+              transform_begin, transform_begin, _owned_storage);
+        }
+
+        // Return a new array with one fewer element (since we're processing
+        // pairs)
+        return return_type(
+          transform_begin, transform_begin + (size() - 1), _owned_storage);
+    }
+
+    /**
+     * @brief Check if adjacent elements are different
+     * @return A new fusion_array containing 1 where adjacent elements differ,
+     * 0 otherwise
+     */
+    [[nodiscard]] auto differ() const { return map_adj(parrot::neq{}); }
+
+    /**
+     * @brief Compute differences between adjacent elements
+     * @return A new fusion_array containing the differences
+     */
+    [[nodiscard]] auto deltas() const { return map_adj(delta{}); }
+
+    /**
+     * @brief Double each element (multiply by 2)
+     * @return A new fusion_array with doubled values
+     */
+    [[nodiscard]] auto dble() const {
+        return map(double_functor<value_type>());
+    }
+
+    /**
+     * @brief Halve each element (divide by 2)
+     * @return A new fusion_array with halved values
+     */
+    [[nodiscard]] auto half() const { return map(half_functor<value_type>()); }
+
+    /**
+     * @brief Calculate absolute value of each element
+     * @return A new fusion_array with absolute values
+     */
+    [[nodiscard]] auto abs() const { return map(abs_functor<value_type>()); }
+
+    /**
+     * @brief Calculate natural logarithm of each element
+     * @return A new fusion_array with logarithm values
+     */
+    [[nodiscard]] auto log() const { return map(log_functor<value_type>()); }
+
+    /**
+     * @brief Calculate exponential of each element
+     * @return A new fusion_array with exponential values
+     */
+    [[nodiscard]] auto exp() const { return map(exp_functor<value_type>()); }
+
+    /**
+     * @brief Check if each element is odd
+     * @return A new fusion_array containing 1 for odd elements, 0 for even
+     */
+    [[nodiscard]] auto neg() const { return map(thrust::negate<value_type>()); }
+
+    /**
+     * @brief Check if each element is odd
+     * @return A new fusion_array containing 1 for odd elements, 0 for even
+     */
+    [[nodiscard]] auto odd() const { return map(odd_functor<value_type>()); }
+
+    /**
+     * @brief Check if each element is even
+     * @return A new fusion_array containing 1 for even elements, 0 for odd
+     */
+    [[nodiscard]] auto even() const { return map(even_functor<value_type>()); }
+
+    /**
+     * @brief Get sign of each element
+     * @return A new fusion_array containing 1 for positive, 0 for zero, -1 for
+     * negative
+     */
+    [[nodiscard]] auto sign() const { return map(sign_functor<value_type>()); }
+
+    /**
+     * @brief Calculate square root of each element
+     * @return A new fusion_array with square root values
+     */
+    [[nodiscard]] auto sqrt() const { return map(sqrt_functor<value_type>()); }
+
+    /**
+     * @brief Square each element
+     * @return A new fusion_array with squared values
+     */
+    [[nodiscard]] auto sq() const { return map(sq_functor<value_type>()); }
+
+    /**
+     * @brief Cast each element to a different type
+     * @tparam TargetType The target type to cast elements to
+     * @return A new fusion_array with elements cast to the target type
+     */
+    template <typename TargetType>
+    [[nodiscard]] auto as() const {
+        return map(cast_functor<TargetType, value_type>());
+    }
+
+    /**
+     * @brief Generate random values between 0 and each element
+     * @return A new fusion_array with random values
+     * @details Draws from a fresh seed on every call; use rand(seed) for
+     * reproducible values.
+     */
+    [[nodiscard]] auto rand() const { return rand(detail::entropy_seed()); }
+
+    /**
+     * @brief Generate reproducible random values between 0 and each element
+     * (lazy operation)
+     * @param seed Key of the Philox4x32-10 stream
+     * @param offset Number of stream elements to skip
+     * @return A new fusion_array whose element i is element offset + i of
+     * the uniform stream for seed, scaled by element i of this array
+     * @details The same seed and offset give the same values on every run,
+     * and scalar(1.F).repeat(n).rand(seed) matches
+     * random::uniform(n, seed).
+     */
+    [[nodiscard]] auto rand(std::uint64_t seed,
+                            std::uint64_t offset = 0) const {
+        // Create a counting iterator for indices
+        auto indices = thrust::make_counting_iterator<index_t>(0);
+
+        // Create a zip iterator combining indices with the array values
+        auto zip_begin = thrust::make_zip_iterator(
+          thrust::make_tuple(indices, _begin));
+        auto zip_end = thrust::make_zip_iterator(
+          thrust::make_tuple(indices + size(), _end));
+
+        // Create a transform iterator that applies the random functor
+        using RandFunc = rand_functor<value_type>;
+
+        return fusion_array<
+          thrust::transform_iterator<RandFunc, decltype(zip_begin)>>(
+          thrust::make_transform_iterator(zip_begin, RandFunc{seed, offset}),
+          thrust::make_transform_iterator(zip_end, RandFunc{seed, offset}),
+          _owned_storage,
+          _shape);
+    }
+
+    /**
+     * @brief Get the size of the array
+     * @return The number of elements
+     */
+    [[nodiscard]] auto size() const -> index_t {
+        detail::bind_scope const scope(_context);
+        if constexpr (has_mask) {
+            // For masked arrays, count the number of non-zero mask elements
+            auto mask_begin = _mask_range.first;
+            auto mask_end   = _mask_range.second;
+            return thrust::count_if(detail::blocking_policy(),
+                                    mask_begin,
+                                    mask_end,
+                                    cuda::std::identity{});
+        } else {
+            return cuda::std::distance(_begin, _end);
+        }
+    }
+
+    /**
+     * @brief Append a value to the array
+     * @param value The value to append
+     * @return A new fusion_array with the appended value
+     */
+    template <typename T = int>
+    auto append(T value) const {
+        if constexpr (has_mask) {
+            // Apply mask first, then append
+            auto unmasked = _apply_mask_if_needed();
+            return unmasked.append(value);
+        } else {
+            index_t const n     = size();
+            auto appended_begin = thrustx::make_append_iterator(
+              _begin, n, value);
+
+            return fusion_array<decltype(appended_begin)>(
+              appended_begin,
+              appended_begin + n + 1,
+              _owned_storage  // Pass ownership to derived array
+            );
+        }
+    }
+
+    /**
+     * @brief Prepend a value to the array
+     * @param value The value to prepend
+     * @return A new fusion_array with the prepended value
+     */
+    template <typename T = int>
+    auto prepend(T value) const {
+        if constexpr (has_mask) {
+            // Apply mask first, then prepend
+            auto unmasked = _apply_mask_if_needed();
+            return unmasked.prepend(value);
+        } else {
+            index_t const n      = size();
+            auto prepended_begin = thrustx::make_prepend_iterator(
+              _begin, n, value);
+
+            return fusion_array<decltype(prepended_begin)>(
+              prepended_begin,
+              prepended_begin + n + 1,
+              _owned_storage  // Pass ownership to derived array
+            );
+        }
+    }
+
+    /**
+     * @brief Sort the array (eager operation)
+     * @return A new fusion_array with sorted elements
+     * @details Arithmetic types use CUB's radix sort directly on the input.
+     */
+    [[nodiscard]] auto sort() const { return _sort(false); }
+
+    /**
+     * @brief Sort the array in descending order (eager operation)
+     * @return A new fusion_array with elements from largest to smallest
+     * @details Descending order is a flag of the radix sort, so this costs
+     * the same as sort() and avoids a separate rev() pass.
+     */
+    [[nodiscard]] auto sort_desc() const { return _sort(true); }
+
+    /**
+     * @brief Sort each row of a matrix independently (eager operation)
+     * @param axis integral_constant selecting the axis; only 2 (rows) is
+     * supported, e.g. matrix.sort(2_ic)
+     * @return A new fusion_array with the same shape and sorted rows
+     * @details Uses CUB's segmented sort, one segment per row.
+     */
+    template <int Axis>
+    [[nodiscard]] auto sort(std::integral_constant<int, Axis> /*axis*/) const {
+        return _sort_rows<Axis>(false);
+    }
+
+    /**
+     * @brief Sort each row of a matrix in descending order (eager operation)
+     * @param axis integral_constant selecting the axis; only 2 (rows) is
+     * supported
+     * @return A new fusion_array with the same shape and rows sorted from
+     * largest to smallest
+     */
+    template <int Axis>
+    [[nodiscard]] auto sort_desc(
+      std::integral_constant<int, Axis> /*axis*/) const {
+        return _sort_rows<Axis>(true);
+    }
+
+    /**
+     * @brief Sort the array using a custom comparator (eager operation)
+     * @param comp The binary comparator to use for sorting
+     * @return A new fusion_array with sorted elements
+     */
+    template <typename BinaryComp>
+    auto sort_by(BinaryComp comp) const {
+        detail::bind_scope const scope(_context);
+        index_t n = size();
+
+        // Create a new device vector and take ownership of it
+        auto sorted_data = detail::make_buffer<value_type>(n);
+
+        detail::evaluate_into(_begin, n, sorted_data->data(), _owned_storage);
+        thrust::sort(
+          detail::policy(), sorted_data->begin(), sorted_data->end(), comp);
+
+        // Return a new fusion_array with ownership of the sorted data; it is
+        // not flagged as sorted since comp need not be ascending
+        return fusion_array<
+          typename device_buffer<value_type>::iterator>(
+          sorted_data->begin(), sorted_data->end(), sorted_data);
+    }
+
+    /**
+     * @brief Sort the array based on keys produced by a unary function (eager
+     * operation)
+     * @param key_func The unary function to extract keys for comparison
+     * @return A new fusion_array with sorted elements
+     * @details Keys are computed once per element. Arithmetic keys use a
+     * stable CUB radix sort of (key, value) pairs; other keys fall back to a
+     * stable merge sort, so elements with equal keys keep their order.
+     */
+    template <typename KeyFunc>
+    auto sort_by_key(KeyFunc key_func) const
+      -> fusion_array<typename device_buffer<
+        typename cuda::std::iterator_traits<Iterator>::value_type>::iterator> {
+        return _sort_by_key(key_func, false);
+    }
+
+    /**
+     * @brief Sort the array by descending keys produced by a unary function
+     * (eager operation)
+     * @param key_func The unary function to extract keys for comparison
+     * @return A new fusion_array with elements ordered by descending key
+     */
+    template <typename KeyFunc>
+    auto sort_by_key_desc(KeyFunc key_func) const
+      -> fusion_array<typename device_buffer<
+        typename cuda::std::iterator_traits<Iterator>::value_type>::iterator> {
+        return _sort_by_key(key_func, true);
+    }
+
+    /**
+     * @brief Select the k largest elements (eager operation)
+     * @param k Number of elements to keep; clamped to the array size
+     * @return A fusion_array of (value, index) pairs, largest value first
+     * @details Produces the same result as enumerate().sort().rev().take(k):
+     * indices are 1-based and equal values come out highest index first.
+     * A radix select finds the k-th largest value, so only the k winners are
+     * sorted instead of the whole array.
+     */
+    [[nodiscard]] auto topk(int k) const {
+        return topk(k, std::integral_constant<int, 0>{});
+    }
+
+    /**
+     * @brief Select the k largest elements along an axis (eager operation)
+     * @tparam Axis 0 for the whole array, 2 for each row of a matrix
+     * @param k Number of elements to keep; clamped to the array size (axis 0)
+     * or the row length (axis 2)
+     * @param axis integral_constant selecting the axis (allows 2_ic syntax)
+     * @return A fusion_array of (value, index) pairs; for axis 2 its shape is
+     * {rows, k} and indices are 1-based column positions
+     */
+    template <int Axis>
+    [[nodiscard]] auto topk(int k,
+                            std::integral_constant<int, Axis> /*axis*/) const {
+        static_assert(Axis == 0 || Axis == 2,
+                      "topk supports axis 0 (all) and 2 (rows)");
+        static_assert(std::is_arithmetic_v<value_type>,
+                      "topk requires an arithmetic value type");
+        detail::bind_scope const scope(_context);
+        if (k < 0) { throw std::invalid_argument("topk: k must be >= 0"); }
+
+        index_t rows = 1;
+        index_t cols = size();
+        if constexpr (Axis == 2) {
+            if (_shape.size() < 2) {
+                throw std::runtime_error(
+                  "Cannot perform row-wise topk on array with rank < 2");
+            }
+            rows = _shape[0];
+            cols = _shape[1];
+        }
+        k = static_cast<int>(std::min<index_t>(k, cols));
+
+        std::shared_ptr<void> input;
+        auto const *data  = _device_data(input);
+        auto const count  = static_cast<std::size_t>(rows) * k;
+        auto values       = detail::make_buffer<value_type>(count);
+        auto indices      = detail::make_buffer<int>(count);
+        auto *out_values  = thrust::raw_pointer_cast(values->data());
+        auto *out_indices = thrust::raw_pointer_cast(indices->data());
+        if constexpr (Axis == 0) {
+            thrustx::topk(data,
+                          cols,
+                          k,
+                          out_values,
+                          out_indices,
+                          1,
+                          detail::temp_allocator{},
+                          detail::current_stream());
+        } else {
+            thrustx::topk_rows(data,
+                               rows,
+                               cols,
+                               k,
+                               out_values,
+                               out_indices,
+                               1,
+                               detail::temp_allocator{},
+                               detail::current_stream());
+        }
+
+        auto const shape = Axis == 2 ? std::vector<index_t>{rows, k}
+                                     : std::vector<index_t>{k};
+        return _pair_columns(values, indices, shape);
+    }
+
+    /**
+     * @brief Row-wise softmax (eager operation)
+     * @param axis integral_constant selecting the axis; only 2 (rows) is
+     * supported, e.g. matrix.softmax(2_ic)
+     * @return A fusion_array with the same shape, each row summing to 1
+     * @details Fused, numerically stable kernel: the row max, the sum of
+     * exponentials and the normalization take one pass over the input, with
+     * the row held in shared memory. Integer inputs produce float results.
+     */
+    template <int Axis>
+    [[nodiscard]] auto softmax(
+      std::integral_constant<int, Axis> /*axis*/) const {
+        static_assert(Axis == 2, "softmax supports axis 2 (rows)");
+        return _normalize_rows<thrustx::row_normalize::softmax>("softmax");
+    }
+
+    /**
+     * @brief Row-wise log-softmax (eager operation)
+     * @param axis integral_constant selecting the axis; only 2 (rows) is
+     * supported
+     * @return A fusion_array with the same shape holding x - logsumexp(row)
+     */
+    template <int Axis>
+    [[nodiscard]] auto log_softmax(
+      std::integral_constant<int, Axis> /*axis*/) const {
+        static_assert(Axis == 2, "log_softmax supports axis 2 (rows)");
+        return _normalize_rows<thrustx::row_normalize::log_softmax>(
+          "log_softmax");
+    }
+
+    /**
+     * @brief Row-wise log-sum-exp (eager operation)
+     * @param axis integral_constant selecting the axis; only 2 (rows) is
+     * supported
+     * @return A fusion_array with one value per row, log(sum(exp(row)))
+     * computed without overflow
+     */
+    template <int Axis>
+    [[nodiscard]] auto logsumexp(
+      std::integral_constant<int, Axis> /*axis*/) const {
+        static_assert(Axis == 2, "logsumexp supports axis 2 (rows)");
+        return _normalize_rows<thrustx::row_normalize::logsumexp>(
+          "logsumexp");
+    }
+
+    /**
+     * @brief Generic reduction with custom binary operation (eager operation)
+     * @tparam Axis The axis along which to reduce (0=all elements,
+     * 1=column-wise, 2=row-wise)
+     * @param init The initial value for the reduction
+     * @param op The binary operation to apply for reduction
+     * @param axis Optional integral_constant parameter for axis (allows 2_ic
+     * syntax)
+     * @return A fusion_array containing the reduction result(s)
+     */
+    template <int Axis = 0, typename T, typename BinaryOp>
+    auto reduce(T init,
+                BinaryOp op,
+                std::integral_constant<int, Axis> /*axis*/ = {}) const {
+        detail::bind_scope const scope(_context);
+        using value_type = typename std::iterator_traits<Iterator>::value_type;
+        detail::note_evaluation(
+          _owned_storage, _begin, _end - _begin, "reduce");
+
+        if constexpr (has_mask) {
+            return _reduce_masked<Axis>(init, op);
+        } else if constexpr (Axis == 0) {
+            // Default reduction (all elements)
+            // Reduce into a device-resident scalar so the result can feed
+            // further lazy operations without a host round-trip; only
+            // value() waits for it
+            auto result_vec = detail::make_buffer<T>(1);
+            thrustx::reduce_into(_begin,
+                                 _end,
+                                 result_vec->begin(),
+                                 op,
+                                 init,
+                                 detail::temp_allocator{},
+                                 detail::current_stream());
+
+            auto result_begin = detail::make_device_scalar_iterator(
+              *result_vec);
+            return fusion_array<device_scalar_iterator<T>>(
+              result_begin,
+              result_begin + 1,
+              result_vec,
+              std::vector<index_t>{});
+        } else if constexpr (Axis == 2) {
+            // Row-wise reduction (for 2D arrays)
+            if (_shape.size() < 2) {
+                throw std::runtime_error(
+                  "Cannot perform row-wise reduction on array with rank < 2");
+            }
+
+            index_t num_rows = _shape[0];
+            index_t num_cols = _shape[1];
+
+            auto result_vec = detail::make_buffer<value_type>(num_rows);
+
+            // Perform row-wise reduction using reduce_by_key
+            auto output = result_vec->begin();
+
+            thrustx::reduce_by_n(_begin,
+                                 _end,
+                                 output,
+                                 num_cols,
+                                 op,
+                                 init,
+                                 detail::temp_allocator{},
+                                 detail::current_stream());
+
+            // Return result as fusion_array
+            return fusion_array<
+              typename device_buffer<value_type>::iterator>(
+              result_vec->begin(),
+              result_vec->end(),
+              result_vec,
+              std::vector<index_t>{num_rows});
+        } else if constexpr (Axis == 1) {
+            // Column-wise reduction (for 2D arrays)
+            if (rank() != 2) {
+                throw std::runtime_error(
+                  "Cannot perform column-wise reduction on array with rank "
+                  "!= 2");
+            }
+
+            index_t num_rows = _shape[0];
+            index_t num_cols = _shape[1];
+
+            auto result_vec = detail::make_buffer<value_type>(num_cols);
+
+            // Accumulate each column in registers; rows are read coalesced
+            thrustx::reduce_columns(
+              _begin,
+              num_rows,
+              num_cols,
+              thrust::raw_pointer_cast(result_vec->data()),
+              op,
+              init,
+              detail::temp_allocator{},
+              detail::current_stream());
+
+            return fusion_array<
+              typename device_buffer<value_type>::iterator>(
+              result_vec->begin(),
+              result_vec->end(),
+              result_vec,
+              std::vector<index_t>{num_cols});
+        } else {
+            static_assert(Axis == 0 || Axis == 1 || Axis == 2,
+                          "Invalid axis value. Must be 0, 1 or 2.");
+            // This will never be reached due to static_assert, but needed for
+            // compilation
+            return fusion_array<typename device_buffer<T>::iterator>();
+        }
+    }
+
+    /**
+     * @brief Maximum reduction (eager operation)
+     * @tparam Axis The axis along which to reduce (0=all elements,
+     * 1=column-wise, 2=row-wise)
+     * @param axis Optional integral_constant parameter for axis (allows 2_ic
+     * syntax)
+     * @return A fusion_array containing the maximum value(s)
+     * @details The maximum of an array known to be sorted (see is_sorted())
+     * is read from its last element without a reduction.
+     */
+    template <int Axis = 0, typename T = int>
+    [[nodiscard]] auto maxr(
+      std::integral_constant<int, Axis> /*axis*/ = {}) const {
+        if constexpr (is_reduced_precision_v<value_type>) {
+            // Accumulate in float (numeric_limits is not specialized for
+            // the reduced-precision types)
+            return as<float>().template maxr<Axis>();
+        } else {
+            if constexpr (Axis == 0 && !has_mask) {
+                if (_is_sorted) {
+                    return _sorted_extreme(
+                      true, std::numeric_limits<value_type>::lowest());
+                }
+            }
+            return reduce<Axis>(std::numeric_limits<value_type>::lowest(),
+                                thrust::maximum<value_type>());
+        }
+    }
+
+    /**
+     * @brief Minimum reduction (eager operation)
+     * @tparam Axis The axis along which to reduce (0=all elements,
+     * 1=column-wise, 2=row-wise)
+     * @param axis Optional integral_constant parameter for axis (allows 2_ic
+     * syntax)
+     * @return A fusion_array containing the minimum value(s)
+     * @details The minimum of an array known to be sorted (see is_sorted())
+     * is read from its first element without a reduction.
+     */
+    template <int Axis = 0, typename T = int>
+    [[nodiscard]] auto minr(
+      std::integral_constant<int, Axis> /*axis*/ = {}) const {
+        if constexpr (is_reduced_precision_v<value_type>) {
+            return as<float>().template minr<Axis>();
+        } else {
+            if constexpr (Axis == 0 && !has_mask) {
+                if (_is_sorted) {
+                    return _sorted_extreme(
+                      false, std::numeric_limits<value_type>::max());
+                }
+            }
+            return reduce<Axis>(std::numeric_limits<value_type>::max(),
+                                thrust::minimum<value_type>());
+        }
+    }
+
+    /**
+     * @brief Sum reduction (eager operation)
+     * @tparam Axis The axis along which to reduce (0=all elements,
+     * 1=column-wise, 2=row-wise)
+     * @param axis Optional integral_constant parameter for axis (allows 2_ic
+     * syntax)
+     * @return A fusion_array containing the sum of elements
+     */
+    template <int Axis = 0, typename T = int>
+    [[nodiscard]] auto sum(
+      std::integral_constant<int, Axis> /*axis*/ = {}) const {
+        if constexpr (is_reduced_precision_v<value_type>) {
+            return as<float>().template sum<Axis>();
+        } else {
+            return reduce<Axis>(value_type(0), thrust::plus<value_type>());
+        }
+    }
+
+    /**
+     * @brief Check if any element is non-zero (eager operation)
+     * @tparam Axis The axis along which to reduce (0=all elements,
+     * 1=column-wise, 2=row-wise)
+     * @param axis Optional integral_constant parameter for axis (allows 2_ic
+     * syntax)
+     * @return A fusion_array containing true if any element is non-zero, false
+     * otherwise
+     */
+    template <int Axis = 0, typename T = int>
+    [[nodiscard]] auto any(
+      std::integral_constant<int, Axis> /*axis*/ = {}) const {
+        return reduce<Axis>(0, thrust::logical_or<int>());
+    }
+
+    /**
+     * @brief Check if all elements are non-zero (eager operation)
+     * @tparam Axis The axis along which to reduce (0=all elements,
+     * 1=column-wise, 2=row-wise)
+     * @param axis Optional integral_constant parameter for axis (allows 2_ic
+     * syntax)
+     * @return A fusion_array containing true if all elements are non-zero,
+     * false otherwise
+     */
+    template <int Axis = 0, typename T = int>
+    [[nodiscard]] auto all(
+      std::integral_constant<int, Axis> /*axis*/ = {}) const {
+        return reduce<Axis>(1, thrust::logical_and<int>());
+    }
+
+    /**
+     * @brief Compute several reductions in a single pass (eager operation)
+     * @tparam Axis The axis along which to reduce (0=all elements,
+     * 1=column-wise, 2=row-wise)
+     * @param axis integral_constant selecting the axis (allows 2_ic syntax)
+     * @param reducers The reducers to run, e.g. agg::sum{}, agg::min{},
+     * agg::max{}, agg::count{}, agg::mean{}, agg::var{}
+     * @return A std::tuple with one fusion_array per reducer (rank 0 for
+     * Axis 0, one value per row for Axis 2), all sharing the storage of the
+     * single reduction
+     * @details The lazy expression is evaluated once; each element is lifted
+     * into a tuple of reducer states that is combined associatively.
+     */
+    template <int Axis, typename... Reducers>
+        requires(sizeof...(Reducers) > 0 &&
+                 (std::is_base_of_v<agg::reducer, Reducers> && ...))
+    auto reduce_many([[maybe_unused]] std::integral_constant<int, Axis> axis,
+                     Reducers... reducers) const {
+        detail::bind_scope const scope(_context);
+        using state_type = thrust::tuple<
+          typename Reducers::template state_type<value_type>...>;
+        auto const init = state_type(
+          Reducers{}.template identity<value_type>()...);
+
+        // map() keeps the mask, so masked arrays reduce without compaction
+        auto const states = map(detail::reduce_many_lift<value_type,
+                                                         Reducers...>())
+                              .template reduce<Axis>(
+                                init,
+                                detail::reduce_many_combine<Reducers...>());
+
+        return _finalize_many<Reducers...>(
+          states, std::index_sequence_for<Reducers...>{});
+    }
+
+    /**
+     * @brief Compute several reductions over all elements in a single pass
+     * @param reducers The reducers to run (see reduce_many above)
+     * @return A std::tuple with one rank-0 fusion_array per reducer
+     */
+    template <typename... Reducers>
+        requires(sizeof...(Reducers) > 0 &&
+                 (std::is_base_of_v<agg::reducer, Reducers> && ...))
+    auto reduce_many(Reducers... reducers) const {
+        return reduce_many(std::integral_constant<int, 0>{}, reducers...);
+    }
+
+    /**
+     * @brief Get the first value (useful for extracting reduction results)
+     * @return The first value in the array, properly handling thrust pairs
+     */
+    [[nodiscard]] auto value() const {
+        detail::bind_scope const scope(_context);
+        _synchronize();
+        // Dereferencing device memory is a blocking one-element copy
+        detail::count_sync();
+        detail::count_d2h(sizeof(extract_value_type_t<value_type>));
+        if constexpr (is_thrust_pair_v<value_type>) {
+            // For thrust pairs, explicitly copy device_reference to host pair
+            using pair_type = typename cuda::std::iterator_traits<
+              Iterator>::value_type;
+            thrust::pair<typename pair_type::first_type,
+                         typename pair_type::second_type>
+              host_pair = *_begin;
+            return host_pair;
+        } else {
+            // Also converts device-resident scalars to a host value
+            return static_cast<extract_value_type_t<value_type>>(*_begin);
+        }
+    }
+
+    /**
+     * @brief Get the first element of the array
+     * @return The first element in the array
+     */
+    [[nodiscard]] auto front() const {
+        detail::bind_scope const scope(_context);
+        _synchronize();
+        using host_value_type = extract_value_type_t<value_type>;
+        if constexpr (has_mask) {
+            // Apply mask first
+            auto unmasked = _apply_mask_if_needed();
+            return static_cast<host_value_type>(unmasked.front());
+        }
+        detail::count_sync();
+        detail::count_d2h(sizeof(host_value_type));
+        return static_cast<host_value_type>(*_begin);
+    }
+
+    /**
+     * @brief Get the last element of the array
+     * @return The last element in the array
+     */
+    [[nodiscard]] auto back() const {
+        detail::bind_scope const scope(_context);
+        _synchronize();
+        using host_value_type = extract_value_type_t<value_type>;
+        if constexpr (has_mask) {
+            // Apply mask first and convert to host type
+            auto unmasked = _apply_mask_if_needed();
+            return static_cast<host_value_type>(unmasked.back());
+        }
+        detail::count_sync();
+        detail::count_d2h(sizeof(host_value_type));
+        // Convert to consistent host type
+        return static_cast<host_value_type>(*(_end - 1));
+    }
+
+#ifdef DLPACK_VERSION
+    /**
+     * @brief Export the array as a DLPack tensor
+     * @return A DLManagedTensor on the current CUDA device; the consumer
+     * calls its deleter when done
+     * @details Arrays over plain device memory are exported without copying
+     * and stay alive until the deleter runs; lazy and masked arrays are
+     * evaluated into a new buffer first. Available when <dlpack/dlpack.h> is
+     * on the include path.
+     */
+    [[nodiscard]] auto to_dlpack() const -> DLManagedTensor * {
+        detail::bind_scope const scope(_context);
+        auto ctx         = std::make_unique<detail::dlpack_export>();
+        auto const *data = _device_data(ctx->storage);
+        // The consumer may read on any stream
+        detail::throw_if_capturing(detail::current_stream(), "to_dlpack");
+        detail::count_sync();
+        detail::throw_on_cuda_error(
+          cudaStreamSynchronize(detail::current_stream()), "to_dlpack");
+
+        if constexpr (has_mask) {
+            ctx->shape.push_back(size());
+        } else {
+            ctx->shape.assign(_shape.begin(), _shape.end());
+        }
+        int device = 0;
+        detail::throw_on_cuda_error(cudaGetDevice(&device), "to_dlpack");
+
+        DLTensor &t   = ctx->tensor.dl_tensor;
+        t.data        = const_cast<value_type *>(data);  // NOLINT
+        t.device      = {kDLCUDA, device};
+        t.ndim        = static_cast<std::int32_t>(ctx->shape.size());
+        t.dtype       = detail::dlpack_dtype<value_type>();
+        t.shape       = ctx->shape.data();
+        t.strides     = nullptr;
+        t.byte_offset = 0;
+
+        ctx->tensor.manager_ctx = ctx.get();
+        ctx->tensor.deleter     = [](DLManagedTensor *m) {
+            delete static_cast<detail::dlpack_export *>(m->manager_ctx);
+        };
+        return &ctx.release()->tensor;
+    }
+#endif  // DLPACK_VERSION
+
+    /**
+     * @brief Copy elements from device to host memory
+     * @return A std::vector containing the host-side values
+     * @details The array is evaluated with one kernel into a staging buffer
+     * (or read in place if it already is contiguous device memory) and moved
+     * to the host with a single bulk copy.
+     */
+    [[nodiscard]] auto to_host() const {
+        using host_value_type = extract_value_type_t<value_type>;
+        if constexpr (has_mask) {
+            // Apply mask first
+            auto unmasked = _apply_mask_if_needed();
+            return unmasked.to_host();
+        } else if constexpr (std::is_same_v<host_value_type, bool>) {
+            // std::vector<bool> is bit-packed, so copy through a plain buffer
+            auto const n       = static_cast<std::size_t>(size());
+            auto const staging = std::make_unique<bool[]>(n);
+            to_host(staging.get());
+            return std::vector<bool>(staging.get(), staging.get() + n);
+        } else {
+            std::vector<host_value_type> host_vector(size());
+            to_host(host_vector.data());
+            return host_vector;
+        }
+    }
+
+    /**
+     * @brief Copy elements from device to caller-supplied host memory
+     * @param out Host buffer with room for size() elements. Pinned memory
+     * (cudaMallocHost) avoids an extra driver-side staging copy.
+     */
+    void to_host(extract_value_type_t<value_type> *out) const {
+        detail::bind_scope const scope(_context);
+        if constexpr (has_mask) {
+            _apply_mask_if_needed().to_host(out);
+        } else {
+            auto const n = static_cast<std::size_t>(size());
+            if (n == 0) { return; }
+            auto const stream = detail::current_stream();
+            auto keepalive    = _copy_to_host_async(out, stream);
+            detail::count_sync();
+            detail::throw_on_cuda_error(cudaStreamSynchronize(stream),
+                                        "to_host");
+        }
+    }
+
+    /**
+     * @brief Start an asynchronous copy of the elements to the host
+     * @return A std::future that yields the host-side values. The copy is
+     * queued on the array's stream immediately; get() only waits for it.
+     */
+    [[nodiscard]] auto to_host_async() const
+      -> std::future<std::vector<extract_value_type_t<value_type>>> {
+        using host_value_type = extract_value_type_t<value_type>;
+        detail::bind_scope const scope(_context);
+        if constexpr (has_mask) {
+            return _apply_mask_if_needed().to_host_async();
+        } else {
+            auto const n      = static_cast<std::size_t>(size());
+            auto const stream = detail::current_stream();
+            auto pending = std::make_shared<
+              detail::pending_host_copy<host_value_type>>(n);
+            if (n > 0) {
+                pending->record(stream,
+                                _copy_to_host_async(pending->data(), stream));
+            }
+            return std::async(std::launch::deferred, [pending]() {
+                pending->wait();
+                return std::vector<host_value_type>(
+                  pending->data(), pending->data() + pending->size());
+            });
+        }
+    }
+
+    /**
+     * @brief Product reduction (eager operation)
+     * @tparam Axis The axis along which to reduce (0=all elements,
+     * 1=column-wise, 2=row-wise)
+     * @return A fusion_array containing the product of elements
+     */
+    template <int Axis = 0, typename T = int>
+    [[nodiscard]] auto prod() const {
+        if constexpr (is_reduced_precision_v<value_type>) {
+            return as<float>().template prod<Axis>();
+        } else {
+            return reduce<Axis>(value_type(1),
+                                thrust::multiplies<value_type>());
+        }
+    }
+
+    /**
+     * @brief Get indices where elements are non-zero (lazy operation)
+     * @return A masked fusion_array containing the 1-indexed positions where
+     * elements are non-zero
+     */
+    [[nodiscard]] auto where() const { return range(size()).keep(*this); }
+
+    /**
+     * @brief Filter elements based on a mask array (lazy operation)
+     * @param mask The mask array (elements kept where mask is non-zero)
+     * @return A masked fusion_array that will filter elements when evaluated
+     */
+    template <typename MaskIteratorKeep>
+    auto keep(const fusion_array<MaskIteratorKeep> &mask) const {
+        index_t n = size();
+
+        // Size check - the mask must be the same size as the array
+        if (n != mask.size()) {
+            throw std::invalid_argument("Mask size must match array size");
+        }
+
+        // Keep the mask array alive to prevent iterator invalidation
+        auto mask_source = std::make_shared<fusion_array<MaskIteratorKeep>>(
+          mask);
+
+        return fusion_array<Iterator, MaskIteratorKeep>(
+          _begin,
+          _end,
+          _owned_storage,
+          mask_source->begin(),
+          mask_source->end(),
+          mask_source);  // Pass mask storage to keep it alive
+    }
+
+    /**
+     * @brief Gather elements from this array using the provided indices
+     * @param indices Array of indices to gather from
+     * @return A new fusion_array containing the gathered elements
+     */
+    template <typename IndexIterator>
+    auto gather(const fusion_array<IndexIterator> &indices) const {
+        auto begin = thrust::make_permutation_iterator(_begin, indices.begin());
+        auto end   = thrust::make_permutation_iterator(_begin, indices.end());
+        return fusion_array<decltype(begin)>(begin, end);
+    }
+
+    /**
+     * @brief Check if arrays match element by element (eager operation)
+     * @param other The array to compare with
+     * @return True if arrays match exactly, false otherwise
+     */
+    template <typename OtherIterator>
+    auto match(const fusion_array<OtherIterator> &other) const -> bool {
+        detail::bind_scope const scope(_context);
+        // Check if sizes match
+        if (size() != other.size()) { return false; }
+
+        // Compare elements
+        return thrust::equal(
+          detail::blocking_policy(), _begin, _end, other.begin());
+    }
+
+    /**
+     * @brief Inclusive scan with logical OR (eager operation)
+     * @tparam Axis The axis along which to scan (0=all elements, 1=column-wise,
+     * 2=row-wise)
+     * @param axis Optional integral_constant parameter for axis (allows 2_ic
+     * syntax)
+     * @return A new fusion_array containing running OR of elements
+     */
+    template <int Axis = 0>
+    [[nodiscard]] auto anys(
+      std::integral_constant<int, Axis> /*axis*/ = {}) const {
+        return scan<Axis>(thrust::logical_or<value_type>());
+    }
+
+    /**
+     * @brief Inclusive scan with logical AND (eager operation)
+     * @tparam Axis The axis along which to scan (0=all elements, 1=column-wise,
+     * 2=row-wise)
+     * @param axis Optional integral_constant parameter for axis (allows 2_ic
+     * syntax)
+     * @return A new fusion_array containing running AND of elements
+     */
+    template <int Axis = 0>
+    [[nodiscard]] auto alls(
+      std::integral_constant<int, Axis> /*axis*/ = {}) const {
+        return scan<Axis>(thrust::logical_and<value_type>());
+    }
+
+    /**
+     * @brief Inclusive scan with minimum (eager operation)
+     * @tparam Axis The axis along which to scan (0=all elements, 1=column-wise,
+     * 2=row-wise)
+     * @param axis Optional integral_constant parameter for axis (allows 2_ic
+     * syntax)
+     * @return A new fusion_array containing running minimum of elements
+     */
+    template <int Axis = 0>
+    [[nodiscard]] auto mins(
+      std::integral_constant<int, Axis> /*axis*/ = {}) const {
+        if constexpr (is_reduced_precision_v<value_type>) {
+            return as<float>().template mins<Axis>();
+        } else {
+            return scan<Axis>(thrust::minimum<value_type>());
+        }
+    }
+
+    /**
+     * @brief Inclusive scan with maximum (eager operation)
+     * @tparam Axis The axis along which to scan (0=all elements, 1=column-wise,
+     * 2=row-wise)
+     * @param axis Optional integral_constant parameter for axis (allows 2_ic
+     * syntax)
+     * @return A new fusion_array containing running maximum of elements
+     */
+    template <int Axis = 0>
+    [[nodiscard]] auto maxs(
+      std::integral_constant<int, Axis> /*axis*/ = {}) const {
+        if constexpr (is_reduced_precision_v<value_type>) {
+            return as<float>().template maxs<Axis>();
+        } else {
+            // A running maximum is ascending, but only along the whole array
+            if constexpr (Axis == 0) {
+                return scan<Axis>(thrust::maximum<value_type>())._mark_sorted();
+            } else {
+                return scan<Axis>(thrust::maximum<value_type>());
+            }
+        }
+    }
+
+    /**
+     * @brief Inclusive scan with addition (eager operation)
+     * @tparam Axis The axis along which to scan (0=all elements, 1=column-wise,
+     * 2=row-wise)
+     * @param axis Optional integral_constant parameter for axis (allows 2_ic
+     * syntax)
+     * @return A new fusion_array containing running sum of elements
+     */
+    template <int Axis = 0>
+    [[nodiscard]] auto sums(
+      std::integral_constant<int, Axis> /*axis*/ = {}) const {
+        if constexpr (is_reduced_precision_v<value_type>) {
+            return as<float>().template sums<Axis>();
+        } else {
+            return scan<Axis>(thrust::plus<value_type>());
+        }
+    }
+
+    /**
+     * @brief Inclusive scan with multiplication (eager operation)
+     * @tparam Axis The axis along which to scan (0=all elements, 1=column-wise,
+     * 2=row-wise)
+     * @param axis Optional integral_constant parameter for axis (allows 2_ic
+     * syntax)
+     * @return A new fusion_array containing running product of elements
+     */
+    template <int Axis = 0>
+    [[nodiscard]] auto prods(
+      std::integral_constant<int, Axis> /*axis*/ = {}) const {
+        if constexpr (is_reduced_precision_v<value_type>) {
+            return as<float>().template prods<Axis>();
+        } else {
+            return scan<Axis>(thrust::multiplies<value_type>());
+        }
+    }
+
+    /**
+     * @brief Generic inclusive scan with custom binary operation (eager
+     * operation)
+     * @details Allows applying any custom binary scan operation to the array
+     * elements. This provides flexibility beyond the predefined scans like
+     * sums, prods, mins, maxs.
+     * @param op The binary operation to apply for the scan (must be
+     * associative)
+     * @param axis Optional integral_constant parameter for axis (allows 2_ic
+     * syntax)
+     * @return A new fusion_array containing the running results of applying
+     * the operation
+     * @see sums, prods, mins, maxs, anys, alls for common predefined scans
+     */
+    template <int Axis = 0, typename BinaryOp>
+    auto scan(BinaryOp op,
+              std::integral_constant<int, Axis> /*axis*/ = {}) const {
+        detail::bind_scope const scope(_context);
+        detail::note_evaluation(_owned_storage, _begin, _end - _begin, "scan");
+        if constexpr (has_mask && Axis == 0) {
+            return _scan_masked(op);
+        } else if constexpr (has_mask) {
+            // Masked arrays are one-dimensional; compact to scan by axis
+            return _apply_mask_if_needed().scan(
+              op, std::integral_constant<int, Axis>{});
+        } else if constexpr (Axis == 0) {
+            index_t n = size();
+            // Create a device vector to store the scan results
+            auto result_vec = detail::make_buffer<value_type>(n);
+
+            // Perform inclusive scan with provided binary operation
+            thrust::inclusive_scan(
+              detail::policy(), _begin, _end, result_vec->begin(), op);
+
+            // Return a new array with the scan results
+            return fusion_array<
+              typename device_buffer<value_type>::iterator>(
+              result_vec->begin(), result_vec->end(), result_vec, _shape);
+        } else if constexpr (Axis == 1) {
+            // Column-wise scan (for 2D arrays)
+            if (rank() != 2) {
+                throw std::runtime_error(
+                  "Cannot perform column-wise scan on array with rank != 2");
+            }
+            index_t const num_rows = _shape[0];
+            index_t const num_cols = _shape[1];
+            auto result_vec    = detail::make_buffer<value_type>(size());
+
+            // Scan down the columns directly; rows are read coalesced
+            thrustx::inclusive_scan_columns(
+              _begin,
+              num_rows,
+              num_cols,
+              thrust::raw_pointer_cast(result_vec->data()),
+              op,
+              detail::temp_allocator{},
+              detail::current_stream());
+
+            return fusion_array<
+              typename device_buffer<value_type>::iterator>(
+              result_vec->begin(), result_vec->end(), result_vec, _shape);
+        } else if constexpr (Axis == 2) {
+            // Row-wise scan (for 2D arrays)
+            if (_shape.size() < 2) {
+                throw std::runtime_error(
+                  "Cannot perform row-wise scan on array with rank < 2");
+            }
+
+            index_t num_rows = _shape[0];
+            index_t num_cols = _shape[1];
+
+            // Create a counting iterator and transform it to row indices
+            auto count_iter  = thrust::make_counting_iterator<index_t>(0);
+            auto row_indices = thrust::make_transform_iterator(
+              count_iter, thrust::placeholders::_1 / num_cols);
+
+            // Allocate space for results
+            auto result_vec = detail::make_buffer<value_type>(size());
 
-    // Constructor with storage and shape (no mask)
-    fusion_array(Iterator begin,
-                 Iterator end,
-                 std::shared_ptr<void> storage,
-                 const std::vector<int> &shape)
-      : _begin(begin),
-        _end(end),
-        _owned_storage(std::move(storage)),
-        _shape(shape),
-        _mask_range{},
-        _mask_storage{} {
-        static_assert(
-          std::is_same_v<MaskIterator, no_mask_t>,
-          "Use the constructor with mask parameters for masked arrays");
+            // Perform row-wise scan using inclusive_scan_by_key
+            thrust::inclusive_scan_by_key(detail::policy(),
+                                          row_indices,
+                                          row_indices + size(),
+                                          _begin,
+                                          result_vec->begin(),
+                                          thrust::equal_to<index_t>(),
+                                          op);
+
+            // Return result as fusion_array
+            return fusion_array<
+              typename device_buffer<value_type>::iterator>(
+              result_vec->begin(), result_vec->end(), result_vec, _shape);
+        } else {
+            static_assert(Axis == 0 || Axis == 1 || Axis == 2,
+                          "Invalid axis value. Must be 0, 1, or 2.");
+            // This will never be reached due to static_assert, but needed for
+            // compilation
+            return fusion_array<
+              typename device_buffer<value_type>::iterator>();
+        }
     }
 
-    // Constructor with storage, shape and mask
-    template <typename MI = MaskIterator>
-    fusion_array(Iterator begin,
-                 Iterator end,
-                 std::shared_ptr<void> storage,
-                 const std::vector<int> &shape,
-                 MI mask_begin,
-                 MI mask_end,
-                 std::shared_ptr<void> mask_storage = nullptr)
-        requires(!std::is_same_v<MI, no_mask_t>)
-      : _begin(begin),
-        _end(end),
-        _owned_storage(std::move(storage)),
-        _shape(shape),
-        _mask_range{mask_begin, mask_end},
-        _mask_storage{std::move(mask_storage)} {}
+    /**
+     * @brief Sliding-window reduction with a custom binary operation (eager
+     * operation)
+     * @param w The window width
+     * @param op The associative binary operation that combines a window
+     * @param axis Optional integral_constant parameter for axis: 0 slides over
+     * all elements, 2 slides along each row (allows 2_ic syntax)
+     * @return For axis 0, a 1D array of size() - w + 1 window results; for
+     * axis 2, a rows x (cols - w + 1) matrix
+     * @details Uses the van Herk/Gil-Werman scheme: every window is the
+     * combination of one segmented suffix and one segmented prefix, so the
+     * cost per element does not depend on w and op needs no inverse. Windows
+     * up to a few thousand elements are computed in shared-memory tiles that
+     * read the input once.
+     * @throws std::invalid_argument if w <= 0 or w exceeds the row length
+     * @see rolling_sum, rolling_mean, rolling_min, rolling_max
+     */
+    template <int Axis = 0, typename BinaryOp>
+    auto rolling(index_t w,
+                 BinaryOp op,
+                 std::integral_constant<int, Axis> /*axis*/ = {}) const {
+        static_assert(Axis == 0 || Axis == 2,
+                      "rolling supports axis 0 (all elements) or 2 (rows)");
+        detail::bind_scope const scope(_context);
+        if constexpr (has_mask) {
+            // Masked arrays are one-dimensional; compact to slide over them
+            return _apply_mask_if_needed().rolling(
+              w, op, std::integral_constant<int, Axis>{});
+        } else {
+            if (Axis == 2 && _shape.size() < 2) {
+                throw std::runtime_error(
+                  "Cannot perform row-wise rolling on array with rank < 2");
+            }
+            index_t const rows = Axis == 2 ? _shape[0] : 1;
+            index_t const cols = Axis == 2 ? _shape[1] : size();
+            if (w <= 0 || w > cols) {
+                throw std::invalid_argument(
+                  "rolling: window must be between 1 and the row length");
+            }
+            detail::note_evaluation(
+              _owned_storage, _begin, _end - _begin, "rolling");
+
+            index_t const windows = cols - w + 1;
+            auto result           = detail::make_buffer<value_type>(
+              static_cast<std::size_t>(rows) * windows);
+            thrustx::rolling(_begin,
+                             rows * cols,
+                             cols,
+                             w,
+                             result->begin(),
+                             op,
+                             detail::temp_allocator{},
+                             detail::current_stream());
+
+            auto const shape = Axis == 2 ? std::vector<index_t>{rows, windows}
+                                         : std::vector<index_t>{windows};
+            return fusion_array<typename device_buffer<value_type>::iterator>(
+              result->begin(), result->end(), result, shape);
+        }
+    }
 
-    // Constructor with initializer_list shape (no mask)
-    fusion_array(Iterator begin,
-                 Iterator end,
-                 std::shared_ptr<void> storage,
-                 std::initializer_list<int> shape)
-      : _begin(begin),
-        _end(end),
-        _owned_storage(std::move(storage)),
-        _shape(shape.begin(), shape.end()),
-        _mask_range{},
-        _mask_storage{} {
-        static_assert(
-          std::is_same_v<MaskIterator, no_mask_t>,
-          "Use the constructor with mask parameters for masked arrays");
+    /**
+     * @brief Sum of every window of w consecutive elements (eager operation)
+     * @param w The window width
+     * @param axis Optional integral_constant parameter for axis (0 or 2)
+     * @return The window sums, shaped as described for rolling()
+     * @details Each window is summed from a segmented prefix and suffix, so
+     * unlike differences of sums() no precision is lost on long inputs.
+     */
+    template <int Axis = 0>
+    [[nodiscard]] auto rolling_sum(
+      index_t w, std::integral_constant<int, Axis> axis = {}) const {
+        return rolling(w, thrust::plus<value_type>(), axis);
     }
 
-    // Scalar constructor - only for non-masked arrays
-    template <typename T>
-    explicit fusion_array(T value)
-      : _begin(thrust::make_constant_iterator(value)),
-        _end(thrust::make_constant_iterator(value) + 1),
-        // Scalar has empty shape (rank 0)
-        _mask_range{},
-        _mask_storage{} {
-        static_assert(std::is_same_v<MaskIterator, no_mask_t>,
-                      "Scalar constructor is only for non-masked arrays");
+    /**
+     * @brief Mean of every window of w consecutive elements (eager operation)
+     * @param w The window width
+     * @param axis Optional integral_constant parameter for axis (0 or 2)
+     * @return The window means, shaped as described for rolling(); integer
+     * inputs produce double results
+     */
+    template <int Axis = 0>
+    [[nodiscard]] auto rolling_mean(
+      index_t w, std::integral_constant<int, Axis> axis = {}) const {
+        using result_type = agg::moment_type<value_type>;
+        return as<result_type>().rolling_sum(w, axis).div(
+          static_cast<result_type>(w));
     }
 
-    // Iterator accessors
-    [[nodiscard]] auto begin() const -> Iterator { return _begin; }
-    [[nodiscard]] auto end() const -> Iterator { return _end; }
+    /**
+     * @brief Minimum of every window of w consecutive elements (eager
+     * operation)
+     * @param w The window width
+     * @param axis Optional integral_constant parameter for axis (0 or 2)
+     * @return The window minima, shaped as described for rolling()
+     */
+    template <int Axis = 0>
+    [[nodiscard]] auto rolling_min(
+      index_t w, std::integral_constant<int, Axis> axis = {}) const {
+        return rolling(w, thrust::minimum<value_type>(), axis);
+    }
 
-    // For masked arrays, provide a method to apply the mask (eager operation)
-    [[nodiscard]] auto apply() const {
-        static_assert(has_mask, "apply() can only be called on masked arrays");
-        return _apply_mask_if_needed();
+    /**
+     * @brief Maximum of every window of w consecutive elements (eager
+     * operation)
+     * @param w The window width
+     * @param axis Optional integral_constant parameter for axis (0 or 2)
+     * @return The window maxima, shaped as described for rolling()
+     */
+    template <int Axis = 0>
+    [[nodiscard]] auto rolling_max(
+      index_t w, std::integral_constant<int, Axis> axis = {}) const {
+        return rolling(w, thrust::maximum<value_type>(), axis);
     }
 
-    // Shape accessor
-    [[nodiscard]] auto shape() const -> std::vector<int> {
+    /**
+     * @brief Remove adjacent duplicate elements (lazy operation)
+     * @return A masked fusion_array that will filter out adjacent duplicates
+     * when evaluated
+     */
+    [[nodiscard]] auto uniq() const {
+        return this->keep(this->differ().prepend(1));
+    }
+
+    /**
+     * @brief Remove duplicate elements from the array (lazy-ish operation)
+     * @details If the array is already sorted (_is_sorted is true), this method
+     * applies a unique operation to remove adjacent duplicates. If the array is
+     * not sorted, 32- and 64-bit integers may be deduplicated with a GPU hash
+     * table (see value_counts()); otherwise it first sorts the array and then
+     * removes duplicates. Either way the result is in ascending order.
+     * @return A new fusion_array containing only unique elements
+     */
+    [[nodiscard]] auto distinct() const {
+        if (_is_sorted) { return this->uniq(); }
+        if (auto counted = _hash_value_counts()) {
+            // Already unique and sorted; uniq() keeps the sorted path's type
+            auto keys = counted->first;
+            return fusion_array<typename device_buffer<value_type>::iterator>(
+                     keys->begin(), keys->end(), keys, true)
+              .uniq();
+        }
+        return this->sort().uniq();
+    }
+
+    [[nodiscard]] auto _mark_sorted() const {
+        return fusion_array<Iterator>(_begin, _end, _owned_storage, true);
+    }
+
+    /**
+     * @brief Count the occurrences of each distinct value (eager operation)
+     * @return A fusion_array of thrust::pairs (value, count) ordered by
+     * value, the same result as sort().rle()
+     * @details Unsorted 32- and 64-bit integer arrays are counted with a GPU
+     * hash table when a linear-counting estimate of the number of distinct
+     * values says the table stays cache resident or the data is heavily
+     * duplicated; other inputs are sorted and run-length encoded.
+     */
+    [[nodiscard]] auto value_counts() const {
+        detail::bind_scope const scope(_context);
+        if (_is_sorted) { return rle(); }
+        if (auto counted = _hash_value_counts()) {
+            return _pair_columns(counted->first, counted->second);
+        }
+        return sort().rle();
+    }
+
+    /**
+     * @brief Run-length encode the array (eager operation)
+     * @return A fusion_array of thrust::pairs with value and count
+     */
+    [[nodiscard]] auto rle() const {
+        detail::bind_scope const scope(_context);
         if constexpr (has_mask) {
-            // For masked arrays, return 1D shape with the masked size
-            return {size()};
-        } else {
-            return _shape;
+            // Runs are formed by kept neighbours only; compact first
+            return _apply_mask_if_needed().rle();
         }
+        index_t n = size();
+
+        // Create a keys vector (values) and a counts vector
+        auto keys   = detail::make_buffer<value_type>(n);
+        auto counts = detail::make_buffer<int>(n);
+
+        // Use constant_iterator for the initial counts (all 1s)
+        auto ones = thrust::make_constant_iterator(1);
+
+        // Run-length encode using reduce_by_key
+        auto new_end = thrust::reduce_by_key(
+          detail::blocking_policy(),
+          _begin,          // Input keys begin
+          _end,            // Input keys end
+          ones,            // Input values begin (all 1s)
+          keys->begin(),   // Output keys begin
+          counts->begin()  // Output values begin
+        );
+
+        // Compute the new size after encoding
+        index_t result_size = cuda::std::distance(keys->begin(), new_end.first);
+
+        // Resize the output vectors
+        keys->resize(result_size);
+        counts->resize(result_size);
+
+        // The keys and counts are the two columns of the pair array
+        return _pair_columns(keys, counts);
     }
 
     /**
-     * @brief Get the rank (dimensionality) of the array
-     * @return The number of dimensions in the array's shape
+     * @brief Group consecutive elements by a predicate and reduce each group
+     * @tparam BinPred The predicate for grouping consecutive elements
+     * @tparam BinaryOp The binary operation for reduction within each group
+     * @param pred The grouping predicate
+     * @param binop The reduction operation
+     * @return A fusion_array containing the reduced values for each group
      */
-    [[nodiscard]] auto rank() const -> int { return _shape.size(); }
+    template <typename BinPred, typename BinaryOp>
+    [[nodiscard]] auto chunk_by_reduce(BinPred pred, BinaryOp binop) const {
+        detail::bind_scope const scope(_context);
+        index_t n = size();
+
+        // Create a result vector to store the reduced values
+        auto result_vec = detail::make_buffer<value_type>(n);
+
+        // Use reduce_by_key with the provided predicates
+        auto new_end = thrust::reduce_by_key(
+          detail::blocking_policy(),
+          _begin,
+          _end,
+          _begin,  // Values are the same as keys for reduction
+          thrust::make_discard_iterator(),
+          result_vec->begin(),
+          pred,  // Grouping predicate
+          binop  // Reduction operation
+        );
+
+        // Compute the new size after reduction
+        index_t result_size = cuda::std::distance(result_vec->begin(),
+                                                  new_end.second);
+        result_vec->resize(result_size);
+
+        // Return a new fusion_array with the reduced values
+        return fusion_array<
+          typename device_buffer<value_type>::iterator>(
+          result_vec->begin(), result_vec->end(), result_vec);
+    }
 
     /**
-     * @brief Get the number of rows in a 2D array
-     * @return The number of rows (first dimension)
-     * @throws std::runtime_error if the array rank is not 2
+     * @brief Reshape the array to the specified dimensions
+     * @param new_shape The new shape as an initializer list of dimensions
+     * @return A new fusion_array with the specified shape
+     * @details The total size of the new shape must be less than or equal to
+     * the current array size. Some data may be truncated if the new size is
+     * smaller. For cycling data to fill larger shapes, use cycle() instead.
+     * @throws std::invalid_argument if total_size > size() or either size is 0
+     * @see cycle
      */
-    [[nodiscard]] auto nrows() const -> int {
-        if (rank() != 2) {
-            throw std::runtime_error(
-              "nrows() can only be called on rank-2 arrays");
+    [[nodiscard]] auto reshape(std::initializer_list<index_t> new_shape) const {
+        index_t total_size = 1;
+        for (auto dim : new_shape) { total_size *= dim; }
+
+        index_t current_size = size();
+
+        // Throw exception if either size is 0
+        if (current_size == 0 || total_size == 0) {
+            throw std::invalid_argument(
+              "reshape: current_size and total_size must be > 0");
         }
-        return _shape[0];
+
+        if (total_size > current_size) {
+            throw std::invalid_argument(
+              "reshape: total_size must be <= current_size; use cycle() for "
+              "larger "
+              "shapes");
+        }
+
+        // Create a new array with truncated view
+        return fusion_array<Iterator>(
+          _begin, _begin + total_size, _owned_storage, new_shape);
     }
 
     /**
-     * @brief Get the number of columns in a 2D array
-     * @return The number of columns (second dimension)
-     * @throws std::runtime_error if the array rank is not 2
+     * @brief Cycle the array data to fill the specified shape
+     * @param new_shape The new shape as an initializer list of dimensions
+     * @return A new fusion_array with the specified shape
+     * @details If the new shape's total size is greater than the array size,
+     * the current data is cycled to fill the new shape. If the new shape's
+     * total size is less than or equal to the array size, behaves like
+     * reshape().
+     * @throws std::invalid_argument if either size is 0
+     * @see reshape
      */
-    [[nodiscard]] auto ncols() const -> int {
-        if (rank() != 2) {
-            throw std::runtime_error(
-              "ncols() can only be called on rank-2 arrays");
+    [[nodiscard]] auto cycle(std::initializer_list<index_t> new_shape) const {
+        index_t total_size = 1;
+        for (auto dim : new_shape) { total_size *= dim; }
+
+        index_t current_size = size();
+
+        // Throw exception if either size is 0
+        if (current_size == 0 || total_size == 0) {
+            throw std::invalid_argument(
+              "cycle: current_size and total_size must be > 0");
         }
-        return _shape[1];
+
+        // Create cycled iterators to repeat the data as needed
+        auto cycled_begin = thrustx::make_cycle_iterator(_begin, current_size);
+        return fusion_array<decltype(cycled_begin)>(
+          cycled_begin, cycled_begin + total_size, _owned_storage, new_shape);
     }
 
-    // Map operation with another fusion_array
-    template <typename OtherIterator,
-              typename OtherMaskIterator,
-              typename BinaryFunctor>
-    auto map2(const fusion_array<OtherIterator, OtherMaskIterator> &value,
-              BinaryFunctor binary_op) const {
-        if (size() != value.size() and rank() != 0 and value.rank() != 0) {
+    // ========================================================================
+    // Copying Operations (Fused/Lazy)
+    // ========================================================================
+    // Operations that replicate or copy elements using lazy iterators for
+    // efficiency and fusion with subsequent operations.
+
+    /**
+     * @brief Repeat a scalar value to create a 1D array of the specified size
+     * @param n The number of times to repeat the scalar value
+     * @return A new fusion_array with n elements all equal to the scalar value
+     * @details This method only works on scalar arrays (rank = 0). It repeats
+     * the scalar value n times to create a 1D array. For arrays with rank > 0,
+     * use cycle() instead.
+     * @throws std::invalid_argument if rank != 0 or n <= 0
+     * @see cycle
+     */
+    [[nodiscard]] auto repeat(index_t n) const {
+        detail::bind_scope const scope(_context);
+        // Check if this is a scalar (rank = 0)
+        if (rank() != 0) {
             throw std::invalid_argument(
-              "Incompatible shapes for element-wise operations: " +
-              std::to_string(size()) + " " + std::to_string(value.size()));
+              "repeat: array must be a scalar (rank = 0)");
         }
 
-        auto const n = std::max(size(), value.size());
-        // Prioritize higher-dimensional arrays to preserve shape information
-        // If ranks are equal, prefer the larger array by size
-        auto const shape = (rank() < value.rank()) ||
-                               (rank() == value.rank() && size() < value.size())
-                             ? value.shape()
-                             : _shape;
-
-        auto zip_begin = thrust::make_zip_iterator(
-          thrust::make_tuple(_begin, value.begin()));
-        auto zip_end = thrust::make_zip_iterator(
-          thrust::make_tuple(_begin + n, value.begin() + n));
+        // Throw exception if n is not positive
+        if (n <= 0) { throw std::invalid_argument("repeat: n must be > 0"); }
 
-        // Create an adapter that converts from tuple-based to two-argument
-        // calling convention
-        auto adapter = binary_op_adapter<BinaryFunctor>(binary_op);
+        if constexpr (detail::is_constant_iterator<Iterator>::value) {
+            // Host-side constant: repeat it without touching the device
+            auto repeated_begin = thrust::make_constant_iterator(*_begin);
 
-        using result_iterator = thrust::transform_iterator<decltype(adapter),
-                                                           decltype(zip_begin)>;
+            return fusion_array<decltype(repeated_begin)>(
+              repeated_begin, repeated_begin + n, nullptr);
+        } else {
+            // Device-resident scalar (e.g. a reduction result): broadcast
+            // element 0 lazily instead of reading it back
+            auto repeated_begin = thrust::make_permutation_iterator(
+              _begin, thrust::make_constant_iterator(0));
 
-        // Create composite storage to keep both operands alive
-        std::shared_ptr<void> composite_storage;
-        if (_owned_storage || value.storage()) {
-            composite_storage = std::make_shared<
-              std::pair<std::shared_ptr<void>, std::shared_ptr<void>>>(
-              _owned_storage, value.storage());
+            return fusion_array<decltype(repeated_begin)>(
+              repeated_begin, repeated_begin + n, _owned_storage);
         }
-
-        return fusion_array<result_iterator>(
-          thrust::make_transform_iterator(zip_begin, adapter),
-          thrust::make_transform_iterator(zip_end, adapter),
-          composite_storage,
-          shape);
     }
 
-    // Map operation with a scalar value
-    template <typename T, typename BinaryFunctor>
-    auto map2(const T &value, BinaryFunctor binary_op) const -> decltype(auto) {
+    /**
+     * @brief Repeat each element of the array n times (lazy operation with
+     * storage preservation)
+     * @param n The number of times to repeat each element
+     * @return A new fusion_array with each element repeated n times
+     * @details For an array [1, 2, 3] with n=2, returns [1, 1, 2, 2, 3, 3].
+     * This operation uses lazy iterators but ensures storage safety by
+     * preserving the source array's storage. This is different from repeat()
+     * which only works on scalars, and from the mask-based replicate() which
+     * scans its mask eagerly.
+     * @throws std::invalid_argument if n <= 0
+     * @see repeat, replicate(const fusion_array<MaskIterType>&)
+     */
+    [[nodiscard]] auto replicate(index_t n) const {
+        if (n <= 0) { throw std::invalid_argument("replicate: n must be > 0"); }
+
         if constexpr (has_mask) {
-            return apply().map2(value, binary_op);
+            // Apply mask first, then replicate
+            auto unmasked = _apply_mask_if_needed();
+            return unmasked.replicate(n);
         } else {
-            using unary_functor = make_unary_functor<value_type, BinaryFunctor>;
-            using TransformIterator = thrust::transform_iterator<unary_functor,
-                                                                 Iterator>;
+            index_t current_size = size();
+            index_t new_size     = current_size * n;
 
-            return fusion_array<TransformIterator>(
-              thrust::make_transform_iterator(_begin,
-                                              unary_functor(value, binary_op)),
-              thrust::make_transform_iterator(_end,
-                                              unary_functor(value, binary_op)),
-              _owned_storage,
-              _shape);
+            auto transform_begin = thrustx::make_replicate_iterator(_begin, n);
+
+            return fusion_array<decltype(transform_begin)>(
+              transform_begin, transform_begin + new_size, _owned_storage);
         }
     }
 
     /**
-     * @brief Apply a unary functor to each element of the array
-     * @tparam UnaryFunctor The type of the unary functor
-     * @param op The unary operation to apply
-     * @return A new fusion_array with the operation applied
+     * @brief Repeat each element of the array by the corresponding mask value
+     * (lazy operation over a materialized scan of the mask)
+     * @param mask Array of integer values specifying how many times to repeat
+     * each element
+     * @return A new fusion_array with each element repeated according to the
+     * mask
+     * @details For an array [1, 2, 3] with mask [2, 1, 3], returns [1, 1, 2, 3,
+     * 3, 3]. Each element at index i is repeated mask[i] times.
+     * The mask is validated and scanned eagerly into one index buffer; each
+     * output element then finds its source with a binary search over that
+     * scan, so subsequent operations fuse with the replication instead of
+     * reading a gathered copy.
+     * @throws std::invalid_argument if mask size doesn't match array size or
+     * any mask value < 0
+     * @see replicate(index_t)
      */
-    template <typename UnaryFunctor>
-    auto map(UnaryFunctor op) const {
-        using TransformIterator = thrust::transform_iterator<UnaryFunctor,
-                                                             Iterator>;
+    template <typename MaskIterType>
+    auto replicate(const fusion_array<MaskIterType> &mask) const {
+        detail::bind_scope const scope(_context);
+        index_t current_size = size();
 
-        return fusion_array<TransformIterator>(
-          thrust::make_transform_iterator(_begin, op),
-          thrust::make_transform_iterator(_end, op),
-          _owned_storage,  // Pass ownership to derived array
-          _shape);
-    }
+        // Size check - the mask must be the same size as the array
+        if (current_size != mask.size()) {
+            throw std::invalid_argument(
+              "Mask size must match array size for replicate operation");
+        }
 
-    /**
-     * @brief Multiply each element by a scalar
-     * @param scalar The value to multiply by
-     * @return A new fusion_array with the operation applied
-     */
-    template <typename T = int>
-    auto times(T scalar) const {
-        return map2(scalar, mul{});
-    }
+        if constexpr (has_mask) {
+            // Apply mask first, then replicate
+            auto unmasked = _apply_mask_if_needed();
+            return unmasked.replicate(mask);
+        } else {
+            // Validate the mask and compute the output size in one fused
+            // (min, sum) pass, so only a single value is read back
+            using mask_value_type = typename fusion_array<
+              MaskIterType>::value_type;
+            auto const mask_stats = thrust::transform_reduce(
+              detail::blocking_policy(),
+              mask.begin(),
+              mask.end(),
+              min_sum_unary_op<mask_value_type, index_t>(),
+              thrust::make_pair(std::numeric_limits<mask_value_type>::max(),
+                                index_t(0)),
+              min_sum_binary_op<mask_value_type, index_t>());
 
-    /**
-     * @brief Add a scalar or another fusion_array element-wise
-     * @param value The scalar or fusion_array to add
-     * @return A new fusion_array with the operation applied
-     */
-    template <typename T>
-    auto add(const T &value) const {
-        return map2(value, parrot::add{});
-    }
+            // Check for negative mask values
+            if (mask_stats.first < 0) {
+                throw std::invalid_argument(
+                  "replicate: mask values must be non-negative");
+            }
 
-    /**
-     * @brief Return elementwise minimum with a scalar
-     * @param scalar The value to compare with
-     * @return A new fusion_array with the operation applied
-     */
-    template <typename T = int>
-    auto min(T scalar) const {
-        return map2(scalar, parrot::min{});
+            // End of each element's repeat range: [2, 3, 6] for [2, 1, 3]
+            index_t const total_size = mask_stats.second;
+            auto ends = detail::make_buffer<index_t>(current_size);
+            thrust::inclusive_scan(detail::policy(),
+                                   mask.begin(),
+                                   mask.end(),
+                                   ends->begin(),
+                                   thrust::plus<index_t>{});
+
+            auto replicated_begin = thrustx::make_replicate_search_iterator(
+              _begin, thrust::raw_pointer_cast(ends->data()), current_size);
+
+            return fusion_array<decltype(replicated_begin)>(
+              replicated_begin,
+              replicated_begin + total_size,
+              detail::join_storage(_owned_storage, ends));
+        }
     }
 
-    /**
-     * @brief Return elementwise maximum with a scalar
-     * @param scalar The value to compare with
-     * @return A new fusion_array with the operation applied
-     */
-    template <typename T = int>
-    auto max(T scalar) const {
-        return map2(scalar, parrot::max{});
-    }
+    // ========================================================================
+    // Combining Operations (Fused/Lazy)
+    // ========================================================================
+    // Operations that pair every element of one array with every element of
+    // another using lazy iterators.
 
     /**
-     * @brief Divide each element by a scalar or perform element-wise division
-     * with another fusion_array.
-     * @tparam T The type of the argument, which can be a scalar or another
-     * fusion_array.
-     * @param arg The scalar value to divide by or the other fusion_array for
-     * element-wise division.
-     * @return A new fusion_array with the division operation applied.
-     * @throws std::invalid_argument if `arg` is a fusion_array and shapes are
-     * incompatible for element-wise operations.
+     * @brief Compute the cartesian product with another array (lazy operation)
+     * @param other The other array to compute the cartesian product with
+     * @return A new fusion_array containing pairs representing the cartesian
+     * product
+     * @details For arrays [1, 2] and [a, b], returns [(1, a), (1, b), (2, a),
+     * (2, b)]. The implementation replicates each element of this array by the
+     * size of the other array, and cycles the other array to match the total
+     * size, then pairs them together.
+     * @throws std::invalid_argument if either array is empty
+     * @see replicate, cycle, pairs
      */
-    template <typename T>
-    auto div(const T &arg) const {
-        return map2(arg, parrot::div{});
-    }
+    template <typename OtherIterator>
+    auto cross(const fusion_array<OtherIterator> &other) const {
+        index_t this_size  = size();
+        index_t other_size = other.size();
 
-    /**
-     * @brief Integer divide each element by a scalar (truncating any fractional
-     * part)
-     * @param scalar The value to divide by
-     * @return A new fusion_array with the operation applied
-     */
-    template <typename T = int>
-    auto idiv(T scalar) const {
-        return map2(scalar, parrot::idiv{});
-    }
+        if (this_size == 0 || other_size == 0) {
+            throw std::invalid_argument("cross: arrays must not be empty");
+        }
 
-    /**
-     * @brief Subtract a scalar from each element
-     * @param scalar The value to subtract
-     * @return A new fusion_array with the operation applied
-     */
-    template <typename T = int>
-    auto minus(T scalar) const {
-        return map2(scalar, parrot::minus{});
+        return this->replicate(other_size)
+          .pairs(other.cycle({this_size * other_size}));
     }
 
     /**
-     * @brief Check if each element is greater than or equal to a scalar
-     * @param scalar The value to compare with
-     * @return A new fusion_array containing 1 where the condition is true, 0
-     * otherwise
+     * @brief Compute the outer product with another array as a 2D matrix (lazy
+     * operation)
+     * @param other The other array to compute the outer product with
+     * @param binary_op The binary operation to apply to each pair of elements
+     * @return A new fusion_array containing the results in a 2D matrix shape
+     * @details For arrays [1, 2] and [a, b] with operation `op`, returns a 2×2
+     * matrix: [op(1, a), op(1, b)] [op(2, a), op(2, b)] This is much more
+     * efficient than the cycle-based approach.
+     * @throws std::invalid_argument if either array is empty
+     * @see cross, reshape, map
      */
-    template <typename T = int>
-    auto gte(T scalar) const {
-        return map2(scalar, parrot::gte{});
-    }
+    template <typename OtherIterator, typename BinaryOp>
+    auto outer(const fusion_array<OtherIterator> &other,
+               BinaryOp binary_op) const {
+        index_t this_size  = size();
+        index_t other_size = other.size();
 
-    /**
-     * @brief Check if each element is less than or equal to a scalar
-     * @param scalar The value to compare with
-     * @return A new fusion_array containing 1 where the condition is true, 0
-     * otherwise
-     */
-    template <typename T = int>
-    auto lte(T scalar) const {
-        return map2(scalar, parrot::lte{});
-    }
+        if (this_size == 0 || other_size == 0) {
+            throw std::invalid_argument("outer: arrays must not be empty");
+        }
 
-    /**
-     * @brief Check if each element is greater than a scalar
-     * @param scalar The value to compare with
-     * @return A new fusion_array containing 1 where the condition is true, 0
-     * otherwise
-     */
-    template <typename T = int>
-    auto gt(T scalar) const {
-        return map2(scalar, parrot::gt{});
+        auto outer_iter = thrustx::make_outer_iterator(
+          _begin, other.begin(), this_size, other_size, binary_op);
+
+        return fusion_array<decltype(outer_iter)>(
+          outer_iter,
+          outer_iter + (this_size * other_size),
+          _owned_storage,
+          {this_size, other_size});
     }
 
+    // ========================================================================
+    // Matrix Products (Eager)
+    // ========================================================================
+    // Products of row-major matrices and vectors. Operands that are not plain
+    // device memory are evaluated first; elements of the product have the
+    // type of compute_type_t<value_type>() * compute_type_t<other>().
+
     /**
-     * @brief Check if each element is less than a scalar
-     * @param scalar The value to compare with
-     * @return A new fusion_array containing 1 where the condition is true, 0
-     * otherwise
+     * @brief Matrix product with another matrix (eager operation)
+     * @param other A rank-2 array with as many rows as this array has columns
+     * @return An m x n array for an m x k array and a k x n array
+     * @details Runs through cuBLAS when PARROT_ENABLE_CUBLAS is defined and
+     * both arrays hold float, double, __half or __nv_bfloat16 of the same
+     * type; __half and __nv_bfloat16 run on tensor cores and produce float.
+     * This is far faster than expressing the product as outer() and sum(2_ic).
+     * @throws std::invalid_argument if either array is not rank 2 or the inner
+     * dimensions differ
+     * @see matvec, dot
      */
-    template <typename T = int>
-    auto lt(T scalar) const {
-        return map2(scalar, parrot::lt{});
+    template <typename OtherIterator>
+    [[nodiscard]] auto matmul(const fusion_array<OtherIterator> &other) const {
+        if (rank() != 2 || other.rank() != 2) {
+            throw std::invalid_argument("matmul: arrays must be rank 2");
+        }
+        if (other.shape()[0] != _shape[1]) {
+            throw std::invalid_argument(
+              "matmul: inner dimensions must match (" +
+              std::to_string(_shape[1]) + " vs " +
+              std::to_string(other.shape()[0]) + ")");
+        }
+        return _product(other,
+                        _shape[0],
+                        other.shape()[1],
+                        _shape[1],
+                        {_shape[0], other.shape()[1]});
     }
 
     /**
-     * @brief Check if each element is equal to a scalar
-     * @param scalar The value to compare with
-     * @return A new fusion_array containing 1 where the condition is true, 0
-     * otherwise
+     * @brief Matrix-vector product (eager operation)
+     * @param vector A rank-1 array with as many elements as this array has
+     * columns
+     * @return A rank-1 array with one element per row of this array
+     * @throws std::invalid_argument if this array is not rank 2, vector is
+     * not rank 1 or the sizes differ
+     * @see matmul, dot
      */
-    template <typename T = int>
-    auto eq(T scalar) const {
-        return map2(scalar, parrot::eq{});
+    template <typename OtherIterator>
+    [[nodiscard]] auto matvec(const fusion_array<OtherIterator> &vector) const {
+        if (rank() != 2 || vector.rank() != 1) {
+            throw std::invalid_argument(
+              "matvec: expected a rank-2 matrix and a rank-1 vector");
+        }
+        if (vector.size() != _shape[1]) {
+            throw std::invalid_argument(
+              "matvec: vector size must match the number of columns (" +
+              std::to_string(vector.size()) + " vs " +
+              std::to_string(_shape[1]) + ")");
+        }
+        return _product(vector, _shape[0], 1, _shape[1], {_shape[0]});
     }
 
     /**
-     * @brief Check if each element is not equal to a scalar
-     * @param scalar The value to compare with
-     * @return A new fusion_array containing 1 where the condition is true, 0
-     * otherwise
+     * @brief Inner product of two vectors (eager operation)
+     * @param other A rank-1 array of the same size
+     * @return A scalar fusion_array with the sum of the element-wise products
+     * @details The products are fused into the reduction, so the vectors are
+     * read once; a memory-bound product gains nothing from cuBLAS.
+     * @throws std::invalid_argument if either array has rank above 1 or the
+     * sizes differ
+     * @see matvec, matmul
      */
-    template <typename T = int>
-    auto neq(T scalar) const {
-        return map2(scalar, parrot::neq{});
+    template <typename OtherIterator>
+    [[nodiscard]] auto dot(const fusion_array<OtherIterator> &other) const {
+        if (rank() > 1 || other.rank() > 1 || size() != other.size()) {
+            throw std::invalid_argument(
+              "dot: expected two vectors of the same size");
+        }
+        using P = _product_t<typename fusion_array<OtherIterator>::value_type>;
+        return this->template as<P>().times(other.template as<P>()).sum();
     }
 
     /**
-     * @brief Apply a binary operation to adjacent elements
-     * @param op The binary operation to apply
-     * @return A new fusion_array with the operation applied
+     * @brief Print the array contents to a stream
+     * @param os The output stream (defaults to std::cout)
+     * @param delimiter The string to print between elements (defaults to space)
+     * @return For masked arrays, returns the unmasked array; otherwise returns
+     * a reference to this array
      */
-    template <typename BinaryOp>
-    auto map_adj(BinaryOp op) const
-      -> fusion_array<thrust::transform_iterator<
-        thrust::zip_function<BinaryOp>,
-        thrust::zip_iterator<thrust::tuple<Iterator, Iterator>>>> {
-        auto zip_begin = thrust::make_zip_iterator(
-          thrust::make_tuple(_begin, _begin + 1));
-        auto transform_begin = thrust::make_transform_iterator(
-          zip_begin, thrust::make_zip_function(op));
+    auto print(std::ostream &os      = std::cout,
+               const char *delimiter = " ") const {
+        detail::bind_scope const scope(_context);
+        if constexpr (has_mask) {
+            // Apply mask first then print
+            auto unmasked = _apply_mask_if_needed();
+            unmasked.print(os, delimiter);
+            return unmasked;
+        } else {
+            // Fetch everything with one bulk copy, then format on the host
+            auto const host = to_host();
+            std::vector<std::string> cells;
+            cells.reserve(host.size());
+            int max_width = 1;
+            for (auto const &element : host) {
+                cells.push_back(detail::format_element(element));
+                max_width = std::max(max_width,
+                                     static_cast<int>(cells.back().length()));
+            }
 
-        using return_type = fusion_array<decltype(transform_begin)>;
+            // 1D arrays and scalars print on one line, higher ranks print
+            // one line per index of the outer dimension
+            index_t outer_dim  = 1;
+            index_t inner_size = static_cast<index_t>(cells.size());
+            if (_shape.size() > 1) {
+                outer_dim  = _shape[0];
+                inner_size = 1;
+                for (size_t i = 1; i < _shape.size(); i++) {
+                    inner_size *= _shape[i];
+                }
+            }
 
-        // If we don't have at least 2 elements, return empty array type
-        if (size() < 2) {
-            return return_type(
-              transform_begin, transform_begin, _owned_storage);
-        }
+            for (index_t i = 0; i < outer_dim; i++) {
+                index_t row_start = i * inner_size;
+                for (index_t j = 0; j < inner_size; j++) {
+                    if (j > 0) { os << delimiter; }
+                    os << std::setw(max_width) << cells[row_start + j];
+                }
+                os << '\n';
+            }
 
-        // Return a new array with one fewer element (since we're processing
-        // pairs)
-        return return_type(
-          transform_begin, transform_begin + (size() - 1), _owned_storage);
+            return *this;
+        }
     }
 
     /**
-     * @brief Check if adjacent elements are different
-     * @return A new fusion_array containing 1 where adjacent elements differ,
-     * 0 otherwise
+     * @brief Find the minimum and maximum values in the array (eager
+     * operation)
+     * @return A fusion_array containing a thrust::pair with first=minimum
+     * and second=maximum
      */
-    [[nodiscard]] auto differ() const { return map_adj(parrot::neq{}); }
+    [[nodiscard]] auto minmax() const {
+        detail::bind_scope const scope(_context);
+        if constexpr (is_reduced_precision_v<value_type>) {
+            return as<float>().minmax();
+        } else {
+            auto unary_op  = minmax_unary_op<value_type>();
+            auto binary_op = minmax_binary_op<value_type>();
+            // Identity of the (min, max) combine, so no element is read back
+            auto init = minmax_pair<value_type>(
+              std::numeric_limits<value_type>::max(),
+              std::numeric_limits<value_type>::lowest());
+
+            return this->map(unary_op).reduce(init, binary_op);
+        }
+    }
 
     /**
-     * @brief Compute differences between adjacent elements
-     * @return A new fusion_array containing the differences
+     * @brief Take the first n elements of the array
+     * @param n The number of elements to take
+     * @return A new fusion_array containing only the first n elements
+     * @throws std::invalid_argument if n > size() or n < 0
      */
-    [[nodiscard]] auto deltas() const { return map_adj(delta{}); }
+    [[nodiscard]] auto take(index_t n) const {
+        if (n < 0 || n > size()) {
+            throw std::invalid_argument(
+              "take: n must be between 0 and size() inclusive");
+        }
 
-    /**
-     * @brief Double each element (multiply by 2)
-     * @return A new fusion_array with doubled values
-     */
-    [[nodiscard]] auto dble() const {
-        return map(double_functor<value_type>());
+        return fusion_array<Iterator>(
+          _begin, _begin + n, _owned_storage, _is_sorted);
     }
 
     /**
-     * @brief Halve each element (divide by 2)
-     * @return A new fusion_array with halved values
+     * @brief Drop the first n elements of the array
+     * @param n The number of elements to drop
+     * @return A new fusion_array containing all elements except the first
+     * n
+     * @throws std::invalid_argument if n > size() or n < 0
      */
-    [[nodiscard]] auto half() const { return map(half_functor<value_type>()); }
+    [[nodiscard]] auto drop(index_t n) const {
+        if (n < 0 || n > size()) {
+            throw std::invalid_argument(
+              "drop: n must be between 0 and size() inclusive");
+        }
+        if (n == size()) {  // if dropping all elements, return empty array
+            return fusion_array<Iterator>(_end, _end, _owned_storage);
+        }
+        return fusion_array<Iterator>(
+          _begin + n, _end, _owned_storage, _is_sorted);
+    }
 
     /**
-     * @brief Calculate absolute value of each element
-     * @return A new fusion_array with absolute values
+     * @brief Flatten the array to rank 1 (modifies shape only, no data copy)
+     * @return A new fusion_array with the same data but flattened to 1D
      */
-    [[nodiscard]] auto abs() const { return map(abs_functor<value_type>()); }
+    [[nodiscard]] auto flatten() const {
+        std::vector<index_t> flat_shape = {size()};
+        return fusion_array<Iterator>(_begin, _end, _owned_storage, flat_shape);
+    }
 
     /**
-     * @brief Calculate natural logarithm of each element
-     * @return A new fusion_array with logarithm values
+     * @brief Get a copy of a specific row (with data copy)
+     * @param row_idx The row index to extract
+     * @return A fusion_array copy of the specified row
+     * @throws std::runtime_error if array rank != 2 or row_idx out of bounds
      */
-    [[nodiscard]] auto log() const { return map(log_functor<value_type>()); }
+    [[nodiscard]] auto row(index_t row_idx) const {
+        if (rank() != 2) {
+            throw std::runtime_error("row() only works on rank 2 arrays");
+        }
 
-    /**
-     * @brief Calculate exponential of each element
-     * @return A new fusion_array with exponential values
-     */
-    [[nodiscard]] auto exp() const { return map(exp_functor<value_type>()); }
+        index_t num_rows = _shape[0];
+        index_t num_cols = _shape[1];
 
-    /**
-     * @brief Check if each element is odd
-     * @return A new fusion_array containing 1 for odd elements, 0 for even
-     */
-    [[nodiscard]] auto neg() const { return map(thrust::negate<value_type>()); }
+        if (row_idx < 0 || row_idx >= num_rows) {
+            throw std::invalid_argument("row index out of bounds");
+        }
 
-    /**
-     * @brief Check if each element is odd
-     * @return A new fusion_array containing 1 for odd elements, 0 for even
-     */
-    [[nodiscard]] auto odd() const { return map(odd_functor<value_type>()); }
+        return this->flatten().drop(row_idx * num_cols).take(num_cols);
+    }
 
     /**
-     * @brief Check if each element is even
-     * @return A new fusion_array containing 1 for even elements, 0 for odd
+     * @brief Find the first index of a value in the array (0-based)
+     * @param value The value to search for
+     * @return The 0-based index of the first occurrence, or -1 if not found
+     * @details Arrays known to be sorted (see is_sorted()) are searched by
+     * bisection; others are scanned.
+     * @throws std::runtime_error if array rank != 1
      */
-    [[nodiscard]] auto even() const { return map(even_functor<value_type>()); }
+    template <typename T>
+    auto index_of(const T &value) const -> index_t {
+        detail::bind_scope const scope(_context);
+        if (rank() != 1) {
+            throw std::runtime_error("index_of() only works on rank 1 arrays");
+        }
 
-    /**
-     * @brief Get sign of each element
-     * @return A new fusion_array containing 1 for positive, 0 for zero, -1 for
-     * negative
-     */
-    [[nodiscard]] auto sign() const { return map(sign_functor<value_type>()); }
+        if constexpr (has_mask) {
+            // Apply mask first, then search
+            auto unmasked = _apply_mask_if_needed();
+            return unmasked.index_of(value);
+        } else if (_is_sorted) {
+            // Binary search: the first element not less than value
+            auto it = thrust::lower_bound(
+              detail::blocking_policy(), _begin, _end, value);
+            if (it == _end || !(value_type(*it) == value)) { return -1; }
+            return cuda::std::distance(_begin, it);
+        } else {
+            auto it = thrust::find(
+              detail::blocking_policy(), _begin, _end, value);
+            if (it == _end) {
+                return -1;  // Not found
+            }
+            return cuda::std::distance(_begin, it);
+        }
+    }
 
     /**
-     * @brief Calculate square root of each element
-     * @return A new fusion_array with square root values
+     * @brief Find the last index of a value in the array (0-based)
+     * @param value The value to search for
+     * @return The 0-based index of the last occurrence, or -1 if not found
+     * @details Arrays known to be sorted (see is_sorted()) are searched by
+     * bisection; others are scanned.
+     * @throws std::runtime_error if array rank != 1
      */
-    [[nodiscard]] auto sqrt() const { return map(sqrt_functor<value_type>()); }
+    template <typename T>
+    auto last_index_of(const T &value) const -> index_t {
+        detail::bind_scope const scope(_context);
+        if (rank() != 1) {
+            throw std::runtime_error(
+              "last_index_of() only works on rank 1 arrays");
+        }
 
-    /**
-     * @brief Square each element
-     * @return A new fusion_array with squared values
-     */
-    [[nodiscard]] auto sq() const { return map(sq_functor<value_type>()); }
+        if constexpr (has_mask) {
+            // Apply mask first, then search
+            auto unmasked = _apply_mask_if_needed();
+            return unmasked.last_index_of(value);
+        } else if (_is_sorted) {
+            // Binary search: the element before the first greater than value
+            auto it = thrust::upper_bound(
+              detail::blocking_policy(), _begin, _end, value);
+            if (it == _begin || !(value_type(*(it - 1)) == value)) {
+                return -1;
+            }
+            return cuda::std::distance(_begin, it) - 1;
+        } else {
+            // Search from the end using reverse iterators
+            auto rbegin = thrust::make_reverse_iterator(_end);
+            auto rend   = thrust::make_reverse_iterator(_begin);
+            auto it     = thrust::find(
+              detail::blocking_policy(), rbegin, rend, value);
 
-    /**
-     * @brief Cast each element to a different type
-     * @tparam TargetType The target type to cast elements to
-     * @return A new fusion_array with elements cast to the target type
-     */
-    template <typename TargetType>
-    [[nodiscard]] auto as() const {
-        return map(cast_functor<TargetType, value_type>());
+            if (it == rend) {
+                return -1;  // Not found
+            }
+
+            // Convert reverse iterator position to forward index
+            return cuda::std::distance(_begin, it.base()) - 1;
+        }
     }
 
     /**
-     * @brief Generate random values between 0 and each element
-     * @return A new fusion_array with random values
+     * @brief Find where each needle would be inserted to keep the array
+     * sorted (eager operation)
+     * @param needles The values to look up
+     * @return A fusion_array of 0-based positions, one per needle: the first
+     * element not less than the needle
+     * @details The array must be sorted in ascending order (this is not
+     * checked). All needles are searched in one vectorized pass.
+     * @see upper_bound, searchsorted
      */
-    [[nodiscard]] auto rand() const {
-        // Create a counting iterator for indices
-        auto indices = thrust::make_counting_iterator(0);
-
-        // Create a zip iterator combining indices with the array values
-        auto zip_begin = thrust::make_zip_iterator(
-          thrust::make_tuple(indices, _begin));
-        auto zip_end = thrust::make_zip_iterator(
-          thrust::make_tuple(indices + size(), _end));
-
-        // Create a transform iterator that applies the random functor
-        using RandFunc = rand_functor<value_type>;
+    template <typename NeedleIterator>
+    auto lower_bound(const fusion_array<NeedleIterator> &needles) const {
+        return _bounds(needles, false);
+    }
 
-        return fusion_array<
-          thrust::transform_iterator<RandFunc, decltype(zip_begin)>>(
-          thrust::make_transform_iterator(zip_begin, RandFunc()),
-          thrust::make_transform_iterator(zip_end, RandFunc()),
-          _owned_storage,
-          _shape);
+    /**
+     * @brief Find the end of each needle's run in a sorted array (eager
+     * operation)
+     * @param needles The values to look up
+     * @return A fusion_array of 0-based positions, one per needle: the first
+     * element greater than the needle
+     * @details The array must be sorted in ascending order (this is not
+     * checked). upper_bound(needles).minus(lower_bound(needles)) counts the
+     * occurrences of each needle.
+     * @see lower_bound, searchsorted
+     */
+    template <typename NeedleIterator>
+    auto upper_bound(const fusion_array<NeedleIterator> &needles) const {
+        return _bounds(needles, true);
     }
 
     /**
-     * @brief Get the size of the array
-     * @return The number of elements
+     * @brief Insertion points of needles in a sorted array (eager operation)
+     * @param needles The values to look up
+     * @param right Return the position after equal elements instead of
+     * before them
+     * @return lower_bound(needles), or upper_bound(needles) if right is set
      */
-    [[nodiscard]] auto size() const -> int {
-        if constexpr (has_mask) {
-            // For masked arrays, count the number of non-zero mask elements
-            auto mask_begin = _mask_range.first;
-            auto mask_end   = _mask_range.second;
-            return thrust::count_if(
-              mask_begin, mask_end, cuda::std::identity{});
-        } else {
-            return cuda::std::distance(_begin, _end);
-        }
+    template <typename NeedleIterator>
+    auto searchsorted(const fusion_array<NeedleIterator> &needles,
+                      bool right = false) const {
+        return _bounds(needles, right);
     }
 
     /**
-     * @brief Append a value to the array
-     * @param value The value to append
-     * @return A new fusion_array with the appended value
+     * @brief Merge with another array into one sorted array (eager
+     * operation)
+     * @param other The array to merge with
+     * @return A sorted fusion_array holding the elements of both arrays
+     * @details Arrays known to be sorted (see is_sorted()) are merged in
+     * linear time; an operand that is not is sorted first. Equal elements
+     * from this array come before those from other.
      */
-    template <typename T = int>
-    auto append(T value) const {
+    template <typename OtherIterator>
+    auto merge(const fusion_array<OtherIterator> &other) const
+      -> fusion_array<typename device_buffer<value_type>::iterator> {
+        detail::bind_scope const scope(_context);
         if constexpr (has_mask) {
-            // Apply mask first, then append
-            auto unmasked = _apply_mask_if_needed();
-            return unmasked.append(value);
+            return _apply_mask_if_needed().merge(other);
         } else {
-            int const n         = size();
-            auto appended_begin = thrustx::make_append_iterator(
-              _begin, n, value);
-
-            return fusion_array<decltype(appended_begin)>(
-              appended_begin,
-              appended_begin + n + 1,
-              _owned_storage  // Pass ownership to derived array
-            );
+            if (!_is_sorted) { return sort().merge(other); }
+            if (!other.is_sorted()) { return merge(other.sort()); }
+
+            auto const n = size() + other.size();
+            auto merged  = detail::make_buffer<value_type>(n);
+            thrust::merge(detail::policy(),
+                          _begin,
+                          _end,
+                          other.begin(),
+                          other.end(),
+                          merged->begin());
+            return fusion_array<typename device_buffer<value_type>::iterator>(
+              merged->begin(), merged->end(), merged, true);
         }
     }
 
     /**
-     * @brief Prepend a value to the array
-     * @param value The value to prepend
-     * @return A new fusion_array with the prepended value
+     * @brief Find the maximum element based on key extractor
+     * @tparam KeyExtractor The type of the key extractor functor
+     * @param key_extractor A functor that extracts a key for comparison
+     * from each element
+     * @return A fusion_array containing the maximum element based on the
+     * extracted key
      */
-    template <typename T = int>
-    auto prepend(T value) const {
-        if constexpr (has_mask) {
-            // Apply mask first, then prepend
-            auto unmasked = _apply_mask_if_needed();
-            return unmasked.prepend(value);
-        } else {
-            int const n          = size();
-            auto prepended_begin = thrustx::make_prepend_iterator(
-              _begin, n, value);
+    template <typename KeyExtractor>
+    auto max_by_key(KeyExtractor key_extractor) const
+      -> fusion_array<typename device_buffer<
+        typename cuda::std::iterator_traits<Iterator>::value_type>::iterator> {
+        detail::bind_scope const scope(_context);
+        _synchronize();
+        index_t n = size();
 
-            return fusion_array<decltype(prepended_begin)>(
-              prepended_begin,
-              prepended_begin + n + 1,
-              _owned_storage  // Pass ownership to derived array
-            );
+        if (n == 0) {
+            // Return an empty array for empty input
+            auto empty = detail::make_buffer<value_type>(0);
+            return fusion_array<typename device_buffer<value_type>::iterator>(
+              empty->begin(), empty->end(), empty);
         }
-    }
 
-    /**
-     * @brief Sort the array (eager operation)
-     * @return A new fusion_array with sorted elements
-     */
-    [[nodiscard]] auto sort() const {
-        int n = size();
+        // Create a comparator that uses the key extractor
+        auto key_comp = [key_extractor] __host__ __device__(
+                          const value_type &a, const value_type &b) {
+            return key_extractor(a) < key_extractor(b);
+        };
 
-        // Create a new device vector and take ownership of it
-        auto sorted_data = std::make_shared<thrust::device_vector<value_type>>(
-          n, thrust::default_init);
+        // Use thrust::max_element with the custom comparator
+        auto max_iter = thrust::max_element(
+          detail::blocking_policy(), _begin, _end, key_comp);
 
-        thrust::copy(_begin, _end, sorted_data->begin());
-        thrust::sort(sorted_data->begin(), sorted_data->end());
+        // Create a device vector with the maximum element directly
+        auto result_vec = std::make_shared<device_buffer<value_type>>(
+          1, *max_iter);
 
-        // Return a new fusion_array with ownership of the sorted data
+        // Return a new fusion_array with the maximum element
         return fusion_array<
-          typename thrust::device_vector<value_type>::iterator>(
-          sorted_data->begin(), sorted_data->end(), sorted_data, true);
+          typename device_buffer<value_type>::iterator>(
+          result_vec->begin(), result_vec->end(), result_vec);
     }
 
     /**
-     * @brief Sort the array using a custom comparator (eager operation)
-     * @param comp The binary comparator to use for sorting
-     * @return A new fusion_array with sorted elements
+     * @brief Create pairs from two arrays of the same length
+     * @tparam OtherIterator The iterator type of the second array
+     * @param other The second array to pair with this array
+     * @return A new fusion_array containing pairs of elements from both
+     * arrays
+     * @throws std::invalid_argument if arrays have different sizes
      */
-    template <typename BinaryComp>
-    auto sort_by(BinaryComp comp) const {
-        int n = size();
+    template <typename OtherIterator>
+    auto pairs(const fusion_array<OtherIterator> &other) const {
+        using first_type = typename cuda::std::iterator_traits<
+          Iterator>::value_type;
+        using second_type = typename cuda::std::iterator_traits<
+          OtherIterator>::value_type;
+        using pair_type = thrust::pair<first_type, second_type>;
 
-        // Create a new device vector and take ownership of it
-        auto sorted_data = std::make_shared<thrust::device_vector<value_type>>(
-          n, thrust::default_init);
+        // Check if arrays have the same size
+        if (size() != other.size()) {
+            throw std::invalid_argument(
+              "Arrays must have the same size for pairs operation");
+        }
+
+        // Create a zip iterator combining elements from both arrays
+        auto zip_begin = thrust::make_zip_iterator(
+          thrust::make_tuple(_begin, other.begin()));
+        auto zip_end = thrust::make_zip_iterator(
+          thrust::make_tuple(_end, other.end()));
 
-        thrust::copy(_begin, _end, sorted_data->begin());
-        thrust::sort(sorted_data->begin(), sorted_data->end(), comp);
+        // Define the functor type for making pairs
+        using make_pair_func = make_pair_functor<first_type, second_type>;
 
-        // Return a new fusion_array with ownership of the sorted data
+        // Keep the storage of both columns alive
+        auto composite_storage = detail::join_storage(_owned_storage,
+                                                      other.storage());
+
+        // Transform the zipped iterators into pairs
         return fusion_array<
-          typename thrust::device_vector<value_type>::iterator>(
-          sorted_data->begin(), sorted_data->end(), sorted_data, true);
+          thrust::transform_iterator<make_pair_func, decltype(zip_begin)>>(
+          thrust::make_transform_iterator(zip_begin, make_pair_func()),
+          thrust::make_transform_iterator(zip_end, make_pair_func()),
+          composite_storage,
+          _shape);
     }
 
     /**
-     * @brief Sort the array based on keys produced by a unary function (eager
-     * operation)
-     * @param key_func The unary function to extract keys for comparison
-     * @return A new fusion_array with sorted elements
+     * @brief Select the first element of each pair (lazy operation)
+     * @return A fusion_array of the first elements
+     * @details Pair arrays produced by pairs(), enumerate(), rle(),
+     * value_counts() and topk() are stored as two columns, so this returns
+     * the first column itself without touching the second. Other pair
+     * arrays are equivalent to map(parrot::fst{}).
+     * @see snd, pairs
      */
-    template <typename KeyFunc>
-    auto sort_by_key(KeyFunc key_func) const
-      -> fusion_array<typename thrust::device_vector<
-        typename cuda::std::iterator_traits<Iterator>::value_type>::iterator> {
-        int n = size();
+    [[nodiscard]] auto fst() const { return _column<0>(); }
 
-        // Create a new device vector and take ownership of it
-        auto sorted_data = std::make_shared<thrust::device_vector<value_type>>(
-          n, thrust::default_init);
+    /**
+     * @brief Select the second element of each pair (lazy operation)
+     * @return A fusion_array of the second elements
+     * @details The counterpart of fst(); for rle() this is the run lengths.
+     * @see fst, pairs
+     */
+    [[nodiscard]] auto snd() const { return _column<1>(); }
 
-        // Copy the array to the device vector
-        thrust::copy(_begin, _end, sorted_data->begin());
+    /**
+     * @brief Create pairs from array elements and their indices (lazy
+     * operation)
+     * @return A new fusion_array containing pairs of (element, index)
+     * @details Creates pairs of (element, index) starting from index 0.
+     * For array [a, b, c], returns [(a, 0), (b, 1), (c, 2)].
+     * Useful for operations that need to track element positions.
+     */
+    [[nodiscard]] auto enumerate() const { return this->pairs(range(size())); }
 
-        // Create a comparator that uses the key function
-        auto key_comp = [key_func] __host__ __device__(const value_type &a,
-                                                       const value_type &b) {
-            return key_func(a) < key_func(b);
-        };
+    /**
+     * @brief Reverse the array (lazy operation)
+     * @return A new fusion_array with elements in reverse order
+     */
+    [[nodiscard]] auto rev() const {
+        auto rbegin = thrust::make_reverse_iterator(_end);
+        auto rend   = thrust::make_reverse_iterator(_begin);
+        return fusion_array<decltype(rbegin)>(
+          rbegin, rend, _owned_storage, _shape);
+    }
 
-        // Sort using the key comparator
-        thrust::sort(sorted_data->begin(), sorted_data->end(), key_comp);
+    /**
+     * @brief Filter elements based on a predicate (lazy operation)
+     * @param predicate A unary predicate that returns true for elements to
+     * keep
+     * @return A masked fusion_array that will filter elements when
+     * evaluated
+     */
+    template <typename Predicate>
+    auto filter(Predicate predicate) const {
+        // Create a transform_iterator that applies the predicate
+        auto mask_begin = thrust::make_transform_iterator(_begin, predicate);
+        auto mask_end   = thrust::make_transform_iterator(_end, predicate);
 
-        // Return a new fusion_array with ownership of the sorted data
-        return fusion_array<
-          typename thrust::device_vector<value_type>::iterator>(
-          sorted_data->begin(), sorted_data->end(), sorted_data, true);
+        // Use existing keep function with the mask iterator
+        return keep(fusion_array<decltype(mask_begin)>(
+          mask_begin, mask_end, _owned_storage));
     }
 
     /**
-     * @brief Generic reduction with custom binary operation (eager operation)
-     * @tparam Axis The axis along which to reduce (0=all elements, 2=row-wise)
-     * @param init The initial value for the reduction
-     * @param op The binary operation to apply for reduction
-     * @param axis Optional integral_constant parameter for axis (allows 2_ic
-     * syntax)
-     * @return A fusion_array containing the reduction result(s)
+     * @brief Transpose a 2D array (lazy operation)
+     * @return A new fusion_array representing the transpose of the
+     * original
+     * @throws std::invalid_argument if the array is not rank 2
      */
-    template <int Axis = 0, typename T, typename BinaryOp>
-    auto reduce(T init,
-                BinaryOp op,
-                std::integral_constant<int, Axis> /*axis*/ = {}) const {
-        using value_type = typename std::iterator_traits<Iterator>::value_type;
+    [[nodiscard]] auto transpose() const {
+        if (rank() != 2) {
+            throw std::invalid_argument(
+              "transpose: array must be rank 2 (a matrix)");
+        }
 
-        if constexpr (Axis == 0) {
-            // Default reduction (all elements)
-            // Perform the reduction to get a single scalar value
-            auto result = thrust::reduce(_begin, _end, init, op);
-
-            // Return a fusion_array with a constant iterator of the result
-            return fusion_array<thrust::constant_iterator<decltype(result)>>(
-              thrust::make_constant_iterator(result),
-              thrust::make_constant_iterator(result) + 1,
-              nullptr,
-              std::vector<int>{});
-        } else if constexpr (Axis == 2) {
-            // Row-wise reduction (for 2D arrays)
-            if (_shape.size() < 2) {
-                throw std::runtime_error(
-                  "Cannot perform row-wise reduction on array with rank < 2");
-            }
+        index_t num_rows   = _shape[0];
+        index_t num_cols   = _shape[1];
+        index_t total_size = num_rows * num_cols;
+
+        // Create a counting iterator for the indices of the transposed
+        // array
+        auto counting_iter = thrust::make_counting_iterator<index_t>(0);
+
+        // Create a transform iterator that applies the transpose_functor
+        // This transform_iterator will yield the indices in the *original*
+        // array that correspond to the elements of the transposed array.
+        auto index_map_iter = thrust::make_transform_iterator(
+          counting_iter, transpose_functor(num_rows, num_cols));
+
+        // Create a permutation iterator
+        auto perm_iter_begin = thrust::make_permutation_iterator(
+          _begin, index_map_iter);
+        auto perm_iter_end = perm_iter_begin + total_size;
+
+        // New shape for the transposed array
+        std::vector<index_t> new_shape = {num_cols, num_rows};
+
+        return fusion_array<decltype(perm_iter_begin)>(
+          perm_iter_begin, perm_iter_end, _owned_storage, new_shape);
+    }
+
+    // clang-format off
+     auto operator/ (auto const &arg) const { return this->div(arg);   }
+     auto operator- (auto const &arg) const { return this->minus(arg); }
+     auto operator+ (auto const &arg) const { return this->add(arg);   }
+     auto operator* (auto const &arg) const { return this->times(arg); }
+     auto operator< (auto const &arg) const { return this->lt(arg);    }
+     auto operator<=(auto const &arg) const { return this->lte(arg);   }
+     auto operator> (auto const &arg) const { return this->gt(arg);    }
+     auto operator>=(auto const &arg) const { return this->gte(arg);   }
+     auto operator==(auto const &arg) const { return this->eq(arg);    }
+     // auto operator%(auto const &arg) const { return this->mod(arg); } // TODO
+    // clang-format on
+};
+
+/**
+ * @brief Create a 1-indexed range array from 1 to n
+ * @param end The upper bound of the range (inclusive)
+ * @return A fusion_array containing integers from 1 to end
+ * @throws std::invalid_argument if end <= 0
+ */
+inline auto range(index_t end)
+  -> fusion_array<thrust::counting_iterator<index_t>> {
+    if (end <= 0) { throw std::invalid_argument("range: end must be > 0"); }
+
+    return {thrust::counting_iterator<index_t>(1),
+            thrust::counting_iterator<index_t>(end + 1)};
+}
+
+/**
+ * @brief Create a fusion_array from a std::vector
+ * @tparam T The element type of the vector
+ * @param host_vec The host vector to copy data from
+ * @return A fusion_array containing the vector's data on the device
+ */
+template <typename T>
+auto array(const std::vector<T> &host_vec) {
+    // Create and own a device vector
+    auto device_vec = std::make_shared<device_buffer<T>>(
+      host_vec.begin(), host_vec.end());
 
-            int num_rows = _shape[0];
-            int num_cols = _shape[1];
+    return fusion_array<typename device_buffer<T>::iterator>(
+      device_vec->begin(), device_vec->end(), device_vec);
+    // Note: _shape is already initialized by the constructor to {size}
+}
 
-            auto
-              result_vec = std::make_shared<thrust::device_vector<value_type>>(
-                num_rows, thrust::default_init);
+/**
+ * @brief Create a fusion_array from an initializer list with automatic type
+ * deduction
+ * @tparam T The element type (automatically deduced)
+ * @param init_list The initializer list containing the array elements
+ * @return A fusion_array containing the initializer list's data on the device
+ */
+template <typename T>
+auto array(std::initializer_list<T> init_list) {
+    // Convert initializer list to a device vector
+    auto device_vec = std::make_shared<device_buffer<T>>(
+      init_list.begin(), init_list.end());
 
-            // Perform row-wise reduction using reduce_by_key
-            auto output = result_vec->begin();
+    return fusion_array<typename device_buffer<T>::iterator>(
+      device_vec->begin(), device_vec->end(), device_vec);
+}
 
-            thrustx::reduce_by_n(_begin, _end, output, num_cols, op, init);
+/**
+ * @brief Create a scalar (rank 0) array containing a single value
+ * @tparam T The element type (automatically deduced)
+ * @param value The scalar value to store in the array
+ * @return A fusion_array with rank 0 containing the single value
+ */
+template <typename T>
+auto scalar(T value) {
+    return fusion_array<thrust::constant_iterator<T>>(value);
+}
 
-            // Return result as fusion_array
-            return fusion_array<
-              typename thrust::device_vector<value_type>::iterator>(
-              result_vec->begin(),
-              result_vec->end(),
-              result_vec,
-              std::vector<int>{num_rows});
-        } else {
-            static_assert(Axis == 0 || Axis == 2,
-                          "Invalid axis value. Must be 0 or 2.");
-            // This will never be reached due to static_assert, but needed for
-            // compilation
-            return fusion_array<typename thrust::device_vector<T>::iterator>();
-        }
+/**
+ * @brief Create a multi-dimensional array filled with a constant value
+ * @tparam T The element type (automatically deduced)
+ * @param value The constant value to fill the matrix with
+ * @param shape The shape as an initializer list {rows, cols}
+ * @return A fusion_array with the specified shape filled with the constant
+ * value
+ * @throws std::invalid_argument if shape doesn't have exactly 2 dimensions
+ */
+template <typename T>
+auto matrix(T value, std::initializer_list<index_t> shape) {
+    if (shape.size() != 2) {
+        throw std::invalid_argument(
+          "matrix: shape must have exactly 2 dimensions");
     }
 
-    /**
-     * @brief Maximum reduction (eager operation)
-     * @tparam Axis The axis along which to reduce (0=all elements, 2=row-wise)
-     * @param axis Optional integral_constant parameter for axis (allows 2_ic
-     * syntax)
-     * @return A fusion_array containing the maximum value(s)
-     */
-    template <int Axis = 0, typename T = int>
-    [[nodiscard]] auto maxr(
-      std::integral_constant<int, Axis> /*axis*/ = {}) const {
-        return reduce<Axis>(std::numeric_limits<value_type>::lowest(),
-                            thrust::maximum<value_type>());
-    }
+    index_t total_size = 1;
+    for (auto dim : shape) { total_size *= dim; }
 
-    /**
-     * @brief Minimum reduction (eager operation)
-     * @tparam Axis The axis along which to reduce (0=all elements, 2=row-wise)
-     * @param axis Optional integral_constant parameter for axis (allows 2_ic
-     * syntax)
-     * @return A fusion_array containing the minimum value(s)
-     */
-    template <int Axis = 0, typename T = int>
-    [[nodiscard]] auto minr(
-      std::integral_constant<int, Axis> /*axis*/ = {}) const {
-        return reduce<Axis>(std::numeric_limits<value_type>::max(),
-                            thrust::minimum<value_type>());
-    }
+    return scalar(value).repeat(total_size).reshape(shape);
+}
 
-    /**
-     * @brief Sum reduction (eager operation)
-     * @tparam Axis The axis along which to reduce (0=all elements, 2=row-wise)
-     * @param axis Optional integral_constant parameter for axis (allows 2_ic
-     * syntax)
-     * @return A fusion_array containing the sum of elements
-     */
-    template <int Axis = 0, typename T = int>
-    [[nodiscard]] auto sum(
-      std::integral_constant<int, Axis> /*axis*/ = {}) const {
-        if constexpr (has_mask) {
-            // Apply mask first
-            auto unmasked = _apply_mask_if_needed();
-            return unmasked.template sum<Axis>();
-        } else {
-            return reduce<Axis>(value_type(0), thrust::plus<value_type>());
-        }
+/**
+ * @brief Create a 2D matrix from a nested initializer list
+ * @tparam T The element type (automatically deduced from the nested list)
+ * @param nested_list A nested initializer list where each inner list represents
+ * a row
+ * @return A fusion_array with shape {rows, cols} containing the matrix data
+ * @throws std::invalid_argument if nested_list is empty or inner lists have
+ * different lengths
+ */
+template <typename T>
+auto matrix(std::initializer_list<std::initializer_list<T>> nested_list) {
+    if (nested_list.size() == 0) {
+        throw std::invalid_argument("matrix: nested_list cannot be empty");
     }
 
-    /**
-     * @brief Check if any element is non-zero (eager operation)
-     * @tparam Axis The axis along which to reduce (0=all elements, 2=row-wise)
-     * @param axis Optional integral_constant parameter for axis (allows 2_ic
-     * syntax)
-     * @return A fusion_array containing true if any element is non-zero, false
-     * otherwise
-     */
-    template <int Axis = 0, typename T = int>
-    [[nodiscard]] auto any(
-      std::integral_constant<int, Axis> /*axis*/ = {}) const {
-        return reduce<Axis>(0, thrust::logical_or<int>());
-    }
+    // Get dimensions
+    auto const rows = static_cast<index_t>(nested_list.size());
+    auto const cols = static_cast<index_t>(nested_list.begin()->size());
 
-    /**
-     * @brief Check if all elements are non-zero (eager operation)
-     * @tparam Axis The axis along which to reduce (0=all elements, 2=row-wise)
-     * @param axis Optional integral_constant parameter for axis (allows 2_ic
-     * syntax)
-     * @return A fusion_array containing true if all elements are non-zero,
-     * false otherwise
-     */
-    template <int Axis = 0, typename T = int>
-    [[nodiscard]] auto all(
-      std::integral_constant<int, Axis> /*axis*/ = {}) const {
-        return reduce<Axis>(1, thrust::logical_and<int>());
+    if (cols == 0) {
+        throw std::invalid_argument("matrix: inner lists cannot be empty");
     }
 
-    /**
-     * @brief Get the first value (useful for extracting reduction results)
-     * @return The first value in the array, properly handling thrust pairs
-     */
-    [[nodiscard]] auto value() const {
-        if constexpr (is_thrust_pair_v<value_type>) {
-            // For thrust pairs, explicitly copy device_reference to host pair
-            using pair_type = typename cuda::std::iterator_traits<
-              Iterator>::value_type;
-            thrust::pair<typename pair_type::first_type,
-                         typename pair_type::second_type>
-              host_pair = *_begin;
-            return host_pair;
-        } else {
-            return *_begin;
+    // Validate that all rows have the same length
+    for (const auto &row : nested_list) {
+        if (static_cast<index_t>(row.size()) != cols) {
+            throw std::invalid_argument(
+              "matrix: all inner lists must have the same length");
         }
     }
 
-    /**
-     * @brief Get the first element of the array
-     * @return The first element in the array
-     */
-    [[nodiscard]] auto front() const {
-        using host_value_type = extract_value_type_t<value_type>;
-        if constexpr (has_mask) {
-            // Apply mask first
-            auto unmasked = _apply_mask_if_needed();
-            return static_cast<host_value_type>(unmasked.front());
-        }
-        return static_cast<host_value_type>(*_begin);
-    }
+    // Flatten the nested data into a single vector (row-major order)
+    std::vector<T> flattened_data;
+    flattened_data.reserve(rows * cols);
 
-    /**
-     * @brief Get the last element of the array
-     * @return The last element in the array
-     */
-    [[nodiscard]] auto back() const {
-        using host_value_type = extract_value_type_t<value_type>;
-        if constexpr (has_mask) {
-            // Apply mask first and convert to host type
-            auto unmasked = _apply_mask_if_needed();
-            return static_cast<host_value_type>(unmasked.back());
-        }
-        // Convert to consistent host type
-        return static_cast<host_value_type>(*(_end - 1));
+    for (const auto &row : nested_list) {
+        for (const auto &element : row) { flattened_data.push_back(element); }
     }
 
-    /**
-     * @brief Copy elements from device to host memory
-     * @return A std::vector containing the host-side values
-     */
-    [[nodiscard]] auto to_host() const {
-        if constexpr (has_mask) {
-            // Apply mask first
-            auto unmasked = _apply_mask_if_needed();
-            return unmasked.to_host();
-        } else {
-            int n = size();
-
-            // Use the extracted value type to avoid device_reference
-            // constructor issues
-            using host_value_type = extract_value_type_t<value_type>;
-            std::vector<host_value_type> host_vector;
-            host_vector.reserve(n);
-
-            for (int i = 0; i < n; ++i) {
-                host_vector.push_back(static_cast<host_value_type>(_begin[i]));
-            }
+    // Create the array and reshape it to the matrix dimensions
+    return array(flattened_data).reshape({rows, cols});
+}
 
-            return host_vector;
-        }
+namespace detail {
+// Device address of memory a kernel can read: device and managed memory as
+// is, pinned host memory through its mapping. Pageable memory is rejected.
+inline auto device_address(const void *data, const char *what) -> void * {
+    if (data == nullptr) { return nullptr; }
+    cudaPointerAttributes attributes{};
+    throw_on_cuda_error(cudaPointerGetAttributes(&attributes, data), what);
+    if (attributes.type == cudaMemoryTypeUnregistered ||
+        attributes.devicePointer == nullptr) {
+        throw std::invalid_argument(
+          std::string(what) +
+          ": pageable host memory cannot be viewed; pin it with "
+          "cudaHostRegister or copy it with array()");
     }
+    return attributes.devicePointer;
+}
+}  // namespace detail
 
-    /**
-     * @brief Product reduction (eager operation)
-     * @tparam Axis The axis along which to reduce (0=all elements, 2=row-wise)
-     * @return A fusion_array containing the product of elements
-     */
-    template <int Axis = 0, typename T = int>
-    [[nodiscard]] auto prod() const {
-        return reduce<Axis>(value_type(1), thrust::multiplies<value_type>());
+/**
+ * @brief Wrap existing memory in a fusion_array without copying
+ * @tparam T The element type
+ * @param data Device, managed (cudaMallocManaged) or pinned host
+ * (cudaMallocHost, cudaHostRegister) memory holding the elements in
+ * row-major order
+ * @param shape The shape of the array; its product is the element count
+ * @param keepalive Owner of the memory, released when the last array that
+ * reads it is destroyed; nullptr if the caller keeps the memory alive
+ * @return A fusion_array reading data in place
+ * @throws std::invalid_argument if data is pageable host memory or shape has
+ * a negative extent
+ * @details A deleter is attached through the keepalive, e.g. for memory
+ * from a CUDA IPC handle:
+ * @code
+ * void *ptr = nullptr;
+ * cudaIpcOpenMemHandle(&ptr, handle, cudaIpcMemLazyEnablePeerAccess);
+ * auto arr = parrot::view(static_cast<float *>(ptr), {n},
+ *                         std::shared_ptr<void>(ptr, cudaIpcCloseMemHandle));
+ * @endcode
+ * Pinned host memory is read over the bus on every access; views of it suit
+ * data that is read once.
+ */
+template <typename T>
+auto view(T *data,
+          const std::vector<index_t> &shape,
+          std::shared_ptr<void> keepalive = nullptr)
+  -> fusion_array<thrust::device_ptr<T>> {
+    std::size_t n = 1;
+    for (index_t const extent : shape) {
+        if (extent < 0) {
+            throw std::invalid_argument("view: extents must be >= 0");
+        }
+        n *= static_cast<std::size_t>(extent);
     }
+    auto begin = thrust::device_pointer_cast(
+      static_cast<T *>(detail::device_address(data, "view")));
+    return fusion_array<thrust::device_ptr<T>>(
+      begin, begin + n, std::move(keepalive), shape);
+}
 
-    /**
-     * @brief Get indices where elements are non-zero (lazy operation)
-     * @return A masked fusion_array containing the 1-indexed positions where
-     * elements are non-zero
-     */
-    [[nodiscard]] auto where() const { return range(size()).keep(*this); }
-
-    /**
-     * @brief Filter elements based on a mask array (lazy operation)
-     * @param mask The mask array (elements kept where mask is non-zero)
-     * @return A masked fusion_array that will filter elements when evaluated
-     */
-    template <typename MaskIteratorKeep>
-    auto keep(const fusion_array<MaskIteratorKeep> &mask) const {
-        int n = size();
+/**
+ * @brief Wrap n existing elements in a rank 1 fusion_array without copying
+ * @param data Device, managed or pinned host memory
+ * @param n The number of elements
+ * @param keepalive Owner of the memory (see the shaped overload)
+ * @return A fusion_array of shape {n} reading data in place
+ */
+template <typename T>
+auto view(T *data, index_t n, std::shared_ptr<void> keepalive = nullptr)
+  -> fusion_array<thrust::device_ptr<T>> {
+    return view(data, std::vector<index_t>{n}, std::move(keepalive));
+}
 
-        // Size check - the mask must be the same size as the array
-        if (n != mask.size()) {
-            throw std::invalid_argument("Mask size must match array size");
+#ifdef DLPACK_VERSION
+/**
+ * @brief Import a DLPack tensor without copying
+ * @tparam T The element type; must match the tensor's dtype
+ * @param tensor A CUDA, CUDA host or CUDA managed tensor in compact
+ * row-major layout; parrot takes ownership and calls its deleter once the
+ * last array that reads it is destroyed
+ * @return A fusion_array with the tensor's shape reading its data in place
+ * @throws std::invalid_argument if the device, dtype or strides are not
+ * supported (the tensor is then left to the caller)
+ */
+template <typename T>
+auto from_dlpack(DLManagedTensor *tensor)
+  -> fusion_array<thrust::device_ptr<T>> {
+    if (tensor == nullptr) {
+        throw std::invalid_argument("from_dlpack: tensor is null");
+    }
+    DLTensor const &t = tensor->dl_tensor;
+    auto const type   = t.device.device_type;
+    if (type != kDLCUDA && type != kDLCUDAHost && type != kDLCUDAManaged) {
+        throw std::invalid_argument("from_dlpack: not a CUDA tensor");
+    }
+    DLDataType const expected = detail::dlpack_dtype<T>();
+    if (t.dtype.code != expected.code || t.dtype.bits != expected.bits ||
+        t.dtype.lanes != 1) {
+        throw std::invalid_argument("from_dlpack: dtype does not match T");
+    }
+
+    std::vector<index_t> shape(t.ndim);
+    std::int64_t stride = 1;
+    for (int d = t.ndim - 1; d >= 0; --d) {
+        if (t.strides != nullptr && t.shape[d] > 1 &&
+            t.strides[d] != stride) {
+            throw std::invalid_argument(
+              "from_dlpack: only compact row-major tensors are supported");
         }
+        shape[d] = static_cast<index_t>(t.shape[d]);
+        stride *= t.shape[d];
+    }
 
-        // Keep the mask array alive to prevent iterator invalidation
-        auto mask_source = std::make_shared<fusion_array<MaskIteratorKeep>>(
-          mask);
+    // Resolved before taking ownership so a rejected tensor is not freed
+    auto *data = static_cast<T *>(detail::device_address(
+      static_cast<char *>(t.data) + t.byte_offset, "from_dlpack"));
+    std::shared_ptr<void> owner(tensor, [](DLManagedTensor *m) {
+        if (m->deleter != nullptr) { m->deleter(m); }
+    });
+    return view(data, shape, std::move(owner));
+}
+#endif  // DLPACK_VERSION
 
-        return fusion_array<Iterator, MaskIteratorKeep>(
-          _begin,
-          _end,
-          _owned_storage,
-          mask_source->begin(),
-          mask_source->end(),
-          mask_source);  // Pass mask storage to keep it alive
+namespace detail {
+// Expression applied to each chunk when a stream_source reduction is not
+// given one
+struct chunk_identity {
+    template <typename Array>
+    auto operator()(const Array &chunk) const {
+        return chunk;
     }
+};
 
-    /**
-     * @brief Gather elements from this array using the provided indices
-     * @param indices Array of indices to gather from
-     * @return A new fusion_array containing the gathered elements
-     */
-    template <typename IndexIterator>
-    auto gather(const fusion_array<IndexIterator> &indices) const {
-        auto begin = thrust::make_permutation_iterator(_begin, indices.begin());
-        auto end   = thrust::make_permutation_iterator(_begin, indices.end());
-        return fusion_array<decltype(begin)>(begin, end);
+// Combines a scanned element with the carry of the chunks before it
+template <typename T, typename BinaryOp>
+struct scan_carry_functor {
+    const T *carry;
+    BinaryOp op;
+
+    __host__ __device__ auto operator()(const T &x) const -> T {
+        return op(*carry, x);
     }
+};
 
-    /**
-     * @brief Check if arrays match element by element (eager operation)
-     * @param other The array to compare with
-     * @return True if arrays match exactly, false otherwise
-     */
-    template <typename OtherIterator>
-    auto match(const fusion_array<OtherIterator> &other) const -> bool {
-        // Check if sizes match
-        if (size() != other.size()) { return false; }
+// Double-buffered staging of a stream_source: two device chunks, pinned
+// host chunks when the source is not pinned, and a copy stream whose
+// transfers are ordered against the compute stream with events
+template <typename T>
+class chunk_pipeline {
+   public:
+    chunk_pipeline(std::size_t chunk, bool staged) {
+        throw_on_cuda_error(
+          cudaStreamCreateWithFlags(&_copy_stream, cudaStreamNonBlocking),
+          "stream_source");
+        for (int b = 0; b < 2; ++b) {
+            _device[b] = make_buffer<T>(chunk);
+            if (staged) {
+                throw_on_cuda_error(
+                  cudaMallocHost(&_staging[b], chunk * sizeof(T)),
+                  "stream_source");
+            }
+            throw_on_cuda_error(
+              cudaEventCreateWithFlags(&_copied[b], cudaEventDisableTiming),
+              "stream_source");
+            throw_on_cuda_error(
+              cudaEventCreateWithFlags(&_consumed[b], cudaEventDisableTiming),
+              "stream_source");
+        }
+    }
+    chunk_pipeline(const chunk_pipeline &)                     = delete;
+    auto operator=(const chunk_pipeline &) -> chunk_pipeline & = delete;
+    ~chunk_pipeline() {
+        cudaStreamSynchronize(_copy_stream);
+        for (int b = 0; b < 2; ++b) {
+            if (_staging[b] != nullptr) { cudaFreeHost(_staging[b]); }
+            cudaEventDestroy(_copied[b]);
+            cudaEventDestroy(_consumed[b]);
+        }
+        cudaStreamDestroy(_copy_stream);
+    }
 
-        // Compare elements
-        return thrust::equal(_begin, _end, other.begin());
+    // Host buffer for chunk slot b, once its previous transfer is done
+    auto staging(int b) -> T * {
+        throw_on_cuda_error(cudaEventSynchronize(_copied[b]), "stream_source");
+        return _staging[b];
     }
 
-    /**
-     * @brief Inclusive scan with logical OR (eager operation)
-     * @tparam Axis The axis along which to scan (0=all elements, 1=column-wise,
-     * 2=row-wise)
-     * @param axis Optional integral_constant parameter for axis (allows 2_ic
-     * syntax)
-     * @return A new fusion_array containing running OR of elements
-     */
-    template <int Axis = 0>
-    [[nodiscard]] auto anys(
-      std::integral_constant<int, Axis> /*axis*/ = {}) const {
-        return scan<Axis>(thrust::logical_or<value_type>());
+    // Copies count elements to slot b after the compute stream is done
+    // with what the slot held before
+    void upload(int b, const T *src, std::size_t count) {
+        throw_on_cuda_error(cudaStreamWaitEvent(_copy_stream, _consumed[b]),
+                            "stream_source");
+        throw_on_cuda_error(
+          cudaMemcpyAsync(thrust::raw_pointer_cast(_device[b]->data()),
+                          src,
+                          count * sizeof(T),
+                          cudaMemcpyHostToDevice,
+                          _copy_stream),
+          "stream_source");
+        throw_on_cuda_error(cudaEventRecord(_copied[b], _copy_stream),
+                            "stream_source");
     }
 
-    /**
-     * @brief Inclusive scan with logical AND (eager operation)
-     * @tparam Axis The axis along which to scan (0=all elements, 1=column-wise,
-     * 2=row-wise)
-     * @param axis Optional integral_constant parameter for axis (allows 2_ic
-     * syntax)
-     * @return A new fusion_array containing running AND of elements
-     */
-    template <int Axis = 0>
-    [[nodiscard]] auto alls(
-      std::integral_constant<int, Axis> /*axis*/ = {}) const {
-        return scan<Axis>(thrust::logical_and<value_type>());
+    // Device chunk of slot b, ready for work queued on stream
+    auto acquire(int b, cudaStream_t stream) -> thrust::device_ptr<T> {
+        throw_on_cuda_error(cudaStreamWaitEvent(stream, _copied[b]),
+                            "stream_source");
+        return _device[b]->data();
     }
 
-    /**
-     * @brief Inclusive scan with minimum (eager operation)
-     * @tparam Axis The axis along which to scan (0=all elements, 1=column-wise,
-     * 2=row-wise)
-     * @param axis Optional integral_constant parameter for axis (allows 2_ic
-     * syntax)
-     * @return A new fusion_array containing running minimum of elements
-     */
-    template <int Axis = 0>
-    [[nodiscard]] auto mins(
-      std::integral_constant<int, Axis> /*axis*/ = {}) const {
-        return scan<Axis>(thrust::minimum<value_type>());
+    // Marks the work on slot b queued so far on stream as the last use
+    void release(int b, cudaStream_t stream) {
+        throw_on_cuda_error(cudaEventRecord(_consumed[b], stream),
+                            "stream_source");
     }
 
+   private:
+    cudaStream_t _copy_stream = nullptr;
+    std::shared_ptr<device_buffer<T>> _device[2];
+    T *_staging[2]           = {nullptr, nullptr};
+    cudaEvent_t _copied[2]   = {nullptr, nullptr};
+    cudaEvent_t _consumed[2] = {nullptr, nullptr};
+};
+}  // namespace detail
+
+/**
+ * @brief Host-resident data evaluated on the device one chunk at a time
+ * @tparam T The element type
+ * @details For inputs larger than device memory. The data stays in host
+ * memory or in a file; reductions and scans apply a lazy expression to each
+ * chunk and combine the per-chunk results on the device. Two device chunk
+ * buffers alternate, so the copy of chunk c + 1 overlaps the evaluation of
+ * chunk c (and, for file and pageable sources, reading chunk c + 1 into
+ * pinned staging overlaps both).
+ * @code
+ * parrot::stream_source<float> logs("latency.bin");
+ * auto total = logs.sum([](auto chunk) { return chunk.sq(); }).value();
+ * auto worst = logs.maxr().value();
+ * @endcode
+ */
+template <typename T>
+class stream_source {
+   public:
+    using value_type = T;
+    using chunk_type = fusion_array<thrust::device_ptr<T>>;
+
+    // Elements per chunk when none is given (64 MiB of floats)
+    static constexpr std::size_t default_chunk_size = std::size_t(1) << 24;
+
     /**
-     * @brief Inclusive scan with maximum (eager operation)
-     * @tparam Axis The axis along which to scan (0=all elements, 1=column-wise,
-     * 2=row-wise)
-     * @param axis Optional integral_constant parameter for axis (allows 2_ic
-     * syntax)
-     * @return A new fusion_array containing running maximum of elements
+     * @brief Stream n elements of host memory
+     * @param data Host memory; pinned memory is copied from directly,
+     * pageable memory through pinned staging buffers
+     * @param n The number of elements
+     * @param chunk_size Elements per chunk
      */
-    template <int Axis = 0>
-    [[nodiscard]] auto maxs(
-      std::integral_constant<int, Axis> /*axis*/ = {}) const {
-        return scan<Axis>(thrust::maximum<value_type>())._mark_sorted();
+    stream_source(const T *data,
+                  std::size_t n,
+                  std::size_t chunk_size = default_chunk_size)
+      : _data(data), _size(n), _chunk(chunk_size) {
+        if (chunk_size == 0) {
+            throw std::invalid_argument("stream_source: chunk_size is 0");
+        }
+        cudaPointerAttributes attributes{};
+        detail::throw_on_cuda_error(
+          cudaPointerGetAttributes(&attributes, data), "stream_source");
+        _pinned = attributes.type == cudaMemoryTypeHost;
     }
 
     /**
-     * @brief Inclusive scan with addition (eager operation)
-     * @tparam Axis The axis along which to scan (0=all elements, 1=column-wise,
-     * 2=row-wise)
-     * @param axis Optional integral_constant parameter for axis (allows 2_ic
-     * syntax)
-     * @return A new fusion_array containing running sum of elements
+     * @brief Stream the elements of a binary file of packed T values
+     * @param path The file to read; it is opened on every pass
+     * @param chunk_size Elements per chunk
+     * @throws std::runtime_error if the file cannot be opened
      */
-    template <int Axis = 0>
-    [[nodiscard]] auto sums(
-      std::integral_constant<int, Axis> /*axis*/ = {}) const {
-        return scan<Axis>(thrust::plus<value_type>());
+    explicit stream_source(std::string path,
+                           std::size_t chunk_size = default_chunk_size)
+      : _path(std::move(path)), _chunk(chunk_size) {
+        if (chunk_size == 0) {
+            throw std::invalid_argument("stream_source: chunk_size is 0");
+        }
+        std::ifstream file(_path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            throw std::runtime_error("stream_source: cannot open " + _path);
+        }
+        _size = static_cast<std::size_t>(file.tellg()) / sizeof(T);
     }
 
-    /**
-     * @brief Inclusive scan with multiplication (eager operation)
-     * @tparam Axis The axis along which to scan (0=all elements, 1=column-wise,
-     * 2=row-wise)
-     * @param axis Optional integral_constant parameter for axis (allows 2_ic
-     * syntax)
-     * @return A new fusion_array containing running product of elements
-     */
-    template <int Axis = 0>
-    [[nodiscard]] auto prods(
-      std::integral_constant<int, Axis> /*axis*/ = {}) const {
-        return scan<Axis>(thrust::multiplies<value_type>());
+    [[nodiscard]] auto size() const -> std::size_t { return _size; }
+    [[nodiscard]] auto chunk_size() const -> std::size_t { return _chunk; }
+    [[nodiscard]] auto num_chunks() const -> std::size_t {
+        return (_size + _chunk - 1) / _chunk;
     }
 
     /**
-     * @brief Generic inclusive scan with custom binary operation (eager
-     * operation)
-     * @details Allows applying any custom binary scan operation to the array
-     * elements. This provides flexibility beyond the predefined scans like
-     * sums, prods, mins, maxs.
-     * @param op The binary operation to apply for the scan (must be
-     * associative)
-     * @param axis Optional integral_constant parameter for axis (allows 2_ic
-     * syntax)
-     * @return A new fusion_array containing the running results of applying
-     * the operation
-     * @see sums, prods, mins, maxs, anys, alls for common predefined scans
+     * @brief Call f(chunk, first) for every chunk in order
+     * @param f Receives the chunk as a fusion_array over device memory and
+     * the index of its first element; the chunk is only valid during the
+     * call, and work f queues on the current stream may still read it
+     * @throws std::runtime_error if the file is shorter than when the
+     * source was created
      */
-    template <int Axis = 0, typename BinaryOp>
-    auto scan(BinaryOp op,
-              std::integral_constant<int, Axis> /*axis*/ = {}) const {
-        if constexpr (Axis == 0) {
-            int n = size();
-            // Create a device vector to store the scan results
-            auto
-              result_vec = std::make_shared<thrust::device_vector<value_type>>(
-                n, thrust::default_init);
-
-            // Perform inclusive scan with provided binary operation
-            thrust::inclusive_scan(_begin, _end, result_vec->begin(), op);
-
-            // Return a new array with the scan results
-            return fusion_array<
-              typename thrust::device_vector<value_type>::iterator>(
-              result_vec->begin(), result_vec->end(), result_vec, _shape);
-        } else if constexpr (Axis == 1) {
-            // Column-wise scan (for 2D arrays)
-            if (rank() != 2) {
-                throw std::runtime_error(
-                  "Cannot perform column-wise scan on array with rank != 2");
+    template <typename F>
+    void for_each_chunk(F &&f) const {
+        auto const chunks = num_chunks();
+        if (chunks == 0) { return; }
+        auto const stream = detail::current_stream();
+        detail::chunk_pipeline<T> pipe(std::min(_chunk, _size), !_pinned);
+
+        std::ifstream file;
+        if (!_path.empty()) {
+            file.open(_path, std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("stream_source: cannot open " +
+                                         _path);
             }
-            // Transpose, perform row-wise scan, then transpose back
-            auto transposed_array         = this->transpose();
-            auto scanned_transposed_array = transposed_array.template scan<2>(
-              op);
-            return scanned_transposed_array.transpose();
-        } else if constexpr (Axis == 2) {
-            // Row-wise scan (for 2D arrays)
-            if (_shape.size() < 2) {
-                throw std::runtime_error(
-                  "Cannot perform row-wise scan on array with rank < 2");
+        }
+        auto load = [&](std::size_t c) {
+            int const b      = static_cast<int>(c % 2);
+            auto const first = c * _chunk;
+            auto const count = std::min(_chunk, _size - first);
+            const T *src     = _data + first;
+            if (!_path.empty()) {
+                T *staging       = pipe.staging(b);
+                auto const bytes = static_cast<std::streamsize>(
+                  count * sizeof(T));
+                file.read(reinterpret_cast<char *>(staging), bytes);  // NOLINT
+                if (file.gcount() != bytes) {
+                    throw std::runtime_error("stream_source: " + _path +
+                                             " is shorter than expected");
+                }
+                src = staging;
+            } else if (!_pinned) {
+                T *staging = pipe.staging(b);
+                std::copy(src, src + count, staging);
+                src = staging;
             }
+            pipe.upload(b, src, count);
+        };
 
-            int num_rows = _shape[0];
-            int num_cols = _shape[1];
-
-            // Create a counting iterator and transform it to row indices
-            auto count_iter  = thrust::make_counting_iterator(0);
-            auto row_indices = thrust::make_transform_iterator(
-              count_iter, thrust::placeholders::_1 / num_cols);
-
-            // Allocate space for results
-            auto
-              result_vec = std::make_shared<thrust::device_vector<value_type>>(
-                size(), thrust::default_init);
-
-            // Perform row-wise scan using inclusive_scan_by_key
-            thrust::inclusive_scan_by_key(row_indices,
-                                          row_indices + size(),
-                                          _begin,
-                                          result_vec->begin(),
-                                          thrust::equal_to<int>(),
-                                          op);
-
-            // Return result as fusion_array
-            return fusion_array<
-              typename thrust::device_vector<value_type>::iterator>(
-              result_vec->begin(), result_vec->end(), result_vec, _shape);
-        } else {
-            static_assert(Axis == 0 || Axis == 1 || Axis == 2,
-                          "Invalid axis value. Must be 0, 1, or 2.");
-            // This will never be reached due to static_assert, but needed for
-            // compilation
-            return fusion_array<
-              typename thrust::device_vector<value_type>::iterator>();
+        load(0);
+        for (std::size_t c = 0; c < chunks; ++c) {
+            if (c + 1 < chunks) { load(c + 1); }
+            int const b      = static_cast<int>(c % 2);
+            auto const first = c * _chunk;
+            auto const count = std::min(_chunk, _size - first);
+            auto const begin = pipe.acquire(b, stream);
+            f(chunk_type(begin, begin + count), first);
+            pipe.release(b, stream);
         }
     }
 
     /**
-     * @brief Remove adjacent duplicate elements (lazy operation)
-     * @return A masked fusion_array that will filter out adjacent duplicates
-     * when evaluated
+     * @brief Reduce expr(chunk) over all chunks (eager operation)
+     * @param expr Lazy expression to evaluate on each chunk
+     * @param init Identity of op; it seeds every chunk's reduction
+     * @param op Associative binary operation
+     * @return A device-resident scalar, as returned by fusion_array::reduce
+     * @details Each chunk's partial lands in a device buffer and the
+     * partials are reduced at the end, with no host synchronization per
+     * chunk.
      */
-    [[nodiscard]] auto uniq() const {
-        return this->keep(this->differ().prepend(1));
+    template <typename F, typename U, typename BinaryOp>
+    auto reduce(F expr, U init, BinaryOp op) const {
+        auto const slots = std::max<std::size_t>(num_chunks(), 1);
+        auto partials    = detail::make_buffer<U>(slots);
+        thrust::fill(
+          detail::policy(), partials->begin(), partials->end(), init);
+        for_each_chunk([&](const chunk_type &chunk, std::size_t first) {
+            auto const partial = expr(chunk).reduce(init, op);
+            thrust::copy_n(detail::policy(),
+                           partial.begin(),
+                           1,
+                           partials->begin() + first / _chunk);
+        });
+
+        auto result_vec = detail::make_buffer<U>(1);
+        thrustx::reduce_into(partials->begin(),
+                             partials->end(),
+                             result_vec->begin(),
+                             op,
+                             init,
+                             detail::temp_allocator{},
+                             detail::current_stream());
+        auto result_begin = detail::make_device_scalar_iterator(*result_vec);
+        return fusion_array<device_scalar_iterator<U>>(
+          result_begin, result_begin + 1, result_vec, std::vector<index_t>{});
+    }
+
+    template <typename U, typename BinaryOp>
+    auto reduce(U init, BinaryOp op) const {
+        return reduce(detail::chunk_identity{}, init, op);
     }
 
     /**
-     * @brief Remove duplicate elements from the array (lazy-ish operation)
-     * @details If the array is already sorted (_is_sorted is true), this method
-     * applies a unique operation to remove adjacent duplicates. If the array is
-     * not sorted, it first sorts the array and then removes duplicates.
-     * @return A new fusion_array containing only unique elements
+     * @brief Sum of expr(chunk) over all chunks (eager operation)
      */
-    [[nodiscard]] auto distinct() const {
-        if (_is_sorted) { return this->uniq(); }
-        return this->sort().uniq();
-    }
-
-    [[nodiscard]] auto _mark_sorted() const {
-        return fusion_array<Iterator>(_begin, _end, _owned_storage, true);
+    template <typename F = detail::chunk_identity>
+    auto sum(F expr = {}) const {
+        using V = typename std::invoke_result_t<F, chunk_type>::value_type;
+        return reduce(expr, V(0), thrust::plus<V>());
     }
 
     /**
-     * @brief Run-length encode the array (eager operation)
-     * @return A fusion_array of thrust::pairs with value and count
+     * @brief Minimum of expr(chunk) over all chunks (eager operation)
      */
-    [[nodiscard]] auto rle() const {
-        using pair_type = thrust::pair<value_type, int>;
-        int n           = size();
-
-        // Create a result vector to store pairs of (value, count)
-        auto result_vec = std::make_shared<thrust::device_vector<pair_type>>(
-          n, thrust::default_init);
-
-        // Create a keys vector (values) and a counts vector
-        auto keys = std::make_shared<thrust::device_vector<value_type>>(
-          n, thrust::default_init);
-        auto counts = std::make_shared<thrust::device_vector<int>>(
-          n, thrust::default_init);
-
-        // Use constant_iterator for the initial counts (all 1s)
-        auto ones = thrust::make_constant_iterator(1);
-
-        // Run-length encode using reduce_by_key
-        auto new_end = thrust::reduce_by_key(
-          _begin,          // Input keys begin
-          _end,            // Input keys end
-          ones,            // Input values begin (all 1s)
-          keys->begin(),   // Output keys begin
-          counts->begin()  // Output values begin
-        );
-
-        // Compute the new size after encoding
-        int result_size = cuda::std::distance(keys->begin(), new_end.first);
-
-        // Resize the output vectors
-        keys->resize(result_size);
-        counts->resize(result_size);
-        result_vec->resize(result_size);
-
-        // Copy the keys and counts into the result vector as pairs
-        thrust::transform(thrust::make_zip_iterator(
-                            thrust::make_tuple(keys->begin(), counts->begin())),
-                          thrust::make_zip_iterator(
-                            thrust::make_tuple(keys->end(), counts->end())),
-                          result_vec->begin(),
-                          tuple_to_pair_functor<value_type>());
-
-        // Return a new fusion_array with the pairs
-        return fusion_array<
-          typename thrust::device_vector<pair_type>::iterator>(
-          result_vec->begin(), result_vec->end(), result_vec);
+    template <typename F = detail::chunk_identity>
+    auto minr(F expr = {}) const {
+        using V = typename std::invoke_result_t<F, chunk_type>::value_type;
+        return reduce(
+          expr, std::numeric_limits<V>::max(), thrust::minimum<V>());
     }
 
     /**
-     * @brief Group consecutive elements by a predicate and reduce each group
-     * @tparam BinPred The predicate for grouping consecutive elements
-     * @tparam BinaryOp The binary operation for reduction within each group
-     * @param pred The grouping predicate
-     * @param binop The reduction operation
-     * @return A fusion_array containing the reduced values for each group
+     * @brief Maximum of expr(chunk) over all chunks (eager operation)
      */
-    template <typename BinPred, typename BinaryOp>
-    [[nodiscard]] auto chunk_by_reduce(BinPred pred, BinaryOp binop) const {
-        int n = size();
-
-        // Create a result vector to store the reduced values
-        auto result_vec = std::make_shared<thrust::device_vector<value_type>>(
-          n, thrust::default_init);
-
-        // Use reduce_by_key with the provided predicates
-        auto new_end = thrust::reduce_by_key(
-          _begin,
-          _end,
-          _begin,  // Values are the same as keys for reduction
-          thrust::make_discard_iterator(),
-          result_vec->begin(),
-          pred,  // Grouping predicate
-          binop  // Reduction operation
-        );
-
-        // Compute the new size after reduction
-        int result_size = cuda::std::distance(result_vec->begin(),
-                                              new_end.second);
-        result_vec->resize(result_size);
-
-        // Return a new fusion_array with the reduced values
-        return fusion_array<
-          typename thrust::device_vector<value_type>::iterator>(
-          result_vec->begin(), result_vec->end(), result_vec);
+    template <typename F = detail::chunk_identity>
+    auto maxr(F expr = {}) const {
+        using V = typename std::invoke_result_t<F, chunk_type>::value_type;
+        return reduce(
+          expr, std::numeric_limits<V>::lowest(), thrust::maximum<V>());
     }
 
     /**
-     * @brief Reshape the array to the specified dimensions
-     * @param new_shape The new shape as an initializer list of dimensions
-     * @return A new fusion_array with the specified shape
-     * @details The total size of the new shape must be less than or equal to
-     * the current array size. Some data may be truncated if the new size is
-     * smaller. For cycling data to fill larger shapes, use cycle() instead.
-     * @throws std::invalid_argument if total_size > size() or either size is 0
-     * @see cycle
+     * @brief Minimum and maximum of expr(chunk) over all chunks (eager
+     * operation)
+     * @return A device-resident thrust::pair (min, max)
      */
-    [[nodiscard]] auto reshape(std::initializer_list<int> new_shape) const {
-        int total_size = 1;
-        for (auto dim : new_shape) { total_size *= dim; }
-
-        int current_size = size();
-
-        // Throw exception if either size is 0
-        if (current_size == 0 || total_size == 0) {
-            throw std::invalid_argument(
-              "reshape: current_size and total_size must be > 0");
-        }
-
-        if (total_size > current_size) {
-            throw std::invalid_argument(
-              "reshape: total_size must be <= current_size; use cycle() for "
-              "larger "
-              "shapes");
-        }
-
-        // Create a new array with truncated view
-        return fusion_array<Iterator>(
-          _begin, _begin + total_size, _owned_storage, new_shape);
+    template <typename F = detail::chunk_identity>
+    auto minmax(F expr = {}) const {
+        using V = typename std::invoke_result_t<F, chunk_type>::value_type;
+        auto lifted = [expr](const chunk_type &chunk) {
+            return expr(chunk).map(minmax_unary_op<V>());
+        };
+        return reduce(lifted,
+                      minmax_pair<V>(std::numeric_limits<V>::max(),
+                                     std::numeric_limits<V>::lowest()),
+                      minmax_binary_op<V>());
     }
 
     /**
-     * @brief Cycle the array data to fill the specified shape
-     * @param new_shape The new shape as an initializer list of dimensions
-     * @return A new fusion_array with the specified shape
-     * @details If the new shape's total size is greater than the array size,
-     * the current data is cycled to fill the new shape. If the new shape's
-     * total size is less than or equal to the array size, behaves like
-     * reshape().
-     * @throws std::invalid_argument if either size is 0
-     * @see reshape
+     * @brief Inclusive scan of expr(chunk) over all chunks, written to host
+     * memory (eager operation)
+     * @param expr Lazy expression to evaluate on each chunk
+     * @param op Associative binary operation
+     * @param out Host memory for size() results (pinned memory lets the
+     * copies overlap)
+     * @details Each chunk is scanned on its own and combined with the last
+     * result of the chunks before it, which stays on the device.
+     */
+    template <typename F, typename BinaryOp, typename V>
+    void scan(F expr, BinaryOp op, V *out) const {
+        static_assert(
+          std::is_same_v<
+            V,
+            typename std::invoke_result_t<F, chunk_type>::value_type>,
+          "scan: out must have the value type of expr(chunk)");
+        auto const stream = detail::current_stream();
+        auto carry        = detail::make_buffer<V>(1);
+        std::shared_ptr<device_buffer<V>> results[2];
+        for_each_chunk([&](const chunk_type &chunk, std::size_t first) {
+            auto const scanned = expr(chunk).scan(op);
+            auto const count   = static_cast<std::size_t>(scanned.size());
+            auto &result       = results[(first / _chunk) % 2];
+            if (!result) {
+                result = detail::make_buffer<V>(std::min(_chunk, _size));
+            }
+            if (first == 0) {
+                thrust::copy(detail::policy(),
+                             scanned.begin(),
+                             scanned.end(),
+                             result->begin());
+            } else {
+                thrust::transform(
+                  detail::policy(),
+                  scanned.begin(),
+                  scanned.end(),
+                  result->begin(),
+                  detail::scan_carry_functor<V, BinaryOp>{
+                    thrust::raw_pointer_cast(carry->data()), op});
+            }
+            thrust::copy_n(detail::policy(),
+                           result->begin() + (count - 1),
+                           1,
+                           carry->begin());
+            detail::count_d2h(count * sizeof(V));
+            detail::throw_on_cuda_error(
+              cudaMemcpyAsync(out + first,
+                              thrust::raw_pointer_cast(result->data()),
+                              count * sizeof(V),
+                              cudaMemcpyDeviceToHost,
+                              stream),
+              "stream_source::scan");
+        });
+        detail::count_sync();
+        detail::throw_on_cuda_error(cudaStreamSynchronize(stream),
+                                    "stream_source::scan");
+    }
+
+    template <typename BinaryOp, typename V>
+    void scan(BinaryOp op, V *out) const {
+        scan(detail::chunk_identity{}, op, out);
+    }
+
+    /**
+     * @brief Running sum of expr(chunk) over all chunks, written to host
+     * memory (eager operation)
      */
-    [[nodiscard]] auto cycle(std::initializer_list<int> new_shape) const {
-        int total_size = 1;
-        for (auto dim : new_shape) { total_size *= dim; }
+    template <typename F, typename V>
+    void sums(F expr, V *out) const {
+        scan(expr, thrust::plus<V>(), out);
+    }
 
-        int current_size = size();
+    template <typename V>
+    void sums(V *out) const {
+        scan(detail::chunk_identity{}, thrust::plus<V>(), out);
+    }
 
-        // Throw exception if either size is 0
-        if (current_size == 0 || total_size == 0) {
-            throw std::invalid_argument(
-              "cycle: current_size and total_size must be > 0");
-        }
+   private:
+    const T *_data = nullptr;
+    std::string _path;
+    std::size_t _size = 0;
+    std::size_t _chunk;
+    bool _pinned = false;
+};
 
-        // Create cycled iterators to repeat the data as needed
-        auto cycled_begin = thrustx::make_cycle_iterator(_begin, current_size);
-        return fusion_array<decltype(cycled_begin)>(
-          cycled_begin, cycled_begin + total_size, _owned_storage, new_shape);
+// ============================================================================
+// NumPy files
+// ============================================================================
+// load_npy and save_npy move .npy data between files and device memory with
+// no host-side parse of the elements. With PARROT_ENABLE_CUFILE defined the
+// data goes straight between the file and device memory through cuFile
+// (GPUDirect Storage); otherwise, or when the file cannot be opened for
+// direct I/O, it goes through two pinned buffers so the disk transfer of one
+// chunk overlaps the bus transfer of the other.
+namespace detail {
+
+// Bytes per pinned staging buffer of load_npy and save_npy
+constexpr std::size_t npy_chunk_bytes = std::size_t(1) << 24;
+
+// NumPy dtype string of T on a little-endian host
+template <typename T>
+auto npy_descr() -> std::string {
+    if constexpr (std::is_same_v<T, bool>) {
+        return "|b1";
+    } else if constexpr (std::is_same_v<T, __half>) {
+        return "<f2";
+    } else {
+        static_assert(std::is_arithmetic_v<T>,
+                      "npy files hold arithmetic or __half elements");
+        char const kind = std::is_floating_point_v<T> ? 'f'
+                          : std::is_signed_v<T>       ? 'i'
+                                                      : 'u';
+        return std::string(sizeof(T) == 1 ? "|" : "<") + kind +
+               std::to_string(sizeof(T));
     }
+}
 
-    // ========================================================================
-    // Copying Operations (Fused/Lazy)
-    // ========================================================================
-    // Operations that replicate or copy elements using lazy iterators for
-    // efficiency and fusion with subsequent operations.
+struct npy_header {
+    std::string descr;
+    bool fortran_order = false;
+    std::vector<index_t> shape;
+    std::size_t data_offset = 0;
+};
 
-    /**
-     * @brief Repeat a scalar value to create a 1D array of the specified size
-     * @param n The number of times to repeat the scalar value
-     * @return A new fusion_array with n elements all equal to the scalar value
-     * @details This method only works on scalar arrays (rank = 0). It repeats
-     * the scalar value n times to create a 1D array. For arrays with rank > 0,
-     * use cycle() instead.
-     * @throws std::invalid_argument if rank != 0 or n <= 0
-     * @see cycle
-     */
-    [[nodiscard]] auto repeat(int n) const {
-        // Check if this is a scalar (rank = 0)
-        if (rank() != 0) {
-            throw std::invalid_argument(
-              "repeat: array must be a scalar (rank = 0)");
+// Value of key in the header dictionary, up to the next ',' or ')' or '}'
+// (the closing ')' of a tuple is kept)
+inline auto npy_field(const std::string &dict,
+                      const std::string &key,
+                      const std::string &path) -> std::string {
+    auto const at    = dict.find("'" + key + "'");
+    auto const colon = at == std::string::npos ? at : dict.find(':', at);
+    auto const begin = colon == std::string::npos
+                         ? colon
+                         : dict.find_first_not_of(' ', colon + 1);
+    if (begin == std::string::npos) {
+        throw std::runtime_error("load_npy: " + path + " has no " + key);
+    }
+    auto const end = dict[begin] == '(' ? dict.find(')', begin) + 1
+                                        : dict.find_first_of(",}", begin);
+    return dict.substr(begin, end - begin);
+}
+
+inline auto read_npy_header(std::ifstream &file, const std::string &path)
+  -> npy_header {
+    char magic[8] = {};
+    file.read(magic, sizeof(magic));
+    if (!file || std::string(magic, 6) != "\x93NUMPY") {
+        throw std::runtime_error("load_npy: " + path + " is not a .npy file");
+    }
+    // Version 1.0 stores the header length in 2 bytes, later versions in 4
+    int const major            = static_cast<unsigned char>(magic[6]);
+    std::size_t const len_size = major == 1 ? 2 : 4;
+    unsigned char len_bytes[4] = {};
+    file.read(reinterpret_cast<char *>(len_bytes),  // NOLINT
+              static_cast<std::streamsize>(len_size));
+    std::size_t header_len = 0;
+    for (std::size_t i = len_size; i-- > 0;) {
+        header_len = (header_len << 8) | len_bytes[i];
+    }
+    std::string dict(header_len, '\0');
+    file.read(dict.data(), static_cast<std::streamsize>(header_len));
+    if (!file) {
+        throw std::runtime_error("load_npy: " + path + " is truncated");
+    }
+
+    npy_header header;
+    header.data_offset = sizeof(magic) + len_size + header_len;
+    auto descr         = npy_field(dict, "descr", path);
+    header.descr       = descr.substr(1, descr.size() - 2);  // quotes
+    if (!header.descr.empty() && header.descr[0] == '=') {
+        header.descr[0] = '<';
+    }
+    header.fortran_order = npy_field(dict, "fortran_order", path) == "True";
+    std::istringstream extents(npy_field(dict, "shape", path).substr(1));
+    for (std::string extent; std::getline(extents, extent, ',');) {
+        if (extent.find_first_of("0123456789") != std::string::npos) {
+            header.shape.push_back(static_cast<index_t>(std::stoll(extent)));
         }
+    }
+    return header;
+}
 
-        // Throw exception if n is not positive
-        if (n <= 0) { throw std::invalid_argument("repeat: n must be > 0"); }
+inline auto npy_header_bytes(const std::string &descr,
+                             const std::vector<index_t> &shape)
+  -> std::string {
+    // Python tuple syntax: (), (n,) or (rows, cols)
+    std::string extents;
+    for (std::size_t i = 0; i < shape.size(); ++i) {
+        if (i > 0) { extents += ", "; }
+        extents += std::to_string(shape[i]);
+    }
+    if (shape.size() == 1) { extents += ","; }
+    std::string dict = "{'descr': '" + descr +
+                       "', 'fortran_order': False, 'shape': (" + extents +
+                       "), }";
+
+    // Magic, version and length, then the dictionary padded with spaces
+    // and ended by '\n' to a multiple of 64 bytes
+    bool const v1            = dict.size() + 64 < 65536;
+    std::size_t const prefix = v1 ? 10 : 12;
+    auto const padded        = (prefix + dict.size() + 1 + 63) / 64 * 64;
+    dict.append(padded - prefix - dict.size() - 1, ' ');
+    dict += '\n';
+
+    std::string bytes = "\x93NUMPY";
+    bytes += static_cast<char>(v1 ? 1 : 2);
+    bytes += '\0';
+    for (std::size_t i = 0; i < prefix - 8; ++i) {
+        bytes += static_cast<char>((dict.size() >> (8 * i)) & 0xFF);
+    }
+    return bytes + dict;
+}
 
-        // Create a constant iterator to repeat the scalar value
-        auto value          = *_begin;  // Get the scalar value
-        auto repeated_begin = thrust::make_constant_iterator(value);
+#ifdef PARROT_ENABLE_CUFILE
+// Moves bytes between device and path at offset with cuFile. Returns false,
+// having moved nothing, if the file cannot be used for direct I/O.
+inline auto cufile_transfer(const std::string &path,
+                            std::size_t offset,
+                            void *device,
+                            std::size_t bytes,
+                            bool write) -> bool {
+    int const fd =
+      ::open(path.c_str(), (write ? O_WRONLY : O_RDONLY) | O_DIRECT);
+    if (fd < 0) { return false; }
+    CUfileDescr_t descr{};
+    descr.handle.fd = fd;
+    descr.type      = CU_FILE_HANDLE_TYPE_OPAQUE_FD;
+    CUfileHandle_t handle{};
+    if (cuFileHandleRegister(&handle, &descr).err != CU_FILE_SUCCESS) {
+        ::close(fd);
+        return false;
+    }
+    // cuFile does not follow the stream: work queued on the buffer (and on
+    // memory the pool hands back) has to finish first
+    count_sync();
+    auto status      = cudaStreamSynchronize(current_stream());
+    std::size_t done = 0;
+    while (status == cudaSuccess && done < bytes) {
+        auto const moved =
+          write ? cuFileWrite(handle, device, bytes - done, offset + done, done)
+                : cuFileRead(handle, device, bytes - done, offset + done, done);
+        if (moved <= 0) { break; }
+        done += static_cast<std::size_t>(moved);
+    }
+    cuFileHandleDeregister(handle);
+    ::close(fd);
+    throw_on_cuda_error(status, write ? "save_npy" : "load_npy");
+    if (done < bytes) {
+        throw std::runtime_error(std::string(write ? "save_npy" : "load_npy") +
+                                 ": cuFile transfer of " + path + " failed");
+    }
+    return true;
+}
+#endif
 
-        return fusion_array<decltype(repeated_begin)>(
-          repeated_begin, repeated_begin + n, nullptr);
+// Reads bytes from file into device memory through two pinned buffers
+inline void read_staged(std::ifstream &file,
+                        char *device,
+                        std::size_t bytes,
+                        const std::string &path) {
+    auto const stream = current_stream();
+    throw_if_capturing(stream, "load_npy");
+    auto const chunk = std::min(bytes, npy_chunk_bytes);
+    pending_host_copy<char> first(chunk);
+    pending_host_copy<char> second(chunk);
+    pending_host_copy<char> *slots[] = {&first, &second};
+    for (std::size_t done = 0, b = 0; done < bytes; done += chunk, b ^= 1) {
+        auto const count = std::min(chunk, bytes - done);
+        auto &slot       = *slots[b];
+        slot.wait();  // its previous chunk has reached the device
+        file.read(slot.data(), static_cast<std::streamsize>(count));
+        if (!file) {
+            throw std::runtime_error("load_npy: " + path + " is truncated");
+        }
+        throw_on_cuda_error(cudaMemcpyAsync(device + done,
+                                            slot.data(),
+                                            count,
+                                            cudaMemcpyHostToDevice,
+                                            stream),
+                            "load_npy");
+        slot.record(stream, nullptr);
     }
+}
 
-    /**
-     * @brief Repeat each element of the array n times (lazy operation with
-     * storage preservation)
-     * @param n The number of times to repeat each element
-     * @return A new fusion_array with each element repeated n times
-     * @details For an array [1, 2, 3] with n=2, returns [1, 1, 2, 2, 3, 3].
-     * This operation uses lazy iterators but ensures storage safety by
-     * preserving the source array's storage. This is different from repeat()
-     * which only works on scalars, and from the mask-based replicate() which
-     * materializes.
-     * @throws std::invalid_argument if n <= 0
-     * @see repeat, replicate(const fusion_array<MaskIterType>&)
-     */
-    [[nodiscard]] auto replicate(int n) const {
-        if (n <= 0) { throw std::invalid_argument("replicate: n must be > 0"); }
+// Writes bytes of device memory to file through two pinned buffers; the
+// copy of the next chunk overlaps the write of this one
+inline void write_staged(std::ofstream &file,
+                         const char *device,
+                         std::size_t bytes,
+                         const std::string &path) {
+    auto const stream = current_stream();
+    throw_if_capturing(stream, "save_npy");
+    auto const chunk  = std::min(bytes, npy_chunk_bytes);
+    auto const chunks = chunk == 0 ? 0 : (bytes + chunk - 1) / chunk;
+    pending_host_copy<char> first(chunk);
+    pending_host_copy<char> second(chunk);
+    pending_host_copy<char> *slots[] = {&first, &second};
+    auto copy = [&](std::size_t c) {
+        auto const count = std::min(chunk, bytes - c * chunk);
+        count_d2h(count);
+        throw_on_cuda_error(cudaMemcpyAsync(slots[c % 2]->data(),
+                                            device + c * chunk,
+                                            count,
+                                            cudaMemcpyDeviceToHost,
+                                            stream),
+                            "save_npy");
+        slots[c % 2]->record(stream, nullptr);
+    };
+
+    if (chunks > 0) { copy(0); }
+    for (std::size_t c = 0; c < chunks; ++c) {
+        if (c + 1 < chunks) { copy(c + 1); }
+        slots[c % 2]->wait();
+        file.write(slots[c % 2]->data(),
+                   static_cast<std::streamsize>(
+                     std::min(chunk, bytes - c * chunk)));
+    }
+    if (!file) {
+        throw std::runtime_error("save_npy: cannot write " + path);
+    }
+}
+}  // namespace detail
 
-        if constexpr (has_mask) {
-            // Apply mask first, then replicate
-            auto unmasked = _apply_mask_if_needed();
-            return unmasked.replicate(n);
-        } else {
-            int current_size = size();
-            int new_size     = current_size * n;
+/**
+ * @brief Load a .npy file into device memory
+ * @tparam T The element type; must match the file's dtype (e.g. float for
+ * '<f4', __half for '<f2')
+ * @param path The file to read
+ * @return A fusion_array with the file's shape, so a 2D file loads as a
+ * matrix
+ * @throws std::runtime_error if the file cannot be read or is not a
+ * C-ordered .npy file of T
+ * @code
+ * auto features = parrot::load_npy<float>("features.npy");  // rows x cols
+ * auto means    = features.sum(1_ic) / features.shape()[0];
+ * @endcode
+ */
+template <typename T>
+auto load_npy(const std::string &path)
+  -> fusion_array<typename device_buffer<T>::iterator> {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) { throw std::runtime_error("load_npy: cannot open " + path); }
+    auto const header = detail::read_npy_header(file, path);
+    if (header.descr != detail::npy_descr<T>()) {
+        throw std::runtime_error("load_npy: " + path + " holds '" +
+                                 header.descr + "', expected '" +
+                                 detail::npy_descr<T>() + "'");
+    }
+    if (header.fortran_order) {
+        throw std::runtime_error("load_npy: " + path +
+                                 " is in Fortran order");
+    }
+
+    std::size_t n = 1;
+    for (index_t const extent : header.shape) {
+        n *= static_cast<std::size_t>(extent);
+    }
+    auto result      = detail::make_buffer<T>(n);
+    auto *const data = reinterpret_cast<char *>(  // NOLINT
+      thrust::raw_pointer_cast(result->data()));
+    auto const bytes = n * sizeof(T);
+#ifdef PARROT_ENABLE_CUFILE
+    if (!detail::cufile_transfer(
+          path, header.data_offset, data, bytes, false)) {
+        detail::read_staged(file, data, bytes, path);
+    }
+#else
+    detail::read_staged(file, data, bytes, path);
+#endif
+    return fusion_array<typename device_buffer<T>::iterator>(
+      result->begin(), result->end(), result, header.shape);
+}
 
-            auto transform_begin = thrustx::make_replicate_iterator(_begin, n);
+/**
+ * @brief Save an array to a .npy file, keeping its shape
+ * @param arr The array to save; lazy arrays are evaluated first
+ * @param path The file to write; an existing file is replaced
+ * @throws std::runtime_error if the file cannot be written
+ * @details Blocks until the file is written.
+ */
+template <typename Iterator, typename MaskIterator>
+void save_npy(const fusion_array<Iterator, MaskIterator> &arr,
+              const std::string &path) {
+    using T            = typename fusion_array<Iterator>::value_type;
+    auto const data    = arr.eval();
+    auto const bytes   = static_cast<std::size_t>(data.size()) * sizeof(T);
+    const auto *device = reinterpret_cast<const char *>(  // NOLINT
+      thrust::raw_pointer_cast(&*data.begin()));
+    auto const header =
+      detail::npy_header_bytes(detail::npy_descr<T>(), data.shape());
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) { throw std::runtime_error("save_npy: cannot open " + path); }
+    file.write(header.data(), static_cast<std::streamsize>(header.size()));
+#ifdef PARROT_ENABLE_CUFILE
+    file.close();
+    if (detail::cufile_transfer(path,
+                                header.size(),
+                                const_cast<char *>(device),  // NOLINT
+                                bytes,
+                                true)) {
+        return;
+    }
+    file.open(path, std::ios::binary | std::ios::app);
+#endif
+    detail::write_staged(file, device, bytes, path);
+}
 
-            return fusion_array<decltype(transform_begin)>(
-              transform_begin, transform_begin + new_size, _owned_storage);
-        }
+/**
+ * @brief Random arrays from the counter-based Philox4x32-10 generator
+ * @details Every generator takes a seed and an offset: element i of the
+ * result is element offset + i of the stream for seed, so results are
+ * reproducible and a stream can be split by offsets. Each Philox call
+ * yields four elements.
+ */
+namespace random {
+namespace detail {
+template <typename T, typename Distribution>
+auto fill(index_t n,
+          std::uint64_t seed,
+          std::uint64_t offset,
+          Distribution dist,
+          const char *what) {
+    if (n < 0) {
+        throw std::invalid_argument(std::string(what) + ": n must be >= 0");
+    }
+    auto result = parrot::detail::make_buffer<T>(n);
+    thrustx::philox_fill(thrust::raw_pointer_cast(result->data()),
+                         static_cast<std::uint64_t>(n),
+                         seed,
+                         offset,
+                         dist,
+                         parrot::detail::current_stream());
+    return fusion_array<typename device_buffer<T>::iterator>(
+      result->begin(), result->end(), result);
+}
+}  // namespace detail
+
+/**
+ * @brief Uniformly distributed floats in [lo, hi) (eager operation)
+ * @param n Number of elements
+ * @param seed Key of the stream
+ * @param lo Lower bound (inclusive)
+ * @param hi Upper bound (exclusive)
+ * @param offset Number of stream elements to skip
+ * @return A fusion_array of n floats
+ */
+inline auto uniform(index_t n,
+                    std::uint64_t seed,
+                    float lo             = 0.F,
+                    float hi             = 1.F,
+                    std::uint64_t offset = 0) {
+    return detail::fill<float>(n,
+                               seed,
+                               offset,
+                               thrustx::uniform_distribution{lo, hi},
+                               "random::uniform");
+}
+
+/**
+ * @brief Normally distributed floats (eager operation)
+ * @param n Number of elements
+ * @param seed Key of the stream
+ * @param mean Mean of the distribution
+ * @param stddev Standard deviation of the distribution
+ * @param offset Number of stream elements to skip
+ * @return A fusion_array of n floats
+ * @details Box-Muller transform of pairs of uniform lanes.
+ */
+inline auto normal(index_t n,
+                   std::uint64_t seed,
+                   float mean           = 0.F,
+                   float stddev         = 1.F,
+                   std::uint64_t offset = 0) {
+    return detail::fill<float>(n,
+                               seed,
+                               offset,
+                               thrustx::normal_distribution{mean, stddev},
+                               "random::normal");
+}
+
+/**
+ * @brief Uniformly distributed integers in [lo, hi] (eager operation)
+ * @param n Number of elements
+ * @param seed Key of the stream
+ * @param lo Smallest value
+ * @param hi Largest value
+ * @param offset Number of stream elements to skip
+ * @return A fusion_array of n ints
+ * @throws std::invalid_argument if lo > hi
+ */
+inline auto integers(index_t n,
+                     std::uint64_t seed,
+                     int lo,
+                     int hi,
+                     std::uint64_t offset = 0) {
+    if (lo > hi) {
+        throw std::invalid_argument("random::integers: lo must be <= hi");
+    }
+    auto const span = static_cast<std::uint64_t>(
+      static_cast<std::int64_t>(hi) - lo + 1);
+    return detail::fill<int>(n,
+                             seed,
+                             offset,
+                             thrustx::integer_distribution{lo, span},
+                             "random::integers");
+}
+}  // namespace random
+
+// Define the stats namespace implementation
+namespace stats {
+// Normal CDF functor
+template <typename T>
+struct norm_cdf_functor {
+    __host__ __device__ auto operator()(const T &x) const -> T {
+        return static_cast<T>(normcdff(static_cast<float>(x)));
     }
+};
 
-    // ========================================================================
-    // Copying Operations (Materializing)
-    // ========================================================================
-    // Operations that replicate or copy elements and require materialization
-    // due to complex access patterns that cannot be efficiently represented
-    // as lazy iterators.
+// Standard normal cumulative distribution function
+template <typename Iterator, typename MaskIterator>
+auto norm_cdf(const fusion_array<Iterator, MaskIterator> &arr) {
+    using value_type = typename cuda::std::iterator_traits<
+      Iterator>::value_type;
+    using NormCDFFunc = norm_cdf_functor<value_type>;
+    return arr.map(NormCDFFunc());
+}
 
-    /**
-     * @brief Repeat each element of the array by the corresponding mask value
-     * (materializing operation using gather pattern)
-     * @param mask Array of integer values specifying how many times to repeat
-     * each element
-     * @return A new fusion_array with each element repeated according to the
-     * mask
-     * @details For an array [1, 2, 3] with mask [2, 1, 3], returns [1, 1, 2, 3,
-     * 3, 3]. Each element at index i is repeated mask[i] times.
-     * This operation requires materialization due to the variable repetition
-     * pattern and uses efficient index generation and permutation iterator
-     * pattern. Unlike the scalar replicate(), this cannot be efficiently
-     * represented as a lazy iterator.
-     * @throws std::invalid_argument if mask size doesn't match array size or
-     * any mask value < 0
-     * @see replicate(int)
-     */
-    template <typename MaskIterType>
-    auto replicate(const fusion_array<MaskIterType> &mask) const
-      -> fusion_array<typename thrust::device_vector<value_type>::iterator,
-                      no_mask_t> {
-        int current_size = size();
+// Statistical mode function - returns the most frequently occurring value
+template <typename Iterator, typename MaskIterator>
+auto mode(const fusion_array<Iterator, MaskIterator> &arr) {
+    using value_type = typename cuda::std::iterator_traits<
+      Iterator>::value_type;
 
-        // Size check - the mask must be the same size as the array
-        if (current_size != mask.size()) {
-            throw std::invalid_argument(
-              "Mask size must match array size for replicate operation");
-        }
+    // Count every value (hash table or sort + rle) and take the largest
+    auto mode_value = arr.value_counts().max_by_key(snd()).value().first;
 
-        if constexpr (has_mask) {
-            // Apply mask first, then replicate
-            auto unmasked = _apply_mask_if_needed();
-            return unmasked.replicate(mask);
-        } else {
-            // Note: mask values are expected to be non-negative integers
-            // For unsigned integer types, this is guaranteed by the type system
+    // Return as a scalar fusion_array
+    return fusion_array<thrust::constant_iterator<value_type>>(mode_value);
+}
 
-            // Check for negative mask values
-            if (mask.minr().value() < 0) {
-                throw std::invalid_argument(
-                  "replicate: mask values must be non-negative");
-            }
+/**
+ * @brief Summary statistics of an array (or of one row of a matrix)
+ */
+template <typename T>
+struct summary {
+    std::int64_t count;
+    agg::moment_type<T> mean;
+    agg::moment_type<T> stddev;  // Population standard deviation
+    T min;
+    T max;
+};
 
-            // Compute total output size
-            int total_size = mask.sum().value();
-
-            if (total_size == 0) {
-                // Return empty array with the correct iterator type
-                using result_iter = typename thrust::device_vector<
-                  value_type>::iterator;
-                auto empty_vec = std::make_shared<
-                  thrust::device_vector<value_type>>();
-                return fusion_array<result_iter, no_mask_t>(
-                  empty_vec->end(), empty_vec->end(), empty_vec);
-            }
+/**
+ * @brief Count, mean, standard deviation, min and max in a single pass
+ * @param arr The input array (lazy expressions are evaluated once)
+ * @return A host-side summary
+ */
+template <typename Iterator, typename MaskIterator>
+auto describe(const fusion_array<Iterator, MaskIterator> &arr) {
+    using value_type = extract_value_type_t<
+      typename cuda::std::iterator_traits<Iterator>::value_type>;
+
+    auto [moments, lo, hi] = arr.reduce_many(
+      agg::moments{}, agg::min{}, agg::max{});
+    auto const m = moments.value();
+
+    return summary<value_type>{m.count,
+                               m.mean,
+                               std::sqrt(m.variance()),
+                               lo.value(),
+                               hi.value()};
+}
 
-            // Use scatter+scan pattern for efficient index generation
-            // Create indices array that maps each output position to input
-            // position
-            auto indices_vec = std::make_shared<thrust::device_vector<int>>(
-              total_size, thrust::default_init);
-
-            // Generate cumulative sum and boundary positions
-            auto mask_cumsum = mask.sums();  // [2, 3, 6] for mask [2, 1, 3]
-            auto boundaries  = mask_cumsum.prepend(0);  // [0, 2, 3, 6]
-
-            // Initialize indices array to 0
-            thrust::fill(indices_vec->begin(), indices_vec->end(), 0);
-
-            // Scatter source indices at boundary positions
-            auto counting_iter = thrust::make_counting_iterator(0);
-            thrust::scatter_if(
-              counting_iter,  // values: [0, 1, 2, ...]
-              counting_iter + current_size,
-              boundaries.begin(),    // map: boundary positions [0, 2, 3, ...]
-              mask.begin(),          // stencil: mask values [2, 1, 3, ...]
-              indices_vec->begin(),  // output array
-              thrust::placeholders::_1 > 0);
-
-            // Fill gaps using inclusive scan with maximum
-            thrust::inclusive_scan(indices_vec->begin(),
-                                   indices_vec->end(),
-                                   indices_vec->begin(),
-                                   thrust::maximum<int>{});
-
-            // Create result vector using permutation iterator and copy
-            auto
-              result_vec = std::make_shared<thrust::device_vector<value_type>>(
-                total_size, thrust::default_init);
-            auto perm_begin = thrust::make_permutation_iterator(
-              _begin, indices_vec->begin());
-            thrust::copy(
-              perm_begin, perm_begin + total_size, result_vec->begin());
+/**
+ * @brief Row-wise count, mean, standard deviation, min and max in a single
+ * pass
+ * @param arr The input matrix
+ * @param axis Must be 2_ic (row-wise)
+ * @return One host-side summary per row
+ */
+template <typename Iterator, typename MaskIterator>
+auto describe(const fusion_array<Iterator, MaskIterator> &arr,
+              std::integral_constant<int, 2> axis) {
+    using value_type = extract_value_type_t<
+      typename cuda::std::iterator_traits<Iterator>::value_type>;
+
+    auto [moments, lo, hi] = arr.reduce_many(
+      axis, agg::moments{}, agg::min{}, agg::max{});
+    auto const m_host  = moments.to_host();
+    auto const lo_host = lo.to_host();
+    auto const hi_host = hi.to_host();
+
+    std::vector<summary<value_type>> result;
+    result.reserve(m_host.size());
+    for (size_t i = 0; i < m_host.size(); ++i) {
+        result.push_back({m_host[i].count,
+                          m_host[i].mean,
+                          std::sqrt(m_host[i].variance()),
+                          lo_host[i],
+                          hi_host[i]});
+    }
+    return result;
+}
+}  // namespace stats
+
+// ----------------------------------------------------------------------------
+// Keyed group-by aggregation
+// ----------------------------------------------------------------------------
+
+namespace detail {
+// Raw device pointer to the elements of arr, copying lazy expressions into a
+// buffer kept alive by keepalive
+template <typename Iterator>
+auto device_data(const fusion_array<Iterator> &arr,
+                 std::shared_ptr<void> &keepalive) {
+    using T = typename fusion_array<Iterator>::value_type;
+    if constexpr (is_contiguous_device_iterator_v<Iterator>) {
+        keepalive = arr.storage();
+        return static_cast<const T *>(thrust::raw_pointer_cast(&*arr.begin()));
+    } else {
+        auto staging = make_buffer<T>(arr.size());
+        evaluate_into(
+          arr.begin(), staging->size(), staging->data(), arr.storage());
+        keepalive = staging;
+        return static_cast<const T *>(
+          thrust::raw_pointer_cast(staging->data()));
+    }
+}
+}  // namespace detail
+
+/**
+ * @brief Values grouped by key; created by group_by(keys, values)
+ * @details Every aggregation returns a std::tuple whose first element holds
+ * the distinct keys in ascending order, followed by one array per aggregate
+ * with the result for each key. Keys flagged as sorted (for example the
+ * result of sort()) are reduced with thrust::reduce_by_key. Unsorted 32- and
+ * 64-bit integer keys are numbered with a GPU hash table and bucketed with a
+ * counting sort when the cardinality estimate favours hashing; other keys
+ * are radix sorted. All aggregates passed to agg() come from one pass.
+ * Positions and group counts are 32-bit, so more than INT_MAX keys throw
+ * std::length_error even with PARROT_ENABLE_64BIT_INDEX.
+ */
+template <typename KeyIterator, typename ValueIterator>
+class grouped {
+   public:
+    using key_type   = typename fusion_array<KeyIterator>::value_type;
+    using value_type = typename fusion_array<ValueIterator>::value_type;
 
-            using result_iter = typename thrust::device_vector<
-              value_type>::iterator;
-            using result_type = fusion_array<result_iter, no_mask_t>;
-            return result_type{
-              result_vec->begin(), result_vec->end(), result_vec};
+    grouped(fusion_array<KeyIterator> keys, fusion_array<ValueIterator> values)
+      : _keys(std::move(keys)), _values(std::move(values)) {
+        if (_keys.size() != _values.size()) {
+            throw std::invalid_argument(
+              "group_by: keys and values must have the same size");
+        }
+        // The hash and sort engines number positions and groups with int
+        if (_keys.size() > std::numeric_limits<int>::max()) {
+            throw std::length_error("group_by: more than INT_MAX keys");
         }
     }
 
     /**
-     * @brief Compute the cartesian product with another array (lazy operation)
-     * @param other The other array to compute the cartesian product with
-     * @return A new fusion_array containing pairs representing the cartesian
-     * product
-     * @details For arrays [1, 2] and [a, b], returns [(1, a), (1, b), (2, a),
-     * (2, b)]. The implementation replicates each element of this array by the
-     * size of the other array, and cycles the other array to match the total
-     * size, then pairs them together.
-     * @throws std::invalid_argument if either array is empty
-     * @see replicate, cycle, pairs
+     * @brief Compute several aggregates per group in a single pass
+     * @param reducers The aggregates, e.g. agg::sum{}, agg::max{},
+     * agg::count{}, agg::mean{}
+     * @return std::tuple of the distinct keys and one array per reducer
      */
-    template <typename OtherIterator>
-    auto cross(const fusion_array<OtherIterator> &other) const {
-        int this_size  = size();
-        int other_size = other.size();
-
-        if (this_size == 0 || other_size == 0) {
-            throw std::invalid_argument("cross: arrays must not be empty");
+    template <typename... Reducers>
+        requires(sizeof...(Reducers) > 0 &&
+                 (std::is_base_of_v<agg::reducer, Reducers> && ...))
+    auto agg(Reducers... /*reducers*/) const {
+        context_guard const guard(_keys.context());
+        using state_type = thrust::tuple<
+          typename Reducers::template state_type<value_type>...>;
+        auto const init = state_type(
+          Reducers{}.template identity<value_type>()...);
+        auto const lift    = detail::reduce_many_lift<value_type,
+                                                      Reducers...>();
+        auto const combine = detail::reduce_many_combine<Reducers...>();
+
+        int const n = _keys.size();
+        auto keys   = detail::make_buffer<key_type>(n);
+        auto states = detail::make_buffer<state_type>(n);
+        int groups  = 0;
+        if (_keys.is_sorted()) {
+            auto lifted = thrust::make_transform_iterator(_values.begin(),
+                                                          lift);
+            auto ends = thrust::reduce_by_key(detail::blocking_policy(),
+                                              _keys.begin(),
+                                              _keys.end(),
+                                              lifted,
+                                              keys->begin(),
+                                              states->begin(),
+                                              thrust::equal_to<key_type>(),
+                                              combine);
+            groups    = static_cast<int>(ends.first - keys->begin());
+        } else {
+            groups = _aggregate_unsorted(*keys, *states, lift, combine, init);
         }
+        keys->resize(groups);
+        states->resize(groups);
 
-        return this->replicate(other_size)
-          .pairs(other.cycle({this_size * other_size}));
+        auto state_array = fusion_array<
+          typename device_buffer<state_type>::iterator>(
+          states->begin(), states->end(), states);
+        return _finalize<Reducers...>(
+          fusion_array<typename device_buffer<key_type>::iterator>(
+            keys->begin(), keys->end(), keys, true),
+          state_array,
+          std::index_sequence_for<Reducers...>{});
     }
 
-    /**
-     * @brief Compute the outer product with another array as a 2D matrix (lazy
-     * operation)
-     * @param other The other array to compute the outer product with
-     * @param binary_op The binary operation to apply to each pair of elements
-     * @return A new fusion_array containing the results in a 2D matrix shape
-     * @details For arrays [1, 2] and [a, b] with operation `op`, returns a 2×2
-     * matrix: [op(1, a), op(1, b)] [op(2, a), op(2, b)] This is much more
-     * efficient than the cycle-based approach.
-     * @throws std::invalid_argument if either array is empty
-     * @see cross, reshape, map
-     */
-    template <typename OtherIterator, typename BinaryOp>
-    auto outer(const fusion_array<OtherIterator> &other,
-               BinaryOp binary_op) const {
-        int this_size  = size();
-        int other_size = other.size();
+    /// @brief Sum of the values of each group
+    [[nodiscard]] auto sum() const {
+        return agg(parrot::agg::sum{});
+    }
 
-        if (this_size == 0 || other_size == 0) {
-            throw std::invalid_argument("outer: arrays must not be empty");
-        }
+    /// @brief Minimum value of each group
+    [[nodiscard]] auto min() const {
+        return agg(parrot::agg::min{});
+    }
 
-        auto outer_iter = thrustx::make_outer_iterator(
-          _begin, other.begin(), this_size, other_size, binary_op);
+    /// @brief Maximum value of each group
+    [[nodiscard]] auto max() const {
+        return agg(parrot::agg::max{});
+    }
 
-        return fusion_array<decltype(outer_iter)>(
-          outer_iter,
-          outer_iter + (this_size * other_size),
-          _owned_storage,
-          {this_size, other_size});
+    /// @brief Number of values in each group
+    [[nodiscard]] auto count() const {
+        return agg(parrot::agg::count{});
     }
 
-    /**
-     * @brief Print the array contents to a stream
-     * @param os The output stream (defaults to std::cout)
-     * @param delimiter The string to print between elements (defaults to space)
-     * @return For masked arrays, returns the unmasked array; otherwise returns
-     * a reference to this array
-     */
-    auto print(std::ostream &os      = std::cout,
-               const char *delimiter = " ") const {
-        if constexpr (has_mask) {
-            // Apply mask first then print
-            auto unmasked = _apply_mask_if_needed();
-            unmasked.print(os, delimiter);
-            return unmasked;
-        } else {
-            int n = size();
-
-            if (_shape.size() <= 1) {
-                // 1D array or scalar
-                int max_width = 1;
-                // Calculate max width first
-                for (auto it = _begin; it != _end; ++it) {
-                    std::stringstream ss;
-                    if constexpr (is_thrust_pair_v<value_type>) {
-                        // Explicitly copy device_reference to host pair
-                        using pair_type = typename cuda::std::iterator_traits<
-                          Iterator>::value_type;
-                        thrust::pair<typename pair_type::first_type,
-                                     typename pair_type::second_type>
-                          host_pair = *it;
-                        ss << "(" << host_pair.first << ", " << host_pair.second
-                           << ")";
-                    } else {
-                        ss << *it;  // Implicit copy to host for other types
-                    }
-                    max_width = std::max(max_width,
-                                         static_cast<int>(ss.str().length()));
-                }
+    /// @brief Arithmetic mean of the values of each group
+    [[nodiscard]] auto mean() const {
+        return agg(parrot::agg::mean{});
+    }
 
-                // Now print with padding
-                if (n > 0) {
-                    std::stringstream ss_first;
-                    if constexpr (is_thrust_pair_v<value_type>) {
-                        // Explicitly copy device_reference to host pair
-                        using pair_type = typename cuda::std::iterator_traits<
-                          Iterator>::value_type;
-                        thrust::pair<typename pair_type::first_type,
-                                     typename pair_type::second_type>
-                          host_pair = *_begin;
-                        ss_first << "(" << host_pair.first << ", "
-                                 << host_pair.second << ")";
-                    } else {
-                        ss_first << *_begin;
-                    }
-                    os << std::setw(max_width) << ss_first.str();
-
-                    for (auto it = _begin + 1; it != _end; ++it) {
-                        std::stringstream ss_rest;
-                        if constexpr (is_thrust_pair_v<value_type>) {
-                            // Explicitly copy device_reference to host pair
-                            using pair_type = typename cuda::std::
-                              iterator_traits<Iterator>::value_type;
-                            thrust::pair<typename pair_type::first_type,
-                                         typename pair_type::second_type>
-                              host_pair = *it;
-                            ss_rest << "(" << host_pair.first << ", "
-                                    << host_pair.second << ")";
-                        } else {
-                            ss_rest << *it;
-                        }
-                        os << delimiter << std::setw(max_width)
-                           << ss_rest.str();
-                    }
-                }
-                os << '\n';
-            } else {
-                // Multi-dimensional array
-                int outer_dim  = _shape[0];
-                int inner_size = 1;
-                for (size_t i = 1; i < _shape.size(); i++) {
-                    inner_size *= _shape[i];
-                }
+   private:
+    template <typename... Reducers,
+              typename Keys,
+              typename States,
+              std::size_t... I>
+    static auto _finalize(const Keys &keys,
+                          const States &states,
+                          std::index_sequence<I...> /*seq*/) {
+        return std::make_tuple(
+          keys, states.map(detail::reduce_many_finalize<I, Reducers>())...);
+    }
+
+    // Groups unsorted keys into keys/states; returns the number of groups
+    template <typename State, typename Lift, typename Combine>
+    auto _aggregate_unsorted(device_buffer<key_type> &keys,
+                             device_buffer<State> &states,
+                             Lift lift,
+                             Combine combine,
+                             State init) const -> int {
+        int const n = _keys.size();
+        if (n == 0) { return 0; }
+        auto const stream = detail::current_stream();
+        std::shared_ptr<void> input;
+        auto const *key_data = detail::device_data(_keys, input);
+
+        if constexpr (thrustx::is_hash_key_v<key_type>) {
+            auto const estimate = thrustx::estimate_cardinality(
+              key_data, n, detail::temp_allocator{}, stream);
+            if (thrustx::prefer_hash(
+                  estimate, n, sizeof(key_type) + sizeof(State))) {
+                // Dense group ids in key order, then a counting sort
+                auto group_ids   = detail::make_buffer<int>(n);
+                auto counts      = detail::make_buffer<int>(n);
+                int const groups = thrustx::hash_group_ids(
+                  key_data,
+                  n,
+                  estimate,
+                  thrust::raw_pointer_cast(group_ids->data()),
+                  thrust::raw_pointer_cast(keys.data()),
+                  thrust::raw_pointer_cast(counts->data()),
+                  detail::temp_allocator{},
+                  stream);
+
+                auto offsets = detail::make_buffer<int>(groups + 1);
+                thrust::exclusive_scan(detail::policy(),
+                                       counts->begin(),
+                                       counts->begin() + groups,
+                                       offsets->begin());
+                thrust::fill_n(
+                  detail::policy(), offsets->begin() + groups, 1, n);
+
+                auto perm = detail::make_buffer<int>(n);
+                thrustx::group_permutation(
+                  thrust::raw_pointer_cast(group_ids->data()),
+                  n,
+                  thrust::raw_pointer_cast(offsets->data()),
+                  groups,
+                  thrust::raw_pointer_cast(perm->data()),
+                  detail::temp_allocator{},
+                  stream);
+
+                auto lifted = thrust::make_transform_iterator(
+                  thrust::make_permutation_iterator(_values.begin(),
+                                                    perm->begin()),
+                  lift);
+                thrustx::segmented_reduce(
+                  lifted,
+                  thrust::raw_pointer_cast(offsets->data()),
+                  groups,
+                  states.begin(),
+                  combine,
+                  init,
+                  detail::temp_allocator{},
+                  stream);
+                return groups;
+            }
+        }
 
-                // Calculate the maximum width for pretty printing
-                int max_width = 1;
-                for (auto it = _begin; it != _end; ++it) {
-                    std::stringstream ss;
-                    if constexpr (is_thrust_pair_v<value_type>) {
-                        // Explicitly copy device_reference to host pair
-                        using pair_type = typename cuda::std::iterator_traits<
-                          Iterator>::value_type;
-                        thrust::pair<typename pair_type::first_type,
-                                     typename pair_type::second_type>
-                          host_pair = *it;
-                        ss << "(" << host_pair.first << ", " << host_pair.second
-                           << ")";
-                    } else {
-                        // Handle potential non-string-convertible types
-                        // gracefully? For now, assume std::to_string works or
-                        // similar stream insertion
-                        ss << *it;  // Implicit copy to host for other types
-                    }
-                    auto width = static_cast<int>(ss.str().length());
-                    max_width  = std::max(max_width, width);
-                }
+        // Sort (key, position) pairs, then reduce runs of equal keys
+        auto sorted_keys = detail::make_buffer<key_type>(n);
+        auto perm        = detail::make_buffer<int>(n);
+        if constexpr (std::is_arithmetic_v<key_type>) {
+            auto positions = detail::make_buffer<int>(n);
+            thrust::sequence(
+              detail::policy(), positions->begin(), positions->end());
+            thrustx::radix_sort_pairs(
+              key_data,
+              thrust::raw_pointer_cast(sorted_keys->data()),
+              thrust::raw_pointer_cast(positions->data()),
+              thrust::raw_pointer_cast(perm->data()),
+              n,
+              false,
+              detail::temp_allocator{},
+              stream);
+        } else {
+            thrust::copy(
+              detail::policy(), key_data, key_data + n, sorted_keys->begin());
+            thrust::sequence(detail::policy(), perm->begin(), perm->end());
+            thrust::stable_sort_by_key(detail::policy(),
+                                       sorted_keys->begin(),
+                                       sorted_keys->end(),
+                                       perm->begin());
+        }
+
+        auto lifted = thrust::make_transform_iterator(
+          thrust::make_permutation_iterator(_values.begin(), perm->begin()),
+          lift);
+        auto ends = thrust::reduce_by_key(detail::blocking_policy(),
+                                          sorted_keys->begin(),
+                                          sorted_keys->end(),
+                                          lifted,
+                                          keys.begin(),
+                                          states.begin(),
+                                          thrust::equal_to<key_type>(),
+                                          combine);
+        return static_cast<int>(ends.first - keys.begin());
+    }
+
+    fusion_array<KeyIterator> _keys;
+    fusion_array<ValueIterator> _values;
+};
 
-                for (int i = 0; i < outer_dim; i++) {
-                    // Print each "row"
-                    int row_start = i * inner_size;
-                    if (inner_size > 0) {
-                        std::stringstream ss_first;
-                        if constexpr (is_thrust_pair_v<value_type>) {
-                            // Explicitly copy device_reference to host pair
-                            using pair_type = typename cuda::std::
-                              iterator_traits<Iterator>::value_type;
-                            thrust::pair<typename pair_type::first_type,
-                                         typename pair_type::second_type>
-                              host_pair = *(_begin + row_start);
-                            ss_first << "(" << host_pair.first << ", "
-                                     << host_pair.second << ")";
-                        } else {
-                            ss_first << *(_begin + row_start);
-                        }
-                        os << std::setw(max_width) << ss_first.str();
-
-                        for (int j = 1; j < inner_size; j++) {
-                            std::stringstream ss_rest;
-                            if constexpr (is_thrust_pair_v<value_type>) {
-                                // Explicitly copy device_reference to host pair
-                                using pair_type = typename cuda::std::
-                                  iterator_traits<Iterator>::value_type;
-                                thrust::pair<typename pair_type::first_type,
-                                             typename pair_type::second_type>
-                                  host_pair = *(_begin + row_start + j);
-                                ss_rest << "(" << host_pair.first << ", "
-                                        << host_pair.second << ")";
-                            } else {
-                                ss_rest << *(_begin + row_start + j);
-                            }
-                            os << delimiter << std::setw(max_width)
-                               << ss_rest.str();
-                        }
-                    }
-                    os << '\n';
-                }
-            }
+/**
+ * @brief Group values by key for keyed aggregation
+ * @param keys The key of every element
+ * @param values The values to aggregate (same size as keys)
+ * @return A grouped object; call sum(), min(), max(), count(), mean() or
+ * agg(reducers...) on it
+ * @details Keys do not need to be adjacent or sorted:
+ * @code
+ * auto [users, totals, largest] = parrot::group_by(user_ids, amounts)
+ *                                   .agg(parrot::agg::sum{},
+ *                                        parrot::agg::max{});
+ * @endcode
+ */
+template <typename KeyIterator, typename ValueIterator>
+auto group_by(const fusion_array<KeyIterator> &keys,
+              const fusion_array<ValueIterator> &values) {
+    return grouped<KeyIterator, ValueIterator>(keys, values);
+}
 
-            return *this;
+// ============================================================================
+// CUDA Graphs
+// ============================================================================
+// capture() records the kernels and copies a pipeline enqueues into a CUDA
+// graph; replaying it relaunches all of them with a single cudaGraphLaunch,
+// which removes the per-operation host overhead of short pipelines run many
+// times. Everything allocated while capturing comes from a pool owned by the
+// graph and is never handed to other work, so every replay finds its results
+// and temporaries at the addresses that were recorded.
+
+namespace detail {
+// Serves allocations made during capture from a private pool that is sealed
+// once the capture ended. Afterwards (e.g. for eager ops on a graph's
+// outputs) requests go to the resource that was active when capture began.
+class graph_memory_resource : public memory_resource {
+   public:
+    explicit graph_memory_resource(memory_resource *fallback)
+      : _fallback(fallback) {}
+
+    auto allocate(std::size_t bytes, cudaStream_t stream = nullptr)
+      -> void * override {
+        std::lock_guard<std::mutex> const lock(_mutex);
+        if (_sealed) { return _fallback->allocate(bytes, stream); }
+        void *ptr = _pool.allocate(bytes, stream);
+        _captured.insert(ptr);
+        return ptr;
+    }
+
+    void deallocate(void *ptr,
+                    std::size_t bytes,
+                    cudaStream_t stream = nullptr) override {
+        std::lock_guard<std::mutex> const lock(_mutex);
+        if (_captured.count(ptr) != 0) {
+            // Cached by the pool; once sealed it is only freed with the graph
+            _pool.deallocate(ptr, bytes, stream);
+        } else {
+            _fallback->deallocate(ptr, bytes, stream);
         }
     }
 
-    /**
-     * @brief Find the minimum and maximum values in the array (eager
-     * operation)
-     * @return A fusion_array containing a thrust::pair with first=minimum
-     * and second=maximum
-     */
-    [[nodiscard]] auto minmax() const {
-        auto unary_op  = minmax_unary_op<value_type>();
-        auto binary_op = minmax_binary_op<value_type>();
-        auto init      = unary_op(*_begin);
+    [[nodiscard]] auto stats() const -> memory_stats override {
+        return _pool.stats();
+    }
 
-        return this->map(unary_op).reduce(init, binary_op);
+    void reset_stats() override { _pool.reset_stats(); }
+
+    void seal() {
+        std::lock_guard<std::mutex> const lock(_mutex);
+        _sealed = true;
+    }
+
+   private:
+    std::mutex _mutex;
+    pool_memory_resource _pool;
+    memory_resource *_fallback;
+    std::unordered_set<void *> _captured;
+    bool _sealed = false;
+};
+
+// What a graph owns. Arrays created during capture are bound to the context
+// through a shared_ptr aliasing this state, so the graph's memory outlives
+// both the graph object and the last of its outputs.
+struct graph_state {
+    graph_memory_resource resource{get_memory_resource()};
+    execution_context context = execution_context::create(&resource);
+    cudaGraphExec_t exec      = nullptr;
+
+    graph_state() = default;
+    graph_state(const graph_state &)                     = delete;
+    auto operator=(const graph_state &) -> graph_state & = delete;
+    ~graph_state() {
+        if (exec != nullptr) { cudaGraphExecDestroy(exec); }
     }
+};
+}  // namespace detail
+
+/**
+ * @brief A captured parrot pipeline that can be relaunched as a whole
+ * @details Created by parrot::capture(). Each replay reruns the recorded
+ * kernels on the same device memory: the arrays produced inside the capture
+ * are overwritten with the new results, and inputs created before the
+ * capture are read at their recorded addresses.
+ */
+class graph {
+   public:
+    graph() = default;
 
     /**
-     * @brief Take the first n elements of the array
-     * @param n The number of elements to take
-     * @return A new fusion_array containing only the first n elements
-     * @throws std::invalid_argument if n > size() or n < 0
+     * @brief Relaunch the captured work on the graph's stream
+     * @details The launch is ordered after the work queued so far on the
+     * current context, and work queued on it afterwards waits for the
+     * replay. The host does not block.
      */
-    [[nodiscard]] auto take(int n) const {
-        if (n < 0 || n > size()) {
-            throw std::invalid_argument(
-              "take: n must be between 0 and size() inclusive");
+    void replay() const {
+        if (_state == nullptr) {
+            throw std::logic_error("graph::replay: empty graph");
         }
-
-        return fusion_array<Iterator>(_begin, _begin + n, _owned_storage);
+        auto const &caller = detail::current_context();
+        _state->context.wait(caller);
+        detail::count_launch();
+        detail::throw_on_cuda_error(
+          cudaGraphLaunch(_state->exec, _state->context.stream()),
+          "graph::replay");
+        caller.wait(_state->context);
     }
 
     /**
-     * @brief Drop the first n elements of the array
-     * @param n The number of elements to drop
-     * @return A new fusion_array containing all elements except the first
-     * n
-     * @throws std::invalid_argument if n > size() or n < 0
+     * @brief Copy new values into captured inputs, then relaunch
+     * @param input An array created before the capture and read by it; it
+     * must own contiguous device memory
+     * @param values The new contents (any expression of the same size)
+     * @param rest Further (input, values) pairs
+     * @throws std::invalid_argument if a pair's sizes differ
      */
-    [[nodiscard]] auto drop(int n) const {
-        if (n < 0 || n > size()) {
+    template <typename InputIterator, typename ValueIterator, typename... Rest>
+    void replay(const fusion_array<InputIterator> &input,
+                const fusion_array<ValueIterator> &values,
+                const Rest &...rest) const {
+        static_assert(is_contiguous_device_iterator_v<InputIterator>,
+                      "replay: captured inputs must be materialized arrays");
+        static_assert(sizeof...(Rest) % 2 == 0,
+                      "replay: expects (input, values) pairs");
+        if (_state == nullptr) {
+            throw std::logic_error("graph::replay: empty graph");
+        }
+        if (input.size() != values.size()) {
             throw std::invalid_argument(
-              "drop: n must be between 0 and size() inclusive");
+              "graph::replay: new values must match the input size");
         }
-        if (n == size()) {  // if dropping all elements, return empty array
-            return fusion_array<Iterator>(_end, _end, _owned_storage);
+        // Queued on the caller's stream, so replay() orders the launch after
+        // it and the values cannot be released before they are read
+        thrust::copy(
+          detail::policy(), values.begin(), values.end(), input.begin());
+        if constexpr (sizeof...(Rest) == 0) {
+            replay();
+        } else {
+            replay(rest...);
         }
-        return fusion_array<Iterator>(_begin + n, _end, _owned_storage);
     }
 
     /**
-     * @brief Flatten the array to rank 1 (modifies shape only, no data copy)
-     * @return A new fusion_array with the same data but flattened to 1D
+     * @brief Block the host until the last replay has finished
      */
-    [[nodiscard]] auto flatten() const {
-        std::vector<int> flat_shape = {size()};
-        return fusion_array<Iterator>(_begin, _end, _owned_storage, flat_shape);
+    void synchronize() const {
+        if (_state != nullptr) { _state->context.synchronize(); }
     }
 
     /**
-     * @brief Get a copy of a specific row (with data copy)
-     * @param row_idx The row index to extract
-     * @return A fusion_array copy of the specified row
-     * @throws std::runtime_error if array rank != 2 or row_idx out of bounds
+     * @brief The context the graph was captured and is replayed on
+     * @details Arrays created during the capture are bound to it.
      */
-    [[nodiscard]] auto row(int row_idx) const {
-        if (rank() != 2) {
-            throw std::runtime_error("row() only works on rank 2 arrays");
-        }
+    [[nodiscard]] auto context() const -> const execution_context & {
+        return _state != nullptr ? _state->context
+                                 : detail::current_context();
+    }
 
-        int num_rows = _shape[0];
-        int num_cols = _shape[1];
+   private:
+    template <typename F>
+    friend auto capture(F &&f);
 
-        if (row_idx < 0 || row_idx >= num_rows) {
-            throw std::invalid_argument("row index out of bounds");
-        }
+    explicit graph(std::shared_ptr<detail::graph_state> state)
+      : _state(std::move(state)) {}
 
-        return this->flatten().drop(row_idx * num_cols).take(num_cols);
+    std::shared_ptr<detail::graph_state> _state;
+};
+
+/**
+ * @brief Record a pipeline into a CUDA graph
+ * @param f Callable that runs the pipeline once. Its eager operations are
+ * recorded, not executed.
+ * @return The instantiated graph; call replay() to run the pipeline. If f
+ * returns a value (e.g. an array or a tuple of arrays), a pair of the graph
+ * and that value, whose arrays hold the results of the latest replay.
+ * @throws std::logic_error if f reads a result back to the host (value(),
+ * to_host(), or an op that returns a host-side count) while capturing
+ * @details Operations run on a stream owned by the graph; arrays bound to
+ * another context with on() are not recorded. Ops that read their result
+ * size back from the device (filter(), uniq(), ...) cannot be captured.
+ * @code
+ * auto x          = parrot::array({1.0F, 2.0F, 3.0F});
+ * auto [g, total] = parrot::capture([&] { return x.sq().sum(); });
+ * g.replay(x, parrot::array({4.0F, 5.0F, 6.0F}));
+ * float t = total.value();  // 77
+ * @endcode
+ */
+template <typename F>
+auto capture(F &&f) {
+    using result_type = std::invoke_result_t<F>;
+    // Placeholder so the void and value-returning cases share one path
+    using stored_type = std::conditional_t<std::is_void_v<result_type>,
+                                           std::monostate,
+                                           result_type>;
+    std::optional<stored_type> result;
+
+    auto state = std::make_shared<detail::graph_state>();
+    std::shared_ptr<const execution_context> const ctx(state,
+                                                       &state->context);
+    auto const stream = state->context.stream();
+    cudaGraph_t recorded = nullptr;
+    {
+        detail::bind_scope const scope(ctx);
+        // Relaxed mode permits the upstream cudaMalloc of the graph's pool
+        detail::throw_on_cuda_error(
+          cudaStreamBeginCapture(stream, cudaStreamCaptureModeRelaxed),
+          "capture");
+        try {
+            if constexpr (std::is_void_v<result_type>) {
+                std::forward<F>(f)();
+            } else {
+                result.emplace(std::forward<F>(f)());
+            }
+        } catch (...) {
+            cudaStreamEndCapture(stream, &recorded);
+            if (recorded != nullptr) { cudaGraphDestroy(recorded); }
+            state->resource.seal();
+            throw;
+        }
+        detail::throw_on_cuda_error(cudaStreamEndCapture(stream, &recorded),
+                                    "capture");
+    }
+    state->resource.seal();
+    auto const status =
+      cudaGraphInstantiateWithFlags(&state->exec, recorded, 0);
+    cudaGraphDestroy(recorded);
+    detail::throw_on_cuda_error(status, "capture");
+    if constexpr (std::is_void_v<result_type>) {
+        return graph(std::move(state));
+    } else {
+        return std::pair<graph, result_type>(graph(std::move(state)),
+                                             std::move(*result));
     }
+}
 
-    /**
-     * @brief Find the first index of a value in the array (0-based)
-     * @param value The value to search for
-     * @return The 0-based index of the first occurrence, or -1 if not found
-     * @throws std::runtime_error if array rank != 1
-     */
-    template <typename T>
-    auto index_of(const T &value) const -> int {
-        if (rank() != 1) {
-            throw std::runtime_error("index_of() only works on rank 1 arrays");
+// ============================================================================
+// Multi-GPU Sharding
+// ============================================================================
+// A sharded_array splits an array into contiguous pieces, one per device,
+// each with its own non-blocking stream. Lazy element-wise work stays local
+// to a shard; reductions, scans, sorts and run-length encoding exchange the
+// little data that crosses shard boundaries. With PARROT_ENABLE_NCCL defined,
+// reductions NCCL maps onto finish with an allreduce; everything else moves
+// through peer copies or the host.
+
+namespace detail {
+// Makes a device current for its lifetime and restores the previous one
+class device_guard {
+   public:
+    explicit device_guard(int device) {
+        throw_on_cuda_error(cudaGetDevice(&_previous), "device_guard");
+        if (device != _previous) {
+            throw_on_cuda_error(cudaSetDevice(device), "device_guard");
         }
+    }
+    device_guard(const device_guard &)                     = delete;
+    auto operator=(const device_guard &) -> device_guard & = delete;
+    ~device_guard() { cudaSetDevice(_previous); }
 
-        if constexpr (has_mask) {
-            // Apply mask first, then search
-            auto unmasked = _apply_mask_if_needed();
-            return unmasked.index_of(value);
-        } else {
-            auto it = thrust::find(_begin, _end, value);
-            if (it == _end) {
-                return -1;  // Not found
+   private:
+    int _previous = 0;
+};
+
+// Enables peer access between every pair of distinct devices once. Copies
+// between devices without it still work but are staged through the host.
+inline void enable_peer_access(const std::vector<int> &devices) {
+    static std::mutex mutex;
+    static std::set<std::pair<int, int>> tried;
+    std::lock_guard<std::mutex> const lock(mutex);
+    for (int const from : devices) {
+        for (int const to : devices) {
+            if (from == to || !tried.insert({from, to}).second) { continue; }
+            int can_access = 0;
+            cudaDeviceCanAccessPeer(&can_access, from, to);
+            if (can_access == 0) { continue; }
+            device_guard const guard(from);
+            if (cudaDeviceEnablePeerAccess(to, 0) != cudaSuccess) {
+                cudaGetLastError();  // Already enabled
             }
-            return cuda::std::distance(_begin, it);
         }
     }
+}
+
+// Evenly spaced sample positions of a shard of n elements
+struct sample_position {
+    index_t n;
+    index_t samples;
+
+    __host__ __device__ auto operator()(index_t i) const -> index_t {
+        return static_cast<index_t>(static_cast<std::int64_t>(n) * (i + 1) /
+                                    (samples + 1));
+    }
+};
+
+// Combines the carry of the preceding shards into a scanned element
+template <typename T, typename BinaryOp>
+struct shard_carry_functor {
+    T carry;
+    bool active;
+    BinaryOp op;
+
+    __host__ __device__ auto operator()(const T &x) const -> T {
+        return active ? static_cast<T>(op(carry, x)) : x;
+    }
+};
+
+#ifdef PARROT_ENABLE_NCCL
+inline void throw_on_nccl_error(ncclResult_t status, const char *what) {
+    if (status != ncclSuccess) {
+        throw std::runtime_error(std::string(what) + ": " +
+                                 ncclGetErrorString(status));
+    }
+}
+
+// One communicator per device for every device list, created on first use.
+// Like the default pool they are leaked, so no teardown order is imposed.
+inline auto nccl_comms(const std::vector<int> &devices)
+  -> const std::vector<ncclComm_t> & {
+    static std::mutex mutex;
+    static auto *comms =
+      new std::map<std::vector<int>, std::vector<ncclComm_t>>();  // NOLINT
+    std::lock_guard<std::mutex> const lock(mutex);
+    auto it = comms->find(devices);
+    if (it == comms->end()) {
+        std::vector<ncclComm_t> created(devices.size());
+        throw_on_nccl_error(ncclCommInitAll(created.data(),
+                                            static_cast<int>(devices.size()),
+                                            devices.data()),
+                            "ncclCommInitAll");
+        it = comms->emplace(devices, std::move(created)).first;
+    }
+    return it->second;
+}
+
+// NCCL element types and reduction operators parrot types map onto; value
+// says whether a mapping exists and id is the NCCL enumerator
+template <typename T>
+struct nccl_type : std::false_type {};
+template <>
+struct nccl_type<std::int8_t> : std::true_type {
+    static constexpr ncclDataType_t id = ncclInt8;
+};
+template <>
+struct nccl_type<std::uint8_t> : std::true_type {
+    static constexpr ncclDataType_t id = ncclUint8;
+};
+template <>
+struct nccl_type<std::int32_t> : std::true_type {
+    static constexpr ncclDataType_t id = ncclInt32;
+};
+template <>
+struct nccl_type<std::uint32_t> : std::true_type {
+    static constexpr ncclDataType_t id = ncclUint32;
+};
+template <>
+struct nccl_type<std::int64_t> : std::true_type {
+    static constexpr ncclDataType_t id = ncclInt64;
+};
+template <>
+struct nccl_type<std::uint64_t> : std::true_type {
+    static constexpr ncclDataType_t id = ncclUint64;
+};
+template <>
+struct nccl_type<float> : std::true_type {
+    static constexpr ncclDataType_t id = ncclFloat32;
+};
+template <>
+struct nccl_type<double> : std::true_type {
+    static constexpr ncclDataType_t id = ncclFloat64;
+};
+
+template <typename BinaryOp>
+struct nccl_op : std::false_type {};
+template <typename T>
+struct nccl_op<thrust::plus<T>> : std::true_type {
+    static constexpr ncclRedOp_t id = ncclSum;
+};
+template <typename T>
+struct nccl_op<thrust::multiplies<T>> : std::true_type {
+    static constexpr ncclRedOp_t id = ncclProd;
+};
+template <typename T>
+struct nccl_op<thrust::minimum<T>> : std::true_type {
+    static constexpr ncclRedOp_t id = ncclMin;
+};
+template <typename T>
+struct nccl_op<thrust::maximum<T>> : std::true_type {
+    static constexpr ncclRedOp_t id = ncclMax;
+};
+template <>
+struct nccl_op<parrot::add> : std::true_type {
+    static constexpr ncclRedOp_t id = ncclSum;
+};
+template <>
+struct nccl_op<parrot::mul> : std::true_type {
+    static constexpr ncclRedOp_t id = ncclProd;
+};
+template <>
+struct nccl_op<parrot::min> : std::true_type {
+    static constexpr ncclRedOp_t id = ncclMin;
+};
+template <>
+struct nccl_op<parrot::max> : std::true_type {
+    static constexpr ncclRedOp_t id = ncclMax;
+};
+#endif
+}  // namespace detail
+
+/**
+ * @brief An array partitioned into contiguous shards, one per device
+ * @tparam Shard The fusion_array type of every shard
+ * @details Shard i lives on devices()[i] and queues its eager operations on
+ * its own non-blocking stream there, so the devices work concurrently.
+ * Element-wise work goes through map() or apply() and stays lazy on every
+ * shard. Reductions leave the combined result on every shard (an allreduce),
+ * so it can feed further per-shard work; value() reads it. Create one with
+ * parrot::shard().
+ *
+ * Example:
+ * @code
+ * auto data  = parrot::shard(parrot::range(1 << 28).as<double>());
+ * auto total = data.apply([](const auto &part) { return part.sq(); })
+ *                .sum()
+ *                .value();
+ * @endcode
+ */
+template <typename Shard>
+class sharded_array {
+   public:
+    using shard_type  = Shard;
+    using value_type  = typename Shard::value_type;
+    using context_ptr = std::shared_ptr<const execution_context>;
 
     /**
-     * @brief Find the last index of a value in the array (0-based)
-     * @param value The value to search for
-     * @return The 0-based index of the last occurrence, or -1 if not found
-     * @throws std::runtime_error if array rank != 1
+     * @brief Assemble a sharded array from shards already on their devices
+     * @param devices Device of every shard
+     * @param contexts Context of every shard (its stream is on that device)
+     * @param shards The shards, in element order
+     * @throws std::invalid_argument if the three lists differ in length or
+     * are empty
      */
-    template <typename T>
-    auto last_index_of(const T &value) const -> int {
-        if (rank() != 1) {
-            throw std::runtime_error(
-              "last_index_of() only works on rank 1 arrays");
+    sharded_array(std::vector<int> devices,
+                  std::vector<context_ptr> contexts,
+                  std::vector<Shard> shards)
+      : _devices(std::move(devices)),
+        _contexts(std::move(contexts)),
+        _shards(std::move(shards)) {
+        if (_devices.empty() || _devices.size() != _contexts.size() ||
+            _devices.size() != _shards.size()) {
+            throw std::invalid_argument(
+              "sharded_array: need one device, context and shard per part");
         }
+    }
 
-        if constexpr (has_mask) {
-            // Apply mask first, then search
-            auto unmasked = _apply_mask_if_needed();
-            return unmasked.last_index_of(value);
-        } else {
-            // Search from the end using reverse iterators
-            auto rbegin = thrust::make_reverse_iterator(_end);
-            auto rend   = thrust::make_reverse_iterator(_begin);
-            auto it     = thrust::find(rbegin, rend, value);
+    [[nodiscard]] auto num_shards() const -> std::size_t {
+        return _shards.size();
+    }
 
-            if (it == rend) {
-                return -1;  // Not found
-            }
+    [[nodiscard]] auto devices() const -> const std::vector<int> & {
+        return _devices;
+    }
 
-            // Convert reverse iterator position to forward index
-            return cuda::std::distance(_begin, it.base()) - 1;
-        }
+    [[nodiscard]] auto shards() const -> const std::vector<Shard> & {
+        return _shards;
     }
 
     /**
-     * @brief Find the maximum element based on key extractor
-     * @tparam KeyExtractor The type of the key extractor functor
-     * @param key_extractor A functor that extracts a key for comparison
-     * from each element
-     * @return A fusion_array containing the maximum element based on the
-     * extracted key
+     * @brief Total number of elements over all shards
      */
-    template <typename KeyExtractor>
-    auto max_by_key(KeyExtractor key_extractor) const
-      -> fusion_array<typename thrust::device_vector<
-        typename cuda::std::iterator_traits<Iterator>::value_type>::iterator> {
-        int n = size();
+    [[nodiscard]] auto size() const -> index_t {
+        index_t total = 0;
+        for (auto const &part : _shards) { total += part.size(); }
+        return total;
+    }
 
-        if (n == 0) {
-            // Return an empty array for empty input
-            return fusion_array<Iterator>(_begin, _begin, _owned_storage);
+    /**
+     * @brief Apply a function to every shard on its device
+     * @param f Callable taking a shard and returning a fusion_array
+     * @return A sharded_array of the results, on the same devices
+     */
+    template <typename F>
+    [[nodiscard]] auto apply(F f) const {
+        return _transform(
+          [&](const Shard &part, std::size_t /*i*/) { return f(part); });
+    }
+
+    /**
+     * @brief Apply a function to matching shards of two sharded arrays
+     * @param other A sharded array on the same devices
+     * @param f Callable taking one shard of each and returning a fusion_array
+     * @throws std::invalid_argument if the arrays use different devices
+     */
+    template <typename OtherShard, typename F>
+    [[nodiscard]] auto apply(const sharded_array<OtherShard> &other,
+                             F f) const {
+        if (other.devices() != _devices) {
+            throw std::invalid_argument(
+              "sharded_array::apply: arrays are sharded differently");
         }
+        return _transform([&](const Shard &part, std::size_t i) {
+            return f(part, other.shards()[i]);
+        });
+    }
 
-        // Create a comparator that uses the key extractor
-        auto key_comp = [key_extractor] __host__ __device__(
-                          const value_type &a, const value_type &b) {
-            return key_extractor(a) < key_extractor(b);
-        };
+    /**
+     * @brief Lazily apply a unary function to every element (no data moves)
+     */
+    template <typename F>
+    [[nodiscard]] auto map(F f) const {
+        return apply([&](const Shard &part) { return part.map(f); });
+    }
 
-        // Use thrust::max_element with the custom comparator
-        auto max_iter = thrust::max_element(_begin, _end, key_comp);
+    /**
+     * @brief Reduce all elements; every shard receives the result
+     * @param init The initial value of every shard's reduction, which must
+     * be an identity of op
+     * @param op An associative binary operation callable on the host
+     * @return A sharded_array of device scalars holding the result
+     * @details Shards reduce concurrently. The partial results are combined
+     * with ncclAllReduce when PARROT_ENABLE_NCCL is defined, the shards are on
+     * distinct devices and op and T map onto NCCL; otherwise they are read
+     * back and combined on the host.
+     */
+    template <typename T, typename BinaryOp>
+    [[nodiscard]] auto reduce(T init, BinaryOp op) const {
+        auto totals = _transform([&](const Shard &part, std::size_t /*i*/) {
+            return part.reduce(init, op);
+        });
+        totals._allreduce(op);
+        return totals;
+    }
 
-        // Create a device vector with the maximum element directly
-        auto result_vec = std::make_shared<thrust::device_vector<value_type>>(
-          1, *max_iter);
+    [[nodiscard]] auto sum() const {
+        return reduce(value_type(0), thrust::plus<value_type>());
+    }
 
-        // Return a new fusion_array with the maximum element
-        return fusion_array<
-          typename thrust::device_vector<value_type>::iterator>(
-          result_vec->begin(), result_vec->end(), result_vec);
+    [[nodiscard]] auto minr() const {
+        return reduce(std::numeric_limits<value_type>::max(),
+                      thrust::minimum<value_type>());
+    }
+
+    [[nodiscard]] auto maxr() const {
+        return reduce(std::numeric_limits<value_type>::lowest(),
+                      thrust::maximum<value_type>());
     }
 
     /**
-     * @brief Create pairs from two arrays of the same length
-     * @tparam OtherIterator The iterator type of the second array
-     * @param other The second array to pair with this array
-     * @return A new fusion_array containing pairs of elements from both
-     * arrays
-     * @throws std::invalid_argument if arrays have different sizes
+     * @brief Minimum and maximum of all elements as a (min, max) pair
      */
-    template <typename OtherIterator>
-    auto pairs(const fusion_array<OtherIterator> &other) const {
-        using first_type = typename cuda::std::iterator_traits<
-          Iterator>::value_type;
-        using second_type = typename cuda::std::iterator_traits<
-          OtherIterator>::value_type;
-        using pair_type = thrust::pair<first_type, second_type>;
+    [[nodiscard]] auto minmax() const {
+        auto totals = _transform(
+          [](const Shard &part, std::size_t /*i*/) { return part.minmax(); });
+        totals._allreduce(minmax_binary_op<value_type>());
+        return totals;
+    }
 
-        // Check if arrays have the same size
-        if (size() != other.size()) {
-            throw std::invalid_argument(
-              "Arrays must have the same size for pairs operation");
+    /**
+     * @brief Read the value of a reduction result
+     * @return The element held by the first shard
+     */
+    [[nodiscard]] auto value() const {
+        detail::device_guard const guard(_devices.front());
+        return _shards.front().value();
+    }
+
+    /**
+     * @brief Inclusive scan over all elements in shard order
+     * @param op An associative binary operation callable on the host and
+     * device
+     * @details Every shard scans locally, the last element of each is read
+     * back, and the carry of the preceding shards is folded into each shard
+     * lazily.
+     */
+    template <typename BinaryOp>
+    [[nodiscard]] auto scan(BinaryOp op) const {
+        auto local = _transform([&](const Shard &part, std::size_t /*i*/) {
+            return part.scan(op);
+        });
+        using T = typename decltype(local)::value_type;
+
+        std::vector<detail::shard_carry_functor<T, BinaryOp>> carries;
+        T carry{};
+        bool have_carry = false;
+        for (std::size_t i = 0; i < local.num_shards(); ++i) {
+            carries.push_back({carry, have_carry, op});
+            auto const &part = local._shards[i];
+            if (part.size() == 0) { continue; }
+            detail::device_guard const guard(_devices[i]);
+            T const last = part.drop(part.size() - 1).to_host()[0];
+            carry = have_carry ? static_cast<T>(op(carry, last)) : last;
+            have_carry = true;
         }
+        return local._transform([&](const auto &part, std::size_t i) {
+            return part.map(carries[i]);
+        });
+    }
 
-        // Create a zip iterator combining elements from both arrays
-        auto zip_begin = thrust::make_zip_iterator(
-          thrust::make_tuple(_begin, other.begin()));
-        auto zip_end = thrust::make_zip_iterator(
-          thrust::make_tuple(_end, other.end()));
+    [[nodiscard]] auto sums() const {
+        return scan(thrust::plus<value_type>());
+    }
 
-        // Define the functor type for making pairs
-        using make_pair_func = make_pair_functor<first_type, second_type>;
+    /**
+     * @brief Sort all elements across the shards (sample sort)
+     * @return A sharded_array whose shards are sorted and ordered: every
+     * element of shard i is <= every element of shard i + 1
+     * @details Shards sort locally, and evenly spaced samples of every shard
+     * choose num_shards() - 1 splitters on the host. Each shard then sends
+     * the elements between consecutive splitters to the matching device with
+     * peer copies, and every device sorts what it received. Equal values
+     * always land on one shard. Shard sizes follow the data distribution.
+     */
+    [[nodiscard]] auto sort() const {
+        using T           = value_type;
+        using buffer_part = fusion_array<typename device_buffer<T>::iterator>;
+        std::size_t const parts = num_shards();
+        auto local = _transform([](const Shard &part, std::size_t /*i*/) {
+            return part.sort().eval();
+        });
+
+        // Splitters from an oversampled, globally sorted sample
+        index_t const per_shard = static_cast<index_t>(32 * parts);
+        std::vector<T> samples;
+        for (std::size_t i = 0; i < parts; ++i) {
+            auto const &part = local._shards[i];
+            if (part.size() == 0) { continue; }
+            detail::device_guard const guard(_devices[i]);
+            detail::bind_scope const scope(_contexts[i]);
+            auto const positions = thrust::make_transform_iterator(
+              thrust::make_counting_iterator<index_t>(0),
+              detail::sample_position{part.size(), per_shard});
+            auto picked = detail::make_buffer<T>(per_shard);
+            thrust::gather(detail::policy(),
+                           positions,
+                           positions + per_shard,
+                           part.begin(),
+                           picked->begin());
+            auto const host = buffer_part(
+                                picked->begin(), picked->end(), picked)
+                                .to_host();
+            samples.insert(samples.end(), host.begin(), host.end());
+        }
+        std::sort(samples.begin(), samples.end());
+        std::vector<T> splitters;
+        for (std::size_t k = 1; k < parts && !samples.empty(); ++k) {
+            splitters.push_back(samples[samples.size() * k / parts]);
+        }
 
-        // Transform the zipped iterators into pairs
-        return fusion_array<
-          thrust::transform_iterator<make_pair_func, decltype(zip_begin)>>(
-          thrust::make_transform_iterator(zip_begin, make_pair_func()),
-          thrust::make_transform_iterator(zip_end, make_pair_func()),
-          _owned_storage,
-          _shape);
+        // offsets[i][d]: first element of shard i that goes to device d
+        std::vector<std::vector<index_t>> offsets(parts);
+        for (std::size_t i = 0; i < parts; ++i) {
+            auto const &part = local._shards[i];
+            offsets[i].assign(parts + 1, part.size());
+            offsets[i][0] = 0;
+            if (part.size() == 0 || splitters.empty()) { continue; }
+            detail::device_guard const guard(_devices[i]);
+            detail::bind_scope const scope(_contexts[i]);
+            auto const count = splitters.size();
+            auto bounds      = detail::make_buffer<T>(count);
+            auto ends        = detail::make_buffer<index_t>(count);
+            detail::throw_on_cuda_error(
+              cudaMemcpyAsync(thrust::raw_pointer_cast(bounds->data()),
+                              splitters.data(),
+                              count * sizeof(T),
+                              cudaMemcpyHostToDevice,
+                              detail::current_stream()),
+              "sharded_array::sort");
+            thrust::upper_bound(detail::policy(),
+                                part.begin(),
+                                part.end(),
+                                bounds->begin(),
+                                bounds->end(),
+                                ends->begin());
+            auto const host = fusion_array<
+                                typename device_buffer<index_t>::iterator>(
+                                ends->begin(), ends->end(), ends)
+                                .to_host();
+            std::copy(host.begin(), host.end(), offsets[i].begin() + 1);
+        }
+
+        // Every device gathers its range from all shards and sorts it
+        std::vector<buffer_part> received;
+        for (std::size_t d = 0; d < parts; ++d) {
+            detail::device_guard const guard(_devices[d]);
+            detail::bind_scope const scope(_contexts[d]);
+            index_t total = 0;
+            for (std::size_t i = 0; i < parts; ++i) {
+                total += offsets[i][d + 1] - offsets[i][d];
+            }
+            auto buffer = detail::make_buffer<T>(total);
+            T *out      = thrust::raw_pointer_cast(buffer->data());
+            for (std::size_t i = 0; i < parts; ++i) {
+                auto const count = offsets[i][d + 1] - offsets[i][d];
+                if (count == 0) { continue; }
+                const T *in = thrust::raw_pointer_cast(
+                  &*local._shards[i].begin());
+                detail::throw_on_cuda_error(
+                  cudaMemcpyPeerAsync(out,
+                                      _devices[d],
+                                      in + offsets[i][d],
+                                      _devices[i],
+                                      count * sizeof(T),
+                                      detail::current_stream()),
+                  "sharded_array::sort");
+                out += count;
+            }
+            received.push_back(
+              buffer_part(buffer->begin(), buffer->end(), buffer)
+                .on(*_contexts[d])
+                .sort());
+        }
+
+        // The local runs are released once every copy out of them finished
+        for (std::size_t d = 0; d < parts; ++d) {
+            detail::device_guard const guard(_devices[d]);
+            _contexts[d]->synchronize();
+        }
+        return sharded_array<buffer_part>(
+          _devices, _contexts, std::move(received));
     }
 
     /**
-     * @brief Create pairs from array elements and their indices (lazy
-     * operation)
-     * @return A new fusion_array containing pairs of (element, index)
-     * @details Creates pairs of (element, index) starting from index 0.
-     * For array [a, b, c], returns [(a, 0), (b, 1), (c, 2)].
-     * Useful for operations that need to track element positions.
+     * @brief Distinct values in ascending order across the shards
+     * @details Sorts with sort(), after which equal values share a shard, so
+     * each shard removes its duplicates locally.
      */
-    [[nodiscard]] auto enumerate() const { return this->pairs(range(size())); }
+    [[nodiscard]] auto distinct() const {
+        return sort().apply([](const auto &part) { return part.distinct(); });
+    }
 
     /**
-     * @brief Reverse the array (lazy operation)
-     * @return A new fusion_array with elements in reverse order
+     * @brief Run-length encode all elements in shard order
+     * @return A sharded_array of (value, count) pairs
+     * @details Shards encode locally. A run that continues across a shard
+     * boundary is merged into the shard where it starts, so no value is
+     * split between neighbouring results.
      */
-    [[nodiscard]] auto rev() const {
-        auto rbegin = thrust::make_reverse_iterator(_end);
-        auto rend   = thrust::make_reverse_iterator(_begin);
-        return fusion_array<decltype(rbegin)>(
-          rbegin, rend, _owned_storage, _shape);
+    [[nodiscard]] auto rle() const {
+        auto runs = _transform(
+          [](const Shard &part, std::size_t /*i*/) { return part.rle(); });
+        std::size_t const parts = num_shards();
+
+        std::vector<bool> drop_first(parts, false);
+        std::vector<std::int64_t> extra(parts, 0);
+        std::vector<std::int64_t> last_count(parts, 0);
+        std::optional<std::size_t> owner;
+        value_type open_value{};
+        for (std::size_t i = 0; i < parts; ++i) {
+            auto const &part = runs._shards[i];
+            auto const n     = part.size();
+            if (n == 0) { continue; }
+            detail::device_guard const guard(_devices[i]);
+            auto const first = part.take(1).to_host()[0];
+            auto const last  = part.drop(n - 1).to_host()[0];
+            if (owner && first.first == open_value) {
+                extra[*owner] += first.second;
+                drop_first[i] = true;
+                if (n == 1) { continue; }  // The whole shard is one run
+            }
+            owner         = i;
+            open_value    = last.first;
+            last_count[i] = last.second;
+        }
+
+        for (std::size_t i = 0; i < parts; ++i) {
+            if (extra[i] == 0) { continue; }
+            detail::device_guard const guard(_devices[i]);
+            auto counts = runs._shards[i].snd();
+            using count_type = typename decltype(counts)::value_type;
+            auto const merged = static_cast<count_type>(last_count[i] +
+                                                        extra[i]);
+            auto *slot = thrust::raw_pointer_cast(
+              &*(counts.begin() + (counts.size() - 1)));
+            auto const stream = _contexts[i]->stream();
+            detail::throw_on_cuda_error(
+              cudaMemcpyAsync(slot,
+                              &merged,
+                              sizeof(count_type),
+                              cudaMemcpyHostToDevice,
+                              stream),
+              "sharded_array::rle");
+            _contexts[i]->synchronize();
+        }
+        return runs._transform([&](const auto &part, std::size_t i) {
+            return part.drop(drop_first[i] ? 1 : 0);
+        });
     }
 
     /**
-     * @brief Filter elements based on a predicate (lazy operation)
-     * @param predicate A unary predicate that returns true for elements to
-     * keep
-     * @return A masked fusion_array that will filter elements when
-     * evaluated
+     * @brief Copy all elements to the host in shard order
      */
-    template <typename Predicate>
-    auto filter(Predicate predicate) const {
-        // Create a transform_iterator that applies the predicate
-        auto mask_begin = thrust::make_transform_iterator(_begin, predicate);
-        auto mask_end   = thrust::make_transform_iterator(_end, predicate);
-
-        // Use existing keep function with the mask iterator
-        return keep(fusion_array<decltype(mask_begin)>(
-          mask_begin, mask_end, _owned_storage));
+    [[nodiscard]] auto to_host() const {
+        std::vector<extract_value_type_t<value_type>> host;
+        host.reserve(size());
+        for (std::size_t i = 0; i < num_shards(); ++i) {
+            detail::device_guard const guard(_devices[i]);
+            auto const part = _shards[i].to_host();
+            host.insert(host.end(), part.begin(), part.end());
+        }
+        return host;
     }
 
     /**
-     * @brief Transpose a 2D array (lazy operation)
-     * @return A new fusion_array representing the transpose of the
-     * original
-     * @throws std::invalid_argument if the array is not rank 2
+     * @brief Block until every shard's queued work finished
      */
-    [[nodiscard]] auto transpose() const {
-        if (rank() != 2) {
-            throw std::invalid_argument(
-              "transpose: array must be rank 2 (a matrix)");
+    void synchronize() const {
+        for (std::size_t i = 0; i < num_shards(); ++i) {
+            detail::device_guard const guard(_devices[i]);
+            _contexts[i]->synchronize();
         }
+    }
 
-        int num_rows   = _shape[0];
-        int num_cols   = _shape[1];
-        int total_size = num_rows * num_cols;
-
-        // Create a counting iterator for the indices of the transposed
-        // array
-        auto counting_iter = thrust::make_counting_iterator(0);
-
-        // Create a transform iterator that applies the transpose_functor
-        // This transform_iterator will yield the indices in the *original*
-        // array that correspond to the elements of the transposed array.
-        auto index_map_iter = thrust::make_transform_iterator(
-          counting_iter, transpose_functor(num_rows, num_cols));
-
-        // Create a permutation iterator
-        auto perm_iter_begin = thrust::make_permutation_iterator(
-          _begin, index_map_iter);
-        auto perm_iter_end = perm_iter_begin + total_size;
-
-        // New shape for the transposed array
-        std::vector<int> new_shape = {num_cols, num_rows};
+   private:
+    template <typename>
+    friend class sharded_array;
+
+    // Runs f(shard, i) for every shard on its device and context
+    template <typename F>
+    auto _transform(F f) const {
+        using result_type = std::decay_t<decltype(f(
+          std::declval<const Shard &>(), std::size_t{}))>;
+        std::vector<result_type> results;
+        results.reserve(num_shards());
+        for (std::size_t i = 0; i < num_shards(); ++i) {
+            detail::device_guard const guard(_devices[i]);
+            detail::bind_scope const scope(_contexts[i]);
+            results.push_back(f(_shards[i], i).on(*_contexts[i]));
+        }
+        return sharded_array<result_type>(
+          _devices, _contexts, std::move(results));
+    }
 
-        return fusion_array<decltype(perm_iter_begin)>(
-          perm_iter_begin, perm_iter_end, _owned_storage, new_shape);
+    // Combines the device scalars of all shards and stores the result in
+    // every one of them
+    template <typename BinaryOp>
+    void _allreduce(BinaryOp op) const {
+        using T         = value_type;
+        auto const slot = [&](std::size_t i) {
+            return thrust::raw_pointer_cast(&*_shards[i].begin());
+        };
+#ifdef PARROT_ENABLE_NCCL
+        if constexpr (detail::nccl_type<T>::value &&
+                      detail::nccl_op<BinaryOp>::value) {
+            auto sorted = _devices;
+            std::sort(sorted.begin(), sorted.end());
+            if (std::adjacent_find(sorted.begin(), sorted.end()) ==
+                sorted.end()) {
+                auto const &comms = detail::nccl_comms(_devices);
+                detail::throw_on_nccl_error(ncclGroupStart(), "ncclGroupStart");
+                for (std::size_t i = 0; i < num_shards(); ++i) {
+                    detail::device_guard const guard(_devices[i]);
+                    detail::throw_on_nccl_error(
+                      ncclAllReduce(slot(i),
+                                    slot(i),
+                                    1,
+                                    detail::nccl_type<T>::id,
+                                    detail::nccl_op<BinaryOp>::id,
+                                    comms[i],
+                                    _contexts[i]->stream()),
+                      "ncclAllReduce");
+                }
+                detail::throw_on_nccl_error(ncclGroupEnd(), "ncclGroupEnd");
+                return;
+            }
+        }
+#endif
+        // One value per shard, combined on the host in shard order
+        std::optional<T> total;
+        for (std::size_t i = 0; i < num_shards(); ++i) {
+            detail::device_guard const guard(_devices[i]);
+            T const part = _shards[i].value();
+            total = total ? static_cast<T>(op(*total, part)) : part;
+        }
+        for (std::size_t i = 0; i < num_shards(); ++i) {
+            detail::device_guard const guard(_devices[i]);
+            detail::throw_on_cuda_error(
+              cudaMemcpyAsync(slot(i),
+                              &*total,
+                              sizeof(T),
+                              cudaMemcpyHostToDevice,
+                              _contexts[i]->stream()),
+              "sharded_array::reduce");
+        }
+        synchronize();
     }
 
-    // clang-format off
-     auto operator/ (auto const &arg) const { return this->div(arg);   }
-     auto operator- (auto const &arg) const { return this->minus(arg); }
-     auto operator+ (auto const &arg) const { return this->add(arg);   }
-     auto operator* (auto const &arg) const { return this->times(arg); }
-     auto operator< (auto const &arg) const { return this->lt(arg);    }
-     auto operator<=(auto const &arg) const { return this->lte(arg);   }
-     auto operator> (auto const &arg) const { return this->gt(arg);    }
-     auto operator>=(auto const &arg) const { return this->gte(arg);   }
-     auto operator==(auto const &arg) const { return this->eq(arg);    }
-     // auto operator%(auto const &arg) const { return this->mod(arg); } // TODO
-    // clang-format on
+    std::vector<int> _devices;
+    std::vector<context_ptr> _contexts;
+    std::vector<Shard> _shards;
 };
 
 /**
- * @brief Create a 1-indexed range array from 1 to n
- * @param end The upper bound of the range (inclusive)
- * @return A fusion_array containing integers from 1 to end
- * @throws std::invalid_argument if end <= 0
+ * @brief Partition an array into contiguous, nearly equal shards
+ * @param arr The array to distribute; it is evaluated once on the current
+ * device and the pieces are copied to their devices
+ * @param devices Device of every shard, in element order (defaults to all
+ * visible devices). A device may appear more than once.
+ * @return A sharded_array of pool-backed device buffers
+ * @throws std::invalid_argument if no device is available
  */
-inline auto range(int end) -> fusion_array<thrust::counting_iterator<int>> {
-    if (end <= 0) { throw std::invalid_argument("range: end must be > 0"); }
+template <typename Iterator, typename MaskIterator>
+auto shard(const fusion_array<Iterator, MaskIterator> &arr,
+           std::vector<int> devices = {}) {
+    using T    = typename fusion_array<Iterator, MaskIterator>::value_type;
+    using part = fusion_array<typename device_buffer<T>::iterator>;
+    if (devices.empty()) {
+        int count = 0;
+        detail::throw_on_cuda_error(cudaGetDeviceCount(&count), "shard");
+        for (int d = 0; d < count; ++d) { devices.push_back(d); }
+    }
+    if (devices.empty()) {
+        throw std::invalid_argument("shard: no CUDA device available");
+    }
+    detail::enable_peer_access(devices);
+
+    int home = 0;
+    detail::throw_on_cuda_error(cudaGetDevice(&home), "shard");
+    auto const source = arr.eval();
+    source.synchronize();
+    const T *in      = thrust::raw_pointer_cast(&*source.begin());
+    auto const n     = static_cast<std::int64_t>(source.size());
+    auto const parts = static_cast<std::int64_t>(devices.size());
+
+    std::vector<std::shared_ptr<const execution_context>> contexts;
+    std::vector<part> shards;
+    for (std::int64_t i = 0; i < parts; ++i) {
+        auto const first = n * i / parts;
+        auto const last  = n * (i + 1) / parts;
+        auto const count = static_cast<std::size_t>(last - first);
+        detail::device_guard const guard(devices[i]);
+        auto context = std::make_shared<const execution_context>(
+          execution_context::create());
+        detail::bind_scope const scope(context);
+        auto buffer = detail::make_buffer<T>(count);
+        if (count > 0) {
+            detail::throw_on_cuda_error(
+              cudaMemcpyPeerAsync(thrust::raw_pointer_cast(buffer->data()),
+                                  devices[i],
+                                  in + first,
+                                  home,
+                                  count * sizeof(T),
+                                  context->stream()),
+              "shard");
+        }
+        shards.push_back(
+          part(buffer->begin(), buffer->end(), buffer).on(*context));
+        contexts.push_back(std::move(context));
+    }
 
-    return {thrust::counting_iterator<int>(1),
-            thrust::counting_iterator<int>(end + 1)};
+    sharded_array<part> result(
+      std::move(devices), std::move(contexts), std::move(shards));
+    result.synchronize();  // source is released on return
+    return result;
 }
 
-/**
- * @brief Create a fusion_array from a std::vector
- * @tparam T The element type of the vector
- * @param host_vec The host vector to copy data from
- * @return A fusion_array containing the vector's data on the device
- */
-template <typename T>
-auto array(const std::vector<T> &host_vec) {
-    // Create and own a device vector
-    auto device_vec = std::make_shared<thrust::device_vector<T>>(
-      host_vec.begin(), host_vec.end());
-
-    return fusion_array<typename thrust::device_vector<T>::iterator>(
-      device_vec->begin(), device_vec->end(), device_vec);
-    // Note: _shape is already initialized by the constructor to {size}
-}
+// ============================================================================
+// Ragged Arrays
+// ============================================================================
+// Many variable-length segments of one array, described by CSR-style offsets:
+// segment s holds elements [offsets[s], offsets[s + 1]). Every operation runs
+// over all segments at once with one segmented launch (or a scan by segment
+// key), instead of one group of launches per segment.
+namespace detail {
+// Element of a segment-sorted array that lands at output position o when
+// the first taken[s + 1] - taken[s] elements of every segment s are kept
+struct ragged_take_functor {
+    const index_t *offsets;
+    const index_t *taken;
+    index_t segments;
+
+    __host__ __device__ auto operator()(index_t o) const -> index_t {
+        index_t lo = 0;
+        index_t hi = segments;
+        while (lo < hi) {
+            index_t const mid = lo + (hi - lo) / 2;
+            if (taken[mid + 1] <= o) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return offsets[lo] + (o - taken[lo]);
+    }
+};
 
-/**
- * @brief Create a fusion_array from an initializer list with automatic type
- * deduction
- * @tparam T The element type (automatically deduced)
- * @param init_list The initializer list containing the array elements
- * @return A fusion_array containing the initializer list's data on the device
- */
-template <typename T>
-auto array(std::initializer_list<T> init_list) {
-    // Convert initializer list to a device vector
-    auto device_vec = std::make_shared<thrust::device_vector<T>>(
-      init_list.begin(), init_list.end());
+// Elements kept from segment s by a top-k of k, with 0 past the last
+// segment so an exclusive scan yields the output offsets
+struct ragged_clamp_functor {
+    const index_t *offsets;
+    index_t segments;
+    index_t k;
 
-    return fusion_array<typename thrust::device_vector<T>::iterator>(
-      device_vec->begin(), device_vec->end(), device_vec);
-}
+    __host__ __device__ auto operator()(index_t s) const -> index_t {
+        if (s == segments) { return 0; }
+        auto const length = offsets[s + 1] - offsets[s];
+        return length < k ? length : k;
+    }
+};
+}  // namespace detail
 
 /**
- * @brief Create a scalar (rank 0) array containing a single value
- * @tparam T The element type (automatically deduced)
- * @param value The scalar value to store in the array
- * @return A fusion_array with rank 0 containing the single value
+ * @brief Variable-length segments of one array, processed together
+ * @tparam Values The fusion_array type of the concatenated elements
+ * @details Built from the elements and num_segments() + 1 offsets with
+ * parrot::ragged(). map() stays lazy; the other operations are eager and
+ * each runs as one segmented CUB launch (reduce, sort, topk) or one scan
+ * keyed by segment (scan, rle, distinct), so thousands of short segments
+ * cost the same number of launches as one. Operations run on the calling
+ * thread's current context.
+ * @code
+ * // Purchases of every user, concatenated, and where each user starts
+ * auto baskets  = parrot::ragged(items, offsets);
+ * auto spend    = baskets.map(price).sum();           // one value per user
+ * auto favorite = baskets.rle().map(parrot::snd{}).maxr();
+ * auto top3     = baskets.distinct().topk(3);
+ * @endcode
  */
-template <typename T>
-auto scalar(T value) {
-    return fusion_array<thrust::constant_iterator<T>>(value);
-}
+template <typename Values>
+class ragged_array {
+   public:
+    using values_type  = Values;
+    using value_type   = typename Values::value_type;
+    using offsets_type =
+      fusion_array<typename device_buffer<index_t>::iterator>;
 
-/**
- * @brief Create a multi-dimensional array filled with a constant value
- * @tparam T The element type (automatically deduced)
- * @param value The constant value to fill the matrix with
- * @param shape The shape as an initializer list {rows, cols}
- * @return A fusion_array with the specified shape filled with the constant
- * value
- * @throws std::invalid_argument if shape doesn't have exactly 2 dimensions
- */
-template <typename T>
-auto matrix(T value, std::initializer_list<int> shape) {
-    if (shape.size() != 2) {
-        throw std::invalid_argument(
-          "matrix: shape must have exactly 2 dimensions");
+    /**
+     * @brief Pair elements with the offsets of their segments
+     * @param values The concatenated elements of all segments
+     * @param offsets num_segments() + 1 ascending positions starting at 0
+     * and ending at values.size()
+     * @throws std::invalid_argument if the offsets do not describe values
+     */
+    ragged_array(Values values, const offsets_type &offsets)
+      : _values(std::move(values)), _offsets(offsets) {
+        auto const host = _offsets.to_host();
+        if (host.empty() || host.front() != 0 ||
+            host.back() != _values.size() ||
+            !std::is_sorted(host.begin(), host.end())) {
+            throw std::invalid_argument(
+              "ragged_array: offsets must ascend from 0 to values.size()");
+        }
     }
 
-    auto total_size = 1;
-    for (auto dim : shape) { total_size *= dim; }
+    [[nodiscard]] auto values() const -> const Values & { return _values; }
+    [[nodiscard]] auto offsets() const -> const offsets_type & {
+        return _offsets;
+    }
+    [[nodiscard]] auto num_segments() const -> index_t {
+        return _offsets.size() - 1;
+    }
 
-    return scalar(value).repeat(total_size).reshape(shape);
-}
+    /**
+     * @brief Total number of elements over all segments
+     */
+    [[nodiscard]] auto size() const -> index_t { return _values.size(); }
 
-/**
- * @brief Create a 2D matrix from a nested initializer list
- * @tparam T The element type (automatically deduced from the nested list)
- * @param nested_list A nested initializer list where each inner list represents
- * a row
- * @return A fusion_array with shape {rows, cols} containing the matrix data
- * @throws std::invalid_argument if nested_list is empty or inner lists have
- * different lengths
- */
-template <typename T>
-auto matrix(std::initializer_list<std::initializer_list<T>> nested_list) {
-    if (nested_list.size() == 0) {
-        throw std::invalid_argument("matrix: nested_list cannot be empty");
+    /**
+     * @brief Number of elements of every segment (lazy operation)
+     */
+    [[nodiscard]] auto lengths() const {
+        return _offsets.drop(1).minus(_offsets.take(num_segments()));
     }
 
-    // Get dimensions
-    int rows = static_cast<int>(nested_list.size());
-    int cols = static_cast<int>(nested_list.begin()->size());
+    /**
+     * @brief Apply f to every element, keeping the segments (lazy operation)
+     */
+    template <typename F>
+    [[nodiscard]] auto map(F f) const {
+        auto mapped = _values.map(f);
+        return ragged_array<decltype(mapped)>(
+          std::move(mapped), _offsets, unchecked{});
+    }
 
-    if (cols == 0) {
-        throw std::invalid_argument("matrix: inner lists cannot be empty");
+    /**
+     * @brief Reduce every segment (eager operation)
+     * @param init Identity of op; empty segments produce it
+     * @param op Associative binary operation
+     * @return A rank-1 fusion_array with one result per segment
+     */
+    template <typename T, typename BinaryOp>
+    [[nodiscard]] auto reduce(T init, BinaryOp op) const {
+        auto const segments = num_segments();
+        auto result         = detail::make_buffer<T>(segments);
+        thrustx::reduce_segments(_values.begin(),
+                                 segments,
+                                 _offsets_data(),
+                                 result->begin(),
+                                 op,
+                                 init,
+                                 detail::temp_allocator{},
+                                 detail::current_stream());
+        return fusion_array<typename device_buffer<T>::iterator>(
+          result->begin(), result->end(), result, {segments});
     }
 
-    // Validate that all rows have the same length
-    for (const auto &row : nested_list) {
-        if (static_cast<int>(row.size()) != cols) {
-            throw std::invalid_argument(
-              "matrix: all inner lists must have the same length");
-        }
+    [[nodiscard]] auto sum() const {
+        return reduce(value_type(0), thrust::plus<value_type>());
     }
 
-    // Flatten the nested data into a single vector (row-major order)
-    std::vector<T> flattened_data;
-    flattened_data.reserve(rows * cols);
+    [[nodiscard]] auto minr() const {
+        return reduce(std::numeric_limits<value_type>::max(),
+                      thrust::minimum<value_type>());
+    }
 
-    for (const auto &row : nested_list) {
-        for (const auto &element : row) { flattened_data.push_back(element); }
+    [[nodiscard]] auto maxr() const {
+        return reduce(std::numeric_limits<value_type>::lowest(),
+                      thrust::maximum<value_type>());
     }
 
-    // Create the array and reshape it to the matrix dimensions
-    return array(flattened_data).reshape({rows, cols});
-}
+    /**
+     * @brief Inclusive scan within every segment (eager operation)
+     * @param op Associative binary operation
+     * @return A ragged_array with the same offsets
+     */
+    template <typename BinaryOp>
+    [[nodiscard]] auto scan(BinaryOp op) const {
+        auto const n = size();
+        auto result  = detail::make_buffer<value_type>(n);
+        auto keys    = _segment_ids();
+        thrust::inclusive_scan_by_key(detail::policy(),
+                                      keys,
+                                      keys + n,
+                                      _values.begin(),
+                                      result->begin(),
+                                      thrust::equal_to<index_t>(),
+                                      op);
+        return _with_offsets(result, _offsets);
+    }
 
-// Define the stats namespace implementation
-namespace stats {
-// Normal CDF functor
-template <typename T>
-struct norm_cdf_functor {
-    __host__ __device__ auto operator()(const T &x) const -> T {
-        return normcdff(x);
+    [[nodiscard]] auto sums() const {
+        return scan(thrust::plus<value_type>());
     }
-};
 
-// Standard normal cumulative distribution function
-template <typename Iterator, typename MaskIterator>
-auto norm_cdf(const fusion_array<Iterator, MaskIterator> &arr) {
-    using value_type = typename cuda::std::iterator_traits<
-      Iterator>::value_type;
-    using NormCDFFunc = norm_cdf_functor<value_type>;
-    return arr.map(NormCDFFunc());
-}
+    /**
+     * @brief Sort every segment ascending (eager operation)
+     * @return A ragged_array with the same offsets
+     */
+    [[nodiscard]] auto sort() const { return _sort(false); }
 
-// Statistical mode function - returns the most frequently occurring value
-template <typename Iterator, typename MaskIterator>
-auto mode(const fusion_array<Iterator, MaskIterator> &arr) {
-    using value_type = typename cuda::std::iterator_traits<
-      Iterator>::value_type;
+    /**
+     * @brief The k largest elements of every segment, largest first (eager
+     * operation)
+     * @param k Elements to keep per segment; shorter segments keep all
+     * @return A ragged_array of min(k, length) values per segment
+     * @details Segments are sorted descending with one segmented sort and
+     * cut to k, which suits short segments; use fusion_array::topk for one
+     * long array.
+     */
+    [[nodiscard]] auto topk(index_t k) const {
+        if (k < 0) { throw std::invalid_argument("topk: k must be >= 0"); }
+        auto const segments = num_segments();
+        auto const sorted   = _sort(true);
+
+        auto taken         = detail::make_buffer<index_t>(segments + 1);
+        auto const clamped = thrust::make_transform_iterator(
+          thrust::make_counting_iterator<index_t>(0),
+          detail::ragged_clamp_functor{_offsets_data(), segments, k});
+        thrust::exclusive_scan(detail::policy(),
+                               clamped,
+                               clamped + segments + 1,
+                               taken->begin());
+        auto const offsets  = _as_offsets(taken);
+        index_t const total = offsets.back();
+
+        auto result    = detail::make_buffer<value_type>(total);
+        auto const map = thrust::make_transform_iterator(
+          thrust::make_counting_iterator<index_t>(0),
+          detail::ragged_take_functor{_offsets_data(),
+                                      thrust::raw_pointer_cast(taken->data()),
+                                      segments});
+        thrust::gather(detail::policy(),
+                       map,
+                       map + total,
+                       sorted._values.begin(),
+                       result->begin());
+        return _with_offsets(result, offsets);
+    }
 
-    // Find the mode by sorting, run-length encoding, and finding max by count
-    auto mode_value = arr.sort().rle().max_by_key(snd()).value().first;
+    /**
+     * @brief Run-length encode every segment (eager operation)
+     * @return A ragged_array of (value, count) pairs; runs never cross a
+     * segment boundary
+     */
+    [[nodiscard]] auto rle() const {
+        auto [runs, counts, offsets] = _runs();
+        auto const n = static_cast<index_t>(runs->size());
+        using count_array =
+          fusion_array<typename device_buffer<int>::iterator>;
+        auto pairs = buffer_array(runs->begin(), runs->end(), runs, {n})
+                       .pairs(count_array(
+                         counts->begin(), counts->end(), counts, {n}));
+        return ragged_array<decltype(pairs)>(
+          std::move(pairs), offsets, unchecked{});
+    }
 
-    // Return as a scalar fusion_array
-    return fusion_array<thrust::constant_iterator<value_type>>(mode_value);
+    /**
+     * @brief The distinct elements of every segment, ascending (eager
+     * operation)
+     */
+    [[nodiscard]] auto distinct() const {
+        auto const runs = sort()._runs();
+        return _with_offsets(std::get<0>(runs), std::get<2>(runs));
+    }
+
+    /**
+     * @brief Copy every segment to the host
+     * @return One host vector per segment
+     */
+    [[nodiscard]] auto to_host() const
+      -> std::vector<std::vector<value_type>> {
+        auto const values  = _values.to_host();
+        auto const offsets = _offsets.to_host();
+        std::vector<std::vector<value_type>> segments;
+        segments.reserve(offsets.size() - 1);
+        for (std::size_t s = 0; s + 1 < offsets.size(); ++s) {
+            segments.emplace_back(values.begin() + offsets[s],
+                                  values.begin() + offsets[s + 1]);
+        }
+        return segments;
+    }
+
+   private:
+    template <typename>
+    friend class ragged_array;
+
+    // Offsets that are already known to be valid
+    struct unchecked {};
+
+    ragged_array(Values values, offsets_type offsets, unchecked /*tag*/)
+      : _values(std::move(values)), _offsets(std::move(offsets)) {}
+
+    using buffer_array =
+      fusion_array<typename device_buffer<value_type>::iterator>;
+
+    static auto _as_offsets(const std::shared_ptr<device_buffer<index_t>> &b)
+      -> offsets_type {
+        auto const n = static_cast<index_t>(b->size());
+        return offsets_type(b->begin(), b->end(), b, {n});
+    }
+
+    static auto _with_offsets(
+      const std::shared_ptr<device_buffer<value_type>> &values,
+      const offsets_type &offsets) -> ragged_array<buffer_array> {
+        auto const n = static_cast<index_t>(values->size());
+        return ragged_array<buffer_array>(
+          buffer_array(values->begin(), values->end(), values, {n}),
+          offsets,
+          unchecked{});
+    }
+
+    [[nodiscard]] auto _offsets_data() const -> const index_t * {
+        return thrust::raw_pointer_cast(&*_offsets.begin());
+    }
+
+    // Segment of every element, found by a binary search over the offsets
+    [[nodiscard]] auto _segment_ids() const {
+        return thrustx::make_replicate_search_iterator(
+          thrust::make_counting_iterator<index_t>(0),
+          _offsets_data() + 1,
+          num_segments());
+    }
+
+    [[nodiscard]] auto _sort(bool descending) const
+      -> ragged_array<buffer_array> {
+        auto const data = _values.eval();
+        auto const n    = size();
+        auto result     = detail::make_buffer<value_type>(n);
+        thrustx::segmented_sort(thrust::raw_pointer_cast(&*data.begin()),
+                                thrust::raw_pointer_cast(result->data()),
+                                n,
+                                num_segments(),
+                                _offsets_data(),
+                                descending,
+                                detail::temp_allocator{},
+                                detail::current_stream());
+        return _with_offsets(result, _offsets);
+    }
+
+    // Runs of equal neighbours within every segment: their values, lengths
+    // and the offsets of each segment's runs
+    [[nodiscard]] auto _runs() const {
+        auto const n    = size();
+        auto run_keys   = detail::make_buffer<index_t>(n);
+        auto run_values = detail::make_buffer<value_type>(n);
+        auto counts     = detail::make_buffer<int>(n);
+        auto keys       = thrust::make_zip_iterator(
+          thrust::make_tuple(_segment_ids(), _values.begin()));
+        auto const end = thrust::reduce_by_key(
+          detail::blocking_policy(),
+          keys,
+          keys + n,
+          thrust::make_constant_iterator(1),
+          thrust::make_zip_iterator(
+            thrust::make_tuple(run_keys->begin(), run_values->begin())),
+          counts->begin());
+        auto const runs = cuda::std::distance(counts->begin(), end.second);
+        run_keys->resize(runs);
+        run_values->resize(runs);
+        counts->resize(runs);
+
+        // Segment s's runs start at the first run key >= s
+        auto const segments = num_segments();
+        auto offsets        = detail::make_buffer<index_t>(segments + 1);
+        thrust::lower_bound(detail::policy(),
+                            run_keys->begin(),
+                            run_keys->end(),
+                            thrust::make_counting_iterator<index_t>(0),
+                            thrust::make_counting_iterator(segments + 1),
+                            offsets->begin());
+        return std::make_tuple(
+          std::move(run_values), std::move(counts), _as_offsets(offsets));
+    }
+
+    Values _values;
+    offsets_type _offsets;
+};
+
+/**
+ * @brief Group an array into variable-length segments
+ * @param values The concatenated elements of all segments; lazy values
+ * stay lazy
+ * @param offsets Segment boundaries: segment s is [offsets[s],
+ * offsets[s + 1]), so there is one more offset than segments
+ * @return A ragged_array over values
+ * @throws std::invalid_argument if the offsets do not ascend from 0 to
+ * values.size()
+ */
+template <typename Iterator, typename OffsetIterator>
+auto ragged(const fusion_array<Iterator> &values,
+            const fusion_array<OffsetIterator> &offsets) {
+    using offsets_type =
+      typename ragged_array<fusion_array<Iterator>>::offsets_type;
+    auto const n = static_cast<std::size_t>(offsets.size());
+    auto copied  = detail::make_buffer<index_t>(n);
+    thrust::copy_n(detail::policy(), offsets.begin(), n, copied->begin());
+    return ragged_array<fusion_array<Iterator>>(
+      values,
+      offsets_type(
+        copied->begin(), copied->end(), copied, {static_cast<index_t>(n)}));
 }
-}  // namespace stats
 
 }  // namespace parrot
 
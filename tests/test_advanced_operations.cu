@@ -206,3 +206,45 @@ TEST_CASE("ParrotTest - IotaReverseReverseTest") {
     auto expected = parrot::array({1, 2, 3, 4, 5});
     CHECK(check_match(arr, expected));
 }
+
+// Test reductions on masked arrays (fused, no compaction)
+TEST_CASE("ParrotTest - MaskedReductionTest") {
+    auto arr   = parrot::range(10);
+    auto evens = arr.keep(arr.even());
+    CHECK_EQ(evens.sum().value(), 30);
+    CHECK_EQ(evens.maxr().value(), 10);
+    CHECK_EQ(evens.minr().value(), 2);
+    CHECK_EQ(evens.prod().value(), 3840);
+    CHECK_EQ(evens.minmax().value(), thrust::make_pair(2, 10));
+
+    // Element-wise maps keep the mask
+    auto big = arr.filter([=] __host__ __device__(int x) { return x > 7; });
+    CHECK_EQ(big.times(2).sum().value(), 54);
+    CHECK_EQ(big.sq().sum().value(), 245);
+
+    auto [count, mean] = evens.reduce_many(parrot::agg::count{},
+                                           parrot::agg::mean{});
+    CHECK_EQ(count.value(), 5);
+    CHECK_EQ(mean.value(), doctest::Approx(6.0));
+
+    // A mask that removes everything yields the reduction's init
+    auto none = arr.keep(arr.times(0));
+    CHECK_EQ(none.sum().value(), 0);
+    CHECK_EQ(none.maxr().value(), std::numeric_limits<int>::lowest());
+}
+
+// Test scans and run-length encoding on masked arrays
+TEST_CASE("ParrotTest - MaskedScanTest") {
+    auto arr   = parrot::range(10);
+    auto evens = arr.keep(arr.even());
+    CHECK(check_match(evens.sums(), parrot::array({2, 6, 12, 20, 30})));
+    CHECK(check_match(evens.maxs(), parrot::array({2, 4, 6, 8, 10})));
+    CHECK_EQ(arr.keep(arr.times(0)).sums().size(), 0);
+
+    auto runs = parrot::array({1, 1, 2, 1, 1})
+                  .keep(parrot::array({1, 1, 0, 1, 1}))
+                  .rle()
+                  .to_host();
+    REQUIRE_EQ(runs.size(), 1);
+    CHECK_EQ(runs[0], thrust::make_pair(1, 4));
+}
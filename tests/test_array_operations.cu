@@ -15,7 +15,10 @@
  * limitations under the License.
  */
 
+#include <limits>
+#include <numeric>
 #include <stdexcept>
+#include <vector>
 #include "parrot.hpp"
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "test_common.hpp"
@@ -254,6 +257,27 @@ TEST_CASE("ParrotTest - ReplicateMaskDuplicateZerosTest") {
     CHECK(check_match(result, expected));
 }
 
+// Test replicate function with mask array - lazy result fuses downstream
+TEST_CASE("ParrotTest - ReplicateMaskFusedTest") {
+    auto arr    = parrot::array({1, 2, 3, 4});
+    auto mask   = parrot::array({0, 3, 0, 2});
+    auto result = arr.replicate(mask) * 10;
+    CHECK(check_match(result, parrot::array({20, 20, 20, 40, 40})));
+    CHECK_EQ(arr.replicate(mask).sum().value(), 14);
+
+    auto empty = arr.replicate(parrot::array({0, 0, 0, 0}));
+    CHECK(empty.size() == 0);
+}
+
+// Test replicate function with a narrow mask whose total overflows its type
+TEST_CASE("ParrotTest - ReplicateMaskNarrowTypeTest") {
+    auto arr    = parrot::range(300);
+    auto mask   = parrot::scalar(1).repeat(300).as<std::int8_t>();
+    auto result = arr.replicate(mask);
+    CHECK(result.size() == 300);
+    CHECK(check_match(result, arr));
+}
+
 // Test cross function with basic arrays
 TEST_CASE("ParrotTest - CrossBasicTest") {
     auto arr1   = parrot::array({1, 2});
@@ -363,3 +387,69 @@ TEST_CASE("ParrotTest - OuterAddSumTest") {
     auto expected = arr.add(5).times(10).add(5);
     check_match_eq(result, expected);
 }
+
+// Test evaluating lazy expressions over contiguous leaves, counters and
+// device scalars (vectorized) and over misaligned views (fallback)
+TEST_CASE("ParrotTest - VectorizedEvaluationTest") {
+    int const n = 1003;  // Not a multiple of the vector width
+    std::vector<int> host(n);
+    std::iota(host.begin(), host.end(), 0);
+    auto a = parrot::array(host);
+
+    auto const total = std::accumulate(host.begin(), host.end(), 0);
+    auto fused       = ((a * 3) + parrot::range(n)) - a.sum();
+    std::vector<int> expected(n);
+    for (int i = 0; i < n; ++i) { expected[i] = host[i] * 3 + i + 1 - total; }
+    CHECK(fused.to_host() == expected);
+    CHECK_EQ(fused.sort().back(), expected.back());
+
+    auto shifted = (a.drop(1) * 2).to_host();
+    REQUIRE_EQ(shifted.size(), static_cast<std::size_t>(n - 1));
+    CHECK_EQ(shifted.front(), 2);
+    CHECK_EQ(shifted.back(), 2 * (n - 1));
+}
+
+// Test eval() and cache(): both keep the values computed first, even if the
+// source changes afterwards
+TEST_CASE("ParrotTest - EvalCacheTest") {
+    auto a      = parrot::array({1, 2, 3, 4, 5, 6}).reshape({2, 3});
+    auto lazy   = a * 2;
+    auto eager  = lazy.eval();
+    auto cached = lazy.cache();
+    CHECK(eager.shape() == std::vector<parrot::index_t>{2, 3});
+    CHECK(cached.shape() == std::vector<parrot::index_t>{2, 3});
+    CHECK_EQ(cached.sum().value(), 42);  // First consumer fills the cache
+
+    thrust::fill(a.begin(), a.end(), 0);
+    CHECK_EQ(lazy.sum().value(), 0);
+    CHECK(eager.to_host() == std::vector<int>{2, 4, 6, 8, 10, 12});
+    CHECK(cached.to_host() == std::vector<int>{2, 4, 6, 8, 10, 12});
+    CHECK(parrot::array({3, 1, 2}).sort().eval().is_sorted());
+}
+
+// Test segmented operations over variable-length segments, including empty
+TEST_CASE("ParrotTest - RaggedArrayTest") {
+    auto values  = parrot::array({3, 1, 3, 2, 5, 4, 4, 4});
+    auto offsets = parrot::array({0, 3, 3, 8});
+    auto segs    = parrot::ragged(values, offsets);
+    REQUIRE_EQ(segs.num_segments(), 3);
+    CHECK(segs.lengths().to_host() == std::vector<parrot::index_t>{3, 0, 5});
+
+    CHECK(segs.sum().to_host() == std::vector<int>{7, 0, 19});
+    CHECK(segs.maxr().to_host()[0] == 3);
+    CHECK(segs.map(parrot::double_functor<int>{}).minr().to_host()[2] == 4);
+
+    using rows = std::vector<std::vector<int>>;
+    CHECK(segs.sums().to_host() == rows{{3, 4, 7}, {}, {2, 7, 11, 15, 19}});
+    CHECK(segs.sort().to_host() == rows{{1, 3, 3}, {}, {2, 4, 4, 4, 5}});
+    CHECK(segs.distinct().to_host() == rows{{1, 3}, {}, {2, 4, 5}});
+    CHECK(segs.topk(2).to_host() == rows{{3, 3}, {}, {5, 4}});
+
+    auto runs = segs.rle();
+    CHECK(runs.offsets().to_host() == std::vector<parrot::index_t>{0, 3, 3, 6});
+    CHECK(runs.map(parrot::snd{}).maxr().to_host() ==
+          std::vector<int>{1, std::numeric_limits<int>::lowest(), 3});
+
+    CHECK_THROWS_AS(parrot::ragged(values, parrot::array({0, 9})),
+                    std::invalid_argument);
+}
@@ -0,0 +1,246 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES.
+ * All rights reserved. SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "parrot.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "test_common.hpp"
+
+// Test eager operations on an array bound to a non-default stream
+TEST_CASE("ParrotTest - ExecutionContextBindTest") {
+    auto ctx = parrot::execution_context::create();
+    auto arr = parrot::array({4, 2, 3, 1}).on(ctx);
+
+    auto sorted = arr.sort();
+    CHECK_EQ(sorted.context().stream(), ctx.stream());
+    CHECK(check_match(sorted, parrot::array({1, 2, 3, 4})));
+
+    // Lazy views of a bound array stay on its stream
+    auto scanned = arr.times(2).sums();
+    CHECK_EQ(scanned.context().stream(), ctx.stream());
+    CHECK(check_match(scanned, parrot::array({8, 12, 18, 20})));
+    CHECK_EQ(arr.sum().value(), 10);
+}
+
+// Test the thread-local context guard
+TEST_CASE("ParrotTest - ExecutionContextGuardTest") {
+    auto ctx = parrot::execution_context::create();
+    {
+        parrot::context_guard const guard(ctx);
+        auto arr = parrot::range(6).reshape({2, 3});
+        CHECK_EQ(arr.context().stream(), ctx.stream());
+        auto rows = arr.sum<2>();
+        CHECK(check_match(rows, parrot::array({6, 15})));
+    }
+    CHECK_EQ(parrot::range(3).context().stream(), nullptr);
+}
+
+// Test two pipelines on independent streams
+TEST_CASE("ParrotTest - ExecutionContextOverlapTest") {
+    auto ctx1 = parrot::execution_context::create();
+    auto ctx2 = parrot::execution_context::create();
+
+    auto a = parrot::range(1000).on(ctx1).sq().sum();
+    auto b = parrot::range(1000).on(ctx2).rev().sort().back();
+    ctx2.wait(ctx1);
+    ctx2.synchronize();
+
+    CHECK_EQ(a.value(), 333833500);
+    CHECK_EQ(b, 1000);
+}
+
+// Test chunked reductions over pageable host memory
+TEST_CASE("ParrotTest - StreamSourceReduceTest") {
+    std::vector<int> host(10000);
+    std::iota(host.begin(), host.end(), -4999);
+    parrot::stream_source<int> source(host.data(), host.size(), 1024);
+    REQUIRE_EQ(source.num_chunks(), 10);
+
+    CHECK_EQ(source.sum().value(), 5000);
+    CHECK_EQ(source.minr().value(), -4999);
+    CHECK_EQ(source.maxr().value(), 5000);
+    auto const extremes = source.minmax([](auto chunk) { return chunk.abs(); });
+    CHECK_EQ(extremes.value(), thrust::make_pair(0, 5000));
+    CHECK_EQ(source.sum([](auto chunk) { return chunk.gt(0); }).value(), 5000);
+}
+
+// Test chunked scans carry across chunks and read pinned and file sources
+TEST_CASE("ParrotTest - StreamSourceScanTest") {
+    int const n = 5000;
+    int *pinned = nullptr;
+    REQUIRE_EQ(cudaMallocHost(&pinned, n * sizeof(int)), cudaSuccess);
+    for (int i = 0; i < n; ++i) { pinned[i] = i % 7; }
+
+    std::vector<int> expected(n);
+    std::partial_sum(pinned, pinned + n, expected.begin());
+    std::vector<int> running(n);
+    parrot::stream_source<int>(pinned, n, 777).sums(running.data());
+    CHECK(running == expected);
+
+    char const *path = "stream_source_test.bin";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<char const *>(pinned), n * sizeof(int));
+    }
+    parrot::stream_source<int> file_source(path, 1000);
+    CHECK_EQ(file_source.size(), n);
+    CHECK_EQ(file_source.sum().value(), expected.back());
+    std::vector<int> maxima(n);
+    file_source.scan(thrust::maximum<int>(), maxima.data());
+    CHECK_EQ(maxima.front(), 0);
+    CHECK_EQ(maxima.back(), 6);
+
+    // A file truncated after the source was created is reported
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<char const *>(pinned),
+                   n / 2 * sizeof(int));
+    }
+    CHECK_THROWS_AS((void)file_source.sum(), std::runtime_error);
+
+    std::remove(path);
+    cudaFreeHost(pinned);
+}
+
+// Test .npy round trips keep dtype and shape, and files written by NumPy load
+TEST_CASE("ParrotTest - NpyRoundTripTest") {
+    using namespace parrot::literals;
+    char const *path = "npy_round_trip_test.npy";
+    auto matrix      = parrot::range(6).as<float>().reshape({2, 3});
+    parrot::save_npy(matrix, path);
+    auto loaded = parrot::load_npy<float>(path);
+    CHECK(loaded.shape() == std::vector<parrot::index_t>{2, 3});
+    check_match_eq(loaded, matrix);
+    CHECK_THROWS_AS(parrot::load_npy<int>(path), std::runtime_error);
+
+    parrot::save_npy(parrot::range(3).times(2), path);
+    CHECK_EQ(parrot::load_npy<parrot::index_t>(path).rank(), 1);
+
+    // Header as numpy.save writes it: version 1.0, padded to 64 bytes
+    std::string dict =
+      "{'descr': '<i4', 'fortran_order': False, 'shape': (3, 2), }";
+    dict.append(128 - 10 - dict.size() - 1, ' ');
+    dict += '\n';
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write("\x93NUMPY\x01\x00", 8);
+        file.put(static_cast<char>(dict.size()));
+        file.put('\0');
+        file << dict;
+        std::vector<int> const values = {1, 2, 3, 4, 5, 6};
+        file.write(reinterpret_cast<char const *>(values.data()),
+                   values.size() * sizeof(int));
+    }
+    auto numpy = parrot::load_npy<int>(path);
+    CHECK(numpy.shape() == std::vector<parrot::index_t>{3, 2});
+    CHECK(numpy.sum(2_ic).to_host() == std::vector<int>{3, 7, 11});
+
+    std::remove(path);
+}
+
+// Test per-operation activity counters; nothing is recorded without the flag
+TEST_CASE("ParrotTest - InstrumentationSummaryTest") {
+    parrot::instrumentation::reset();
+    auto sorted = parrot::array({3, 1, 2}).sort();
+    CHECK(sorted.to_host() == std::vector<int>{1, 2, 3});
+    auto const stats = parrot::instrumentation::summary();
+
+#ifdef PARROT_ENABLE_INSTRUMENTATION
+    auto const find = [&](const std::string &name) {
+        return std::find_if(stats.begin(), stats.end(), [&](auto const &s) {
+            return s.name == name;
+        });
+    };
+    auto const sort = find("sort");
+    REQUIRE(sort != stats.end());
+    CHECK_EQ(sort->calls, 1);
+    CHECK_GE(sort->launches, 1);
+    CHECK_GE(sort->allocations, 1);
+    CHECK_EQ(sort->d2h_transfers, 0);
+
+    auto const copy = find("to_host");
+    REQUIRE(copy != stats.end());
+    CHECK_EQ(copy->d2h_transfers, 1);
+    CHECK_EQ(copy->d2h_bytes, 3 * sizeof(int));
+    CHECK_GE(copy->syncs, 1);
+
+    // kp reads the nsys kernel summary columns first
+    std::ostringstream csv;
+    parrot::instrumentation::write_summary(csv);
+    CHECK_EQ(csv.str().rfind("\"Name\",\"Total Time (ns)\",\"Instances\"", 0),
+             0);
+    CHECK_NE(csv.str().find("\"sort\","), std::string::npos);
+#else
+    CHECK(stats.empty());
+#endif
+}
+
+// Test capturing a pipeline into a CUDA graph and replaying it
+TEST_CASE("ParrotTest - GraphCaptureReplayTest") {
+    auto x          = parrot::array({1.0F, 2.0F, 3.0F});
+    auto [g, total] = parrot::capture([&] { return x.sq().sum(); });
+    g.replay();
+    CHECK_EQ(total.value(), 14.0F);
+
+    // New inputs are copied into the captured input before the launch
+    g.replay(x, parrot::array({4.0F, 5.0F, 6.0F}));
+    CHECK_EQ(total.value(), 77.0F);
+    CHECK(x.to_host() == std::vector<float>{4.0F, 5.0F, 6.0F});
+    CHECK_THROWS_AS(g.replay(x, parrot::array({1.0F})),
+                    std::invalid_argument);
+
+    // Host reads cannot be recorded
+    CHECK_THROWS_AS(parrot::capture([&] { (void)x.sum().value(); }),
+                    std::logic_error);
+}
+
+// Test a sharded array; two shards on device 0 exercise the exchanges
+TEST_CASE("ParrotTest - ShardedArrayTest") {
+    auto data    = parrot::array({5, 3, 3, 1, 1, 1, 1, 7, 2});
+    auto sharded = parrot::shard(data, {0, 0});
+    REQUIRE_EQ(sharded.num_shards(), 2);
+    CHECK_EQ(sharded.size(), 9);
+    CHECK(sharded.to_host() == data.to_host());
+
+    CHECK_EQ(sharded.sum().value(), 24);
+    CHECK_EQ(sharded.minr().value(), 1);
+    CHECK_EQ(sharded.maxr().value(), 7);
+    auto const range = sharded.minmax().value();
+    CHECK_EQ(range.first, 1);
+    CHECK_EQ(range.second, 7);
+    auto doubled = sharded.apply([](const auto &part) {
+        return part.times(2);
+    });
+    CHECK_EQ(doubled.sum().value(), 48);
+
+    CHECK(sharded.sums().to_host() == data.sums().to_host());
+    CHECK(sharded.sort().to_host() == data.sort().to_host());
+    CHECK(sharded.distinct().to_host() == std::vector<int>{1, 2, 3, 5, 7});
+
+    // The run of 1s spans the shard boundary and stays one run
+    auto runs = sharded.rle().to_host();
+    REQUIRE_EQ(runs.size(), 5);
+    CHECK_EQ(runs[2].first, 1);
+    CHECK_EQ(runs[2].second, 4);
+}
@@ -220,6 +220,40 @@ TEST_CASE("ParrotTest - ToHostPairTest") {
     }
 }
 
+// Test bulk to_host of a large lazy expression
+TEST_CASE("ParrotTest - ToHostLargeLazyTest") {
+    auto const n = 1 << 20;
+    auto host    = parrot::range(n).times(2).to_host();
+    REQUIRE_EQ(host.size(), n);
+    CHECK_EQ(host.front(), 2);
+    CHECK_EQ(host[12345], 24692);
+    CHECK_EQ(host.back(), 2 * n);
+}
+
+// Test to_host into caller-supplied pinned memory
+TEST_CASE("ParrotTest - ToHostPinnedTest") {
+    auto arr      = parrot::array({3, 1, 2}).sort();
+    int *host_ptr = nullptr;
+    REQUIRE_EQ(cudaMallocHost(&host_ptr, 3 * sizeof(int)), cudaSuccess);
+    arr.to_host(host_ptr);
+    CHECK_EQ(host_ptr[0], 1);
+    CHECK_EQ(host_ptr[1], 2);
+    CHECK_EQ(host_ptr[2], 3);
+    cudaFreeHost(host_ptr);
+}
+
+// Test asynchronous to_host
+TEST_CASE("ParrotTest - ToHostAsyncTest") {
+    auto future = parrot::range(5).sq().to_host_async();
+    auto host   = future.get();
+    REQUIRE_EQ(host.size(), 5);
+    CHECK_EQ(host[0], 1);
+    CHECK_EQ(host[4], 25);
+
+    auto empty = parrot::array({1, 2, 3}).take(0).to_host_async().get();
+    CHECK(empty.empty());
+}
+
 // Test rle function (run length encoding)
 TEST_CASE("ParrotTest - RleBasicTest") {
     auto arr    = parrot::array({1, 1, 2, 2, 2, 3, 4, 4});
@@ -317,6 +351,29 @@ TEST_CASE("ParrotTest - PairsWithDifferentSizesTest") {
     CHECK_THROWS_AS(arr1.pairs(arr2), std::invalid_argument);
 }
 
+// Test that pair arrays keep both columns and project them with fst/snd
+TEST_CASE("ParrotTest - PairColumnsTest") {
+    // The second operand owns the only copy of its data
+    auto pairs = parrot::range(4).pairs(parrot::array({5, 6, 7, 8}));
+    CHECK(check_match(pairs.fst(), parrot::array({1, 2, 3, 4})));
+    CHECK(check_match(pairs.snd(), parrot::array({5, 6, 7, 8})));
+
+    auto runs = parrot::array({1, 1, 2, 2, 2, 3}).rle();
+    CHECK(check_match(runs.fst(), parrot::array({1, 2, 3})));
+    CHECK(check_match(runs.snd(), parrot::array({2, 3, 1})));
+    CHECK_EQ(runs.snd().sum().value(), 6);
+
+    auto top = parrot::array({4, 9, 1, 7}).topk(2);
+    CHECK(check_match(top.fst(), parrot::array({9, 7})));
+    CHECK(check_match(top.snd(), parrot::array({2, 4})));
+
+    // Pair arrays without columns fall back to a projection
+    auto packed = parrot::array({thrust::make_pair(1, 5),
+                                 thrust::make_pair(2, 3)});
+    CHECK(check_match(packed.fst(), parrot::array({1, 2})));
+    CHECK(check_match(packed.snd(), parrot::array({5, 3})));
+}
+
 // Test the enumerate method
 TEST_CASE("ParrotTest - EnumerateTest") {
     auto arr = parrot::array({10, 20, 30, 40});
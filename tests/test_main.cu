@@ -24,8 +24,10 @@
 #include "test_advanced_operations.cu"
 #include "test_array_operations.cu"
 #include "test_basic_operations.cu"
+#include "test_execution.cu"
 #include "test_integration.cu"
 #include "test_math_operations.cu"
+#include "test_memory.cu"
 #include "test_multidimensional.cu"
 #include "test_reductions.cu"
 #include "test_scans.cu"
@@ -18,6 +18,7 @@
 #include <cmath>
 #include <cstddef>
 #include <numbers>
+#include <type_traits>
 #include "parrot.hpp"
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "test_common.hpp"
@@ -204,4 +205,113 @@ TEST_CASE("ParrotTest - RandFloatTest") {
             CHECK_EQ(result_host[i], 0.0F);  // randf(0.0) should be 0.0
         }
     }
-}
\ No newline at end of file
+}
+
+// Test that seeded rand() is reproducible and matches the eager generators
+TEST_CASE("ParrotTest - RandSeedTest") {
+    auto ones   = parrot::scalar(1.0F).repeat(1000);
+    auto stream = ones.rand(7).to_host();
+    CHECK(ones.rand(7).to_host() == stream);
+    CHECK(ones.rand(8).to_host() != stream);
+    CHECK(parrot::random::uniform(1000, 7).to_host() == stream);
+
+    // Offsets skip ahead, including to the middle of a Philox block
+    auto skipped = std::vector<float>(stream.begin() + 3, stream.end());
+    CHECK(ones.take(997).rand(7, 3).to_host() == skipped);
+    CHECK(parrot::random::uniform(997, 7, 0.F, 1.F, 3).to_host() == skipped);
+}
+
+// Test the moments and ranges of the random distributions
+TEST_CASE("ParrotTest - RandomDistributionsTest") {
+    int const n  = 1 << 20;
+    auto uniform = parrot::random::uniform(n, 1);
+    CHECK_GE(uniform.minr().value(), 0.0F);
+    CHECK_LT(uniform.maxr().value(), 1.0F);
+    CHECK_EQ(uniform.sum().value() / n, doctest::Approx(0.5).epsilon(0.01));
+
+    auto normal = parrot::random::normal(n, 2);
+    CHECK_LT(std::abs(normal.sum().value() / n), 0.01F);
+    CHECK_EQ(normal.sq().sum().value() / n,
+             doctest::Approx(1.0).epsilon(0.01));
+
+    auto dice = parrot::random::integers(n, 3, -2, 5);
+    CHECK_EQ(dice.minr().value(), -2);
+    CHECK_EQ(dice.maxr().value(), 5);
+    CHECK_THROWS_AS(parrot::random::integers(4, 1, 5, 0),
+                    std::invalid_argument);
+}
+
+// Test fused row-wise softmax against the composed formulation
+TEST_CASE("ParrotTest - SoftmaxRowsTest") {
+    using namespace parrot::literals;
+    auto matrix   = parrot::range(6).as<float>().reshape({2, 3});
+    auto cols     = matrix.ncols();
+    auto z        = matrix - matrix.maxr(2_ic).replicate(cols);
+    auto expected = z.exp() / z.exp().sum(2_ic).replicate(cols);
+
+    auto result = matrix.softmax(2_ic);
+    REQUIRE_EQ(result.shape().size(), 2);
+    CHECK_EQ(result.shape()[0], 2);
+    CHECK_EQ(result.shape()[1], 3);
+    CHECK(check_match(result, expected));
+
+    // Large inputs must not overflow
+    auto shifted = (matrix + 1000.0F).softmax(2_ic);
+    CHECK(check_match(shifted, expected));
+}
+
+// Test row-wise log_softmax and logsumexp
+TEST_CASE("ParrotTest - LogSumExpRowsTest") {
+    using namespace parrot::literals;
+    auto matrix = parrot::array({1.0F, 2.0F, 3.0F, -1.0F, 0.0F, 1000.0F})
+                    .reshape({2, 3});
+
+    auto lse = matrix.logsumexp(2_ic).to_host();
+    REQUIRE_EQ(lse.size(), 2);
+    CHECK_EQ(lse[0], doctest::Approx(3.4076059F));
+    CHECK_EQ(lse[1], doctest::Approx(1000.0F));
+
+    auto log_sm = matrix.log_softmax(2_ic).to_host();
+    REQUIRE_EQ(log_sm.size(), 6);
+    CHECK_EQ(log_sm[2], doctest::Approx(3.0F - 3.4076059F));
+    CHECK_EQ(log_sm[5], doctest::Approx(0.0F));
+}
+
+// Test softmax on rows too wide for the shared memory cache
+TEST_CASE("ParrotTest - SoftmaxWideRowsTest") {
+    using namespace parrot::literals;
+    int const cols = 20000;
+    auto matrix    = parrot::range(2 * cols).as<float>().reshape({2, cols});
+    auto row_sums  = matrix.softmax(2_ic).sum(2_ic).to_host();
+    REQUIRE_EQ(row_sums.size(), 2);
+    CHECK_EQ(row_sums[0], doctest::Approx(1.0F));
+    CHECK_EQ(row_sums[1], doctest::Approx(1.0F));
+}
+
+// Test reduced-precision elements with float accumulation
+TEST_CASE("ParrotTest - ReducedPrecisionTest") {
+    using namespace parrot::literals;
+    auto halves = parrot::array({0.5F, 1.0F, 1.5F, 2.0F}).as<__half>();
+
+    auto total = halves.sum();
+    static_assert(std::is_same_v<decltype(total.value()), float>);
+    CHECK_EQ(total.value(), doctest::Approx(5.0F));
+    CHECK_EQ(halves.maxr().value(), doctest::Approx(2.0F));
+    CHECK_EQ(halves.reshape({2, 2}).sum(2_ic).to_host()[1],
+             doctest::Approx(3.5F));
+
+    // sq goes through the paired __half2 path, exp through float
+    auto expd = halves.exp().sq().as<float>().to_host();
+    REQUIRE_EQ(expd.size(), 4);
+    CHECK_EQ(expd[0], doctest::Approx(std::exp(1.0F)).epsilon(0.01));
+    CHECK_EQ(expd[3], doctest::Approx(std::exp(4.0F)).epsilon(0.01));
+
+    // Vectorized body and scalar tail round alike: exp in float, once
+    auto odd = parrot::array({0.1F, 0.2F, 0.3F, 0.4F, 0.7F}).as<__half>();
+    CHECK(odd.exp().as<float>().to_host() ==
+          odd.as<float>().exp().as<__half>().as<float>().to_host());
+
+    auto bfloats = parrot::range(4).as<__nv_bfloat16>();
+    CHECK_EQ(bfloats.sums().to_host()[3], doctest::Approx(10.0F));
+    CHECK_EQ(bfloats.minmax().value().second, doctest::Approx(4.0F));
+}
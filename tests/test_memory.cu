@@ -0,0 +1,153 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES.
+ * All rights reserved. SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "parrot.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "test_common.hpp"
+
+// Test that repeated eager operations are served from the pool
+TEST_CASE("ParrotTest - MemoryPoolReuseTest") {
+    parrot::pool_memory_resource pool;
+    auto *previous = parrot::set_memory_resource(&pool);
+
+    auto arr = parrot::array({5, 3, 1, 4, 2});
+    for (int i = 0; i < 4; ++i) {
+        auto sorted = arr.sort();
+        CHECK_EQ(sorted.front(), 1);
+    }
+
+    auto stats = pool.stats();
+    CHECK_GT(stats.allocations, 0);
+    CHECK_GT(stats.hits, 0);
+    CHECK_GT(stats.high_water_mark, 0);
+    CHECK_GT(stats.hit_rate(), 0.0);
+
+    parrot::set_memory_resource(previous);
+}
+
+// Test that released blocks go back to the upstream resource
+TEST_CASE("ParrotTest - MemoryPoolReleaseTest") {
+    parrot::cuda_memory_resource upstream;
+    parrot::pool_memory_resource pool(&upstream);
+
+    void *a = pool.allocate(1000);
+    pool.deallocate(a, 1000);
+    CHECK_EQ(pool.stats().bytes_in_use, 0);
+    CHECK_EQ(pool.stats().bytes_cached,
+             parrot::pool_memory_resource::size_class(1000));
+
+    // Same size class on the same stream reuses the cached block
+    void *b = pool.allocate(900);
+    CHECK_EQ(a, b);
+    pool.deallocate(b, 900);
+
+    pool.release();
+    CHECK_EQ(pool.stats().bytes_cached, 0);
+    CHECK_EQ(upstream.stats().bytes_in_use, 0);
+}
+
+#ifdef NDEBUG
+// Test that a foreign pointer is counted and ignored; debug builds assert
+TEST_CASE("ParrotTest - MemoryPoolForeignPointerTest") {
+    parrot::pool_memory_resource pool;
+    int foreign = 0;
+    pool.deallocate(&foreign, sizeof(foreign));
+    CHECK_EQ(pool.stats().foreign_frees, 1);
+    CHECK_EQ(pool.stats().bytes_cached, 0);
+}
+#endif
+
+// Test the size classes used by the pool
+TEST_CASE("ParrotTest - MemoryPoolSizeClassTest") {
+    using pool = parrot::pool_memory_resource;
+    CHECK_EQ(pool::size_class(1), 256);
+    CHECK_EQ(pool::size_class(257), 512);
+    CHECK_EQ(pool::size_class(1 << 20), 1 << 20);
+    CHECK_EQ(pool::size_class((1 << 20) + 1), 2 << 20);
+}
+
+// Test that results stay correct under a non-caching resource
+TEST_CASE("ParrotTest - MemoryResourceSwapTest") {
+    parrot::cuda_memory_resource direct;
+    auto *previous = parrot::set_memory_resource(&direct);
+
+    auto result = parrot::range(10).sum();
+    CHECK_EQ(result.value(), 55);
+    CHECK(check_match(parrot::array({3, 1, 2}).sort(),
+                      parrot::array({1, 2, 3})));
+    CHECK_EQ(direct.stats().hits, 0);
+
+    parrot::set_memory_resource(previous);
+    CHECK_EQ(parrot::get_memory_resource(), previous);
+}
+
+// Test that view() reads existing device memory in place
+TEST_CASE("ParrotTest - ViewDeviceMemoryTest") {
+    int *data = nullptr;
+    REQUIRE_EQ(cudaMalloc(&data, 6 * sizeof(int)), cudaSuccess);
+    std::vector<int> const host = {1, 2, 3, 4, 5, 6};
+    REQUIRE_EQ(cudaMemcpy(data,
+                          host.data(),
+                          host.size() * sizeof(int),
+                          cudaMemcpyHostToDevice),
+               cudaSuccess);
+
+    bool released = false;
+    {
+        auto owner  = std::shared_ptr<void>(data, [&released](void *p) {
+            cudaFree(p);
+            released = true;
+        });
+        auto matrix = parrot::view(data, {2, 3}, owner);
+        owner.reset();
+        CHECK_EQ(matrix.shape(), std::vector<parrot::index_t>{2, 3});
+        CHECK_EQ(matrix.sum().value(), 21);
+
+        // Writes through the pointer are visible to the view
+        int const seven = 7;
+        REQUIRE_EQ(
+          cudaMemcpy(data, &seven, sizeof(int), cudaMemcpyHostToDevice),
+          cudaSuccess);
+        CHECK_EQ(matrix.front(), 7);
+        CHECK_FALSE(released);
+    }
+    CHECK(released);
+}
+
+// Test views of pinned and managed host memory
+TEST_CASE("ParrotTest - ViewHostMemoryTest") {
+    float *pinned = nullptr;
+    REQUIRE_EQ(cudaMallocHost(&pinned, 4 * sizeof(float)), cudaSuccess);
+    for (int i = 0; i < 4; ++i) { pinned[i] = static_cast<float>(i + 1); }
+    CHECK_EQ(parrot::view(pinned, 4).times(2.F).sum().value(), 20.F);
+    cudaFreeHost(pinned);
+
+    int *managed = nullptr;
+    REQUIRE_EQ(cudaMallocManaged(&managed, 3 * sizeof(int)), cudaSuccess);
+    managed[0] = 3;
+    managed[1] = 1;
+    managed[2] = 2;
+    CHECK(check_match(parrot::view(managed, 3).sort(),
+                      parrot::array({1, 2, 3})));
+    cudaFree(managed);
+
+    std::vector<int> pageable = {1, 2, 3};
+    CHECK_THROWS_AS(parrot::view(pageable.data(), 3), std::invalid_argument);
+}
@@ -19,6 +19,8 @@
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <vector>
 #include "parrot.hpp"
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "test_common.hpp"
@@ -781,4 +783,45 @@ TEST_CASE("ParrotTest - ShapePreservationScalarLike") {
         CHECK_EQ(shape[2], 1);
         CHECK_EQ(result.size(), 1);
     }
-}
\ No newline at end of file
+}
+
+// Test matrix, matrix-vector and vector products against hand-computed values
+TEST_CASE("ParrotTest - MatrixProductTest") {
+    auto a = parrot::matrix({{1, 2, 3},  //
+                             {4, 5, 6}});
+    auto b = parrot::matrix({{7, 8},  //
+                             {9, 10},
+                             {11, 12}});
+
+    SUBCASE("matmul") {
+        auto result = a.matmul(b);
+        CHECK_EQ(result.shape(), std::vector<parrot::index_t>{2, 2});
+        check_match_eq(result, parrot::array({58, 64, 139, 154}));
+    }
+
+    SUBCASE("matmul of lazy and reduced-precision operands") {
+        auto result = a.as<float>().times(2).matmul(b.as<float>());
+        check_match_eq(result, parrot::array({116.0F, 128.0F, 278.0F, 308.0F}));
+        auto halves = a.as<__half>().matmul(b.as<__half>());
+        static_assert(std::is_same_v<decltype(halves)::value_type, float>);
+        check_match_eq(halves, parrot::array({58.0F, 64.0F, 139.0F, 154.0F}));
+    }
+
+    SUBCASE("matvec") {
+        auto result = a.matvec(parrot::array({1, 0, -1}));
+        CHECK_EQ(result.rank(), 1);
+        check_match_eq(result, parrot::array({-2, -2}));
+    }
+
+    SUBCASE("dot") {
+        auto x = parrot::array({1.0F, 2.0F, 3.0F});
+        CHECK_EQ(x.dot(x).value(), doctest::Approx(14.0F));
+    }
+
+    SUBCASE("mismatched shapes") {
+        CHECK_THROWS_AS(a.matmul(a), std::invalid_argument);
+        CHECK_THROWS_AS(a.matvec(parrot::array({1, 2})), std::invalid_argument);
+        CHECK_THROWS_AS(parrot::array({1, 2}).dot(parrot::array({1})),
+                        std::invalid_argument);
+    }
+}
@@ -203,4 +203,141 @@ TEST_CASE("ParrotTest - StatsModeNegativeTest") {
     auto arr    = parrot::array({-1, -2, -1, -3, -1});
     auto result = parrot::stats::mode(arr);
     CHECK_EQ(result.value(), -1);  // -1 appears most frequently (3 times)
-}
\ No newline at end of file
+}
+
+// Test that reduction results broadcast on the device without a host copy
+TEST_CASE("ParrotTest - DeviceScalarBroadcastTest") {
+    auto arr      = parrot::array({1, 5, 3});
+    auto centered = arr - arr.maxr();
+    CHECK_EQ(centered.rank(), 1);
+    CHECK(check_match(centered, parrot::array({-4, 0, -2})));
+
+    auto total = arr.sum();
+    CHECK_EQ(total.rank(), 0);
+    CHECK(check_match(arr.div(total.as<double>()),
+                      parrot::array({1.0 / 9, 5.0 / 9, 3.0 / 9})));
+}
+
+// Test repeat() on a device-resident scalar
+TEST_CASE("ParrotTest - DeviceScalarRepeatTest") {
+    auto repeated = parrot::array({2, 3, 4}).sum().repeat(3);
+    CHECK(check_match(repeated, parrot::array({9, 9, 9})));
+    CHECK_EQ(parrot::range(4).minr().value(), 1);
+}
+
+// Test several reductions computed in one pass
+TEST_CASE("ParrotTest - ReduceManyTest") {
+    auto arr = parrot::array({4, 1, 3, 2});
+    auto [s, lo, hi, n] = arr.reduce_many(parrot::agg::sum{},
+                                          parrot::agg::min{},
+                                          parrot::agg::max{},
+                                          parrot::agg::count{});
+    CHECK_EQ(s.value(), 10);
+    CHECK_EQ(lo.value(), 1);
+    CHECK_EQ(hi.value(), 4);
+    CHECK_EQ(n.value(), 4);
+
+    auto [mean, var] = arr.times(2).reduce_many(parrot::agg::mean{},
+                                                parrot::agg::var{});
+    CHECK(mean.value() == doctest::Approx(5.0));
+    CHECK(var.value() == doctest::Approx(5.0));
+}
+
+// Test row-wise multi-output reduction
+TEST_CASE("ParrotTest - ReduceManyRowsTest") {
+    using namespace parrot::literals;
+    auto matrix = parrot::range(6).reshape({2, 3});
+    auto [row_sums, row_max] = matrix.reduce_many(
+      2_ic, parrot::agg::sum{}, parrot::agg::max{});
+    CHECK(check_match(row_sums, parrot::array({6, 15})));
+    CHECK(check_match(row_max, parrot::array({3, 6})));
+}
+
+// Test stats::describe
+TEST_CASE("ParrotTest - StatsDescribeTest") {
+    using namespace parrot::literals;
+    auto data    = parrot::array({2.0, 4.0, 4.0, 4.0, 5.0, 5.0, 7.0, 9.0});
+    auto summary = parrot::stats::describe(data);
+    CHECK_EQ(summary.count, 8);
+    CHECK(summary.mean == doctest::Approx(5.0));
+    CHECK(summary.stddev == doctest::Approx(2.0));
+    CHECK_EQ(summary.min, 2.0);
+    CHECK_EQ(summary.max, 9.0);
+
+    auto matrix = parrot::range(6).reshape({2, 3});
+    auto rows   = parrot::stats::describe(matrix, 2_ic);
+    REQUIRE_EQ(rows.size(), 2);
+    CHECK(rows[1].mean == doctest::Approx(5.0));
+    CHECK_EQ(rows[1].min, 4);
+    CHECK_EQ(rows[0].count, 3);
+}
+
+// Test column-wise reductions
+TEST_CASE("ParrotTest - ReduceColumnsTest") {
+    using namespace parrot::literals;
+    auto matrix = parrot::range(6).reshape({2, 3});  // [[1,2,3],[4,5,6]]
+    CHECK(check_match(matrix.sum(1_ic), parrot::array({5, 7, 9})));
+    CHECK(check_match(matrix.maxr(1_ic), parrot::array({4, 5, 6})));
+    CHECK(check_match(matrix.minr(1_ic), parrot::array({1, 2, 3})));
+    REQUIRE_EQ(matrix.sum(1_ic).shape().size(), 1);
+    CHECK_EQ(matrix.sum(1_ic).shape()[0], 3);
+
+    // Tall matrix reduced through partial row groups
+    int const rows = 200000;
+    auto tall      = parrot::range(rows * 2).reshape({rows, 2}).minus(1);
+    auto col_max   = tall.maxr(1_ic).to_host();
+    CHECK_EQ(col_max[0], 2 * rows - 2);
+    CHECK_EQ(col_max[1], 2 * rows - 1);
+    auto counts = tall.reduce_many(1_ic, parrot::agg::count{});
+    CHECK_EQ(std::get<0>(counts).to_host()[1], rows);
+}
+
+// Test group_by on keys flagged as sorted (reduce_by_key path)
+TEST_CASE("ParrotTest - GroupBySortedTest") {
+    auto keys   = parrot::array({3, 1, 2, 1, 3, 3}).sort();
+    auto values = parrot::array({10, 20, 30, 40, 50, 60});
+    auto [groups, sums] = parrot::group_by(keys, values).sum();
+    CHECK(check_match(groups, parrot::array({1, 2, 3})));
+    CHECK(check_match(sums, parrot::array({30, 40, 150})));
+}
+
+// Test group_by on unsorted integer keys (hash path), including key -1
+TEST_CASE("ParrotTest - GroupByUnsortedTest") {
+    auto keys   = parrot::array({7, -1, 3, 7, -1, 7});
+    auto values = parrot::array({1.0F, 2.0F, 3.0F, 4.0F, 5.0F, 6.0F});
+    auto [groups, totals, largest, counts, means] =
+      parrot::group_by(keys, values)
+        .agg(parrot::agg::sum{},
+             parrot::agg::max{},
+             parrot::agg::count{},
+             parrot::agg::mean{});
+    CHECK(check_match(groups, parrot::array({-1, 3, 7})));
+    CHECK(check_match(totals, parrot::array({7.0F, 3.0F, 11.0F})));
+    CHECK(check_match(largest, parrot::array({5.0F, 3.0F, 6.0F})));
+    auto count_host = counts.to_host();
+    REQUIRE_EQ(count_host.size(), 3);
+    CHECK_EQ(count_host[0], 2);
+    CHECK_EQ(count_host[2], 3);
+    CHECK(check_match(means, parrot::array({3.5F, 3.0F, 11.0F / 3.0F})));
+
+    auto [min_keys, mins] = parrot::group_by(keys, values).min();
+    CHECK(check_match(mins, parrot::array({2.0F, 3.0F, 1.0F})));
+}
+
+// Test group_by on a larger lazy input and on floating point keys
+TEST_CASE("ParrotTest - GroupByLargeTest") {
+    auto keys   = parrot::range(100000).idiv(1000);
+    auto values = parrot::range(100000).rev();
+    auto [groups, sums] = parrot::group_by(keys.rev(), values).sum();
+    auto [expected_groups, expected_sums] =
+      parrot::group_by(keys.sort(), values.rev()).sum();
+    CHECK_EQ(groups.size(), 101);
+    CHECK(check_match(groups, expected_groups));
+    CHECK(check_match(sums, expected_sums));
+
+    auto float_keys = parrot::array({0.5F, 1.5F, 0.5F});
+    auto [fgroups, fcounts] =
+      parrot::group_by(float_keys, parrot::array({1, 2, 3})).count();
+    CHECK(check_match(fgroups, parrot::array({0.5F, 1.5F})));
+    CHECK_EQ(fcounts.to_host()[0], 2);
+}
@@ -162,3 +162,49 @@ TEST_CASE("ParrotTest - ScanColTest") {
                                .reshape({3, 3});
     CHECK(check_match(scan_col_maxs, expected_col_maxs));
 }
+
+// Test column-wise scan on a tall matrix (spans several row chunks)
+TEST_CASE("ParrotTest - ScanColumnsTallTest") {
+    int const rows = 100000;
+    int const cols = 3;
+    auto ones      = parrot::scalar(1).repeat(rows * cols);
+    auto scanned   = ones.reshape({rows, cols}).scan<1>(parrot::add{});
+    REQUIRE_EQ(scanned.shape().size(), 2);
+    CHECK_EQ(scanned.shape()[0], rows);
+
+    auto host = scanned.to_host();
+    CHECK_EQ(host[0], 1);
+    CHECK_EQ(host[cols * 500 + 2], 501);
+    CHECK_EQ(host[host.size() - 1], rows);
+}
+
+// Test sliding-window operations over all elements and along rows
+TEST_CASE("ParrotTest - RollingTest") {
+    using namespace parrot::literals;
+    auto arr = parrot::array({3, 1, 4, 1, 5, 9, 2, 6});
+    CHECK(check_match(arr.rolling_sum(3),
+                      parrot::array({8, 6, 10, 15, 16, 17})));
+    CHECK(check_match(arr.rolling_min(3), parrot::array({1, 1, 1, 1, 2, 2})));
+    CHECK(check_match(arr.rolling_max(3), parrot::array({4, 4, 5, 9, 9, 9})));
+    CHECK(check_match(arr.rolling_mean(2),
+                      parrot::array({2.0, 2.5, 2.5, 3.0, 7.0, 5.5, 4.0})));
+    CHECK(check_match(arr.rolling(8, parrot::max{}), parrot::array({9})));
+
+    // Row-wise windows never cross into the next row
+    auto matrix = arr.reshape({2, 4});
+    auto rows   = matrix.rolling_sum(2, 2_ic);
+    REQUIRE_EQ(rows.shape().size(), 2);
+    CHECK_EQ(rows.shape()[1], 3);
+    CHECK(check_match(rows,
+                      parrot::array({4, 5, 5, 14, 11, 8}).reshape({2, 3})));
+
+    // Windows wider than a shared-memory tile use global segmented scans
+    auto wide = parrot::scalar(1).repeat(10000).rolling_sum(5000).to_host();
+    CHECK_EQ(wide.size(), 5001);
+    CHECK_EQ(wide[0], 5000);
+    CHECK_EQ(wide[wide.size() - 1], 5000);
+
+    CHECK_THROWS_AS((void)arr.rolling_sum(0), std::invalid_argument);
+    CHECK_THROWS_AS((void)arr.rolling_sum(9), std::invalid_argument);
+    CHECK_THROWS_AS((void)matrix.rolling_sum(5, 2_ic), std::invalid_argument);
+}
@@ -100,4 +100,196 @@ TEST_CASE("ParrotTest - UniqAllDuplicatesTest") {
     auto result = arr.uniq();
     CHECK_EQ(result.size(), 1);
     CHECK_EQ(result.sum().value(), 5);
-}
\ No newline at end of file
+}
+
+// Test topk against the full-sort formulation it replaces
+TEST_CASE("ParrotTest - TopkTest") {
+    auto arr      = parrot::array({3, 1, 4, 1, 5, 9, 2, 6, 5, 3});
+    auto result   = arr.topk(4);
+    auto expected = arr.enumerate().sort().rev().take(4);
+    CHECK_EQ(result.size(), 4);
+    CHECK(result.to_host() == expected.to_host());
+
+    // k larger than the array keeps every element
+    CHECK(arr.topk(20).to_host() == arr.enumerate().sort().rev().to_host());
+    CHECK_EQ(arr.topk(0).size(), 0);
+}
+
+// Test topk tie handling and negative floating point values
+TEST_CASE("ParrotTest - TopkTiesTest") {
+    auto ties = parrot::array({2, 2, 7, 2, 1, 2});
+    CHECK(ties.topk(3).to_host() ==
+          ties.enumerate().sort().rev().take(3).to_host());
+
+    auto floats = parrot::array({-1.5F, 0.25F, -3.0F, 2.0F, -0.5F});
+    auto host   = floats.topk(3).to_host();
+    REQUIRE_EQ(host.size(), 3);
+    CHECK_EQ(host[0].first, 2.0F);
+    CHECK_EQ(host[0].second, 4);
+    CHECK_EQ(host[1].first, 0.25F);
+    CHECK_EQ(host[2].first, -0.5F);
+
+    // 0.0 ranks above -0.0, as in the radix selection
+    auto zeros = parrot::array({0.0F, -0.0F, 1.0F}).topk(2).to_host();
+    REQUIRE_EQ(zeros.size(), 2);
+    CHECK_EQ(zeros[1].second, 1);
+    CHECK_FALSE(std::signbit(zeros[1].first));
+}
+
+// Test topk on a lazy input with many duplicates
+TEST_CASE("ParrotTest - TopkLargeTest") {
+    auto arr = parrot::range(1000).cycle({100000}).times(3);
+    CHECK(arr.topk(25).to_host() ==
+          arr.enumerate().sort().rev().take(25).to_host());
+}
+
+// Test row-wise topk
+TEST_CASE("ParrotTest - TopkRowsTest") {
+    using namespace parrot::literals;
+    auto matrix = parrot::array({5, 1, 9, 3, 9, 2, 8, 8, 4, 6}).reshape({2, 5});
+    auto result = matrix.topk(2, 2_ic);
+    REQUIRE_EQ(result.shape().size(), 2);
+    CHECK_EQ(result.shape()[0], 2);
+    CHECK_EQ(result.shape()[1], 2);
+
+    auto host = result.to_host();
+    REQUIRE_EQ(host.size(), 4);
+    CHECK_EQ(host[0], thrust::make_pair(9, 5));
+    CHECK_EQ(host[1], thrust::make_pair(9, 3));
+    CHECK_EQ(host[2], thrust::make_pair(8, 3));
+    CHECK_EQ(host[3], thrust::make_pair(8, 2));
+
+    // k above the in-kernel rank sort limit takes the sorted path
+    auto wide = parrot::range(6000).reshape({2, 3000}).topk(2000, 2_ic);
+    auto rows = wide.to_host();
+    REQUIRE_EQ(rows.size(), 4000);
+    CHECK_EQ(rows[0].first, 2999);
+    CHECK_EQ(rows[0].second, 3000);
+    CHECK_EQ(rows[1999].first, 1000);
+    CHECK_EQ(rows[2000].first, 5999);
+    CHECK_EQ(rows[3999].first, 4000);
+    for (std::size_t i = 1; i < rows.size(); ++i) {
+        if (i != 2000) { CHECK_LT(rows[i].first, rows[i - 1].first); }
+    }
+}
+
+// Test descending sort on the radix path
+TEST_CASE("ParrotTest - SortDescTest") {
+    auto arr = parrot::array({4, -2, 3, 1, 3});
+    CHECK(check_match(arr.sort_desc(), parrot::array({4, 3, 3, 1, -2})));
+
+    auto floats = parrot::array({0.5F, -1.5F, 2.25F});
+    CHECK(check_match(floats.sort_desc(), parrot::array({2.25F, 0.5F, -1.5F})));
+}
+
+// Test row-wise sorting of a matrix
+TEST_CASE("ParrotTest - SortRowsTest") {
+    using namespace parrot::literals;
+    auto matrix = parrot::array({3, 1, 2, 9, 7, 8}).reshape({2, 3});
+
+    auto ascending = matrix.sort(2_ic);
+    REQUIRE_EQ(ascending.shape().size(), 2);
+    CHECK_EQ(ascending.shape()[0], 2);
+    CHECK_EQ(ascending.shape()[1], 3);
+    CHECK(check_match(ascending, parrot::array({1, 2, 3, 7, 8, 9})));
+
+    auto descending = matrix.sort_desc(2_ic);
+    CHECK(check_match(descending, parrot::array({3, 2, 1, 9, 8, 7})));
+}
+
+// Test that sort_by_key keeps the order of equal keys
+TEST_CASE("ParrotTest - SortByKeyStableTest") {
+    auto arr = parrot::array({1, 4, 2, 3, 6, 5, 8, 7});
+    CHECK(check_match(arr.sort_by_key(EvenFirstFunctor()),
+                      parrot::array({4, 2, 6, 8, 1, 3, 5, 7})));
+    CHECK(check_match(arr.sort_by_key_desc(EvenFirstFunctor()),
+                      parrot::array({1, 3, 5, 7, 4, 2, 6, 8})));
+}
+
+// Test value_counts ordering and the hash table's empty-slot key (-1)
+TEST_CASE("ParrotTest - ValueCountsTest") {
+    auto arr    = parrot::array({7, -1, 3, 7, -1, 7, 0});
+    auto result = arr.value_counts();
+    CHECK(result.to_host() == arr.sort().rle().to_host());
+
+    auto host = result.to_host();
+    REQUIRE_EQ(host.size(), 4);
+    CHECK_EQ(host[0], thrust::make_pair(-1, 2));
+    CHECK_EQ(host[3], thrust::make_pair(7, 3));
+
+    auto wide = parrot::array({5LL, -1LL, 5LL}).value_counts().to_host();
+    REQUIRE_EQ(wide.size(), 2);
+    CHECK_EQ(wide[0].second, 1);
+    CHECK_EQ(wide[1].second, 2);
+}
+
+// Test value_counts and distinct on larger unsorted inputs
+TEST_CASE("ParrotTest - ValueCountsLargeTest") {
+    // Few distinct values (hash path) and all distinct values
+    auto repeated = parrot::range(1000).cycle({200000}).rev().times(-3);
+    CHECK(repeated.value_counts().to_host() ==
+          repeated.sort().rle().to_host());
+
+    auto unique = parrot::range(200000).times(7).sort_desc();
+    CHECK_EQ(unique.value_counts().size(), 200000);
+    CHECK(check_match(unique.distinct(), unique.sort()));
+}
+
+// Test distinct on unsorted input
+TEST_CASE("ParrotTest - DistinctUnsortedTest") {
+    auto arr = parrot::array({4, 1, 4, 2, 1, -1, 2});
+    CHECK(check_match(arr.distinct(), parrot::array({-1, 1, 2, 4})));
+
+    auto floats = parrot::array({2.5F, 1.0F, 2.5F});
+    CHECK(check_match(floats.distinct(), parrot::array({1.0F, 2.5F})));
+}
+
+// Test vectorized binary searches on a sorted array
+TEST_CASE("ParrotTest - SearchsortedTest") {
+    auto sorted  = parrot::array({1, 3, 3, 3, 7, 9});
+    auto needles = parrot::array({0, 3, 4, 9, 10});
+    CHECK(check_match(sorted.lower_bound(needles),
+                      parrot::array({0, 1, 4, 5, 6})));
+    CHECK(check_match(sorted.upper_bound(needles),
+                      parrot::array({0, 4, 4, 6, 6})));
+    CHECK(check_match(sorted.searchsorted(needles),
+                      sorted.lower_bound(needles)));
+    CHECK(check_match(sorted.searchsorted(needles, true),
+                      sorted.upper_bound(needles)));
+}
+
+// Test the sorted-array fast paths of index_of, minr and maxr
+TEST_CASE("ParrotTest - SortedFastPathsTest") {
+    using namespace parrot::literals;
+    auto sorted = parrot::array({5, 2, 8, 2, 9, 2}).sort();
+    REQUIRE(sorted.is_sorted());
+    CHECK_EQ(sorted.index_of(2), 0);
+    CHECK_EQ(sorted.last_index_of(2), 2);
+    CHECK_EQ(sorted.index_of(8), 4);
+    CHECK_EQ(sorted.index_of(4), -1);
+    CHECK_EQ(sorted.last_index_of(10), -1);
+    CHECK_EQ(sorted.minr().value(), 2);
+    CHECK_EQ(sorted.maxr().value(), 9);
+    CHECK(sorted.drop(3).is_sorted());
+    CHECK_EQ(sorted.drop(3).minr().value(), 5);
+
+    // Orders that are not ascending are not flagged
+    CHECK_FALSE(parrot::array({1, 2, 3}).sort_by(parrot::gt{}).is_sorted());
+    CHECK_FALSE(parrot::array({1, 2, 3}).sort_desc().is_sorted());
+    auto running = parrot::matrix({{3, 1}, {2, 5}}).maxs(2_ic);
+    CHECK_FALSE(running.is_sorted());
+    CHECK_EQ(running.minr().value(), 2);
+}
+
+// Test merging sorted and unsorted arrays
+TEST_CASE("ParrotTest - MergeTest") {
+    auto left   = parrot::array({1, 4, 6}).sort();
+    auto right  = parrot::array({2, 3, 7, 8}).sort();
+    auto merged = left.merge(right);
+    CHECK(merged.is_sorted());
+    CHECK(check_match(merged, parrot::array({1, 2, 3, 4, 6, 7, 8})));
+
+    // Unsorted operands are sorted first
+    CHECK(check_match(parrot::array({6, 1, 4}).merge(parrot::array({3, 1})),
+                      parrot::array({1, 1, 3, 4, 6})));
+}
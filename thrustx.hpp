@@ -18,83 +18,2586 @@
 #ifndef THRUSTX_HPP
 #define THRUSTX_HPP
 
+#include <cuda_bf16.h>
+#include <cuda_fp16.h>
+#include <cuda_fp8.h>
 #include <cuda_runtime.h>
+#include <thrust/copy.h>
+#include <thrust/device_ptr.h>
+#include <thrust/for_each.h>
 #include <thrust/functional.h>
+#include <thrust/gather.h>
+#include <thrust/iterator/constant_iterator.h>
 #include <thrust/iterator/counting_iterator.h>
+#include <thrust/iterator/detail/normal_iterator.h>
 #include <thrust/iterator/permutation_iterator.h>
+#include <thrust/iterator/reverse_iterator.h>
 #include <thrust/iterator/transform_iterator.h>
+#include <thrust/iterator/zip_iterator.h>
+#include <thrust/scan.h>
+#include <thrust/scatter.h>
+#include <thrust/sequence.h>
+#include <thrust/sort.h>
+#include <thrust/system/cuda/execution_policy.h>
+#include <thrust/transform_reduce.h>
+#include <thrust/tuple.h>
+#include <cub/block/block_reduce.cuh>
+#include <cub/block/block_scan.cuh>
+#include <cub/device/device_radix_sort.cuh>
 #include <cub/device/device_reduce.cuh>
 #include <cub/device/device_segmented_reduce.cuh>
+#include <cub/device/device_segmented_sort.cuh>
+#include <cub/warp/warp_reduce.cuh>
+#include <cuda/std/bit>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <iterator>
+#include <new>
 #include <stdexcept>
+#include <string>
 #include <type_traits>
+#include <utility>
 
 // ThrustX namespace for extended thrust functionality
 namespace thrustx {
 
+// ----------------------------------------------------------------------------
+// Index type
+// ----------------------------------------------------------------------------
+// Sizes, shapes and element positions use index_t: int by default, whose
+// division and modulo are cheaper on the GPU, or std::int64_t with
+// PARROT_ENABLE_64BIT_INDEX defined, for arrays of 2^31 elements or more.
+
+#ifdef PARROT_ENABLE_64BIT_INDEX
+using index_t = std::int64_t;
+#else
+using index_t = int;
+#endif
+
+// ----------------------------------------------------------------------------
+// Reduced-precision types
+// ----------------------------------------------------------------------------
+// __half, __nv_bfloat16 and the fp8 formats are storage types: element-wise
+// math and accumulation convert them to float. __half and __nv_bfloat16 also
+// have packed pair types whose intrinsics process two elements at once.
+
+template <typename T>
+inline constexpr bool is_reduced_precision_v =
+  std::is_same_v<T, __half> || std::is_same_v<T, __nv_bfloat16> ||
+  std::is_same_v<T, __nv_fp8_e4m3> || std::is_same_v<T, __nv_fp8_e5m2>;
+
+// Type that arithmetic on T is carried out in
+template <typename T>
+using compute_type_t = std::conditional_t<is_reduced_precision_v<T>, float, T>;
+
+namespace detail {
+// Two elements packed for paired intrinsics
+template <typename T>
+struct paired {};
+
+template <>
+struct paired<__half> {
+    using type = __half2;
+    __device__ static auto pack(__half a, __half b) -> type {
+        return __halves2half2(a, b);
+    }
+    __device__ static auto low(type p) -> __half { return __low2half(p); }
+    __device__ static auto high(type p) -> __half { return __high2half(p); }
+};
+
+template <>
+struct paired<__nv_bfloat16> {
+    using type = __nv_bfloat162;
+    __device__ static auto pack(__nv_bfloat16 a, __nv_bfloat16 b) -> type {
+        return __halves2bfloat162(a, b);
+    }
+    __device__ static auto low(type p) -> __nv_bfloat16 {
+        return __low2bfloat16(p);
+    }
+    __device__ static auto high(type p) -> __nv_bfloat16 {
+        return __high2bfloat16(p);
+    }
+};
+
+// Whether functor F transforms a packed pair of T with F::pair
+template <typename F, typename T, typename = void>
+struct has_pair_op : std::false_type {};
+
+template <typename F, typename T>
+struct has_pair_op<F,
+                   T,
+                   std::void_t<decltype(std::declval<const F &>().pair(
+                     std::declval<typename paired<T>::type>()))>>
+  : std::true_type {};
+}  // namespace detail
+
+// ----------------------------------------------------------------------------
+// Activity counters
+// ----------------------------------------------------------------------------
+// With PARROT_ENABLE_COUNTERS defined, kernel launches (CUB and thrust
+// dispatches count once each), device allocations, host synchronizations and
+// device-to-host copies are tallied per thread. Otherwise the hooks are empty.
+// PARROT_ENABLE_INSTRUMENTATION implies the counters.
+
+#if defined(PARROT_ENABLE_INSTRUMENTATION) && !defined(PARROT_ENABLE_COUNTERS)
+#define PARROT_ENABLE_COUNTERS
+#endif
+
+/**
+ * @brief Running totals of the device activity issued by the calling thread
+ */
+struct activity_counters {
+    std::size_t launches        = 0;
+    std::size_t allocations     = 0;
+    std::size_t allocated_bytes = 0;
+    std::size_t syncs           = 0;
+    std::size_t d2h_transfers   = 0;
+    std::size_t d2h_bytes       = 0;
+
+    auto operator+=(const activity_counters &other) -> activity_counters & {
+        launches += other.launches;
+        allocations += other.allocations;
+        allocated_bytes += other.allocated_bytes;
+        syncs += other.syncs;
+        d2h_transfers += other.d2h_transfers;
+        d2h_bytes += other.d2h_bytes;
+        return *this;
+    }
+
+    auto operator-=(const activity_counters &other) -> activity_counters & {
+        launches -= other.launches;
+        allocations -= other.allocations;
+        allocated_bytes -= other.allocated_bytes;
+        syncs -= other.syncs;
+        d2h_transfers -= other.d2h_transfers;
+        d2h_bytes -= other.d2h_bytes;
+        return *this;
+    }
+};
+
+namespace detail {
+
+inline auto activity() -> activity_counters & {
+    thread_local activity_counters counters;
+    return counters;
+}
+
+inline void count_launch([[maybe_unused]] std::size_t launches = 1) {
+#ifdef PARROT_ENABLE_COUNTERS
+    activity().launches += launches;
+#endif
+}
+
+inline void count_allocation([[maybe_unused]] std::size_t bytes) {
+#ifdef PARROT_ENABLE_COUNTERS
+    ++activity().allocations;
+    activity().allocated_bytes += bytes;
+#endif
+}
+
+inline void count_sync() {
+#ifdef PARROT_ENABLE_COUNTERS
+    ++activity().syncs;
+#endif
+}
+
+inline void count_d2h([[maybe_unused]] std::size_t bytes) {
+#ifdef PARROT_ENABLE_COUNTERS
+    ++activity().d2h_transfers;
+    activity().d2h_bytes += bytes;
+#endif
+}
+
+}  // namespace detail
+
+// Default temporary storage allocator for thrustx algorithms. It follows the
+// allocator protocol accepted by thrust::cuda::par(alloc), so callers can swap
+// in a caching allocator without touching the algorithms.
+struct cuda_temp_allocator {
+    using value_type = char;
+
+    auto allocate(std::ptrdiff_t num_bytes) -> char * {
+        void *ptr = nullptr;
+        if (cudaMalloc(&ptr, num_bytes) != cudaSuccess) {
+            throw std::bad_alloc();
+        }
+        detail::count_allocation(static_cast<std::size_t>(num_bytes));
+        return static_cast<char *>(ptr);
+    }
+
+    void deallocate(char *ptr, std::size_t /*num_bytes*/) { cudaFree(ptr); }
+};
+
 // High-performance implementation using CUB's optimized uniform segmentation
 // Reduces input into segments of N elements each using CUB's fixed-size
 // segmented reduce API when possible
 template <typename InputIterator,
           typename OutputIterator,
           typename BinaryOp,
-          typename T>
-void reduce_by_n_impl(InputIterator first,
-                      InputIterator last,
+          typename T,
+          typename TempAllocator = cuda_temp_allocator>
+void reduce_by_n_impl(InputIterator first,
+                      InputIterator last,
+                      OutputIterator out,
+                      index_t N,
+                      BinaryOp op,
+                      T init,
+                      TempAllocator alloc = {},
+                      cudaStream_t stream = nullptr) {
+    if (N <= 0) {
+        throw std::invalid_argument("reduce_by_n: N must be positive");
+    }
+
+    index_t const total_size = std::distance(first, last);
+    if (total_size == 0) { return; }
+
+    index_t const num_segments = total_size / N;
+
+    if (total_size % N != 0) {
+        throw std::invalid_argument(
+          "reduce_by_n: N must be a divisor of std::distance(first, last)");
+    }
+
+    void *d_temp_storage      = nullptr;
+    size_t temp_storage_bytes = 0;
+
+    // Query temp storage size using CUB's fixed-size segmented reduce API
+    cub::DeviceSegmentedReduce::Reduce(d_temp_storage,
+                                       temp_storage_bytes,
+                                       first,
+                                       out,
+                                       num_segments,
+                                       N,  // segment_size
+                                       op,
+                                       init,
+                                       stream);
+
+    // Temp storage comes from the caller's allocator (never zero bytes, since
+    // CUB treats a null pointer as a size query)
+    temp_storage_bytes = std::max<size_t>(temp_storage_bytes, 1);
+    d_temp_storage     = alloc.allocate(temp_storage_bytes);
+
+    // Actual reduction using fixed-size segmented reduce
+    cub::DeviceSegmentedReduce::Reduce(d_temp_storage,
+                                       temp_storage_bytes,
+                                       first,
+                                       out,
+                                       num_segments,
+                                       N,  // segment_size
+                                       op,
+                                       init,
+                                       stream);
+    detail::count_launch();
+
+    alloc.deallocate(static_cast<char *>(d_temp_storage), temp_storage_bytes);
+}
+
+// Reduces [first, last) into *out on the device (no host round-trip). The
+// result stays in device memory, so later kernels can consume it directly.
+template <typename InputIterator,
+          typename OutputIterator,
+          typename BinaryOp,
+          typename T,
+          typename TempAllocator = cuda_temp_allocator>
+void reduce_into(InputIterator first,
+                 InputIterator last,
+                 OutputIterator out,
+                 BinaryOp op,
+                 T init,
+                 TempAllocator alloc = {},
+                 cudaStream_t stream = nullptr) {
+    auto const num_items = std::distance(first, last);
+
+    void *d_temp_storage      = nullptr;
+    size_t temp_storage_bytes = 0;
+
+    cub::DeviceReduce::Reduce(d_temp_storage,
+                              temp_storage_bytes,
+                              first,
+                              out,
+                              num_items,
+                              op,
+                              init,
+                              stream);
+
+    temp_storage_bytes = std::max<size_t>(temp_storage_bytes, 1);
+    d_temp_storage     = alloc.allocate(temp_storage_bytes);
+
+    cub::DeviceReduce::Reduce(d_temp_storage,
+                              temp_storage_bytes,
+                              first,
+                              out,
+                              num_items,
+                              op,
+                              init,
+                              stream);
+    detail::count_launch();
+
+    alloc.deallocate(static_cast<char *>(d_temp_storage), temp_storage_bytes);
+}
+
+// ----------------------------------------------------------------------------
+// Column-wise (axis 1) reductions and scans over row-major matrices
+// ----------------------------------------------------------------------------
+// Threads of a warp own consecutive columns, so every row is read coalesced
+// and each column is accumulated in registers; no transpose is needed.
+
+namespace detail {
+
+// Block shape used by the column kernels: 32 columns x 8 row lanes
+constexpr int column_tile_x = 32;
+constexpr int column_tile_y = 8;
+
+inline auto multiprocessor_count() -> int {
+    int device = 0;
+    int sms    = 1;
+    cudaGetDevice(&device);
+    cudaDeviceGetAttribute(&sms, cudaDevAttrMultiProcessorCount, device);
+    return std::max(sms, 1);
+}
+
+// Checks the launches just issued and counts them as activity
+inline void throw_on_launch_error(const char *what, std::size_t launches = 1) {
+    count_launch(launches);
+    auto const status = cudaGetLastError();
+    if (status != cudaSuccess) {
+        throw std::runtime_error(std::string(what) + ": " +
+                                 cudaGetErrorString(status));
+    }
+}
+
+// Each block reduces a 32-column tile over the rows assigned to its
+// blockIdx.y; row lanes are then combined in shared memory. With
+// gridDim.y == 1 the block produces final results (init applied), otherwise
+// one partial row per blockIdx.y.
+template <typename InputIterator,
+          typename OutputIterator,
+          typename BinaryOp,
+          typename T>
+__global__ void reduce_columns_kernel(InputIterator in,
+                                      int rows,
+                                      int cols,
+                                      OutputIterator out,
+                                      BinaryOp op,
+                                      T init,
+                                      bool apply_init) {
+    // Raw storage: __shared__ variables cannot have non-trivial constructors
+    __shared__ alignas(T) unsigned char
+      partial_storage[sizeof(T) * column_tile_y * column_tile_x];
+    __shared__ bool present[column_tile_y][column_tile_x];
+    auto *partial = reinterpret_cast<T(*)[column_tile_x]>(partial_storage);
+
+    int const col        = blockIdx.x * column_tile_x + threadIdx.x;
+    int const row_stride = gridDim.y * column_tile_y;
+
+    T acc{};
+    bool have = false;
+    if (col < cols) {
+        for (int row = blockIdx.y * column_tile_y + threadIdx.y; row < rows;
+             row += row_stride) {
+            T const x = in[static_cast<long long>(row) * cols + col];
+            acc       = have ? op(acc, x) : x;
+            have      = true;
+        }
+    }
+    partial[threadIdx.y][threadIdx.x] = acc;
+    present[threadIdx.y][threadIdx.x] = have;
+    __syncthreads();
+
+    if (threadIdx.y == 0 && col < cols) {
+        for (int lane = 1; lane < column_tile_y; ++lane) {
+            if (present[lane][threadIdx.x]) {
+                acc  = have ? op(acc, partial[lane][threadIdx.x])
+                            : partial[lane][threadIdx.x];
+                have = true;
+            }
+        }
+        if (apply_init) {
+            acc = have ? op(init, acc) : init;
+        }
+        out[static_cast<long long>(blockIdx.y) * cols + col] = acc;
+    }
+}
+
+// Phase 1 of the column scan: aggregate of every (row chunk, column)
+template <typename InputIterator, typename BinaryOp, typename T>
+__global__ void scan_columns_aggregate_kernel(InputIterator in,
+                                              int rows,
+                                              int cols,
+                                              int chunk_rows,
+                                              int num_chunks,
+                                              BinaryOp op,
+                                              T *aggregates) {
+    int const col   = blockIdx.x * column_tile_x + threadIdx.x;
+    int const chunk = blockIdx.y * column_tile_y + threadIdx.y;
+    if (col >= cols || chunk >= num_chunks) { return; }
+
+    int const first = chunk * chunk_rows;
+    int const last  = min(first + chunk_rows, rows);
+    T acc           = in[static_cast<long long>(first) * cols + col];
+    for (int row = first + 1; row < last; ++row) {
+        acc = op(acc, in[static_cast<long long>(row) * cols + col]);
+    }
+    aggregates[static_cast<long long>(chunk) * cols + col] = acc;
+}
+
+// Phase 2: exclusive scan of the chunk aggregates down each column (in place)
+template <typename BinaryOp, typename T>
+__global__ void scan_columns_carry_kernel(int cols,
+                                          int num_chunks,
+                                          BinaryOp op,
+                                          T *aggregates) {
+    int const col = blockIdx.x * blockDim.x + threadIdx.x;
+    if (col >= cols) { return; }
+
+    T carry = aggregates[col];
+    for (int chunk = 1; chunk < num_chunks; ++chunk) {
+        auto const idx = static_cast<long long>(chunk) * cols + col;
+        T const next   = op(carry, aggregates[idx]);
+        aggregates[idx] = carry;
+        carry           = next;
+    }
+}
+
+// Phase 3: rescan every chunk seeded with the carry of the chunks above it
+template <typename InputIterator,
+          typename OutputIterator,
+          typename BinaryOp,
+          typename T>
+__global__ void scan_columns_kernel(InputIterator in,
+                                    int rows,
+                                    int cols,
+                                    int chunk_rows,
+                                    int num_chunks,
+                                    OutputIterator out,
+                                    BinaryOp op,
+                                    const T *carries) {
+    int const col   = blockIdx.x * column_tile_x + threadIdx.x;
+    int const chunk = blockIdx.y * column_tile_y + threadIdx.y;
+    if (col >= cols || chunk >= num_chunks) { return; }
+
+    int const first = chunk * chunk_rows;
+    int const last  = min(first + chunk_rows, rows);
+    auto idx        = static_cast<long long>(first) * cols + col;
+    T acc           = in[idx];
+    if (chunk > 0) {
+        acc = op(carries[static_cast<long long>(chunk) * cols + col], acc);
+    }
+    out[idx] = acc;
+    for (int row = first + 1; row < last; ++row) {
+        idx += cols;
+        acc      = op(acc, in[idx]);
+        out[idx] = acc;
+    }
+}
+
+}  // namespace detail
+
+// Reduces each column of a row-major rows x cols matrix into out[col].
+// init is combined once per column (as thrust::reduce does).
+template <typename InputIterator,
+          typename OutputIterator,
+          typename BinaryOp,
+          typename T,
+          typename TempAllocator = cuda_temp_allocator>
+void reduce_columns(InputIterator first,
+                    int rows,
+                    int cols,
+                    OutputIterator out,
+                    BinaryOp op,
+                    T init,
+                    TempAllocator alloc = {},
+                    cudaStream_t stream = nullptr) {
+    if (rows < 0 || cols < 0) {
+        throw std::invalid_argument("reduce_columns: negative shape");
+    }
+    if (cols == 0) { return; }
+
+    dim3 const block(detail::column_tile_x, detail::column_tile_y);
+    int const grid_x = (cols + detail::column_tile_x - 1) /
+                       detail::column_tile_x;
+    int const max_y  = std::max(
+      1, (rows + detail::column_tile_y - 1) / detail::column_tile_y);
+    // Enough row groups to fill the device; every group owns >= 1 row
+    int const grid_y = std::clamp(
+      detail::multiprocessor_count() * 8 / grid_x, 1, std::min(max_y, 65535));
+
+    if (grid_y == 1) {
+        detail::reduce_columns_kernel<<<dim3(grid_x, 1), block, 0, stream>>>(
+          first, rows, cols, out, op, init, true);
+        detail::throw_on_launch_error("reduce_columns");
+        return;
+    }
+
+    // Two passes: one partial row per row group, then reduce the partials
+    auto const bytes = static_cast<std::size_t>(grid_y) * cols * sizeof(T);
+    char *storage    = alloc.allocate(static_cast<std::ptrdiff_t>(bytes));
+    T *partials      = reinterpret_cast<T *>(storage);
+
+    detail::reduce_columns_kernel<<<dim3(grid_x, grid_y), block, 0, stream>>>(
+      first, rows, cols, partials, op, init, false);
+    detail::reduce_columns_kernel<<<dim3(grid_x, 1), block, 0, stream>>>(
+      partials, grid_y, cols, out, op, init, true);
+    detail::throw_on_launch_error("reduce_columns", 2);
+
+    alloc.deallocate(storage, bytes);
+}
+
+// Inclusive scan down each column of a row-major rows x cols matrix.
+// Rows are split into chunks: chunk aggregates are computed, scanned per
+// column, and then each chunk is rescanned from its carry.
+template <typename InputIterator,
+          typename OutputIterator,
+          typename BinaryOp,
+          typename TempAllocator = cuda_temp_allocator>
+void inclusive_scan_columns(InputIterator first,
+                            int rows,
+                            int cols,
+                            OutputIterator out,
+                            BinaryOp op,
+                            TempAllocator alloc = {},
+                            cudaStream_t stream = nullptr) {
+    using T = typename std::iterator_traits<InputIterator>::value_type;
+    if (rows < 0 || cols < 0) {
+        throw std::invalid_argument("inclusive_scan_columns: negative shape");
+    }
+    if (rows == 0 || cols == 0) { return; }
+
+    // About 2048 resident threads per SM, one (chunk, column) pair each
+    int const target     = detail::multiprocessor_count() * 2048;
+    int num_chunks       = std::clamp(target / cols, 1, rows);
+    int const chunk_rows = (rows + num_chunks - 1) / num_chunks;
+    num_chunks           = (rows + chunk_rows - 1) / chunk_rows;
+
+    auto const bytes = static_cast<std::size_t>(num_chunks) * cols * sizeof(T);
+    char *storage    = alloc.allocate(static_cast<std::ptrdiff_t>(bytes));
+    T *aggregates    = reinterpret_cast<T *>(storage);
+
+    dim3 const block(detail::column_tile_x, detail::column_tile_y);
+    dim3 const grid(
+      (cols + detail::column_tile_x - 1) / detail::column_tile_x,
+      (num_chunks + detail::column_tile_y - 1) / detail::column_tile_y);
+
+    detail::scan_columns_aggregate_kernel<<<grid, block, 0, stream>>>(
+      first, rows, cols, chunk_rows, num_chunks, op, aggregates);
+    detail::scan_columns_carry_kernel<<<(cols + 127) / 128, 128, 0, stream>>>(
+      cols, num_chunks, op, aggregates);
+    detail::scan_columns_kernel<<<grid, block, 0, stream>>>(
+      first, rows, cols, chunk_rows, num_chunks, out, op, aggregates);
+    detail::throw_on_launch_error("inclusive_scan_columns", 3);
+
+    alloc.deallocate(storage, bytes);
+}
+
+// ----------------------------------------------------------------------------
+// Top-k selection (radix select)
+// ----------------------------------------------------------------------------
+// The k-th largest key is found one byte at a time, from the most significant
+// byte down, with a 256-bin histogram of the keys that still match the
+// selected prefix. Only the k winners are sorted afterwards, so the input is
+// read a few times instead of being fully sorted.
+
+namespace detail {
+
+// Offset of an array of U placed after bytes of scratch: bytes rounded up
+// to the alignment of U, so 1- and 2-byte values may precede int indices
+template <typename U>
+constexpr auto aligned_offset(std::size_t bytes) -> std::size_t {
+    return (bytes + alignof(U) - 1) / alignof(U) * alignof(U);
+}
+
+// Unsigned key whose integer order matches the value order of T
+template <typename T>
+using radix_key_t = std::conditional_t<
+  sizeof(T) == 1,
+  std::uint8_t,
+  std::conditional_t<sizeof(T) == 2,
+                     std::uint16_t,
+                     std::conditional_t<sizeof(T) == 4,
+                                        std::uint32_t,
+                                        std::uint64_t>>>;
+
+template <typename T>
+__host__ __device__ auto to_radix_key(T value) -> radix_key_t<T> {
+    using Key          = radix_key_t<T>;
+    constexpr Key high = Key(1) << (sizeof(Key) * 8 - 1);
+    if constexpr (std::is_floating_point_v<T>) {
+        auto const bits = ::cuda::std::bit_cast<Key>(value);
+        // Negative floats order reversed; positive ones after all negatives
+        return (bits & high) ? Key(~bits) : Key(bits | high);
+    } else if constexpr (std::is_signed_v<T>) {
+        return static_cast<Key>(value) ^ high;
+    } else {
+        return static_cast<Key>(value);
+    }
+}
+
+template <typename Key>
+struct radix_select_result {
+    Key threshold;  // Key of the k-th largest element
+    int greater;    // Elements with a key above the threshold (< k)
+    int equal;      // Elements with a key equal to the threshold
+};
+
+template <typename Iterator, typename Key>
+__global__ void radix_histogram_kernel(Iterator in,
+                                       int n,
+                                       Key prefix,
+                                       Key mask,
+                                       int shift,
+                                       unsigned int *histogram) {
+    using T = typename std::iterator_traits<Iterator>::value_type;
+    __shared__ unsigned int local[256];
+    for (int i = threadIdx.x; i < 256; i += blockDim.x) { local[i] = 0; }
+    __syncthreads();
+
+    for (int idx = blockIdx.x * blockDim.x + threadIdx.x; idx < n;
+         idx += gridDim.x * blockDim.x) {
+        Key const key = to_radix_key(static_cast<T>(in[idx]));
+        if ((key & mask) == prefix) {
+            atomicAdd(&local[(key >> shift) & 0xFF], 1U);
+        }
+    }
+    __syncthreads();
+
+    for (int i = threadIdx.x; i < 256; i += blockDim.x) {
+        if (local[i] != 0) { atomicAdd(&histogram[i], local[i]); }
+    }
+}
+
+// Walks the histogram from the top bin down and picks the bin holding the
+// remaining-th largest key; returns the number of keys in higher bins
+template <typename Histogram>
+__host__ __device__ auto select_bin(const Histogram &histogram,
+                                    int remaining,
+                                    int &bin) -> int {
+    int above = 0;
+    for (bin = 255; bin > 0; --bin) {
+        auto const count = static_cast<int>(histogram[bin]);
+        if (above + count >= remaining) { break; }
+        above += count;
+    }
+    return above;
+}
+
+// Finds the key of the k-th largest element (1 <= k <= n); one host
+// synchronization per key byte
+template <typename Iterator, typename TempAllocator>
+auto radix_select(Iterator first,
+                  int n,
+                  int k,
+                  TempAllocator &alloc,
+                  cudaStream_t stream) {
+    using T   = typename std::iterator_traits<Iterator>::value_type;
+    using Key = radix_key_t<T>;
+
+    constexpr std::size_t bytes = 256 * sizeof(unsigned int);
+    char *storage               = alloc.allocate(bytes);
+    auto *histogram             = reinterpret_cast<unsigned int *>(storage);
+    unsigned int host_histogram[256];
+
+    int const threads = 256;
+    int const blocks  = std::clamp(
+      (n + threads - 1) / threads, 1, multiprocessor_count() * 4);
+
+    Key prefix    = 0;
+    Key mask      = 0;
+    int remaining = k;
+    int equal     = 0;
+    for (int shift = static_cast<int>(sizeof(Key) * 8) - 8; shift >= 0;
+         shift -= 8) {
+        cudaMemsetAsync(histogram, 0, bytes, stream);
+        radix_histogram_kernel<<<blocks, threads, 0, stream>>>(
+          first, n, prefix, mask, shift, histogram);
+        cudaMemcpyAsync(host_histogram,
+                        histogram,
+                        bytes,
+                        cudaMemcpyDeviceToHost,
+                        stream);
+        cudaStreamSynchronize(stream);
+        count_d2h(bytes);
+        count_sync();
+        throw_on_launch_error("topk");
+
+        int bin = 0;
+        remaining -= select_bin(host_histogram, remaining, bin);
+        equal = static_cast<int>(host_histogram[bin]);
+        prefix |= Key(bin) << shift;
+        mask |= Key(0xFF) << shift;
+    }
+
+    alloc.deallocate(storage, bytes);
+    return radix_select_result<Key>{prefix, k - remaining, equal};
+}
+
+template <typename T>
+struct radix_key_compare {
+    radix_key_t<T> threshold;
+    bool greater;  // Select keys above (true) or equal to (false) threshold
+
+    __host__ __device__ auto operator()(const thrust::tuple<T, int> &t) const
+      -> bool {
+        auto const key = to_radix_key(thrust::get<0>(t));
+        return greater ? key > threshold : key == threshold;
+    }
+};
+
+// Order of top-k results: larger values first, ties by larger index first.
+// Values compare by radix key, the order the selection uses, so -0.0 sorts
+// below 0.0 and NaNs keep the order strict.
+template <typename T>
+struct topk_order {
+    template <typename Tuple>
+    __host__ __device__ auto operator()(const Tuple &a, const Tuple &b) const
+      -> bool {
+        auto const key_a = to_radix_key(static_cast<T>(thrust::get<0>(a)));
+        auto const key_b = to_radix_key(static_cast<T>(thrust::get<0>(b)));
+        if (key_a != key_b) { return key_b < key_a; }
+        return thrust::get<1>(b) < thrust::get<1>(a);
+    }
+};
+
+// Largest k whose row winners are rank sorted inside topk_rows_kernel; the
+// rank sort costs O(k^2 / threads) per thread, so larger k sort afterwards
+constexpr int topk_rank_sort_limit = 1024;
+
+// Orders positions of the rows x k winner scratch by row, then topk_order
+template <typename T>
+struct topk_row_order {
+    const T *values;
+    const int *indices;
+    long long k;
+
+    __host__ __device__ auto operator()(long long a, long long b) const
+      -> bool {
+        if (a / k != b / k) { return a < b; }
+        return topk_order<T>{}(thrust::make_tuple(values[a], indices[a]),
+                            thrust::make_tuple(values[b], indices[b]));
+    }
+};
+
+// One block per row: radix select in shared memory, then gather the winners
+// (ties taken from the end of the row) and rank-sort them into the output
+template <int BlockThreads, typename Iterator, typename T>
+__global__ void topk_rows_kernel(Iterator in,
+                                 int cols,
+                                 int k,
+                                 int index_base,
+                                 T *scratch_values,
+                                 int *scratch_indices,
+                                 T *out_values,
+                                 int *out_indices) {
+    using Key       = radix_key_t<T>;
+    using BlockScan = cub::BlockScan<int, BlockThreads>;
+    __shared__ unsigned int histogram[256];
+    __shared__ typename BlockScan::TempStorage scan_storage;
+    __shared__ Key selected_prefix;
+    __shared__ int selected_remaining;
+    __shared__ int greater_count;
+
+    auto const row    = static_cast<long long>(blockIdx.x);
+    auto const row_in = in + row * cols;
+    T *values         = scratch_values + row * k;
+    int *indices      = scratch_indices + row * k;
+
+    Key prefix    = 0;
+    Key mask      = 0;
+    int remaining = k;
+    for (int shift = static_cast<int>(sizeof(Key) * 8) - 8; shift >= 0;
+         shift -= 8) {
+        for (int i = threadIdx.x; i < 256; i += BlockThreads) {
+            histogram[i] = 0;
+        }
+        __syncthreads();
+        for (int c = threadIdx.x; c < cols; c += BlockThreads) {
+            Key const key = to_radix_key(static_cast<T>(row_in[c]));
+            if ((key & mask) == prefix) {
+                atomicAdd(&histogram[(key >> shift) & 0xFF], 1U);
+            }
+        }
+        __syncthreads();
+        if (threadIdx.x == 0) {
+            int bin            = 0;
+            int const above    = select_bin(histogram, remaining, bin);
+            selected_remaining = remaining - above;
+            selected_prefix    = prefix | (Key(bin) << shift);
+        }
+        __syncthreads();
+        prefix    = selected_prefix;
+        remaining = selected_remaining;
+        mask |= Key(0xFF) << shift;
+    }
+
+    // Everything above the threshold is a winner
+    if (threadIdx.x == 0) { greater_count = 0; }
+    __syncthreads();
+    for (int c = threadIdx.x; c < cols; c += BlockThreads) {
+        T const value = row_in[c];
+        if (to_radix_key(value) > prefix) {
+            int const slot = atomicAdd(&greater_count, 1);
+            values[slot]   = value;
+            indices[slot]  = c + index_base;
+        }
+    }
+    __syncthreads();
+    int const greater = greater_count;
+
+    // Ties fill the remaining slots, highest indices first
+    int taken = 0;
+    for (int base = cols - 1; base >= 0 && taken < remaining;
+         base -= BlockThreads) {
+        int const c = base - static_cast<int>(threadIdx.x);
+        T value{};
+        int flag = 0;
+        if (c >= 0) {
+            value = row_in[c];
+            flag  = to_radix_key(value) == prefix ? 1 : 0;
+        }
+        int rank  = 0;
+        int total = 0;
+        BlockScan(scan_storage).ExclusiveSum(flag, rank, total);
+        if (flag != 0 && taken + rank < remaining) {
+            values[greater + taken + rank]  = value;
+            indices[greater + taken + rank] = c + index_base;
+        }
+        taken += total;
+        __syncthreads();
+    }
+    __syncthreads();
+    if (k > topk_rank_sort_limit) { return; }  // Sorted by topk_rows
+
+    // Rank sort of the k winners (k is small compared to the row)
+    auto const order = topk_order<T>{};
+    for (int i = threadIdx.x; i < k; i += BlockThreads) {
+        auto const mine = thrust::make_tuple(values[i], indices[i]);
+        int rank        = 0;
+        for (int j = 0; j < k; ++j) {
+            rank += order(thrust::make_tuple(values[j], indices[j]), mine);
+        }
+        out_values[row * k + rank]  = values[i];
+        out_indices[row * k + rank] = indices[i];
+    }
+}
+
+}  // namespace detail
+
+// Writes the k largest elements of [first, first + n) to out_values and
+// their positions (offset by index_base) to out_indices, ordered by value
+// descending and, for equal values, by position descending.
+template <typename Iterator, typename TempAllocator = cuda_temp_allocator>
+void topk(Iterator first,
+          int n,
+          int k,
+          typename std::iterator_traits<Iterator>::value_type *out_values,
+          int *out_indices,
+          int index_base      = 0,
+          TempAllocator alloc = {},
+          cudaStream_t stream = nullptr) {
+    using T = typename std::iterator_traits<Iterator>::value_type;
+    static_assert(std::is_arithmetic_v<T>, "topk: requires arithmetic values");
+    if (k < 0 || k > n) {
+        throw std::invalid_argument("topk: k must be between 0 and n");
+    }
+    if (k == 0) { return; }
+
+    auto policy    = thrust::cuda::par_nosync(alloc).on(stream);
+    auto selection = detail::radix_select(first, n, k, alloc, stream);
+
+    auto in_begin = thrust::make_zip_iterator(
+      thrust::make_tuple(first, thrust::make_counting_iterator(index_base)));
+    auto in_end = in_begin + n;
+    auto out    = thrust::make_zip_iterator(
+      thrust::make_tuple(thrust::device_pointer_cast(out_values),
+                         thrust::device_pointer_cast(out_indices)));
+
+    // Elements strictly above the threshold (exactly selection.greater)
+    thrust::copy_if(policy,
+                    in_begin,
+                    in_end,
+                    out,
+                    detail::radix_key_compare<T>{selection.threshold, true});
+
+    // Ties with the threshold, taken from the highest positions
+    int const ties = k - selection.greater;
+    if (ties > 0) {
+        auto const equal = static_cast<std::size_t>(selection.equal);
+        auto const index_offset =
+          detail::aligned_offset<int>(equal * sizeof(T));
+        auto const bytes = index_offset + equal * sizeof(int);
+        char *storage = alloc.allocate(static_cast<std::ptrdiff_t>(bytes));
+        auto tie_out  = thrust::make_zip_iterator(thrust::make_tuple(
+          thrust::device_pointer_cast(reinterpret_cast<T *>(storage)),
+          thrust::device_pointer_cast(
+            reinterpret_cast<int *>(storage + index_offset))));
+        thrust::copy_if(
+          policy,
+          thrust::make_reverse_iterator(in_end),
+          thrust::make_reverse_iterator(in_begin),
+          tie_out,
+          detail::radix_key_compare<T>{selection.threshold, false});
+        thrust::copy(policy, tie_out, tie_out + ties, out + selection.greater);
+        alloc.deallocate(storage, bytes);
+    }
+
+    thrust::sort(policy, out, out + k, detail::topk_order<T>{});
+}
+
+// Row-wise top-k of a row-major rows x cols matrix: row r's winners go to
+// out_values/out_indices[r * k, (r + 1) * k) in topk() order, with column
+// positions offset by index_base. Up to topk_rank_sort_limit winners per row
+// are ordered inside the selection kernel; larger k take one extra sort.
+template <typename Iterator, typename TempAllocator = cuda_temp_allocator>
+void topk_rows(Iterator first,
+               int rows,
+               int cols,
+               int k,
+               typename std::iterator_traits<Iterator>::value_type *out_values,
+               int *out_indices,
+               int index_base      = 0,
+               TempAllocator alloc = {},
+               cudaStream_t stream = nullptr) {
+    using T = typename std::iterator_traits<Iterator>::value_type;
+    static_assert(std::is_arithmetic_v<T>, "topk: requires arithmetic values");
+    if (k < 0 || k > cols) {
+        throw std::invalid_argument("topk: k must be between 0 and cols");
+    }
+    if (k == 0 || rows == 0) { return; }
+
+    auto const count        = static_cast<std::size_t>(rows) * k;
+    auto const index_offset = detail::aligned_offset<int>(count * sizeof(T));
+    auto const bytes        = index_offset + count * sizeof(int);
+    char *storage = alloc.allocate(static_cast<std::ptrdiff_t>(bytes));
+    auto *values  = reinterpret_cast<T *>(storage);
+    auto *indices = reinterpret_cast<int *>(storage + index_offset);
+
+    constexpr int threads = 256;
+    detail::topk_rows_kernel<threads><<<rows, threads, 0, stream>>>(
+      first, cols, k, index_base, values, indices, out_values, out_indices);
+    detail::throw_on_launch_error("topk_rows");
+
+    if (k > detail::topk_rank_sort_limit) {
+        auto const perm_bytes = count * sizeof(long long);
+        char *perm_storage =
+          alloc.allocate(static_cast<std::ptrdiff_t>(perm_bytes));
+        auto perm = thrust::device_pointer_cast(
+          reinterpret_cast<long long *>(perm_storage));
+        auto policy = thrust::cuda::par_nosync(alloc).on(stream);
+        thrust::sequence(policy, perm, perm + count);
+        thrust::sort(policy,
+                     perm,
+                     perm + count,
+                     detail::topk_row_order<T>{values, indices, k});
+        auto winners = thrust::make_zip_iterator(
+          thrust::make_tuple(thrust::device_pointer_cast(values),
+                             thrust::device_pointer_cast(indices)));
+        thrust::gather(policy,
+                       perm,
+                       perm + count,
+                       winners,
+                       thrust::make_zip_iterator(thrust::make_tuple(
+                         thrust::device_pointer_cast(out_values),
+                         thrust::device_pointer_cast(out_indices))));
+        alloc.deallocate(perm_storage, perm_bytes);
+    }
+
+    alloc.deallocate(storage, bytes);
+}
+
+// ----------------------------------------------------------------------------
+// Row-wise softmax / log-sum-exp
+// ----------------------------------------------------------------------------
+// One block per row. A single pass keeps a running (max, sum of exp(x - max))
+// per thread, a block reduction merges them, and a second pass normalizes
+// the row. Rows that fit are cached in shared memory during the first pass,
+// so the input is read from global memory once.
+
+enum class row_normalize { softmax, log_softmax, logsumexp };
+
+namespace detail {
+
+// Rows up to this many bytes are cached in dynamic shared memory
+constexpr std::size_t normalize_cache_bytes = 32 * 1024;
+
+// Running softmax statistics; sum == 0 marks an empty state
+template <typename T>
+struct online_softmax_state {
+    T max;
+    T sum;
+};
+
+template <typename T>
+struct online_softmax_op {
+    __host__ __device__ auto operator()(const online_softmax_state<T> &a,
+                                        const online_softmax_state<T> &b) const
+      -> online_softmax_state<T> {
+        if (a.sum == T(0)) { return b; }
+        if (b.sum == T(0)) { return a; }
+        T const max = a.max < b.max ? b.max : a.max;
+        return {max,
+                a.sum * std::exp(a.max - max) + b.sum * std::exp(b.max - max)};
+    }
+};
+
+template <int BlockThreads,
+          row_normalize Mode,
+          typename Iterator,
+          typename OutputIterator>
+__global__ void normalize_rows_kernel(Iterator in,
+                                      int cols,
+                                      bool cache_row,
+                                      OutputIterator out) {
+    using T     = typename std::iterator_traits<OutputIterator>::value_type;
+    using state = online_softmax_state<T>;
+    using BlockReduce = cub::BlockReduce<state, BlockThreads>;
+    __shared__ typename BlockReduce::TempStorage reduce_storage;
+    __shared__ state row_state;
+    extern __shared__ __align__(16) unsigned char row_cache_storage[];
+    auto *row_cache = reinterpret_cast<T *>(row_cache_storage);
+
+    auto const row    = static_cast<long long>(blockIdx.x);
+    auto const row_in = in + row * cols;
+
+    // Online update: one exp per element
+    state acc{T(0), T(0)};
+    for (int c = threadIdx.x; c < cols; c += BlockThreads) {
+        T const x = static_cast<T>(row_in[c]);
+        if (cache_row) { row_cache[c] = x; }
+        if (acc.sum == T(0)) {
+            acc = {x, T(1)};
+        } else if (acc.max < x) {
+            acc.sum = acc.sum * std::exp(acc.max - x) + T(1);
+            acc.max = x;
+        } else {
+            acc.sum += std::exp(x - acc.max);
+        }
+    }
+
+    state const total = BlockReduce(reduce_storage)
+                          .Reduce(acc, online_softmax_op<T>{});
+    if (threadIdx.x == 0) { row_state = total; }
+    __syncthreads();
+
+    if constexpr (Mode == row_normalize::logsumexp) {
+        if (threadIdx.x == 0) {
+            out[row] = row_state.max + std::log(row_state.sum);
+        }
+    } else {
+        T const max     = row_state.max;
+        T const sum     = row_state.sum;
+        T const log_sum = std::log(sum);
+        for (int c = threadIdx.x; c < cols; c += BlockThreads) {
+            T const x = cache_row ? row_cache[c] : static_cast<T>(row_in[c]);
+            if constexpr (Mode == row_normalize::softmax) {
+                out[row * cols + c] = std::exp(x - max) / sum;
+            } else {
+                out[row * cols + c] = x - max - log_sum;
+            }
+        }
+    }
+}
+
+}  // namespace detail
+
+// Normalizes each row of a row-major rows x cols matrix. softmax and
+// log_softmax write rows * cols values; logsumexp writes one value per row.
+// Arithmetic happens in the output value type.
+template <row_normalize Mode, typename Iterator, typename OutputIterator>
+void normalize_rows(Iterator first,
+                    int rows,
+                    int cols,
+                    OutputIterator out,
+                    cudaStream_t stream = nullptr) {
+    using T = typename std::iterator_traits<OutputIterator>::value_type;
+    static_assert(std::is_floating_point_v<T>,
+                  "normalize_rows: output must be floating point");
+    if (rows == 0 || cols == 0) { return; }
+
+    auto const row_bytes  = static_cast<std::size_t>(cols) * sizeof(T);
+    bool const cache_row  = Mode != row_normalize::logsumexp &&
+                            row_bytes <= detail::normalize_cache_bytes;
+    auto const smem_bytes = cache_row ? row_bytes : 0;
+
+    constexpr int threads = 256;
+    detail::normalize_rows_kernel<threads, Mode>
+      <<<rows, threads, smem_bytes, stream>>>(first, cols, cache_row, out);
+    detail::throw_on_launch_error("normalize_rows");
+}
+
+// ----------------------------------------------------------------------------
+// Matrix products
+// ----------------------------------------------------------------------------
+// Row-major c[m x n] = a[m x k] * b[k x n] for the element types cuBLAS does
+// not take. gemm stages 16 x 16 tiles of a and b in shared memory; the n == 1
+// case (matrix-vector) gives each row of a to one warp instead, so a is read
+// coalesced and once. Products accumulate in the output value type.
+
+namespace detail {
+
+constexpr int gemm_tile  = 16;
+constexpr int gemv_warps = 8;
+
+template <typename T, typename U, typename Out>
+__global__ void gemm_tile_kernel(const T *a,
+                                 const U *b,
+                                 index_t m,
+                                 index_t n,
+                                 index_t k,
+                                 Out *c) {
+    __shared__ Out a_tile[gemm_tile][gemm_tile];
+    __shared__ Out b_tile[gemm_tile][gemm_tile + 1];
+
+    auto const ty  = static_cast<index_t>(threadIdx.y);
+    auto const tx  = static_cast<index_t>(threadIdx.x);
+    auto const row = static_cast<index_t>(blockIdx.y) * gemm_tile + ty;
+    auto const col = static_cast<index_t>(blockIdx.x) * gemm_tile + tx;
+
+    Out acc(0);
+    for (index_t t = 0; t < k; t += gemm_tile) {
+        a_tile[ty][tx] = row < m && t + tx < k
+                           ? static_cast<Out>(a[row * k + t + tx])
+                           : Out(0);
+        b_tile[ty][tx] = t + ty < k && col < n
+                           ? static_cast<Out>(b[(t + ty) * n + col])
+                           : Out(0);
+        __syncthreads();
+        for (int i = 0; i < gemm_tile; ++i) {
+            acc += a_tile[ty][i] * b_tile[i][tx];
+        }
+        __syncthreads();
+    }
+    if (row < m && col < n) { c[row * n + col] = acc; }
+}
+
+template <typename T, typename U, typename Out>
+__global__ void gemv_warp_kernel(const T *a,
+                                 const U *x,
+                                 index_t m,
+                                 index_t k,
+                                 Out *y) {
+    using WarpReduce = cub::WarpReduce<Out>;
+    __shared__ typename WarpReduce::TempStorage storage[gemv_warps];
+
+    auto const warp = static_cast<int>(threadIdx.x) / 32;
+    auto const lane = static_cast<index_t>(threadIdx.x) % 32;
+    auto const row  = static_cast<index_t>(blockIdx.x) * gemv_warps + warp;
+    if (row >= m) { return; }  // the whole warp leaves together
+
+    Out acc(0);
+    for (index_t c = lane; c < k; c += 32) {
+        acc += static_cast<Out>(a[row * k + c]) * static_cast<Out>(x[c]);
+    }
+    Out const total = WarpReduce(storage[warp]).Sum(acc);
+    if (lane == 0) { y[row] = total; }
+}
+
+}  // namespace detail
+
+// Writes the row-major product of a (m x k) and b (k x n) to c (m x n)
+template <typename T, typename U, typename Out>
+void gemm(const T *a,
+          const U *b,
+          index_t m,
+          index_t n,
+          index_t k,
+          Out *c,
+          cudaStream_t stream = nullptr) {
+    if (m == 0 || n == 0) { return; }
+    if (n == 1) {
+        auto const blocks = (m + detail::gemv_warps - 1) / detail::gemv_warps;
+        detail::gemv_warp_kernel<<<static_cast<unsigned>(blocks),
+                                   detail::gemv_warps * 32,
+                                   0,
+                                   stream>>>(a, b, m, k, c);
+        detail::throw_on_launch_error("gemv");
+        return;
+    }
+    dim3 const threads(detail::gemm_tile, detail::gemm_tile);
+    dim3 const blocks(
+      static_cast<unsigned>((n + detail::gemm_tile - 1) / detail::gemm_tile),
+      static_cast<unsigned>((m + detail::gemm_tile - 1) / detail::gemm_tile));
+    detail::gemm_tile_kernel<<<blocks, threads, 0, stream>>>(a, b, m, n, k, c);
+    detail::throw_on_launch_error("gemm");
+}
+
+// ----------------------------------------------------------------------------
+// Sliding windows (van Herk/Gil-Werman)
+// ----------------------------------------------------------------------------
+// The input is cut into blocks of w elements. The window starting at i is the
+// suffix of i's block from i combined with the prefix of the next block up to
+// i + w - 1, and both come from segmented scans, so any associative op costs
+// three applications per element whatever the window width. Tiles are scanned
+// in shared memory and read from global memory once, plus a w - 1 halo;
+// windows too wide for a tile use segmented scans in global memory instead.
+
+namespace detail {
+
+// Element of a segmented scan; head marks the first element of a segment
+template <typename T>
+struct segmented_value {
+    T value;
+    bool head;
+};
+
+// Segmented scan operator. A reverse scan runs from the end of the input,
+// so its accumulator holds later elements and goes on the right of op.
+template <typename T, typename BinaryOp, bool Reverse>
+struct segmented_scan_op {
+    BinaryOp op;
+
+    __host__ __device__ auto operator()(const segmented_value<T> &a,
+                                        const segmented_value<T> &b) const
+      -> segmented_value<T> {
+        if (b.head) { return b; }
+        if constexpr (Reverse) {
+            return {static_cast<T>(op(b.value, a.value)), a.head};
+        } else {
+            return {static_cast<T>(op(a.value, b.value)), a.head};
+        }
+    }
+};
+
+// Converts elements to the scan's value type
+template <typename T>
+struct convert_to {
+    template <typename U>
+    __host__ __device__ auto operator()(const U &u) const -> T {
+        return static_cast<T>(u);
+    }
+};
+
+// Binary operator with its operands swapped, for scans over reverse iterators
+template <typename BinaryOp>
+struct swapped_op {
+    BinaryOp op;
+
+    template <typename T>
+    __host__ __device__ auto operator()(const T &a, const T &b) const {
+        return op(b, a);
+    }
+};
+
+// Elements of the windows staged per tile, and the widest window a tile takes
+template <typename T>
+constexpr int rolling_items = sizeof(T) <= 4 ? 8 : 4;
+constexpr int rolling_threads = 256;
+
+template <typename T>
+constexpr int rolling_max_tile_width = rolling_threads * rolling_items<T> / 2;
+
+// Position of the window starting at flat index g in a row-major output with
+// cols - w + 1 columns, or -1 when the window crosses a row boundary
+__host__ __device__ inline auto rolling_slot(index_t g,
+                                             index_t cols,
+                                             index_t w) -> index_t {
+    index_t const row = g / cols;
+    index_t const col = g - row * cols;
+    return col > cols - w ? index_t(-1) : row * (cols - w + 1) + col;
+}
+
+// One block per tile of tile - w + 1 windows. The tile is staged in shared
+// memory, scanned forward (prefixes) and backward (suffixes) by segments of
+// w elements aligned to the tile start, and every window combines the two.
+template <int BlockThreads,
+          int Items,
+          typename T,
+          typename Iterator,
+          typename BinaryOp,
+          typename OutputIterator>
+__global__ void rolling_tile_kernel(Iterator in,
+                                    index_t n,
+                                    index_t cols,
+                                    int w,
+                                    BinaryOp op,
+                                    OutputIterator out) {
+    constexpr int tile = BlockThreads * Items;
+    using value        = segmented_value<T>;
+    using BlockScan    = cub::BlockScan<value, BlockThreads>;
+    __shared__ typename BlockScan::TempStorage scan_storage;
+    __shared__ __align__(16) unsigned char storage[2 * tile * sizeof(T)];
+    auto *prefix = reinterpret_cast<T *>(storage);
+    auto *suffix = prefix + tile;
+
+    int const step      = tile - w + 1;
+    index_t const first = static_cast<index_t>(blockIdx.x) * step;
+
+    // Coalesced staging; positions past the end repeat the last element and
+    // only feed windows that are never written
+    for (int i = threadIdx.x; i < tile; i += BlockThreads) {
+        index_t const g = first + i;
+        suffix[i]       = static_cast<T>(in[g < n ? g : n - 1]);
+    }
+    __syncthreads();
+
+    value forward[Items];
+    value backward[Items];
+    for (int k = 0; k < Items; ++k) {
+        int const i = threadIdx.x * Items + k;
+        int const j = tile - 1 - i;
+        forward[k]  = {suffix[i], i % w == 0};
+        backward[k] = {suffix[j], j % w == w - 1 || j == tile - 1};
+    }
+    __syncthreads();
+
+    using forward_op  = segmented_scan_op<T, BinaryOp, false>;
+    using backward_op = segmented_scan_op<T, BinaryOp, true>;
+    BlockScan(scan_storage).InclusiveScan(forward, forward, forward_op{op});
+    __syncthreads();
+    BlockScan(scan_storage).InclusiveScan(backward, backward, backward_op{op});
+    for (int k = 0; k < Items; ++k) {
+        int const i          = threadIdx.x * Items + k;
+        prefix[i]            = forward[k].value;
+        suffix[tile - 1 - i] = backward[k].value;
+    }
+    __syncthreads();
+
+    for (int i = threadIdx.x; i < step; i += BlockThreads) {
+        index_t const g = first + i;
+        if (g > n - w) { break; }
+        index_t const slot = rolling_slot(g, cols, w);
+        if (slot < 0) { continue; }
+        out[slot] = i % w == 0
+                      ? suffix[i]
+                      : static_cast<T>(op(suffix[i], prefix[i + w - 1]));
+    }
+}
+
+// Combines global prefix and suffix scans into the window starting at g
+template <typename T, typename BinaryOp, typename OutputIterator>
+struct rolling_combine_functor {
+    const T *prefix;
+    const T *suffix;
+    index_t cols;
+    index_t w;
+    BinaryOp op;
+    OutputIterator out;
+
+    __host__ __device__ void operator()(index_t g) const {
+        index_t const slot = rolling_slot(g, cols, w);
+        if (slot < 0) { return; }
+        out[slot] = g % w == 0
+                      ? suffix[g]
+                      : static_cast<T>(op(suffix[g], prefix[g + w - 1]));
+    }
+};
+
+}  // namespace detail
+
+// Applies op over every window of w consecutive elements that lies inside one
+// row of a row-major matrix with cols columns; pass cols == n for a 1D input.
+// Row r's windows go to out[r * (cols - w + 1), (r + 1) * (cols - w + 1)).
+// op must be associative; arithmetic happens in the output value type.
+template <typename Iterator,
+          typename OutputIterator,
+          typename BinaryOp,
+          typename TempAllocator = cuda_temp_allocator>
+void rolling(Iterator first,
+             index_t n,
+             index_t cols,
+             index_t w,
+             OutputIterator out,
+             BinaryOp op,
+             TempAllocator alloc = {},
+             cudaStream_t stream = nullptr) {
+    using T = typename std::iterator_traits<OutputIterator>::value_type;
+    if (w <= 0 || cols <= 0 || w > cols || n % cols != 0) {
+        throw std::invalid_argument("rolling: invalid window or shape");
+    }
+    if (n == 0) { return; }
+
+    constexpr int threads = detail::rolling_threads;
+    constexpr int items   = detail::rolling_items<T>;
+    if constexpr (sizeof(T) <= 8 && std::is_trivially_copyable_v<T>) {
+        if (w <= detail::rolling_max_tile_width<T>) {
+            index_t const windows = n - w + 1;
+            index_t const step    = threads * items - w + 1;
+            auto const blocks     = (windows + step - 1) / step;
+            detail::rolling_tile_kernel<threads, items, T>
+              <<<static_cast<unsigned>(blocks), threads, 0, stream>>>(
+                first, n, cols, static_cast<int>(w), op, out);
+            detail::throw_on_launch_error("rolling");
+            return;
+        }
+    }
+
+    // Wide windows: block-segmented scans over the whole input
+    auto const bytes = static_cast<std::size_t>(n) * sizeof(T);
+    char *storage    = alloc.allocate(static_cast<std::ptrdiff_t>(2 * bytes));
+    T *prefix        = reinterpret_cast<T *>(storage);
+    T *suffix        = reinterpret_cast<T *>(storage + bytes);
+
+    auto policy = thrust::cuda::par_nosync(alloc).on(stream);
+    auto keys   = thrust::make_transform_iterator(
+      thrust::make_counting_iterator<index_t>(0), thrust::placeholders::_1 / w);
+    auto values = thrust::make_transform_iterator(first,
+                                                  detail::convert_to<T>{});
+    thrust::inclusive_scan_by_key(policy,
+                                  keys,
+                                  keys + n,
+                                  values,
+                                  thrust::device_pointer_cast(prefix),
+                                  thrust::equal_to<index_t>{},
+                                  op);
+    thrust::inclusive_scan_by_key(
+      policy,
+      thrust::make_reverse_iterator(keys + n),
+      thrust::make_reverse_iterator(keys),
+      thrust::make_reverse_iterator(values + n),
+      thrust::make_reverse_iterator(thrust::device_pointer_cast(suffix + n)),
+      thrust::equal_to<index_t>{},
+      detail::swapped_op<BinaryOp>{op});
+    using combine = detail::
+      rolling_combine_functor<T, BinaryOp, OutputIterator>;
+    thrust::for_each_n(policy,
+                       thrust::make_counting_iterator<index_t>(0),
+                       n - w + 1,
+                       combine{prefix, suffix, cols, w, op, out});
+
+    alloc.deallocate(storage, 2 * bytes);
+}
+
+// ----------------------------------------------------------------------------
+// Radix sorts
+// ----------------------------------------------------------------------------
+
+namespace detail {
+
+// Runs a CUB device algorithm twice: once to size its temporary storage and
+// once with storage from alloc
+template <typename TempAllocator, typename Algorithm>
+void with_temp_storage(TempAllocator &alloc, Algorithm algorithm) {
+    void *d_temp_storage      = nullptr;
+    size_t temp_storage_bytes = 0;
+    algorithm(d_temp_storage, temp_storage_bytes);
+
+    temp_storage_bytes = std::max<size_t>(temp_storage_bytes, 1);
+    d_temp_storage     = alloc.allocate(temp_storage_bytes);
+    algorithm(d_temp_storage, temp_storage_bytes);
+    count_launch();
+
+    alloc.deallocate(static_cast<char *>(d_temp_storage), temp_storage_bytes);
+}
+
+// Start offset of row i in a row-major matrix
+struct row_offset_functor {
+    int cols;
+    __host__ __device__ auto operator()(int row) const -> int {
+        return row * cols;
+    }
+};
+
+}  // namespace detail
+
+// Sorts n keys with CUB's radix sort (stable)
+template <typename Key, typename TempAllocator = cuda_temp_allocator>
+void radix_sort_keys(const Key *keys_in,
+                     Key *keys_out,
+                     int n,
+                     bool descending     = false,
+                     TempAllocator alloc = {},
+                     cudaStream_t stream = nullptr) {
+    if (n == 0) { return; }
+    detail::with_temp_storage(alloc, [&](void *temp, size_t &bytes) {
+        if (descending) {
+            cub::DeviceRadixSort::SortKeysDescending(
+              temp, bytes, keys_in, keys_out, n, 0, sizeof(Key) * 8, stream);
+        } else {
+            cub::DeviceRadixSort::SortKeys(
+              temp, bytes, keys_in, keys_out, n, 0, sizeof(Key) * 8, stream);
+        }
+    });
+}
+
+// Sorts n (key, value) pairs by key with CUB's radix sort (stable)
+template <typename Key,
+          typename Value,
+          typename TempAllocator = cuda_temp_allocator>
+void radix_sort_pairs(const Key *keys_in,
+                      Key *keys_out,
+                      const Value *values_in,
+                      Value *values_out,
+                      int n,
+                      bool descending     = false,
+                      TempAllocator alloc = {},
+                      cudaStream_t stream = nullptr) {
+    if (n == 0) { return; }
+    detail::with_temp_storage(alloc, [&](void *temp, size_t &bytes) {
+        if (descending) {
+            cub::DeviceRadixSort::SortPairsDescending(temp,
+                                                      bytes,
+                                                      keys_in,
+                                                      keys_out,
+                                                      values_in,
+                                                      values_out,
+                                                      n,
+                                                      0,
+                                                      sizeof(Key) * 8,
+                                                      stream);
+        } else {
+            cub::DeviceRadixSort::SortPairs(temp,
+                                            bytes,
+                                            keys_in,
+                                            keys_out,
+                                            values_in,
+                                            values_out,
+                                            n,
+                                            0,
+                                            sizeof(Key) * 8,
+                                            stream);
+        }
+    });
+}
+
+// Sorts each segment [offsets[s], offsets[s + 1]) of n keys independently
+// with CUB's segmented sort
+template <typename Key,
+          typename OffsetIterator,
+          typename TempAllocator = cuda_temp_allocator>
+void segmented_sort(const Key *keys_in,
+                    Key *keys_out,
+                    index_t n,
+                    index_t segments,
+                    OffsetIterator offsets,
+                    bool descending     = false,
+                    TempAllocator alloc = {},
+                    cudaStream_t stream = nullptr) {
+    if (n == 0 || segments == 0) { return; }
+    detail::with_temp_storage(alloc, [&](void *temp, size_t &bytes) {
+        if (descending) {
+            cub::DeviceSegmentedSort::SortKeysDescending(temp,
+                                                         bytes,
+                                                         keys_in,
+                                                         keys_out,
+                                                         n,
+                                                         segments,
+                                                         offsets,
+                                                         offsets + 1,
+                                                         stream);
+        } else {
+            cub::DeviceSegmentedSort::SortKeys(temp,
+                                               bytes,
+                                               keys_in,
+                                               keys_out,
+                                               n,
+                                               segments,
+                                               offsets,
+                                               offsets + 1,
+                                               stream);
+        }
+    });
+}
+
+// Sorts every row of a row-major rows x cols matrix independently with
+// CUB's segmented sort
+template <typename Key, typename TempAllocator = cuda_temp_allocator>
+void segmented_sort_rows(const Key *keys_in,
+                         Key *keys_out,
+                         int rows,
+                         int cols,
+                         bool descending     = false,
+                         TempAllocator alloc = {},
+                         cudaStream_t stream = nullptr) {
+    if (rows == 0 || cols == 0) { return; }
+    auto offsets = thrust::make_transform_iterator(
+      thrust::make_counting_iterator(0), detail::row_offset_functor{cols});
+    segmented_sort(
+      keys_in, keys_out, rows * cols, rows, offsets, descending, alloc, stream);
+}
+
+// Reduces each segment [offsets[s], offsets[s + 1]) of first into out[s]
+// with CUB's segmented reduce; empty segments produce init. This is
+// reduce_by_n for segments of arbitrary length.
+template <typename InputIterator,
+          typename OffsetIterator,
+          typename OutputIterator,
+          typename BinaryOp,
+          typename T,
+          typename TempAllocator = cuda_temp_allocator>
+void reduce_segments(InputIterator first,
+                     index_t segments,
+                     OffsetIterator offsets,
+                     OutputIterator out,
+                     BinaryOp op,
+                     T init,
+                     TempAllocator alloc = {},
+                     cudaStream_t stream = nullptr) {
+    if (segments == 0) { return; }
+    detail::with_temp_storage(alloc, [&](void *temp, size_t &bytes) {
+        cub::DeviceSegmentedReduce::Reduce(temp,
+                                           bytes,
+                                           first,
+                                           out,
+                                           segments,
+                                           offsets,
+                                           offsets + 1,
+                                           op,
+                                           init,
+                                           stream);
+    });
+}
+
+// ----------------------------------------------------------------------------
+// Hash-based counting and grouping (open addressing)
+// ----------------------------------------------------------------------------
+// Keys are stored by bit pattern in a power-of-two table with linear probing.
+// The all-ones pattern marks an empty slot; occurrences of that key value are
+// counted in an extra slot. estimate_cardinality() sizes the table, and
+// prefer_hash() decides between hashing and sorting.
+
+// Key types the hash engine accepts: 32- and 64-bit integers
+template <typename T>
+inline constexpr bool is_hash_key_v = std::is_integral_v<T> &&
+                                      (sizeof(T) == 4 || sizeof(T) == 8);
+
+namespace detail {
+
+template <typename T>
+using hash_word_t =
+  std::conditional_t<sizeof(T) == 4, unsigned int, unsigned long long>;
+
+template <typename Word>
+inline constexpr Word empty_slot = ~Word(0);
+
+// Bits of the linear counting bitmap used for cardinality estimates
+constexpr int cardinality_bits = 1 << 20;
+
+// splitmix64 finalizer
+__host__ __device__ inline auto mix_hash(unsigned long long x)
+  -> unsigned long long {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+template <typename T>
+__host__ __device__ auto to_hash_word(T value) -> hash_word_t<T> {
+    return ::cuda::std::bit_cast<hash_word_t<T>>(value);
+}
+
+struct popcount_functor {
+    __host__ __device__ auto operator()(unsigned int word) const -> int {
+#ifdef __CUDA_ARCH__
+        return __popc(word);
+#else
+        return __builtin_popcount(word);
+#endif
+    }
+};
+
+template <typename Iterator>
+__global__ void linear_counting_kernel(Iterator in,
+                                       int n,
+                                       unsigned int *bitmap) {
+    using T = typename std::iterator_traits<Iterator>::value_type;
+    for (int idx = blockIdx.x * blockDim.x + threadIdx.x; idx < n;
+         idx += gridDim.x * blockDim.x) {
+        auto const bit = static_cast<unsigned int>(
+          mix_hash(to_hash_word(static_cast<T>(in[idx]))) &
+          (cardinality_bits - 1));
+        atomicOr(&bitmap[bit >> 5], 1U << (bit & 31));
+    }
+}
+
+// Inserts every key and counts it in its slot. Keys equal to the empty
+// pattern use the extra slot at index capacity (counts has capacity + 1
+// entries). If element_slots is set, it receives each element's slot.
+template <typename Iterator, typename Word>
+__global__ void hash_insert_kernel(Iterator in,
+                                   int n,
+                                   Word *slots,
+                                   int *counts,
+                                   int capacity,
+                                   int *overflow,
+                                   int *element_slots) {
+    using T = typename std::iterator_traits<Iterator>::value_type;
+    for (int idx = blockIdx.x * blockDim.x + threadIdx.x; idx < n;
+         idx += gridDim.x * blockDim.x) {
+        Word const key = to_hash_word(static_cast<T>(in[idx]));
+        int slot       = capacity;
+        if (key != empty_slot<Word>) {
+            slot = static_cast<int>(mix_hash(key) & (capacity - 1));
+            for (int probe = 0;; ++probe) {
+                if (probe == capacity) {
+                    *overflow = 1;
+                    return;
+                }
+                Word const prev = atomicCAS(
+                  &slots[slot], empty_slot<Word>, key);
+                if (prev == empty_slot<Word> || prev == key) { break; }
+                slot = (slot + 1) & (capacity - 1);
+            }
+        }
+        atomicAdd(&counts[slot], 1);
+        if (element_slots != nullptr) { element_slots[idx] = slot; }
+    }
+}
+
+inline auto grid_for(int n, int threads) -> int {
+    return std::clamp(
+      (n + threads - 1) / threads, 1, multiprocessor_count() * 8);
+}
+
+// Device memory of a filled hash table; release with alloc.deallocate
+template <typename Word>
+struct hash_table {
+    char *storage;
+    std::size_t bytes;
+    Word *slots;
+    int *counts;  // capacity + 1 entries
+    int capacity;
+};
+
+// Builds the table for [first, first + n), sized from expected_distinct and
+// rebuilt at full size if that estimate was too small
+template <typename Iterator, typename TempAllocator>
+auto build_hash_table(Iterator first,
+                      int n,
+                      double expected_distinct,
+                      int *element_slots,
+                      TempAllocator &alloc,
+                      cudaStream_t stream) {
+    using T    = typename std::iterator_traits<Iterator>::value_type;
+    using Word = hash_word_t<T>;
+
+    auto table_size = [](double keys) {
+        int capacity = 1024;
+        while (capacity < 2.0 * keys && capacity < (1 << 30)) {
+            capacity *= 2;
+        }
+        return capacity;
+    };
+    int capacity = table_size(std::min<double>(n, expected_distinct * 1.25));
+
+    for (;;) {
+        // Slots, counts (with the empty-key slot), then the overflow flag
+        auto const bytes = static_cast<std::size_t>(capacity) *
+                             (sizeof(Word) + sizeof(int)) +
+                           2 * sizeof(int);
+        char *storage = alloc.allocate(static_cast<std::ptrdiff_t>(bytes));
+        auto *slots   = reinterpret_cast<Word *>(storage);
+        auto *counts  = reinterpret_cast<int *>(storage +
+                                               capacity * sizeof(Word));
+        int *overflow = counts + capacity + 1;
+
+        cudaMemsetAsync(slots, 0xFF, capacity * sizeof(Word), stream);
+        cudaMemsetAsync(counts, 0, (capacity + 2) * sizeof(int), stream);
+        int const threads = 256;
+        hash_insert_kernel<<<grid_for(n, threads), threads, 0, stream>>>(
+          first, n, slots, counts, capacity, overflow, element_slots);
+        throw_on_launch_error("hash table");
+
+        int host_overflow = 0;
+        cudaMemcpyAsync(&host_overflow,
+                        overflow,
+                        sizeof(int),
+                        cudaMemcpyDeviceToHost,
+                        stream);
+        cudaStreamSynchronize(stream);
+        count_d2h(sizeof(int));
+        count_sync();
+        if (host_overflow == 0) {
+            return hash_table<Word>{storage, bytes, slots, counts, capacity};
+        }
+
+        // Too many distinct keys for the estimate; size for all of them
+        alloc.deallocate(storage, bytes);
+        capacity = table_size(n);
+    }
+}
+
+// Whether slot i of a table holds a key
+template <typename Word>
+struct occupied_slot {
+    const Word *slots;
+    const int *counts;
+    int capacity;
+
+    __host__ __device__ auto operator()(int i) const -> bool {
+        return i < capacity ? slots[i] != empty_slot<Word>
+                            : counts[capacity] != 0;
+    }
+};
+
+// Key stored in slot i of a table
+template <typename T>
+struct slot_key {
+    const hash_word_t<T> *slots;
+    int capacity;
+
+    __host__ __device__ auto operator()(int i) const -> T {
+        return ::cuda::std::bit_cast<T>(
+          i < capacity ? slots[i] : empty_slot<hash_word_t<T>>);
+    }
+};
+
+// Looks up table[i]
+struct lookup_functor {
+    const int *table;
+    __host__ __device__ auto operator()(int i) const -> int {
+        return table[i];
+    }
+};
+
+template <typename Index>
+__global__ void group_permutation_kernel(const Index *groups,
+                                         int n,
+                                         Index *cursors,
+                                         Index *perm) {
+    for (int idx = blockIdx.x * blockDim.x + threadIdx.x; idx < n;
+         idx += gridDim.x * blockDim.x) {
+        perm[atomicAdd(&cursors[groups[idx]], 1)] = idx;
+    }
+}
+
+}  // namespace detail
+
+// Estimates the number of distinct values in [first, first + n) by linear
+// counting; one pass over the input and one host synchronization
+template <typename Iterator, typename TempAllocator = cuda_temp_allocator>
+auto estimate_cardinality(Iterator first,
+                          int n,
+                          TempAllocator alloc = {},
+                          cudaStream_t stream = nullptr) -> double {
+    if (n == 0) { return 0.0; }
+    constexpr int words         = detail::cardinality_bits / 32;
+    constexpr std::size_t bytes = words * sizeof(unsigned int);
+    auto *bitmap = reinterpret_cast<unsigned int *>(alloc.allocate(bytes));
+
+    cudaMemsetAsync(bitmap, 0, bytes, stream);
+    int const threads = 256;
+    detail::linear_counting_kernel<<<detail::grid_for(n, threads),
+                                     threads,
+                                     0,
+                                     stream>>>(first, n, bitmap);
+    detail::throw_on_launch_error("estimate_cardinality");
+
+    auto policy    = thrust::cuda::par(alloc).on(stream);
+    auto const set = thrust::transform_reduce(policy,
+                                              bitmap,
+                                              bitmap + words,
+                                              detail::popcount_functor{},
+                                              0,
+                                              thrust::plus<int>());
+    alloc.deallocate(reinterpret_cast<char *>(bitmap), bytes);
+
+    double const m     = detail::cardinality_bits;
+    double const zeros = m - set;
+    if (zeros == 0) { return n; }
+    return std::min<double>(n, -m * std::log(zeros / m));
+}
+
+// Whether counting distinct values by hashing should beat sorting: the hash
+// table is expected to stay in L2, or the input is heavily duplicated
+inline auto prefer_hash(double distinct, int n, std::size_t slot_bytes)
+  -> bool {
+    int device   = 0;
+    int l2_bytes = 0;
+    cudaGetDevice(&device);
+    cudaDeviceGetAttribute(&l2_bytes, cudaDevAttrL2CacheSize, device);
+    double const table_bytes = 2.0 * distinct * slot_bytes;
+    return table_bytes <= l2_bytes || distinct * 16 <= n;
+}
+
+// Counts the occurrences of every distinct value of [first, first + n).
+// Writes the distinct values to out_keys and their counts to out_counts (in
+// no particular order) and returns how many there are; both outputs need
+// room for n entries. expected_distinct only sizes the table: if it is too
+// small the count is retried with a table large enough for n keys.
+template <typename Iterator, typename TempAllocator = cuda_temp_allocator>
+auto hash_count(Iterator first,
+                int n,
+                double expected_distinct,
+                typename std::iterator_traits<Iterator>::value_type *out_keys,
+                int *out_counts,
+                TempAllocator alloc = {},
+                cudaStream_t stream = nullptr) -> int {
+    using T    = typename std::iterator_traits<Iterator>::value_type;
+    using Word = detail::hash_word_t<T>;
+    static_assert(is_hash_key_v<T>, "hash_count: requires 32/64-bit integers");
+    if (n == 0) { return 0; }
+
+    auto table = detail::build_hash_table(
+      first, n, expected_distinct, nullptr, alloc, stream);
+    auto policy = thrust::cuda::par(alloc).on(stream);
+
+    auto slot_index = thrust::make_counting_iterator(0);
+    auto in         = thrust::make_zip_iterator(thrust::make_tuple(
+      thrust::make_transform_iterator(
+        slot_index, detail::slot_key<T>{table.slots, table.capacity}),
+      thrust::device_pointer_cast(table.counts)));
+    auto out = thrust::make_zip_iterator(
+      thrust::make_tuple(thrust::device_pointer_cast(out_keys),
+                         thrust::device_pointer_cast(out_counts)));
+    auto const end = thrust::copy_if(
+      policy,
+      in,
+      in + table.capacity + 1,
+      slot_index,
+      out,
+      detail::occupied_slot<Word>{table.slots, table.counts, table.capacity});
+
+    alloc.deallocate(table.storage, table.bytes);
+    return static_cast<int>(end - out);
+}
+
+// Numbers the distinct keys of [first, first + n) 0, 1, ... in ascending
+// key order. Writes each element's group to out_groups (n entries), the
+// distinct keys to out_keys and the group sizes to out_counts (room for n
+// entries each) and returns the number of groups.
+template <typename Iterator, typename TempAllocator = cuda_temp_allocator>
+auto hash_group_ids(
+  Iterator first,
+  int n,
+  double expected_distinct,
+  int *out_groups,
+  typename std::iterator_traits<Iterator>::value_type *out_keys,
+  int *out_counts,
+  TempAllocator alloc = {},
+  cudaStream_t stream = nullptr) -> int {
+    using T    = typename std::iterator_traits<Iterator>::value_type;
+    using Word = detail::hash_word_t<T>;
+    static_assert(is_hash_key_v<T>,
+                  "hash_group_ids: requires 32/64-bit integers");
+    if (n == 0) { return 0; }
+
+    // out_groups first holds each element's slot
+    auto table = detail::build_hash_table(
+      first, n, expected_distinct, out_groups, alloc, stream);
+    auto policy = thrust::cuda::par(alloc).on(stream);
+
+    auto const slot_bytes = static_cast<std::size_t>(table.capacity + 1) *
+                            sizeof(int);
+    auto *group_slots = reinterpret_cast<int *>(alloc.allocate(slot_bytes));
+    auto slots_begin  = thrust::device_pointer_cast(group_slots);
+    auto const slots_end = thrust::copy_if(
+      policy,
+      thrust::make_counting_iterator(0),
+      thrust::make_counting_iterator(table.capacity + 1),
+      slots_begin,
+      detail::occupied_slot<Word>{table.slots, table.counts, table.capacity});
+    auto const groups = static_cast<int>(slots_end - slots_begin);
+
+    // Order the groups by key; only the distinct keys are sorted
+    auto keys_begin = thrust::device_pointer_cast(out_keys);
+    thrust::transform(policy,
+                      slots_begin,
+                      slots_end,
+                      keys_begin,
+                      detail::slot_key<T>{table.slots, table.capacity});
+    thrust::sort_by_key(policy, keys_begin, keys_begin + groups, slots_begin);
+    auto counts_begin = thrust::device_pointer_cast(table.counts);
+    thrust::gather(policy,
+                   slots_begin,
+                   slots_end,
+                   counts_begin,
+                   thrust::device_pointer_cast(out_counts));
+
+    // Reuse the slot counts as a slot -> group map, then relabel elements
+    thrust::scatter(policy,
+                    thrust::make_counting_iterator(0),
+                    thrust::make_counting_iterator(groups),
+                    slots_begin,
+                    counts_begin);
+    auto elements = thrust::device_pointer_cast(out_groups);
+    thrust::transform(policy,
+                      elements,
+                      elements + n,
+                      elements,
+                      detail::lookup_functor{table.counts});
+
+    alloc.deallocate(reinterpret_cast<char *>(group_slots), slot_bytes);
+    alloc.deallocate(table.storage, table.bytes);
+    return groups;
+}
+
+// Writes the positions 0 .. n - 1 to out_perm grouped by group id: the
+// positions of group g land in out_perm[offsets[g], offsets[g + 1]), in
+// unspecified order (a counting sort without the comparison sort)
+template <typename TempAllocator = cuda_temp_allocator>
+void group_permutation(const int *groups,
+                       int n,
+                       const int *offsets,
+                       int num_groups,
+                       int *out_perm,
+                       TempAllocator alloc = {},
+                       cudaStream_t stream = nullptr) {
+    if (n == 0) { return; }
+    auto const bytes = static_cast<std::size_t>(num_groups) * sizeof(int);
+    auto *cursors    = reinterpret_cast<int *>(alloc.allocate(bytes));
+    cudaMemcpyAsync(
+      cursors, offsets, bytes, cudaMemcpyDeviceToDevice, stream);
+
+    int const threads = 256;
+    detail::group_permutation_kernel<int>
+      <<<detail::grid_for(n, threads), threads, 0, stream>>>(
+        groups, n, cursors, out_perm);
+    detail::throw_on_launch_error("group_permutation");
+
+    alloc.deallocate(reinterpret_cast<char *>(cursors), bytes);
+}
+
+// Reduces the segments [offsets[s], offsets[s + 1]) of first into out[s]
+template <typename InputIterator,
+          typename OutputIterator,
+          typename BinaryOp,
+          typename T,
+          typename TempAllocator = cuda_temp_allocator>
+void segmented_reduce(InputIterator first,
+                      const int *offsets,
+                      int num_segments,
                       OutputIterator out,
-                      int N,
                       BinaryOp op,
-                      T init) {
-    if (N <= 0) {
-        throw std::invalid_argument("reduce_by_n: N must be positive");
+                      T init,
+                      TempAllocator alloc = {},
+                      cudaStream_t stream = nullptr) {
+    if (num_segments == 0) { return; }
+    detail::with_temp_storage(alloc, [&](void *temp, size_t &bytes) {
+        cub::DeviceSegmentedReduce::Reduce(temp,
+                                           bytes,
+                                           first,
+                                           out,
+                                           num_segments,
+                                           offsets,
+                                           offsets + 1,
+                                           op,
+                                           init,
+                                           stream);
+    });
+}
+
+// ----------------------------------------------------------------------------
+// Counter-based random numbers (Philox4x32-10)
+// ----------------------------------------------------------------------------
+// Element j of the stream for a seed is lane j % 4 of the Philox block for
+// counter j / 4, so any element can be computed on its own and a generator
+// that fills whole blocks produces the same values four at a time. An offset
+// skips ahead by that many elements.
+
+// Four 32-bit outputs of Philox4x32 with 10 rounds (Salmon et al., SC'11)
+__host__ __device__ inline auto philox4x32(std::uint64_t counter,
+                                           std::uint64_t seed) -> uint4 {
+    constexpr std::uint32_t m0 = 0xD2511F53U;
+    constexpr std::uint32_t m1 = 0xCD9E8D57U;
+    constexpr std::uint32_t w0 = 0x9E3779B9U;
+    constexpr std::uint32_t w1 = 0xBB67AE85U;
+
+    uint4 c = {static_cast<std::uint32_t>(counter),
+               static_cast<std::uint32_t>(counter >> 32),
+               0U,
+               0U};
+    auto k0 = static_cast<std::uint32_t>(seed);
+    auto k1 = static_cast<std::uint32_t>(seed >> 32);
+    for (int round = 0; round < 10; ++round) {
+        auto const p0 = static_cast<std::uint64_t>(m0) * c.x;
+        auto const p1 = static_cast<std::uint64_t>(m1) * c.z;
+        c = {static_cast<std::uint32_t>(p1 >> 32) ^ c.y ^ k0,
+             static_cast<std::uint32_t>(p1),
+             static_cast<std::uint32_t>(p0 >> 32) ^ c.w ^ k1,
+             static_cast<std::uint32_t>(p0)};
+        k0 += w0;
+        k1 += w1;
     }
+    return c;
+}
 
-    int total_size = std::distance(first, last);
-    if (total_size == 0) { return; }
+__host__ __device__ inline auto philox_lane(uint4 block, int lane)
+  -> std::uint32_t {
+    switch (lane) {
+        case 0: return block.x;
+        case 1: return block.y;
+        case 2: return block.z;
+        default: return block.w;
+    }
+}
 
-    int num_segments = total_size / N;
+// Maps 32 random bits to a float in [0, 1)
+__host__ __device__ inline auto bits_to_unit(std::uint32_t bits) -> float {
+    return static_cast<float>(bits >> 8) * (1.0F / 16777216.0F);
+}
 
-    if (total_size % N != 0) {
-        throw std::invalid_argument(
-          "reduce_by_n: N must be a divisor of std::distance(first, last)");
+// Uniform floats in [lo, hi)
+struct uniform_distribution {
+    float lo = 0.F;
+    float hi = 1.F;
+
+    __host__ __device__ auto operator()(uint4 block, int lane) const
+      -> float {
+        return lo + (hi - lo) * bits_to_unit(philox_lane(block, lane));
     }
+};
 
-    // Use raw CUDA memory for temp storage to avoid thrust overhead
-    void *d_temp_storage      = nullptr;
-    size_t temp_storage_bytes = 0;
+// Normal floats by Box-Muller on lane pairs (0, 1) and (2, 3)
+struct normal_distribution {
+    float mean   = 0.F;
+    float stddev = 1.F;
 
-    // Query temp storage size using CUB's fixed-size segmented reduce API
-    cub::DeviceSegmentedReduce::Reduce(d_temp_storage,
-                                       temp_storage_bytes,
-                                       first,
-                                       out,
-                                       num_segments,
-                                       N,  // segment_size
-                                       op,
-                                       init);
+    __host__ __device__ auto operator()(uint4 block, int lane) const
+      -> float {
+        int const first = lane & ~1;
+        // u1 in (0, 1] keeps the logarithm finite
+        float const u1 =
+          static_cast<float>((philox_lane(block, first) >> 8) + 1) *
+          (1.0F / 16777216.0F);
+        float const u2 = bits_to_unit(philox_lane(block, first + 1));
+        float const r  = sqrtf(-2.0F * logf(u1));
+        float const t  = 6.2831853071795865F * u2;
+        return mean + stddev * r * ((lane & 1) != 0 ? sinf(t) : cosf(t));
+    }
+};
 
-    // Raw CUDA allocation - no initialization kernel
-    cudaMalloc(&d_temp_storage, temp_storage_bytes);
+// Integers in [lo, hi] by multiply-shift (bias below 2^-32 * span)
+struct integer_distribution {
+    int lo             = 0;
+    std::uint64_t span = 1;
 
-    // Actual reduction using fixed-size segmented reduce
-    cub::DeviceSegmentedReduce::Reduce(d_temp_storage,
-                                       temp_storage_bytes,
-                                       first,
-                                       out,
-                                       num_segments,
-                                       N,  // segment_size
-                                       op,
-                                       init);
+    __host__ __device__ auto operator()(uint4 block, int lane) const -> int {
+        auto const bits = static_cast<std::uint64_t>(philox_lane(block, lane));
+        return static_cast<int>(lo + static_cast<std::int64_t>(
+                                       (bits * span) >> 32));
+    }
+};
+
+// Element j of the stream for seed, drawn from dist
+template <typename Distribution>
+struct philox_functor {
+    std::uint64_t seed;
+    std::uint64_t offset;
+    Distribution dist;
+
+    __host__ __device__ auto operator()(std::uint64_t i) const {
+        auto const j = offset + i;
+        return dist(philox4x32(j / 4, seed), static_cast<int>(j % 4));
+    }
+};
+
+namespace detail {
+
+// One Philox block per thread; its four outputs go to consecutive elements
+template <typename T, typename Distribution>
+__global__ void philox_fill_kernel(T *out,
+                                   std::uint64_t n,
+                                   std::uint64_t seed,
+                                   std::uint64_t offset,
+                                   std::uint64_t blocks,
+                                   Distribution dist) {
+    auto const first_block = offset / 4;
+    for (auto b = static_cast<std::uint64_t>(blockIdx.x) * blockDim.x +
+                  threadIdx.x;
+         b < blocks;
+         b += static_cast<std::uint64_t>(gridDim.x) * blockDim.x) {
+        uint4 const block = philox4x32(first_block + b, seed);
+        for (int lane = 0; lane < 4; ++lane) {
+            // Position of this lane relative to the first element written
+            auto const j = 4 * (first_block + b) + lane;
+            if (j >= offset && j - offset < n) {
+                out[j - offset] = static_cast<T>(dist(block, lane));
+            }
+        }
+    }
+}
+
+}  // namespace detail
+
+// Fills out[0, n) with elements offset .. offset + n - 1 of the stream for
+// seed; element i equals philox_functor{seed, offset, dist}(i)
+template <typename T, typename Distribution>
+void philox_fill(T *out,
+                 std::uint64_t n,
+                 std::uint64_t seed,
+                 std::uint64_t offset,
+                 Distribution dist,
+                 cudaStream_t stream = nullptr) {
+    if (n == 0) { return; }
+    auto const blocks = (offset + n + 3) / 4 - offset / 4;
+    int const threads = 256;
+    auto const grid   = std::min<std::uint64_t>(
+      (blocks + threads - 1) / threads, 65535);
+    detail::philox_fill_kernel<<<static_cast<unsigned int>(grid),
+                                 threads,
+                                 0,
+                                 stream>>>(
+      out, n, seed, offset, blocks, dist);
+    detail::throw_on_launch_error("philox_fill");
+}
+
+// ----------------------------------------------------------------------------
+// Vectorized evaluation
+// ----------------------------------------------------------------------------
+// A lazy expression is a nest of transform and zip iterators; evaluating it
+// with thrust::copy dereferences the whole nest once per element with scalar
+// loads. When every leaf is contiguous device memory of an arithmetic or
+// reduced-precision type, a counting or constant iterator, or a broadcast
+// device scalar, the nest is flattened into a tree of plain nodes and
+// evaluated by one grid-stride kernel in which each thread loads, transforms
+// and stores Vec consecutive elements with vector (up to 128-bit) accesses.
+// Functors with a pair() member transform __half and __nv_bfloat16 chunks
+// two elements per paired instruction; pair() must round exactly like the
+// scalar operator(), so results do not depend on where a chunk starts.
+
+namespace detail {
+
+// Vec consecutive elements, aligned so that copying the whole chunk compiles
+// to vector loads and stores of at most 16 bytes
+template <typename T, int Vec>
+struct alignas(sizeof(T) * Vec < 16 ? sizeof(T) * Vec : 16) vector_chunk {
+    T v[Vec];
+};
+
+template <typename T, int Vec>
+auto is_chunk_aligned(const T *ptr) -> bool {
+    return reinterpret_cast<std::uintptr_t>(ptr) %
+             alignof(vector_chunk<T, Vec>) ==
+           0;
+}
+
+// Leaf over contiguous device memory
+template <typename T>
+struct contiguous_node {
+    using value_type = T;
+    const T *data;
+
+    template <int Vec>
+    __device__ void load(std::int64_t i, value_type (&out)[Vec]) const {
+        auto const chunk = *reinterpret_cast<const vector_chunk<T, Vec> *>(
+          data + i);
+#pragma unroll
+        for (int k = 0; k < Vec; ++k) { out[k] = chunk.v[k]; }
+    }
+
+    __device__ auto load_one(std::int64_t i) const -> value_type {
+        return data[i];
+    }
+
+    template <int Vec>
+    [[nodiscard]] auto aligned() const -> bool {
+        return is_chunk_aligned<T, Vec>(data);
+    }
+};
+
+// Leaf of a counting iterator starting at first
+template <typename T>
+struct counting_node {
+    using value_type = T;
+    T first;
+
+    template <int Vec>
+    __device__ void load(std::int64_t i, value_type (&out)[Vec]) const {
+#pragma unroll
+        for (int k = 0; k < Vec; ++k) { out[k] = load_one(i + k); }
+    }
+
+    __device__ auto load_one(std::int64_t i) const -> value_type {
+        return static_cast<T>(first + static_cast<T>(i));
+    }
+
+    template <int Vec>
+    [[nodiscard]] auto aligned() const -> bool {
+        return true;
+    }
+};
+
+// Leaf that repeats one value, held on the host or in device memory
+template <typename T, bool OnDevice>
+struct broadcast_node {
+    using value_type = T;
+    std::conditional_t<OnDevice, const T *, T> value;
+
+    template <int Vec>
+    __device__ void load(std::int64_t i, value_type (&out)[Vec]) const {
+        auto const v = load_one(i);
+#pragma unroll
+        for (int k = 0; k < Vec; ++k) { out[k] = v; }
+    }
+
+    __device__ auto load_one(std::int64_t /*i*/) const -> value_type {
+        if constexpr (OnDevice) {
+            return *value;
+        } else {
+            return value;
+        }
+    }
+
+    template <int Vec>
+    [[nodiscard]] auto aligned() const -> bool {
+        return true;
+    }
+};
+
+// Element-wise functor applied in registers to the chunk of its operand
+template <typename F, typename Node, typename T>
+struct transform_node {
+    using value_type = T;
+    F f;
+    Node operand;
+
+    template <int Vec>
+    __device__ void load(std::int64_t i, value_type (&out)[Vec]) const {
+        using source_type = typename Node::value_type;
+        source_type in[Vec];
+        operand.template load<Vec>(i, in);
+        if constexpr (std::is_same_v<source_type, T> && Vec % 2 == 0 &&
+                      has_pair_op<F, T>::value) {
+            // Packed math: one paired intrinsic per two elements
+            using pair_ops = paired<T>;
+#pragma unroll
+            for (int k = 0; k < Vec; k += 2) {
+                auto const r = f.pair(pair_ops::pack(in[k], in[k + 1]));
+                out[k]       = pair_ops::low(r);
+                out[k + 1]   = pair_ops::high(r);
+            }
+        } else {
+#pragma unroll
+            for (int k = 0; k < Vec; ++k) { out[k] = f(in[k]); }
+        }
+    }
+
+    __device__ auto load_one(std::int64_t i) const -> value_type {
+        return f(operand.load_one(i));
+    }
+
+    template <int Vec>
+    [[nodiscard]] auto aligned() const -> bool {
+        return operand.template aligned<Vec>();
+    }
+};
+
+// Tuples assembled from the chunks of each zipped operand
+template <typename... Nodes>
+struct zip_node {
+    using value_type = thrust::tuple<typename Nodes::value_type...>;
+    thrust::tuple<Nodes...> operands;
+
+    template <int Vec>
+    __device__ void load(std::int64_t i, value_type (&out)[Vec]) const {
+        load_operands<Vec>(i, out, std::index_sequence_for<Nodes...>{});
+    }
+
+    __device__ auto load_one(std::int64_t i) const -> value_type {
+        return load_one(i, std::index_sequence_for<Nodes...>{});
+    }
+
+    template <int Vec>
+    [[nodiscard]] auto aligned() const -> bool {
+        return aligned<Vec>(std::index_sequence_for<Nodes...>{});
+    }
+
+   private:
+    template <int Vec, std::size_t I>
+    __device__ void load_operand(std::int64_t i,
+                                 value_type (&out)[Vec]) const {
+        using operand_type = std::decay_t<decltype(thrust::get<I>(operands))>;
+        typename operand_type::value_type in[Vec];
+        thrust::get<I>(operands).template load<Vec>(i, in);
+#pragma unroll
+        for (int k = 0; k < Vec; ++k) { thrust::get<I>(out[k]) = in[k]; }
+    }
+
+    template <int Vec, std::size_t... I>
+    __device__ void load_operands(std::int64_t i,
+                                  value_type (&out)[Vec],
+                                  std::index_sequence<I...> /*is*/) const {
+        (load_operand<Vec, I>(i, out), ...);
+    }
+
+    template <std::size_t... I>
+    __device__ auto load_one(std::int64_t i,
+                             std::index_sequence<I...> /*is*/) const
+      -> value_type {
+        return value_type(thrust::get<I>(operands).load_one(i)...);
+    }
+
+    template <int Vec, std::size_t... I>
+    [[nodiscard]] auto aligned(std::index_sequence<I...> /*is*/) const
+      -> bool {
+        return (thrust::get<I>(operands).template aligned<Vec>() && ...);
+    }
+};
+
+// Maps an iterator type to its node: value is false for iterators the kernel
+// cannot evaluate (permutations, reversals, user iterators, ...)
+template <typename Iterator, typename = void>
+struct vector_node : std::false_type {};
+
+template <typename T>
+inline constexpr bool is_vector_leaf_v =
+  std::is_arithmetic_v<std::remove_cv_t<T>> ||
+  is_reduced_precision_v<std::remove_cv_t<T>>;
+
+template <typename T>
+struct vector_node<thrust::device_ptr<T>,
+                   std::enable_if_t<is_vector_leaf_v<T>>> : std::true_type {
+    using type = contiguous_node<std::remove_cv_t<T>>;
+    static auto make(thrust::device_ptr<T> it) -> type {
+        return {thrust::raw_pointer_cast(it)};
+    }
+};
+
+template <typename T>
+struct vector_node<thrust::detail::normal_iterator<thrust::device_ptr<T>>,
+                   std::enable_if_t<is_vector_leaf_v<T>>> : std::true_type {
+    using type = contiguous_node<std::remove_cv_t<T>>;
+    static auto make(thrust::detail::normal_iterator<thrust::device_ptr<T>> it)
+      -> type {
+        return {thrust::raw_pointer_cast(it.base())};
+    }
+};
+
+template <typename T, typename... Params>
+struct vector_node<thrust::counting_iterator<T, Params...>,
+                   std::enable_if_t<is_vector_leaf_v<T>>> : std::true_type {
+    using type = counting_node<T>;
+    static auto make(thrust::counting_iterator<T, Params...> it) -> type {
+        return {*it};
+    }
+};
+
+template <typename T, typename... Params>
+struct vector_node<thrust::constant_iterator<T, Params...>,
+                   std::enable_if_t<is_vector_leaf_v<T>>> : std::true_type {
+    using type = broadcast_node<T, false>;
+    static auto make(thrust::constant_iterator<T, Params...> it) -> type {
+        return {*it};
+    }
+};
+
+template <typename Node>
+inline constexpr bool is_contiguous_node_v = false;
+
+template <typename T>
+inline constexpr bool is_contiguous_node_v<contiguous_node<T>> = true;
+
+// Every position of a permutation through a constant index reads the same
+// element (parrot's device-resident scalars)
+template <typename Elements, typename Index, typename... Params>
+struct vector_node<
+  thrust::permutation_iterator<Elements,
+                               thrust::constant_iterator<Index, Params...>>,
+  std::enable_if_t<
+    is_contiguous_node_v<typename vector_node<Elements>::type>>>
+  : std::true_type {
+    using value_type = typename vector_node<Elements>::type::value_type;
+    using type       = broadcast_node<value_type, true>;
+    static auto make(
+      thrust::permutation_iterator<Elements,
+                                   thrust::constant_iterator<Index, Params...>>
+        it) -> type {
+        return {thrust::raw_pointer_cast(&*it)};
+    }
+};
+
+template <typename F, typename Iterator, typename Reference, typename Value>
+struct vector_node<
+  thrust::transform_iterator<F, Iterator, Reference, Value>,
+  std::enable_if_t<vector_node<Iterator>::value>> : std::true_type {
+    using iterator =
+      thrust::transform_iterator<F, Iterator, Reference, Value>;
+    using value_type = std::remove_cv_t<std::remove_reference_t<
+      typename std::iterator_traits<iterator>::value_type>>;
+    using type = transform_node<F, typename vector_node<Iterator>::type,
+                                value_type>;
+    static auto make(const iterator &it) -> type {
+        return {it.functor(), vector_node<Iterator>::make(it.base())};
+    }
+};
+
+template <typename... Iterators>
+struct vector_node<thrust::zip_iterator<thrust::tuple<Iterators...>>,
+                   std::enable_if_t<(vector_node<Iterators>::value && ...)>>
+  : std::true_type {
+    using iterator = thrust::zip_iterator<thrust::tuple<Iterators...>>;
+    using type     = zip_node<typename vector_node<Iterators>::type...>;
+    static auto make(const iterator &it) -> type {
+        return make(it.get_iterator_tuple(),
+                    std::index_sequence_for<Iterators...>{});
+    }
+
+   private:
+    template <std::size_t... I>
+    static auto make(const thrust::tuple<Iterators...> &its,
+                     std::index_sequence<I...> /*is*/) -> type {
+        return {thrust::make_tuple(
+          vector_node<Iterators>::make(thrust::get<I>(its))...)};
+    }
+};
+
+template <int Vec, typename Node, typename T>
+__global__ void vectorized_copy_kernel(Node node, T *out, std::int64_t n) {
+    auto const chunks = n / Vec;
+    auto const tid    = static_cast<std::int64_t>(blockIdx.x) * blockDim.x +
+                     threadIdx.x;
+    auto const stride = static_cast<std::int64_t>(gridDim.x) * blockDim.x;
+    auto *chunk_out   = reinterpret_cast<vector_chunk<T, Vec> *>(out);
+    for (auto c = tid; c < chunks; c += stride) {
+        typename Node::value_type values[Vec];
+        node.template load<Vec>(c * Vec, values);
+        vector_chunk<T, Vec> chunk;
+#pragma unroll
+        for (int k = 0; k < Vec; ++k) {
+            chunk.v[k] = static_cast<T>(values[k]);
+        }
+        chunk_out[c] = chunk;
+    }
+    // The last n % Vec (< Vec) elements, one per thread
+    if constexpr (Vec > 1) {
+        auto const i = chunks * Vec + tid;
+        if (i < n) { out[i] = static_cast<T>(node.load_one(i)); }
+    }
+}
+
+}  // namespace detail
+
+// Whether vectorized_copy can evaluate an expression of type Iterator into
+// elements of type T
+template <typename Iterator, typename T>
+inline constexpr bool is_vectorizable_v = detail::vector_node<
+                                            Iterator>::value &&
+                                          detail::is_vector_leaf_v<T> &&
+                                          16 % sizeof(T) == 0;
 
-    // Free temp storage
-    cudaFree(d_temp_storage);
+// Evaluates out[i] = first[i] for i in [0, n) with one vectorized kernel.
+// Returns false without launching anything if the expression is not
+// vectorizable (see is_vectorizable_v) or one of its pointers, or out, is not
+// aligned to a chunk; the caller then falls back to thrust::copy.
+template <typename Iterator, typename T>
+auto vectorized_copy(Iterator first,
+                     std::int64_t n,
+                     T *out,
+                     cudaStream_t stream = nullptr) -> bool {
+    if constexpr (!is_vectorizable_v<Iterator, T>) {
+        return false;
+    } else {
+        constexpr int vec = static_cast<int>(16 / sizeof(T));
+        using node_type   = typename detail::vector_node<Iterator>::type;
+        node_type const node = detail::vector_node<Iterator>::make(first);
+        if (!node.template aligned<vec>() ||
+            !detail::is_chunk_aligned<T, vec>(out)) {
+            return false;
+        }
+        if (n == 0) { return true; }
+        int const threads = 256;
+        auto const blocks = std::clamp<std::int64_t>(
+          (n / vec + threads - 1) / threads,
+          1,
+          detail::multiprocessor_count() * 8);
+        detail::vectorized_copy_kernel<vec>
+          <<<static_cast<unsigned int>(blocks), threads, 0, stream>>>(
+            node, out, n);
+        detail::throw_on_launch_error("vectorized_copy");
+        return true;
+    }
 }
 
 // Cycle functor for cycling through indices
 struct cycle_functor {
-    int n;
-    explicit cycle_functor(int n) : n(n) {}
-    __host__ __device__ auto operator()(int i) const -> int { return i % n; }
+    index_t n;
+    explicit cycle_functor(index_t n) : n(n) {}
+    __host__ __device__ auto operator()(index_t i) const -> index_t {
+        return i % n;
+    }
 };
 
 // Direct cycle functor that avoids permutation iterator overhead
@@ -102,11 +2605,11 @@ struct cycle_functor {
 template <typename Iterator>
 struct direct_cycle_functor {
     Iterator begin;
-    int n;
+    index_t n;
 
-    direct_cycle_functor(Iterator begin, int n) : begin(begin), n(n) {}
+    direct_cycle_functor(Iterator begin, index_t n) : begin(begin), n(n) {}
 
-    __host__ __device__ auto operator()(int i) const ->
+    __host__ __device__ auto operator()(index_t i) const ->
       typename cuda::std::iterator_traits<Iterator>::value_type {
         return begin[i % n];
     }
@@ -115,8 +2618,8 @@ struct direct_cycle_functor {
 // Helper function to create a cycle iterator (optimized version using
 // direct_cycle_functor)
 template <typename Iterator>
-auto make_cycle_iterator(Iterator begin, int n) {
-    auto counting = thrust::make_counting_iterator<int>(0);
+auto make_cycle_iterator(Iterator begin, index_t n) {
+    auto counting = thrust::make_counting_iterator<index_t>(0);
     return thrust::make_transform_iterator(
       counting, direct_cycle_functor<Iterator>(begin, n));
 }
@@ -124,15 +2627,15 @@ auto make_cycle_iterator(Iterator begin, int n) {
 // Legacy helper function to create a cycle iterator (compatible with old code)
 // This creates a permutation iterator like the original implementation
 template <typename Iterator>
-auto make_cycle_iterator_permutation(Iterator begin, int n) {
-    auto a = thrust::make_counting_iterator<int>(0);
+auto make_cycle_iterator_permutation(Iterator begin, index_t n) {
+    auto a = thrust::make_counting_iterator<index_t>(0);
     auto b = thrust::make_transform_iterator(a, cycle_functor(n));
     return thrust::make_permutation_iterator(begin, b);
 }
 
 // Helper function to create a cycle functor
 template <typename Iterator>
-auto make_cycle_functor(Iterator begin, int n) {
+auto make_cycle_functor(Iterator begin, index_t n) {
     return direct_cycle_functor<Iterator>(begin, n);
 }
 
@@ -140,13 +2643,13 @@ auto make_cycle_functor(Iterator begin, int n) {
 template <typename Iterator, typename T>
 struct append_functor {
     Iterator _begin;
-    int _size;
+    index_t _size;
     T _value;
 
-    append_functor(Iterator begin, int size, T value)
+    append_functor(Iterator begin, index_t size, T value)
       : _begin(begin), _size(size), _value(value) {}
 
-    __host__ __device__ auto operator()(const int &idx) const -> T {
+    __host__ __device__ auto operator()(const index_t &idx) const -> T {
         if (idx < _size) { return _begin[idx]; }
         return _value;
     }
@@ -156,13 +2659,13 @@ struct append_functor {
 template <typename Iterator, typename T>
 struct prepend_functor {
     Iterator _begin;
-    int _size;
+    index_t _size;
     T _value;
 
-    prepend_functor(Iterator begin, int size, T value)
+    prepend_functor(Iterator begin, index_t size, T value)
       : _begin(begin), _size(size), _value(value) {}
 
-    __host__ __device__ auto operator()(const int &idx) const -> T {
+    __host__ __device__ auto operator()(const index_t &idx) const -> T {
         if (idx == 0) { return _value; }
         return _begin[idx - 1];
     }
@@ -170,35 +2673,37 @@ struct prepend_functor {
 
 // Helper function to create an append functor
 template <typename Iterator, typename T>
-auto make_append_functor(Iterator begin, int size, T value) {
+auto make_append_functor(Iterator begin, index_t size, T value) {
     return append_functor<Iterator, T>(begin, size, value);
 }
 
 // Helper function to create a prepend functor
 template <typename Iterator, typename T>
-auto make_prepend_functor(Iterator begin, int size, T value) {
+auto make_prepend_functor(Iterator begin, index_t size, T value) {
     return prepend_functor<Iterator, T>(begin, size, value);
 }
 
 // Helper function to create an append iterator
 template <typename Iterator, typename T>
-auto make_append_iterator(Iterator begin, int size, T value) {
+auto make_append_iterator(Iterator begin, index_t size, T value) {
     using value_type = typename cuda::std::iterator_traits<
       Iterator>::value_type;
     using AppendFunc     = append_functor<Iterator, value_type>;
     auto transform_begin = thrust::make_transform_iterator(
-      thrust::make_counting_iterator(0), AppendFunc(begin, size, value));
+      thrust::make_counting_iterator<index_t>(0),
+      AppendFunc(begin, size, value));
     return transform_begin;
 }
 
 // Helper function to create a prepend iterator
 template <typename Iterator, typename T>
-auto make_prepend_iterator(Iterator begin, int size, T value) {
+auto make_prepend_iterator(Iterator begin, index_t size, T value) {
     using value_type = typename cuda::std::iterator_traits<
       Iterator>::value_type;
     using PrependFunc    = prepend_functor<Iterator, value_type>;
     auto transform_begin = thrust::make_transform_iterator(
-      thrust::make_counting_iterator(0), PrependFunc(begin, size, value));
+      thrust::make_counting_iterator<index_t>(0),
+      PrependFunc(begin, size, value));
     return transform_begin;
 }
 
@@ -206,18 +2711,18 @@ auto make_prepend_iterator(Iterator begin, int size, T value) {
 template <typename Iterator, typename T>
 struct replicate_functor {
     Iterator _begin;
-    int _n;
+    index_t _n;
 
-    replicate_functor(Iterator begin, int n) : _begin(begin), _n(n) {}
+    replicate_functor(Iterator begin, index_t n) : _begin(begin), _n(n) {}
 
-    __host__ __device__ auto operator()(int idx) const -> T {
+    __host__ __device__ auto operator()(index_t idx) const -> T {
         return _begin[idx / _n];
     }
 };
 
 // Helper function to create a replicate functor
 template <typename Iterator>
-auto make_replicate_functor(Iterator begin, int n) {
+auto make_replicate_functor(Iterator begin, index_t n) {
     using value_type = typename cuda::std::iterator_traits<
       Iterator>::value_type;
     return replicate_functor<Iterator, value_type>(begin, n);
@@ -225,15 +2730,59 @@ auto make_replicate_functor(Iterator begin, int n) {
 
 // Helper function to create a replicate iterator
 template <typename Iterator>
-auto make_replicate_iterator(Iterator begin, int n) {
+auto make_replicate_iterator(Iterator begin, index_t n) {
     using value_type = typename cuda::std::iterator_traits<
       Iterator>::value_type;
     using ReplicateFunc  = replicate_functor<Iterator, value_type>;
     auto transform_begin = thrust::make_transform_iterator(
-      thrust::make_counting_iterator(0), ReplicateFunc(begin, n));
+      thrust::make_counting_iterator<index_t>(0), ReplicateFunc(begin, n));
     return transform_begin;
 }
 
+/**
+ * @brief Variable replicate functor: maps an output position to the element
+ * whose repeat range contains it
+ * @details ends holds the inclusive scan of the repeat counts, so element i
+ * covers [ends[i - 1], ends[i]). The source is found by an upper-bound binary
+ * search, which keeps the work per output element at O(log n) regardless of
+ * how unevenly the counts are distributed.
+ */
+template <typename Iterator, typename T>
+struct replicate_search_functor {
+    Iterator _begin;
+    const index_t *_ends;
+    index_t _n;
+
+    replicate_search_functor(Iterator begin, const index_t *ends, index_t n)
+      : _begin(begin), _ends(ends), _n(n) {}
+
+    __host__ __device__ auto operator()(index_t idx) const -> T {
+        index_t lo = 0;
+        index_t hi = _n;
+        while (lo < hi) {
+            index_t const mid = lo + (hi - lo) / 2;
+            if (_ends[mid] <= idx) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return _begin[lo];
+    }
+};
+
+// Helper function to create a variable replicate iterator
+template <typename Iterator>
+auto make_replicate_search_iterator(Iterator begin,
+                                    const index_t *ends,
+                                    index_t n) {
+    using value_type = typename cuda::std::iterator_traits<
+      Iterator>::value_type;
+    using SearchFunc = replicate_search_functor<Iterator, value_type>;
+    return thrust::make_transform_iterator(
+      thrust::make_counting_iterator<index_t>(0), SearchFunc(begin, ends, n));
+}
+
 /**
  * @brief Direct outer product functor (avoids cycle overhead)
  */
@@ -241,30 +2790,36 @@ template <typename Iterator1, typename Iterator2, typename BinaryOp>
 struct direct_outer_functor {
     Iterator1 begin1;
     Iterator2 begin2;
-    int size1, size2;
+    index_t size1, size2;
     BinaryOp binary_op;
 
-    direct_outer_functor(
-      Iterator1 begin1, Iterator2 begin2, int size1, int size2, BinaryOp op)
+    direct_outer_functor(Iterator1 begin1,
+                         Iterator2 begin2,
+                         index_t size1,
+                         index_t size2,
+                         BinaryOp op)
       : begin1(begin1),
         begin2(begin2),
         size1(size1),
         size2(size2),
         binary_op(op) {}
 
-    __host__ __device__ auto operator()(int linear_idx) const
+    __host__ __device__ auto operator()(index_t linear_idx) const
       -> decltype(binary_op(*begin1, *begin2)) {
-        int row = linear_idx / size2;
-        int col = linear_idx % size2;
+        index_t row = linear_idx / size2;
+        index_t col = linear_idx % size2;
         return binary_op(begin1[row], begin2[col]);
     }
 };
 
 // Helper function to create an outer product iterator
 template <typename Iterator1, typename Iterator2, typename BinaryOp>
-auto make_outer_iterator(
-  Iterator1 begin1, Iterator2 begin2, int size1, int size2, BinaryOp op) {
-    auto counting = thrust::make_counting_iterator<int>(0);
+auto make_outer_iterator(Iterator1 begin1,
+                         Iterator2 begin2,
+                         index_t size1,
+                         index_t size2,
+                         BinaryOp op) {
+    auto counting = thrust::make_counting_iterator<index_t>(0);
     return thrust::make_transform_iterator(
       counting,
       direct_outer_functor<Iterator1, Iterator2, BinaryOp>(
@@ -279,12 +2834,30 @@ template <typename InputIterator,
 void reduce_by_n(InputIterator first,
                  InputIterator last,
                  OutputIterator out,
-                 int N,
+                 index_t N,
                  BinaryOp op,
                  T init) {
     reduce_by_n_impl(first, last, out, N, op, init);
 }
 
+// Overload that draws CUB temporary storage from a caller-supplied allocator
+// and enqueues the reduction on the given stream (no synchronization)
+template <typename InputIterator,
+          typename OutputIterator,
+          typename BinaryOp,
+          typename T,
+          typename TempAllocator>
+void reduce_by_n(InputIterator first,
+                 InputIterator last,
+                 OutputIterator out,
+                 index_t N,
+                 BinaryOp op,
+                 T init,
+                 TempAllocator alloc,
+                 cudaStream_t stream = nullptr) {
+    reduce_by_n_impl(first, last, out, N, op, init, alloc, stream);
+}
+
 // Backward compatibility overload (uses default initialization)
 template <typename InputIterator, typename OutputIterator, typename BinaryOp>
 void reduce_by_n(InputIterator first,